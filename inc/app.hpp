@@ -4,16 +4,75 @@
 #include "store.hpp"
 #include "grid.hpp"
 #include "scene.hpp"
+#include "threadpool.hpp"
+
+#include <vector>
+#include <future>
+#include <functional>
 
 namespace mini {
 	class application : public application_base {
+		public:
+			// time per frame spent creating gl objects for finished loads
+			static constexpr double UPLOAD_BUDGET = 0.004;
+
+			// resident gpu memory past which the store drops what no scene holds on to
+			static constexpr std::size_t RESOURCE_BUDGET = 128ULL << 20;
+
+			// resident gpu memory scenes that are not showing may hold on to, what the showing
+			// scene or the requested one also uses is not counted, as it stays resident anyway
+			static constexpr std::size_t SCENE_POOL_BUDGET = 96ULL << 20;
+
+			// workers building the cpu side of requested scenes, a request that was superseded
+			// keeps its worker until the job is done
+			static constexpr std::size_t PREPARE_THREADS = 2;
+
+		private:
+			enum class scene_id_t {
+				none,
+				spring,
+				top,
+				rotation,
+				soft,
+				ik,
+				puma,
+				flywheel,
+				blackhole
+			};
+
+			// a scene that is not showing, it is not integrated so its simulation stands still,
+			// and it keeps the camera and clear color it had set on the context
+			struct pooled_scene_t {
+				scene_id_t id;
+				std::unique_ptr<scene_base> scene;
+				resource_manifest_t manifest;
+				std::unique_ptr<camera> saved_camera;
+				glm::vec3 clear_color;
+			};
+
 		private:
 			std::unique_ptr<scene_base> m_scene;
+			resource_manifest_t m_scene_manifest;
+			scene_id_t m_scene_id;
 			bool m_layout_ready;
 
+			// most recently shown first
+			std::vector<pooled_scene_t> m_pool;
+
+			// a requested scene is built once the loads its manifest names have come through
+			std::function<std::unique_ptr<scene_base>()> m_next_scene;
+			resource_manifest_t m_next_manifest;
+			scene_id_t m_next_scene_id;
+
+			// cpu work the requested scene is built from, it runs on the workers meanwhile
+			std::shared_future<void> m_next_job;
+
 			app_context m_context;
 			resource_store m_store;
 
+			// declared last so a job still running finishes before the rest goes away
+			thread_pool m_workers;
+
 		public:
 			application();
 
@@ -36,6 +95,19 @@ namespace mini {
 		private:
 			void m_draw_main_menu();
 			void m_draw_main_window();
+			void m_draw_loading_window();
+
+			// the job is only started when the scene is built anew rather than taken from the pool
+			void m_request_scene(scene_id_t id, const resource_manifest_t& manifest, 
+				std::function<std::unique_ptr<scene_base>()> factory, std::function<void()> job = nullptr);
+			void m_poll_next_scene();
+
+			// for scenes with a prepare step, the factory takes what the job left behind
+			template<typename T> void m_request_prepared_scene(scene_id_t id);
+
+			void m_suspend_scene();
+			void m_trim_pool();
+			std::size_t m_get_pooled_bytes() const;
 
 			void m_load_scene_spring();
 			void m_load_scene_top();
@@ -1,20 +1,35 @@
 #pragma once
 #include <functional>
 #include <optional>
+#include <memory>
 
 #include "context.hpp"
 #include "shader.hpp"
 #include "cubemap.hpp"
+#include "deflection.hpp"
 
 namespace mini {
+	// the sky is traced into offscreen targets: at a reduced resolution while the view changes,
+	// then refined with jittered full resolution samples averaged until it converges
 	class black_hole_quad : public graphics_object {
 		private:
+			static constexpr int PREVIEW = 0;
+			static constexpr int ACCUMULATION = 1;
+
 			std::shared_ptr<shader_program> m_program;
 			std::shared_ptr<cubemap> m_cubemap;
+			std::unique_ptr<shader_program> m_present_program;
 
-			GLuint m_vao, m_pos_buffer;
+			GLuint m_vao, m_pos_buffer, m_deflection_texture;
 			float m_distance, m_star_mass;
 
+			GLuint m_target_fbo[2], m_target_texture[2];
+			int m_target_width[2], m_target_height[2];
+
+			glm::mat4x4 m_last_world;
+			int m_preview_scale, m_max_samples, m_num_samples, m_active_target;
+			bool m_restart;
+
 		public:
 			black_hole_quad(std::shared_ptr<shader_program> program, std::shared_ptr<cubemap> cubemap);
 			~black_hole_quad();
@@ -28,8 +43,25 @@ namespace mini {
 			void set_star_mass(float star_mass);
 			void set_distance(float distance);
 
+			int get_preview_scale() const;
+			int get_max_samples() const;
+			int get_num_samples() const;
+			bool is_converged() const;
+
+			void set_preview_scale(int scale);
+			void set_max_samples(int samples);
+
 			void set_cube_map(std::shared_ptr<cubemap> cubemap);
+			void set_deflection_table(const deflection_table& table);
+
+			// traces the next pass into the offscreen targets, called once per frame before
+			// the quad is drawn, nothing is traced once the image has converged
+			void refine(const glm::mat4x4& world_matrix, const video_mode_t& video_mode);
 			
 			virtual void render(app_context& context, const glm::mat4x4& world_matrix) const override;
+
+		private:
+			void m_resize_target(int target, int width, int height);
+			void m_trace(int target, const glm::vec2& resolution, const glm::vec2& jitter, float weight);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "cubemap.hpp"
+#include "deflection.hpp"
+#include "threadpool.hpp"
+
+namespace mini {
+	// cpu version of fs_blackhole.glsl for reference images, regression checks and throughput
+	// numbers on machines without a gpu
+	class black_hole_renderer {
+		public:
+			static constexpr int TILE_SIZE = 32;
+
+			struct view_t {
+				int width, height;
+				glm::mat4x4 world;
+				float distance, star_mass;
+			};
+
+			struct stats_t {
+				double seconds;
+				double rays_per_second;
+			};
+
+		private:
+			const deflection_table& m_deflection;
+			std::shared_ptr<const cubemap_image> m_sky;
+
+		public:
+			black_hole_renderer(const deflection_table& deflection, std::shared_ptr<const cubemap_image> sky);
+
+			// rgba pixels, rows are ordered like the viewport shows them
+			std::vector<std::uint8_t> render(thread_pool& pool, const view_t& view, stats_t* stats = nullptr) const;
+
+			static void save_png(const std::string& path, const std::vector<std::uint8_t>& pixels, int width, int height);
+			static std::vector<std::uint8_t> load_png(const std::string& path, int& width, int& height);
+
+			// program --render-blackhole out.png [--width w] [--height h] [--mass m] [--distance d] [--yaw a]
+			// [--pitch a] [--cubemap dir] [--repeat n] [--reference ref.png] [--tolerance t]
+			static int run_headless(int argc, char** argv);
+
+		private:
+			void m_render_tile(const view_t& view, int x0, int y0, int x1, int y1, std::uint8_t* pixels) const;
+	};
+}
\ No newline at end of file
@@ -4,8 +4,12 @@
 #include <array>
 #include <memory>
 #include <vector>
+#include <string>
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texcache.hpp"
 
 namespace mini {
     enum CUBEMAP_SIDE {
@@ -27,12 +31,31 @@ namespace mini {
         std::array<cubemap_side_info, 6> sides;
     };
 
+    // decoded rgba faces kept on the cpu, sampled the way a GL_LINEAR cube map without seamless
+    // filtering is, so cpu renders match the shader
+    class cubemap_image {
+        private:
+            std::array<std::vector<unsigned char>, 6> m_faces;
+            std::array<uint32_t, 6> m_widths, m_heights;
+
+        public:
+            cubemap_image();
+            cubemap_image(const std::array<std::string, 6>& sides);
+
+            // faces are independent, so they can be decoded by different threads
+            void load_side(std::size_t side, const std::string& path);
+
+            cubemap_info get_info();
+            glm::vec3 sample(const glm::vec3& direction) const;
+    };
+
     class cubemap {
         private:
             GLuint m_handle;
 
         public:
             cubemap(const cubemap_info& info);
+            cubemap(const std::array<std::shared_ptr<const baked_image>, 6>& faces);
             ~cubemap();
 
             cubemap(const cubemap&) = delete;
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include "threadpool.hpp"
+
+namespace mini {
+	// angle swept by a light ray passing a schwarzschild mass M at impact parameter b. in units
+	// of b it only depends on beta = M / b, so one table serves every mass. rays with beta above
+	// 1 / sqrt(27) are captured. the table is sampled at x = -ln(1 - beta / beta_c) / LOG_RANGE,
+	// which resolves the logarithmic growth of the angle next to the photon sphere
+	class deflection_table {
+		public:
+			static constexpr std::size_t DEFAULT_SIZE = 4096;
+			static constexpr double LOG_RANGE = 16.0;
+
+		private:
+			std::vector<float> m_angles;
+
+		public:
+			deflection_table(thread_pool& pool, std::size_t size = DEFAULT_SIZE);
+
+			const std::vector<float>& get_angles() const;
+			std::size_t get_size() const;
+
+			// linear lookup matching the shader, beta must be below the critical value
+			float sample(double beta) const;
+
+			static double critical_beta();
+			static double beta_at(double x);
+			static double coordinate_of(double beta);
+
+			static double turning_point(double beta);
+			static double angle(double beta, double tolerance = 1e-10);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <complex>
+#include <vector>
+
+namespace mini {
+	using complex_t = std::complex<float>;
+
+	// fourier transform of a fixed size, the size is split into factors of 4, 2, 3 and 5
+	// and whatever prime is left is done as a plain dft of that length
+	class fft_plan final {
+		private:
+			std::size_t m_size;
+			std::vector<std::size_t> m_factors;
+			std::vector<complex_t> m_twiddles;
+
+		public:
+			fft_plan(std::size_t size = 1);
+
+			std::size_t size() const;
+			void forward(const complex_t* input, complex_t* output) const;
+
+		private:
+			void m_transform(const complex_t* input, complex_t* output, std::size_t stride, std::size_t factor) const;
+	};
+
+	// transform of real samples giving size / 2 + 1 bins, an even size is done as a
+	// complex transform of half the size with the samples packed in pairs
+	class real_fft final {
+		private:
+			std::size_t m_size;
+			fft_plan m_plan;
+			std::vector<complex_t> m_twiddles;
+			mutable std::vector<complex_t> m_packed, m_spectrum;
+
+		public:
+			real_fft(std::size_t size = 2);
+
+			std::size_t size() const;
+			std::size_t num_bins() const;
+			void forward(const float* input, complex_t* output) const;
+	};
+
+	// welch averaged power spectrum of an endless series, samples are pushed one by one and
+	// only the current window is kept, every hop samples a hann windowed transform is added
+	class spectrum_stream final {
+		private:
+			std::size_t m_window_size, m_hop;
+			real_fft m_fft;
+
+			std::vector<float> m_window;
+			std::vector<float> m_history;
+			std::vector<float> m_frame;
+			std::vector<complex_t> m_bins;
+			std::vector<double> m_power_sum;
+
+			std::size_t m_position, m_num_samples, m_num_windows;
+			double m_window_norm;
+
+		public:
+			spectrum_stream();
+
+			void configure(std::size_t window_size, std::size_t hop);
+			void reset();
+			void push(float sample);
+
+			std::size_t get_window_size() const;
+			std::size_t get_num_windows() const;
+
+			// one sided amplitude per bin, a sine of amplitude a shows up as a at its bin
+			void amplitude(std::vector<float>& result) const;
+	};
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace mini {
+	// four floats processed together, sse2 when the target has it and plain loops otherwise
+	struct lane4_t {
+#if defined(__SSE2__) || defined(_M_X64)
+		__m128 v;
+
+		static lane4_t load(const float* data) { return { _mm_loadu_ps(data) }; }
+		static lane4_t set(float value) { return { _mm_set1_ps(value) }; }
+		void store(float* data) const { _mm_storeu_ps(data, v); }
+
+		friend lane4_t operator+(const lane4_t& a, const lane4_t& b) { return { _mm_add_ps(a.v, b.v) }; }
+		friend lane4_t operator-(const lane4_t& a, const lane4_t& b) { return { _mm_sub_ps(a.v, b.v) }; }
+		friend lane4_t operator*(const lane4_t& a, const lane4_t& b) { return { _mm_mul_ps(a.v, b.v) }; }
+		friend lane4_t operator/(const lane4_t& a, const lane4_t& b) { return { _mm_div_ps(a.v, b.v) }; }
+
+		static lane4_t sqrt(const lane4_t& x) { return { _mm_sqrt_ps(x.v) }; }
+
+		// x = y + k * pi with y in [-pi/2, pi/2], the sign is (-1)^k
+		static void reduce_pi(const lane4_t& x, lane4_t& y, lane4_t& sign) {
+			const __m128i k = _mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(0.318309886f)));
+			const __m128 kf = _mm_cvtepi32_ps(k);
+
+			y.v = _mm_sub_ps(x.v, _mm_mul_ps(kf, _mm_set1_ps(3.14159274f)));
+			y.v = _mm_add_ps(y.v, _mm_mul_ps(kf, _mm_set1_ps(8.74227766e-8f)));
+			sign.v = _mm_xor_ps(_mm_set1_ps(1.0f), _mm_castsi128_ps(_mm_slli_epi32(k, 31)));
+		}
+#else
+		float v[4];
+
+		static lane4_t load(const float* data) { return { { data[0], data[1], data[2], data[3] } }; }
+		static lane4_t set(float value) { return { { value, value, value, value } }; }
+		void store(float* data) const { std::copy(v, v + 4, data); }
+
+		friend lane4_t operator+(const lane4_t& a, const lane4_t& b) { 
+			return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; 
+		}
+
+		friend lane4_t operator-(const lane4_t& a, const lane4_t& b) { 
+			return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; 
+		}
+
+		friend lane4_t operator*(const lane4_t& a, const lane4_t& b) { 
+			return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; 
+		}
+
+		friend lane4_t operator/(const lane4_t& a, const lane4_t& b) { 
+			return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; 
+		}
+
+		static lane4_t sqrt(const lane4_t& x) {
+			return { { std::sqrt(x.v[0]), std::sqrt(x.v[1]), std::sqrt(x.v[2]), std::sqrt(x.v[3]) } };
+		}
+
+		// x = y + k * pi with y in [-pi/2, pi/2], the sign is (-1)^k
+		static void reduce_pi(const lane4_t& x, lane4_t& y, lane4_t& sign) {
+			for (int i = 0; i < 4; ++i) {
+				const float k = std::nearbyint(x.v[i] * 0.318309886f);
+				y.v[i] = (x.v[i] - k * 3.14159274f) + k * 8.74227766e-8f;
+				sign.v[i] = (static_cast<int>(k) & 1) ? -1.0f : 1.0f;
+			}
+		}
+#endif
+	};
+
+	inline void lane_sincos(const lane4_t& x, lane4_t& s, lane4_t& c) {
+		lane4_t y, sign;
+		lane4_t::reduce_pi(x, y, sign);
+
+		// taylor series are accurate to float precision on [-pi/2, pi/2]
+		const auto z = y * y;
+		const auto set = lane4_t::set;
+
+		s = set(-1.0f / 39916800.0f);
+		s = set(1.0f / 362880.0f) + z * s;
+		s = set(-1.0f / 5040.0f) + z * s;
+		s = set(1.0f / 120.0f) + z * s;
+		s = set(-1.0f / 6.0f) + z * s;
+		s = sign * y * (set(1.0f) + z * s);
+
+		c = set(1.0f / 479001600.0f);
+		c = set(-1.0f / 3628800.0f) + z * c;
+		c = set(1.0f / 40320.0f) + z * c;
+		c = set(-1.0f / 720.0f) + z * c;
+		c = set(1.0f / 24.0f) + z * c;
+		c = set(-0.5f) + z * c;
+		c = sign * (set(1.0f) + z * c);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace mini {
+	// read only view of a whole file, memory mapped where the platform supports it
+	class mapped_file {
+		private:
+			const unsigned char* m_data;
+			std::size_t m_size;
+
+			void* m_file_handle;
+			void* m_map_handle;
+			std::vector<unsigned char> m_fallback;
+
+		public:
+			mapped_file(const std::string& path);
+			~mapped_file();
+
+			mapped_file(const mapped_file&) = delete;
+			mapped_file& operator=(const mapped_file&) = delete;
+
+			const unsigned char* get_data() const;
+			std::size_t get_size() const;
+	};
+}
\ No newline at end of file
@@ -11,23 +11,55 @@ namespace fs = std::filesystem;
 
 namespace mini {
 	class triangle_mesh {
+		public:
+			static constexpr uint32_t BINARY_MAGIC = 0x534d4653; // "SFMS"
+			static constexpr uint32_t BINARY_VERSION = 3;
+
+			// largest screen space error a level of detail may show
+			static constexpr float LOD_ERROR_PIXELS = 1.0f;
+
+			// interleaved, this is also the record layout of the binary format
+			struct vertex_t {
+				glm::vec3 position;
+				glm::vec3 normal;
+				glm::vec2 uv;
+			};
+
+			// a range of the index buffer, error is the farthest the level strays from the
+			// full mesh in model units, all levels share the vertex buffer
+			struct lod_t {
+				uint32_t first_index;
+				uint32_t num_indices;
+				float error;
+			};
+
+			// cpu side of a mesh, can be produced off the gl thread, no lods means the
+			// indices are one full detail level
+			struct mesh_data_t {
+				std::vector<vertex_t> vertices;
+				std::vector<uint32_t> indices;
+				std::vector<lod_t> lods;
+			};
+
 		private:
-			std::vector<float> m_positions;
-			std::vector<float> m_normals;
-			std::vector<float> m_uvs;
+			std::vector<vertex_t> m_vertices;
 			std::vector<uint32_t> m_indices;
+			std::vector<lod_t> m_lods;
+
+			glm::vec3 m_bounds_center;
+			float m_bounds_radius;
 
 			GLuint m_array_object;
-			GLuint m_position_buffer;
-			GLuint m_normal_buffer;
-			GLuint m_uv_buffer;
+			GLuint m_vertex_buffer;
 			GLuint m_index_buffer;
 
 		public:
-			const std::vector<float>& get_positions() const;
-			const std::vector<float>& get_normals() const;
-			const std::vector<float>& get_uvs() const;
+			const std::vector<vertex_t>& get_vertices() const;
 			const std::vector<uint32_t>& get_indices() const;
+			const std::vector<lod_t>& get_lods() const;
+
+			const glm::vec3& get_bounds_center() const;
+			float get_bounds_radius() const;
 
 			triangle_mesh(
 				const std::vector<float>& positions, 
@@ -35,19 +67,44 @@ namespace mini {
 				const std::vector<float>& uvs,
 				const std::vector<uint32_t>& indices);
 
+			triangle_mesh(mesh_data_t data);
+
 			~triangle_mesh();
 
 			triangle_mesh(const triangle_mesh&);
 			triangle_mesh& operator= (const triangle_mesh&);
 
-			void draw();
+			void draw(std::size_t lod = 0);
+
+			// coarsest level whose error stays below max_error pixels when one model unit
+			// covers pixels_per_unit pixels
+			std::size_t select_lod(float pixels_per_unit, float max_error = LOD_ERROR_PIXELS) const;
+
+			// pixels covered by one unit at the given view space depth
+			static float get_pixels_per_unit(const glm::mat4x4& projection, float viewport_height, float depth);
 
 		private:
 			void m_initialize();
+			void m_compute_bounds();
 			void m_destroy();
 
 		public:
+			// .obj is read as wavefront, .mesh as the binary format, anything else as the
+			// vertex count, index count, vertices and indices text layout of meshes/duck.txt
+			static mesh_data_t read_data_from_file(const fs::path& path);
+
+			// transforms the file and runs it through mesh_optimizer unless it carries lods,
+			// needs no gl so it can run on a worker ahead of the upload
+			static mesh_data_t read_data_from_file(const fs::path& path, const glm::vec3& offset, const glm::vec3& scale);
 			static std::shared_ptr<triangle_mesh> read_from_file(const fs::path& path, const glm::vec3& offset, const glm::vec3& scale);
+
+			// the binary format is the header followed by the raw vertex, index and lod arrays,
+			// so reading it back is a single copy per array
+			static void write_data_to_file(const fs::path& path, const mesh_data_t& data);
+
+			// optimizes any readable mesh and stores it in the binary format
+			static int run_headless(int argc, char** argv);
+
 			static std::shared_ptr<triangle_mesh> make_plane_mesh();
 			static std::shared_ptr<triangle_mesh> make_plane_mesh_front();
 			static std::shared_ptr<triangle_mesh> make_plane_mesh_back();
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "mesh.hpp"
+
+namespace mini {
+	// preprocessing of indexed triangle lists before they go to the gpu
+	class mesh_optimizer {
+		public:
+			using vertex_t = triangle_mesh::vertex_t;
+			using mesh_data_t = triangle_mesh::mesh_data_t;
+
+			static constexpr std::size_t CACHE_SIZE = 16;
+			static constexpr std::size_t MAX_LODS = 8;
+			static constexpr std::size_t MIN_LOD_TRIANGLES = 64;
+			static constexpr float LOD_RATIO = 0.5f;
+
+		public:
+			// welds duplicates, orders triangles for the post transform cache, builds the lod
+			// chain and orders vertices by first use, meshes that already have lods are kept
+			static void optimize(mesh_data_t& data);
+
+			// merges bitwise identical vertices
+			static void deduplicate(mesh_data_t& data);
+
+			// tipsify, sander et al. 2007, runs in linear time
+			static void optimize_vertex_cache(std::vector<uint32_t>& indices, std::size_t num_vertices);
+
+			// renumbers vertices in the order the indices first use them and drops unused ones
+			static void optimize_vertex_fetch(mesh_data_t& data);
+
+			// quadric error edge collapse, every collapse keeps one of its two vertices so the
+			// result indexes the same vertex array, error is the farthest a removed vertex lies
+			// from the simplified surface around the vertex it was collapsed into
+			static std::vector<uint32_t> simplify(
+				const std::vector<vertex_t>& vertices,
+				const std::vector<uint32_t>& indices,
+				std::size_t target_triangles,
+				float& error
+			);
+
+			// transformed vertices per triangle for a fifo cache, 0.5 is the ideal on large grids
+			static float average_cache_miss_ratio(const std::vector<uint32_t>& indices, std::size_t num_vertices);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <glad/glad.h>
+
+#include "context.hpp"
+#include "shader.hpp"
+
+namespace mini {
+	// many screen space points drawn with a single instanced call, every point carries
+	// its own position and color
+	class point_cloud : public graphics_object {
+		private:
+			GLuint m_vao, m_quad_buffer, m_instance_buffer;
+			std::shared_ptr<shader_program> m_shader;
+
+			// center and color of every point, 7 floats each
+			std::vector<float> m_instances;
+			std::size_t m_num_points;
+
+			float m_point_size;
+			bool m_ready;
+
+		public:
+			point_cloud(std::shared_ptr<shader_program> shader);
+			~point_cloud();
+
+			point_cloud(const point_cloud&) = delete;
+			point_cloud& operator=(const point_cloud&) = delete;
+
+			float get_point_size() const;
+			void set_point_size(float size);
+
+			std::size_t get_num_points() const;
+
+			void clear();
+			void add_point(const glm::vec3& position, const glm::vec4& color);
+			void rebuild_buffers();
+
+			virtual void render(app_context& context, const glm::mat4x4& world_matrix) const override;
+
+		private:
+			void m_free_buffers();
+	};
+}
\ No newline at end of file
@@ -1,21 +1,47 @@
 #pragma once
 #include "scene.hpp"
+#include "store.hpp"
 #include "cubemap.hpp"
 #include "bhquad.hpp"
+#include "threadpool.hpp"
+#include "deflection.hpp"
+#include "bhrender.hpp"
+
+#include <future>
 
 namespace mini {
 	class black_hole_scene : public scene_base {
 		private:
 			std::vector<std::pair<std::string, std::shared_ptr<cubemap>>> m_cubemaps;
+			std::vector<std::array<std::string, 6>> m_cubemap_files;
+			std::vector<cubemap_future_t> m_cubemap_requests;
 			std::shared_ptr<black_hole_quad> m_screenquad;
 
+			// the deflection only depends on M / b, so the table is built once for every mass
+			std::unique_ptr<thread_pool> m_workers;
+			deflection_table m_deflection;
+
 			int m_last_vp_width, m_last_vp_height, m_selected_map;
 			float m_cam_pitch, m_cam_yaw;
 
 			bool m_viewport_focus;
 
+			std::string m_reference_path;
+			std::string m_reference_status;
+			std::future<std::string> m_reference_task;
+
 		public:
-			black_hole_scene(application_base& app);
+			// the table takes the quadrature of every entry, it is built before the scene
+			// on the workers the scene keeps for its reference renders
+			struct prepared_t {
+				std::unique_ptr<thread_pool> workers;
+				deflection_table deflection;
+			};
+
+			static resource_manifest_t get_manifest();
+			static std::shared_ptr<prepared_t> prepare();
+
+			black_hole_scene(application_base& app, std::shared_ptr<prepared_t> prepared = nullptr);
 			~black_hole_scene();
 
 			black_hole_scene(const black_hole_scene&) = delete;
@@ -28,7 +54,15 @@ namespace mini {
 			void menu() override;
 
 		private:
+			black_hole_scene(application_base& app, prepared_t&& prepared);
+
 			void m_gui_viewport();
 			void m_gui_settings();
+
+			void m_poll_cubemaps();
+
+			glm::mat4x4 m_world_matrix() const;
+			void m_start_reference_render();
+			void m_poll_reference_render();
 	};
 }
\ No newline at end of file
@@ -3,10 +3,13 @@
 #include "curve.hpp"
 #include "grid.hpp"
 #include "segments.hpp"
+#include "threadpool.hpp"
 
 #include <array>
 #include <vector>
 #include <random>
+#include <future>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -29,6 +32,72 @@ namespace mini {
 				void clear();
 			};
 
+			struct derivative_estimate_t {
+				float time;
+				float value, first, second;
+			};
+
+			// estimates the first two derivatives of a noisy series, every method costs the
+			// same per sample no matter how long its window is
+			struct derivative_filter_t {
+				// 0 - finite differences, 1 - savitzky-golay, 2 - alpha-beta-gamma, 3 - kalman
+				int method_id;
+
+				// savitzky-golay fits a parabola over an odd window of the last samples, the
+				// window is a ring and its moments sum(y j^k) are updated instead of recomputed
+				int window;
+				std::vector<float> values, times;
+				std::size_t head, count, since_refresh;
+				double moments[3];
+
+				// tracker gains and kalman noise, the measurement noise follows the scene error
+				float alpha, beta, gamma;
+				float process_noise, measurement_noise;
+
+				bool started;
+				float last_time;
+				// kalman gains span many orders of magnitude at high rates, so the state
+				// and its covariance are kept in double precision
+				glm::dvec3 state;
+				glm::dmat3 covariance;
+
+				derivative_filter_t(int method);
+
+				void reset();
+				bool push(float time, float value, derivative_estimate_t& estimate);
+
+			private:
+				void m_refresh_moments();
+				bool m_push_difference(derivative_estimate_t& estimate) const;
+				bool m_push_savitzky_golay(derivative_estimate_t& estimate) const;
+				void m_push_tracker(float time, float value, derivative_estimate_t& estimate);
+				void m_push_kalman(float time, float value, derivative_estimate_t& estimate);
+			};
+
+			struct monte_carlo_settings_t {
+				int realizations;
+				float sample_rate, duration;
+				float wheel_radius, stick_length, flywheel_speed, eps;
+				std::uint32_t seed;
+			};
+
+			// welford accumulator, partial sums of different threads are merged with chan's formula
+			struct running_moments_t {
+				double count, mean, m2;
+
+				void add(double x);
+				void merge(const running_moments_t& other);
+				double variance() const;
+			};
+
+			// per time bin statistics of x, x' and x'' over all noise realizations
+			struct monte_carlo_result_t {
+				int realizations;
+				std::array<std::vector<float>, 3> time;
+				std::array<std::vector<float>, 3> mean, deviation, exact;
+				std::array<float, 3> mean_deviation, bias;
+			};
+
 			struct simulation_state_t {
 				float wheel_radius;
 				float stick_length;
@@ -61,6 +130,18 @@ namespace mini {
 			time_series_t m_speed_series;
 			time_series_t m_accel_series;
 			time_series_t m_hodograph;
+
+			derivative_filter_t m_speed_filter;
+			derivative_filter_t m_accel_filter;
+			int m_samples_per_frame;
+
+			monte_carlo_settings_t m_mc_settings;
+			monte_carlo_result_t m_mc_result;
+
+			// the estimate runs its realizations here, members go in reverse so the task ends first
+			thread_pool m_workers;
+			std::future<monte_carlo_result_t> m_mc_task;
+			float m_mc_band;
 		
 			int m_last_vp_width, m_last_vp_height;
 			bool m_mouse_in_viewport, m_viewport_focus;
@@ -77,6 +158,8 @@ namespace mini {
 			std::normal_distribution<float> m_distr;
 	
 		public:
+			static resource_manifest_t get_manifest();
+
 			flywheel_scene(application_base & app);
 			~flywheel_scene();
 
@@ -96,6 +179,17 @@ namespace mini {
 			void m_gui_settings();
 			void m_gui_viewport();
 			void m_gui_graphs();
+			void m_gui_filter(derivative_filter_t& filter);
+
+			void m_gui_monte_carlo();
+
+			void m_reset_series();
+
+			void m_start_monte_carlo();
+			void m_poll_monte_carlo();
+
+			static monte_carlo_result_t m_run_monte_carlo(thread_pool& workers, monte_carlo_settings_t settings, 
+				derivative_filter_t speed_filter, derivative_filter_t accel_filter);
 
 			void m_plot_series(const time_series_t& series, const std::string& name, const ImVec2& size, 
 				const float min_range_x);
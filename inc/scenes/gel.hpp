@@ -164,6 +164,8 @@ namespace mini {
 			glm::vec3 m_distort_max;
 
 		public:
+			static resource_manifest_t get_manifest();
+
 			gel_scene(application_base& app);
 			~gel_scene();
 
@@ -1,4 +1,7 @@
 #pragma once
+#include <functional>
+#include <random>
+
 #include "scene.hpp"
 #include "grid.hpp"
 #include "segments.hpp"
@@ -42,30 +45,290 @@ namespace mini {
 					size(w, h) { }
 			};
 
+			enum class planner_t {
+				bfs,
+				astar,
+				distance_field,
+				hierarchical
+			};
+
+			struct planner_settings_t {
+				planner_t planner;
+				bool diagonal;
+				bool shortcut;
+
+				planner_settings_t() :
+					planner(planner_t::bfs),
+					diagonal(true),
+					shortcut(false) { }
+			};
+
 			struct configuration_space_t {
-				std::vector<unsigned char> data;
-				std::vector<int> dist;
+				// one bit per cell, set when any obstacle blocks the cell, this is the only
+				// record of collisions, the texture is built from it
+				std::vector<uint64_t> occupancy;
+
+				// search depth painted over the space and the cells painted as the path
+				std::vector<unsigned char> depth;
+				std::vector<uint64_t> on_path;
+
+				// move codes, four bits per cell, the direction of the move that reached each
+				// cell during the last search
+				std::vector<unsigned char> parents;
+
+				// cached search tree rooted at the goal, every cell stores the move that gets it
+				// one step closer to field_goal, valid until obstacles or arm lengths change
+				std::vector<unsigned char> field;
+				int field_goal;
+				int field_dirs;
+
+				// the field's depths are what the overlay shows, clearing it for another planner
+				// means the field has to be searched again to be seen
+				bool field_painted;
+
+				// cells currently painted as the path in the texture
+				std::vector<int> path_cells;
+
+				// the sorted cells blocked by each obstacle, this lets a single obstacle be moved
+				// without touching the rest of the space, a cell it gives up stays blocked only
+				// if another footprint holds it
+				std::vector<std::vector<int>> footprints;
 
 				std::shared_ptr<mini::texture> texture;
 
 				int res_x;
 				int res_y;
 
+				// region of the texture that changed since the last upload
+				int dirty_min_x, dirty_min_y;
+				int dirty_max_x, dirty_max_y;
+				bool has_path;
+
+				// the texture is left to create_texture, which has to run on the gl thread
 				configuration_space_t(int rx, int ry);
+				configuration_space_t(configuration_space_t&&) = default;
 				configuration_space_t(configuration_space_t&) = delete;
 				configuration_space_t& operator=(const configuration_space_t&) = delete;
 
+				// the pixels come from get_pixels, which can run on any thread
+				void create_texture(std::vector<unsigned char>&& pixels);
+				std::vector<unsigned char> get_pixels() const;
+
 				bool is_collision(int x, int y) const;
-				void set_collision(int x, int y, bool collision);
+				void set_footprint(std::size_t obstacle, std::vector<int>&& cells);
+				void remove_footprint(std::size_t obstacle);
+				void clear_footprints();
+				void mark_dirty(int x, int y);
+				void mark_all_dirty();
 				void update_texture();
-				void clear_texture();
+				void clear_path();
+				void show_path(const std::vector<robot_configuration_t>& path);
 				bool find_path(
 					const robot_configuration_t& start, 
 					const robot_configuration_t& end, 
+					const planner_settings_t& settings,
 					std::vector<robot_configuration_t>& path);
+
+				private:
+					int m_config_to_cell(const robot_configuration_t& config) const;
+					robot_configuration_t m_point_to_config(const glm::vec2& point) const;
+					int m_neighbor(int index, int dir) const;
+					bool m_can_move(int index, int dir) const;
+					bool m_is_line_free(const glm::vec2& from, const glm::vec2& to) const;
+					void m_clear_overlay();
+					void m_set_path_cell(int index, bool value);
+					void m_fill_pixels(int x0, int y0, int width, int height, std::vector<unsigned char>& pixels) const;
+
+					static unsigned char m_get_code(const std::vector<unsigned char>& codes, int index);
+					static void m_set_code(std::vector<unsigned char>& codes, int index, unsigned char code);
+					void m_build_field(int goal, int num_dirs);
+					void m_search_bfs(int start, int end, int num_dirs);
+					void m_search_astar(int start, int end, int num_dirs);
+			};
+
+			enum class cell_state_t {
+				free,
+				blocked,
+				mixed
+			};
+
+			// mip pyramid over a 2^levels square configuration space, each node stores whether any
+			// and whether all of the configurations inside it collide, children are only built
+			// (and only ever read) below mixed nodes so the work follows the obstacle boundaries
+			struct occupancy_pyramid_t {
+				using classifier_t = std::function<cell_state_t(int level, int x, int y)>;
+
+				std::vector<std::vector<uint64_t>> any_blocked;
+				std::vector<std::vector<uint64_t>> all_blocked;
+
+				int levels;
+				int resolution;
+				std::size_t num_nodes;
+				bool valid;
+
+				occupancy_pyramid_t();
+
+				void build(int num_levels, const classifier_t& classify);
+				bool is_collision(int x, int y) const;
+				bool find_path(
+					const robot_configuration_t& start,
+					const robot_configuration_t& end,
+					std::vector<robot_configuration_t>& path) const;
+
+				private:
+					struct leaf_t {
+						int level, x, y;
+						bool blocked;
+					};
+
+					bool m_get_bit(const std::vector<uint64_t>& bits, int level, int x, int y) const;
+					void m_set_bit(std::vector<uint64_t>& bits, int level, int x, int y);
+					leaf_t m_find_leaf(int x, int y) const;
+					int m_config_to_cell(float theta) const;
+			};
+
+			// joint angles of a planar arm with any number of links, every angle is relative
+			// to the previous link just like theta1 and theta2 of the two link arm
+			using chain_configuration_t = std::vector<float>;
+
+			struct arm_chain_t {
+				std::vector<float> lengths;
+
+				// obstacles in arm coordinates, only the ones within reach of the arm are kept
+				std::vector<glm::vec2> box_min;
+				std::vector<glm::vec2> box_max;
+
+				int dimension() const;
+				void set_obstacles(const std::vector<obstacle_t>& obstacles);
+				void forward(const float* joints, std::vector<glm::vec2>& points) const;
+				float displacement(const float* from, const float* to) const;
+				bool collides(const float* joints) const;
+			};
+
+			// kd-tree over joint space, points are only ever appended so every point is also
+			// a node and splits cycle through the axes, distances wrap around every axis
+			struct kd_tree_t {
+				int dimension;
+
+				// subtrees are skipped unless they could hold a point this many times closer than
+				// the current k-th neighbour, 1 gives exact results
+				float approximation;
+
+				std::vector<float> points;
+				std::vector<int> left;
+				std::vector<int> right;
+
+				kd_tree_t();
+
+				void clear(int dim);
+				int insert(const float* point);
+				void remove_last();
+				int size() const;
+				const float* point(int index) const;
+				int nearest(const float* query) const;
+				void k_nearest(const float* query, int k, std::vector<int>& result) const;
+
+				private:
+					struct search_t {
+						const float* query;
+						std::size_t k;
+
+						// per axis lower bounds on the distance to the current subtree
+						std::vector<float> offsets;
+						std::vector<std::pair<float, int>> heap;
+					};
+
+					void m_search(int node, int depth, float bound, search_t& search) const;
+			};
+
+			enum class sampler_t {
+				rrt_connect,
+				lazy_prm
+			};
+
+			struct sampling_settings_t {
+				sampler_t sampler;
+				int max_samples;
+				int neighbors;
+				float range;
+
+				// largest distance any point of the arm may move between two collision checks
+				float resolution;
+				bool shortcut;
+
+				sampling_settings_t() :
+					sampler(sampler_t::rrt_connect),
+					max_samples(20000),
+					neighbors(10),
+					range(0.5f),
+					resolution(0.05f),
+					shortcut(true) { }
+			};
+
+			// sampling based planner for arm_chain_t, the lazy prm roadmap is kept between
+			// queries and only rebuilt after reset, i.e. when the arm or obstacles change
+			struct sampling_planner_t {
+				arm_chain_t chain;
+
+				kd_tree_t roadmap;
+				std::vector<std::vector<int>> adjacency;
+				std::vector<int> edge_from;
+				std::vector<int> edge_to;
+				std::vector<float> edge_length;
+				std::vector<unsigned char> edge_state;
+
+				std::mt19937 random;
+				std::size_t num_samples;
+				std::size_t num_checks;
+
+				sampling_planner_t();
+
+				void reset(std::vector<float>&& lengths, const std::vector<obstacle_t>& obstacles);
+				bool find_path(
+					const chain_configuration_t& start,
+					const chain_configuration_t& end,
+					const sampling_settings_t& settings,
+					std::vector<chain_configuration_t>& path);
+
+				private:
+					void m_sample(float* out);
+					void m_steer(const float* from, const float* to, float range, float* out) const;
+					bool m_is_edge_free(const float* from, const float* to, float resolution);
+					void m_check_edges(const std::vector<int>& edges, float resolution);
+					int m_add_vertex(const float* joints, int neighbors);
+					void m_remove_last_vertex();
+					bool m_rrt_connect(
+						const chain_configuration_t& start,
+						const chain_configuration_t& end,
+						const sampling_settings_t& settings,
+						std::vector<chain_configuration_t>& path);
+					bool m_lazy_prm(
+						const chain_configuration_t& start,
+						const chain_configuration_t& end,
+						const sampling_settings_t& settings,
+						std::vector<chain_configuration_t>& path);
+					void m_shortcut(std::vector<chain_configuration_t>& path, float resolution);
+					void m_densify(std::vector<chain_configuration_t>& path, float resolution) const;
 			};
 
 			configuration_space_t m_conf;
+			occupancy_pyramid_t m_pyramid;
+			planner_settings_t m_planner;
+			int m_planner_id;
+			int m_pyramid_levels;
+
+			sampling_planner_t m_sampler;
+			sampling_settings_t m_sampling;
+			int m_sampler_id;
+
+			bool m_chain_mode;
+			int m_chain_links;
+			float m_chain_link_len;
+
+			chain_configuration_t m_chain_start;
+			chain_configuration_t m_chain_current;
+			chain_configuration_t m_chain_end;
+			std::vector<chain_configuration_t> m_chain_path;
 
 			float m_arm1_len;
 			float m_arm2_len;
@@ -82,6 +345,8 @@ namespace mini {
 			bool m_is_start_collision, m_is_end_collision;
 			bool m_show_path_error;
 			bool m_loop_animation;
+			bool m_live_replanning;
+			bool m_is_dragging_start;
 
 			offset_t m_vp_mouse_offset;
 			glm::vec2 m_start_point, m_end_point;
@@ -91,6 +356,9 @@ namespace mini {
 			std::shared_ptr<segments_array> m_robot_arm_start;
 			std::shared_ptr<segments_array> m_robot_arm_end;
 			std::shared_ptr<segments_array> m_robot_arm_curr;
+			std::shared_ptr<segments_array> m_chain_arm_start;
+			std::shared_ptr<segments_array> m_chain_arm_end;
+			std::shared_ptr<segments_array> m_chain_arm_curr;
 			std::shared_ptr<plane_object> m_billboard;
 
 			std::unique_ptr<mini::camera> m_old_camera;
@@ -108,7 +376,17 @@ namespace mini {
 			float m_animation_timer;
 
 		public:
-			ik_scene(application_base& app);
+			// the part of the scene that needs no gl context, built on a worker while the
+			// shaders load so the constructor only has to upload it
+			struct prepared_t {
+				configuration_space_t conf;
+				std::vector<unsigned char> pixels;
+			};
+
+			static resource_manifest_t get_manifest();
+			static std::shared_ptr<prepared_t> prepare();
+
+			ik_scene(application_base& app, std::shared_ptr<prepared_t> prepared = nullptr);
 			ik_scene(const ik_scene&) = delete;
 			ik_scene& operator=(const ik_scene&) = delete;
 
@@ -121,6 +399,8 @@ namespace mini {
 			virtual void on_key_event(int key, int scancode, int action, int mods) override;
 
 		private:
+			ik_scene(application_base& app, prepared_t&& prepared);
+
 			void m_gui_settings();
 			void m_gui_viewport();
 			void m_gui_parameters();
@@ -129,22 +409,36 @@ namespace mini {
 			void m_handle_mouse_release(float x, float y);
 
 			std::shared_ptr<segments_array> m_build_robot_arm(
-				std::shared_ptr<shader_program> line_shader) const;
+				std::shared_ptr<shader_program> line_shader, std::size_t num_links) const;
 
 			void m_configure_robot_arm(
 				std::shared_ptr<segments_array>& arm, 
 				const robot_configuration_t& config);
 
+			void m_configure_chain_arm(
+				std::shared_ptr<segments_array>& arm,
+				const chain_configuration_t& config);
+
 			glm::vec2 m_get_mouse_world() const;
 
 			inline bool m_collides(float alpha, float beta) const;
+			inline bool m_collides(float alpha, float beta, const obstacle_t& obstacle) const;
+
+			std::vector<int> m_rasterize_obstacle(const obstacle_t& obstacle) const;
+			cell_state_t m_classify_region(float alpha, float beta, float half_alpha, float half_beta) const;
 
 			void m_check_collisions();
 			void m_rebuild_configuration();
+			void m_obstacle_changed(int index);
+			void m_build_pyramid();
 			void m_mode_changed();
 			void m_length_changed();
+			void m_chain_changed();
+			void m_reset_sampler();
 			void m_solve_start_ik();
+			void m_replan_path();
 			void m_solve_end_ik();
 			bool m_solve_arm_ik(robot_configuration_t& config, float x, float y, bool alt) const;
+			bool m_solve_chain_ik(chain_configuration_t& config, float x, float y) const;
 	};
 }
@@ -7,10 +7,16 @@
 #include "mesh.hpp"
 #include "model.hpp"
 #include "segments.hpp"
+#include "pointcloud.hpp"
+#include "threadpool.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <array>
+#include <atomic>
+#include <future>
+
 namespace mini {
 	class puma_scene : public scene_base {
 		private:
@@ -75,6 +81,162 @@ namespace mini {
 				}
 			};
 
+			// effector interpolation baked into joint space, samples are spaced evenly in
+			// animation time and played back through a catmull-rom spline
+			struct puma_trajectory_t {
+				// q1 to q6 of every sample, angles are unwrapped so neighbouring samples never
+				// differ by more than pi and can be interpolated directly
+				std::vector<float> joints;
+
+				// solver points for the debug view only, interpolated linearly
+				std::vector<puma_solution_meta_t> metas;
+
+				int num_samples;
+				bool valid;
+
+				puma_trajectory_t() : num_samples(0), valid(false) { }
+
+				void sample(float t, puma_config_t& config, puma_solution_meta_t& meta) const;
+			};
+
+			// what a bake reads, copied so the scene can be edited while it runs
+			struct bake_request_t {
+				puma_target_t start;
+				puma_target_t end;
+				puma_config_t config;
+				puma_solution_meta_t meta;
+				int num_samples;
+			};
+
+			// forward kinematics of many arms at once, joints and results are kept as structure
+			// of arrays and evaluated a block of lanes at a time with simd
+			struct puma_batch_t {
+				static constexpr int LANES = 4;
+
+				float l1, l2, l3;
+				int count;
+
+				// q1 to q6, one array per joint, padded to a multiple of LANES
+				std::array<std::vector<float>, 6> joints;
+
+				// x, y and z of p1 to p4 in the drawing frame, p4 is the effector
+				std::array<std::vector<float>, 12> points;
+
+				// effector rotation columns, together with p4 this is a 3x4 affine transform
+				std::array<std::vector<float>, 9> rotation;
+
+				puma_batch_t() : l1(3.5f), l2(2.5f), l3(2.0f), count(0) { }
+
+				void resize(int count);
+				void evaluate();
+			};
+
+			// standard denavit-hartenberg link, the joint value is added to theta for revolute
+			// joints and to d for prismatic ones and then clamped to the limits
+			struct dh_joint_t {
+				float theta, d, a, alpha;
+				bool prismatic;
+				float lower, upper;
+			};
+
+			struct dls_settings_t {
+				int max_iterations;
+				float damping;
+				float tolerance;
+				float max_step;
+				float orientation_weight;
+
+				dls_settings_t() : max_iterations(64), damping(0.05f), tolerance(1e-4f), 
+					max_step(0.5f), orientation_weight(1.0f) { }
+			};
+
+			struct dls_result_t {
+				int iterations;
+				float error;
+				bool converged;
+			};
+
+			// serial chain of dh links between a fixed base and tool transform, inverse kinematics
+			// is solved by damped least squares on the geometric jacobian
+			struct dh_chain_t {
+				std::vector<dh_joint_t> joints;
+				glm::mat4x4 base;
+				glm::mat4x4 tool;
+
+				dh_chain_t() : base(1.0f), tool(1.0f) { }
+
+				int dimension() const;
+
+				// frames[0] is the base and frames[i] the frame after link i, without the tool
+				void frames(const float* q, std::vector<glm::mat4x4>& frames) const;
+				glm::mat4x4 forward(const float* q) const;
+
+				// q is the warm start and receives the solution
+				dls_result_t solve(const glm::mat4x4& target, float* q, const dls_settings_t& settings) const;
+
+				// targets are split into one contiguous chunk per worker, every chunk starts from the
+				// seed and every following target warm starts from the solution before it
+				void solve_batch(thread_pool& workers, const std::vector<glm::mat4x4>& targets, const float* seed, 
+					std::vector<float>& solutions, std::vector<dls_result_t>& results, 
+					const dls_settings_t& settings) const;
+			};
+
+			struct solver_stats_t {
+				int samples;
+				float analytic_time;
+				float numeric_time;
+				float mean_iterations;
+				int max_iterations;
+				float max_error;
+				int failures;
+
+				solver_stats_t() : samples(0), analytic_time(0.0f), numeric_time(0.0f), 
+					mean_iterations(0.0f), max_iterations(0), max_error(0.0f), failures(0) { }
+			};
+
+			enum class workspace_metric_t {
+				reachability,
+				branches,
+				conditioning,
+				colinear
+			};
+
+			// statistics of the ik solver over every orientation tested at one target position
+			struct workspace_voxel_t {
+				// fraction of orientations with an exact solution inside the joint limits
+				float reachability;
+
+				// mean number of distinct valid solutions, at most 2
+				float branches;
+
+				// mean inverse condition number of the jacobian, 0 at singularities
+				float conditioning;
+
+				// fraction of orientations with the wrist centre near the base axis, where
+				// the solver falls back to the colinear case
+				float colinear;
+			};
+
+			// voxel grid of target positions centered at the base, the file cache is keyed
+			// by the link lengths and checked against the grid settings
+			struct workspace_map_t {
+				float l1, l2, l3;
+				float extent;
+				int resolution;
+				int orientations;
+				std::vector<workspace_voxel_t> voxels;
+
+				workspace_map_t() : l1(0.0f), l2(0.0f), l3(0.0f), extent(0.0f), 
+					resolution(0), orientations(0) { }
+
+				glm::vec3 voxel_center(int x, int y, int z) const;
+				bool same_settings(const workspace_map_t& other) const;
+				std::string cache_path() const;
+
+				bool load();
+				bool save() const;
+			};
+
 			app_context& m_context1;
 			app_context m_context2;
 
@@ -135,8 +297,58 @@ namespace mini {
 			bool m_anim_active;
 			bool m_anim_paused;
 
+			// the last finished bake keeps playing until the one started after a change is done
+			puma_trajectory_t m_trajectory;
+			bool m_trajectory_dirty;
+			int m_bake_samples;
+			bool m_baked_playback;
+
+			dh_chain_t m_dh_chain;
+			std::vector<float> m_dh_joints;
+			std::vector<glm::mat4x4> m_dh_frames;
+			std::shared_ptr<segments_array> m_dh_lines;
+			dls_settings_t m_dls;
+			solver_stats_t m_solver_stats;
+			int m_ik_solver_id;
+			int m_dh_chain_id;
+			float m_analytic_time;
+			float m_numeric_time;
+			dls_result_t m_numeric_result;
+
+			puma_batch_t m_batch;
+			std::shared_ptr<segments_array> m_batch_lines;
+			bool m_multi_robot;
+			int m_num_robots;
+			float m_robot_spacing;
+			float m_batch_time;
+			float m_reference_time;
+			float m_reference_error;
+
+			workspace_map_t m_workspace;
+
+			// bakes and batch solves run on the first pool, the workspace map gets its own so
+			// per frame work never queues behind its slices
+			thread_pool m_workers;
+			thread_pool m_workspace_workers;
+			std::future<workspace_map_t> m_workspace_task;
+			std::future<puma_trajectory_t> m_bake_task;
+			std::atomic<int> m_workspace_progress;
+			std::atomic<bool> m_workspace_cancel;
+			std::shared_ptr<point_cloud> m_workspace_cloud;
+			int m_workspace_total;
+
+			workspace_metric_t m_workspace_metric;
+			int m_workspace_metric_id;
+			int m_workspace_resolution;
+			int m_workspace_orientations;
+			float m_workspace_extent;
+			bool m_show_workspace;
+
 		public:
+			static resource_manifest_t get_manifest();
+
 			puma_scene(application_base& app);
+			~puma_scene();
 			puma_scene(const puma_scene&) = delete;
 			puma_scene& operator=(const puma_scene&) = delete;
 
@@ -154,6 +366,29 @@ namespace mini {
 
 			void m_solve_ik(puma_config_t& config, puma_solution_meta_t& meta, 
 				const puma_target_t& target, ik_mode_t mode) const;
+
+			puma_trajectory_t m_bake_trajectory(thread_pool& workers, bake_request_t request) const;
+			void m_poll_trajectory_bake();
+
+			glm::mat4x4 m_forward_kinematics(const puma_config_t& config) const;
+
+			void m_configure_chain();
+			void m_reset_numeric();
+			void m_solve_numeric(const puma_target_t& target);
+			void m_compare_solvers();
+
+			void m_configure_batch();
+			void m_update_batch();
+			void m_benchmark_batch();
+			float m_inverse_condition(const puma_config_t& config) const;
+
+			workspace_voxel_t m_analyze_voxel(const puma_config_t& base, const glm::vec3& position, 
+				const std::vector<glm::quat>& orientations) const;
+
+			workspace_map_t m_analyze_workspace(workspace_map_t map);
+			void m_start_workspace_analysis();
+			void m_poll_workspace_analysis();
+			void m_rebuild_workspace_cloud();
 		
 			void m_draw_puma(app_context& context, const puma_config_t& config, glm::vec3& effector_pos) const;
 			void m_draw_frame(app_context& context, const glm::mat4x4& transform) const;
@@ -85,6 +85,8 @@ namespace mini {
 			simulation_state_t m_state;
 
 		public:
+			static resource_manifest_t get_manifest();
+
 			slerp_scene(application_base& app);
 			slerp_scene(const slerp_scene&) = delete;
 			slerp_scene& operator=(const slerp_scene&) = delete;
@@ -3,13 +3,37 @@
 #include "function.hpp"
 #include "curve.hpp"
 #include "grid.hpp"
+#include "fft.hpp"
+#include "threadpool.hpp"
+
+#include <array>
+#include <future>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 namespace mini {
 	class spring_scene : public scene_base {
 		public:
 			static constexpr std::size_t MAX_DATA_POINTS = 2000;
+			static constexpr float MAX_PANEL_WIDTH = 0.01f;
 
 		private:
+			struct sweep_settings_t {
+				float mass, spring, friction;
+				float min_frequency, max_frequency;
+				float amplitude;
+				int num_points, num_periods;
+			};
+
+			// steady state response to h(t) = a sin(2 pi f t), measured from the simulation and
+			// from the model 1 / (c - m w^2 + i k w), the phase is in degrees
+			struct sweep_result_t {
+				std::vector<float> frequency;
+				std::vector<float> amplitude, phase;
+				std::vector<float> model_amplitude, model_phase;
+			};
+
 			float m_friction_coefficient; // k
 			float m_spring_coefficient; // c
 			float m_mass; // m
@@ -30,6 +54,13 @@ namespace mini {
 			int m_last_vp_width, m_last_vp_height;
 
 			bool m_paused;
+			int m_integrator_id;
+
+			// exact step of the linear system, e^(Ah) for the state and the response to
+			// the forcing at every quadrature node, e^(A(h-s)) e2 times the node weight
+			glm::mat2x2 m_step_exp;
+			std::vector<float> m_forcing_nodes;
+			std::vector<glm::vec2> m_forcing_kernel;
 
 			std::string m_w_expression;
 			std::string m_h_expression;
@@ -52,6 +83,21 @@ namespace mini {
 
 			std::size_t m_num_data_points;
 
+			// spectra of x, v and a streamed over the whole run
+			bool m_spectrum_enabled;
+			int m_spectrum_window;
+			int m_spectrum_series_id;
+			std::array<spectrum_stream, 3> m_spectra;
+			std::vector<float> m_spectrum_frequency;
+			std::vector<float> m_spectrum_amplitude;
+
+			sweep_settings_t m_sweep_settings;
+			sweep_result_t m_sweep;
+
+			// declared before the task so a running sweep is waited for while the pool is alive
+			thread_pool m_workers;
+			std::future<sweep_result_t> m_sweep_task;
+
 			// drawable objects
 			std::shared_ptr<grid_object> m_grid;
 			std::shared_ptr<curve> m_spring_curve;
@@ -59,6 +105,8 @@ namespace mini {
 			std::shared_ptr<curve> m_roof_object;
 
 		public:
+			static resource_manifest_t get_manifest();
+
 			spring_scene(application_base& app);
 			spring_scene(const spring_scene&) = delete;
 			spring_scene& operator=(const spring_scene&) = delete;
@@ -79,11 +127,24 @@ namespace mini {
 			void m_gui_trajectory();
 			void m_gui_settings();
 			void m_gui_viewport();
+			void m_gui_frequency();
 
 			// export to file
 			void m_export_data();
 
 			void m_start_simulation();
+			void m_prepare_exact_step();
+
+			void m_step_euler(float t0, float w, float h);
+			void m_step_verlet(float t0, float w, float h);
+			void m_step_rk4(float t0);
+			void m_step_exact(float t0);
+
+			void m_reset_spectra();
+			void m_start_sweep();
+			void m_poll_sweep();
+
+			static sweep_result_t m_run_sweep(thread_pool& workers, sweep_settings_t settings);
 			void m_push_data_point(float t, float f, float g, float h, float x, float v, float a);
 	};
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "grid.hpp"
 #include "viewport.hpp"
 #include "cube.hpp"
+#include "pointcloud.hpp"
+#include "threadpool.hpp"
 
 #include <array>
 #include <vector>
@@ -16,6 +18,7 @@ namespace mini {
 	class top_scene : public scene_base {
 		private:
 			static constexpr std::size_t MAX_DATA_POINTS = 2048;
+			static constexpr int MAX_ENSEMBLE_SIZE = 65536;
 
 			struct simulation_parameters_t {
 				float diagonal_length;
@@ -23,6 +26,7 @@ namespace mini {
 				float cube_deviation;
 				float angular_velocity;
 				float int_step;
+				int integrator_id;
 
 				simulation_parameters_t() {
 					diagonal_length = 3.5f;
@@ -30,6 +34,7 @@ namespace mini {
 					cube_deviation = 0.3f;
 					angular_velocity = 20.0f;
 					int_step = 0.001f;
+					integrator_id = 0;
 				}
 			};
 
@@ -54,10 +59,56 @@ namespace mini {
 				glm::vec3 W;
 				glm::quat Q;
 
+				// body angular momentum, the splitting integrator advances it instead of W
+				glm::vec3 L;
+
 				float time, step_timer;
 
+				// energy and vertical angular momentum are conserved by the exact motion,
+				// the drift is relative to their values at the last reset
+				float energy_start, momentum_start;
+				float energy_drift, momentum_drift;
+				float max_energy_drift, max_momentum_drift;
+
 				simulation_state_t(const simulation_parameters_t & parameters, const world_parameters_t* world_params);
 				void integrate(float delta_time);
+
+				void step_rk4(float h);
+				void step_splitting(float h);
+
+				glm::vec3 torque() const;
+				glm::vec3 momentum() const;
+				float energy() const;
+
+				void reset_invariants();
+			};
+
+			// many tops integrated side by side with the same step, every array holds one
+			// value per top and is padded to a multiple of the simd width
+			struct ensemble_t {
+				static constexpr std::size_t LANES = 4;
+
+				std::size_t count;
+				float time, step_timer;
+
+				std::vector<float> wx, wy, wz;
+				std::vector<float> qw, qx, qy, qz;
+
+				// a cube tensor is the same value on the diagonal and another one off it
+				std::vector<float> inertia_diag, inertia_off;
+				std::vector<float> inverse_diag, inverse_off;
+
+				// mass times the distance to the center of mass, and the diagonal length
+				std::vector<float> lever, diagonal;
+
+				ensemble_t();
+
+				void resize(std::size_t count);
+				void set(std::size_t index, const simulation_state_t& state);
+				void integrate(thread_pool& workers, float delta_time, float int_step, float gravity);
+				void integrate_range(std::size_t first, std::size_t last, int steps, float h, float gravity);
+
+				glm::vec3 tip(std::size_t index) const;
 			};
 
 			bool m_display_cube;
@@ -65,6 +116,7 @@ namespace mini {
 			bool m_display_grid;
 			bool m_display_plane;
 			bool m_display_path;
+			bool m_ensemble_mode;
 
 			world_parameters_t m_world_params;
 			simulation_parameters_t m_start_params;
@@ -74,14 +126,28 @@ namespace mini {
 			std::vector<float> m_time_points;
 			std::vector<glm::vec3> m_path_points;
 
+			int m_ensemble_size;
+			float m_deviation_spread;
+			float m_velocity_spread;
+			float m_diagonal_spread;
+			float m_ensemble_time;
+			float m_ensemble_radius;
+
+			ensemble_t m_ensemble;
+			thread_pool m_workers;
+			std::vector<glm::vec4> m_ensemble_colors;
+
 			std::shared_ptr<grid_object> m_grid;
 			std::shared_ptr<cube_object> m_cube;
 			std::shared_ptr<curve> m_curve;
 			std::shared_ptr<curve> m_diagonal;
+			std::shared_ptr<point_cloud> m_tip_cloud;
 
 			viewport_window m_viewport;
 
 		public:
+			static resource_manifest_t get_manifest();
+
 			top_scene(application_base & app);
 			~top_scene();
 
@@ -102,6 +168,8 @@ namespace mini {
 			void m_gui_viewport();
 
 			void m_reset_simulation();
+			void m_reset_ensemble();
+			void m_update_tip_cloud();
 			void m_clear_data_points();
 			void m_push_data_point(const float time, const glm::vec3& point);
 	};
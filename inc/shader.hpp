@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <stdexcept>
 
 #include <glad/glad.h>
@@ -41,6 +42,20 @@ namespace mini {
 			void set_tesselation_source (const std::string & tcs, const std::string & tes);
 			bool compile ();
 
+			// compile split in two, in between a driver with parallel compile works on its own
+			// threads, finish_compile throws like compile and blocks if the driver is not done
+			void begin_compile ();
+			bool is_compile_complete () const;
+			void finish_compile ();
+
+			// false if the driver rejects the binary, the sources still have to be set so that
+			// copies can recompile
+			bool load_binary (GLenum format, const std::vector<unsigned char> & binary);
+			bool get_binary (GLenum & format, std::vector<unsigned char> & binary) const;
+
+			// lets the driver compile on background threads, false if it cannot
+			static bool enable_parallel_compile ();
+
 			bool is_ready () const;
 			
 			shader_program ();
@@ -67,7 +82,9 @@ namespace mini {
 			void set_uniform (const std::string & name, const glm::mat4x4 & matrix);
 
 		private:
-			bool m_try_compile (GLenum shader_type, const std::string & source, GLuint * out_shader);
+			GLuint m_start_compile (GLenum shader_type, const std::string & source);
+			bool m_try_compile (GLuint shader_object);
 			bool m_try_link ();
+			void m_delete_objects ();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+namespace mini {
+	// linked program binaries on disk, keyed by every stage source and the driver that linked
+	// them, a miss or a binary the driver turns down just means compiling from source
+	class shader_cache {
+		public:
+			static constexpr uint32_t MAGIC = 0x48534653; // "SFSH"
+			static constexpr uint32_t VERSION = 1;
+
+			// vertex, fragment, tesselation control, tesselation evaluation and geometry,
+			// empty sources are stages the program does not have
+			using sources_t = std::array<std::string, 5>;
+
+			struct binary_t {
+				GLenum format;
+				std::vector<unsigned char> data;
+			};
+
+		private:
+			std::string m_directory;
+			std::string m_driver;
+			bool m_enabled;
+
+		public:
+			// reads the driver strings, so it needs the context to be current
+			shader_cache(const std::string& directory = "cache/shaders");
+
+			bool is_enabled() const;
+			uint64_t get_key(const sources_t& sources) const;
+			std::string get_cache_path(uint64_t key) const;
+
+			// both are safe to call from worker threads, store only logs failures
+			bool load(uint64_t key, binary_t& binary) const;
+			void store(uint64_t key, const binary_t& binary) const;
+
+		private:
+			static uint64_t m_hash(const void* data, std::size_t size, uint64_t hash);
+	};
+}
\ No newline at end of file
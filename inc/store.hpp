@@ -1,18 +1,112 @@
 #pragma once
+#include <array>
 #include <memory>
+#include <future>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <exception>
 #include <unordered_map>
 
 #include "shader.hpp"
 #include "texture.hpp"
+#include "cubemap.hpp"
+#include "mesh.hpp"
+#include "texcache.hpp"
+#include "shadercache.hpp"
+#include "threadpool.hpp"
 
 namespace mini {
 	using shader_handle_t = std::shared_ptr<shader_program>;
 	using texture_handle_t = std::shared_ptr<texture>;
+	using cubemap_handle_t = std::shared_ptr<cubemap>;
+	using mesh_handle_t = std::shared_ptr<triangle_mesh>;
+
+	using shader_future_t = std::shared_future<shader_handle_t>;
+	using texture_future_t = std::shared_future<texture_handle_t>;
+	using cubemap_future_t = std::shared_future<cubemap_handle_t>;
+	using mesh_future_t = std::shared_future<mesh_handle_t>;
+
+	// empty file names are stages the program does not have
+	struct shader_files_t {
+		std::string vs, ps, tcs, tes, gs;
+	};
+
+	// the file and the transform baked into the vertices before the mesh is optimized
+	struct mesh_file_t {
+		std::string file;
+		glm::vec3 offset = { 0.0f, 0.0f, 0.0f };
+		glm::vec3 scale = { 1.0f, 1.0f, 1.0f };
+	};
+
+	// what a scene asks the store for, so it can be loaded before the scene is built
+	struct resource_manifest_t {
+		std::vector<std::string> shaders;
+		std::vector<std::string> textures;
+		std::vector<std::string> cubemaps;
+		std::vector<std::string> meshes;
+	};
 
 	class resource_store final {
+		public:
+			static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 256ULL << 20;
+
 		private:
-			std::unordered_map<std::string, shader_handle_t> m_shaders;
-			std::unordered_map<std::string, texture_handle_t> m_textures;
+			// the worker stage reads and decodes, then hands back the gl stage which has to
+			// run on the thread owning the context
+			using upload_t = std::function<void()>;
+
+			struct pending_upload_t {
+				std::string name;
+				std::future<upload_t> staged;
+				std::function<void(std::exception_ptr)> fail;
+			};
+
+			// programs the driver is still compiling, polled by process_uploads
+			struct pending_link_t {
+				std::string name;
+				uint64_t key;
+				shader_handle_t shader;
+				std::shared_ptr<std::promise<shader_handle_t>> promise;
+			};
+
+			// a slot that is not ready belongs to its load, only that load replaces or drops
+			// it, ready slots are dropped by eviction and come back from their recipe
+			template<typename T> struct slot_t {
+				std::shared_future<T> future;
+				std::size_t bytes = 0;
+				uint64_t last_used = 0;
+			};
+
+			std::unordered_map<std::string, slot_t<shader_handle_t>> m_shaders;
+			std::unordered_map<std::string, slot_t<texture_handle_t>> m_textures;
+			std::unordered_map<std::string, slot_t<cubemap_handle_t>> m_cubemaps;
+			std::unordered_map<std::string, slot_t<mesh_handle_t>> m_meshes;
+
+			// every resource ever declared or loaded, by name
+			std::unordered_map<std::string, shader_files_t> m_shader_files;
+			std::unordered_map<std::string, std::string> m_texture_files;
+			std::unordered_map<std::string, std::array<std::string, 6>> m_cubemap_files;
+			std::unordered_map<std::string, mesh_file_t> m_mesh_files;
+
+			// the last prefetched manifest is never evicted, its scene may not exist yet
+			resource_manifest_t m_manifest;
+
+			std::size_t m_memory_budget;
+			std::size_t m_resident_bytes;
+			uint64_t m_use_clock;
+
+			std::vector<pending_upload_t> m_pending;
+			std::vector<pending_link_t> m_linking;
+
+			// asynchronous image loads go through baked copies of the pngs
+			texture_cache m_texture_cache;
+
+			// every shader load tries a program binary from an earlier run first
+			shader_cache m_shader_cache;
+
+			// declared last so queued jobs finish before the rest of the store goes away
+			thread_pool m_workers;
 
 		public:
 			void load_shader(
@@ -50,8 +144,96 @@ namespace mini {
 				const std::string& file
 			);
 
-			shader_handle_t get_shader(const std::string & name) const;
-			texture_handle_t get_texture(const std::string & name) const;
+			// asynchronous variants, the files are read and decoded on worker threads and the
+			// gl objects are created by process_uploads, a failed compile yields a null shader
+			// like the blocking loaders, a missing file is reported through the future
+			shader_future_t load_shader_async(
+				const std::string & name, 
+				const std::string & vs_file, 
+				const std::string & ps_file
+			);
+
+			shader_future_t load_shader_async(
+				const std::string & name, 
+				const std::string & vs_file, 
+				const std::string & ps_file, 
+				const std::string & gs_file
+			);
+
+			shader_future_t load_shader_async(
+				const std::string & name, 
+				const std::string & vs_file, 
+				const std::string & ps_file, 
+				const std::string & tcs_file, 
+				const std::string & tes_file
+			);
+
+			shader_future_t load_shader_async(
+				const std::string & name, 
+				const std::string & vs_file, 
+				const std::string & ps_file, 
+				const std::string & tcs_file, 
+				const std::string & tes_file, 
+				const std::string & gs_file
+			);
+
+			texture_future_t load_texture_async(
+				const std::string& name,
+				const std::string& file
+			);
+
+			// a cube map is only decoded once, later requests share the first one
+			cubemap_future_t load_cubemap_async(
+				const std::string& name,
+				const std::array<std::string, 6>& sides
+			);
+
+			// parsing and optimizing run on a worker, only the buffers are made on the gl thread
+			mesh_future_t load_mesh_async(
+				const std::string& name,
+				const mesh_file_t& file
+			);
+
+			// the catalogue, nothing is read until a resource is first asked for or prefetched
+			void declare_shader(const std::string& name, const shader_files_t& files);
+			void declare_texture(const std::string& name, const std::string& file);
+			void declare_cubemap(const std::string& name, const std::array<std::string, 6>& sides);
+			void declare_mesh(const std::string& name, const mesh_file_t& file);
+
+			// starts loading everything the manifest names that is not resident yet
+			void prefetch(const resource_manifest_t& manifest);
+
+			// runs finished gl stages until the budget is spent, at least one per call,
+			// returns the number of loads still in flight, evicts when an upload went over the memory budget
+			std::size_t process_uploads(double budget_seconds);
+			void finish_uploads();
+			std::size_t get_pending_uploads() const;
+
+			// loads of the manifest a scene would block on that have not come through yet, cube
+			// maps are left out since scenes poll for those
+			std::size_t get_pending_loads(const resource_manifest_t& manifest) const;
+
+			// drops the least recently used resources nothing outside the store holds on to
+			// until the resident estimate fits the budget, returns the bytes freed
+			std::size_t evict_unused();
+
+			void set_memory_budget(std::size_t bytes);
+			std::size_t get_memory_budget() const;
+			std::size_t get_resident_bytes() const;
+
+			// the share of the resident estimate taken by the resources the manifest names
+			std::size_t get_resident_bytes(const resource_manifest_t& manifest) const;
+
+			// a declared shader, texture or mesh that is not loaded yet is loaded on the spot, a
+			// cube map is never waited for, the caller polls its future, which is not valid when
+			// nothing was declared under the name
+			shader_handle_t get_shader(const std::string & name);
+			texture_handle_t get_texture(const std::string & name);
+			cubemap_future_t get_cubemap(const std::string & name);
+			mesh_handle_t get_mesh(const std::string & name);
+
+			// the faces a cube map was declared with, empty paths for an unknown name
+			std::array<std::string, 6> get_cubemap_files(const std::string & name) const;
 
 			resource_store();
 			~resource_store() = default;
@@ -62,37 +244,37 @@ namespace mini {
 		private:
 			std::string m_read_file_content(const std::string& path) const;
 
-			void m_add_shader(const std::string & name, shader_handle_t shader);
-			void m_add_texture(const std::string & name, texture_handle_t texture);
-
-			std::shared_ptr<shader_program> m_load_shader(
-				const std::string& vs_file, 
-				const std::string& ps_file
-			) const;
-
-			std::shared_ptr<shader_program> m_load_shader(
-				const std::string& vs_file, 
-				const std::string& ps_file, 
-				const std::string& gs_file
-			) const;
-
-			std::shared_ptr<shader_program> m_load_shader(
-				const std::string& vs_file, 
-				const std::string& ps_file,
-				const std::string& tcs_file, 
-				const std::string& tes_file
-			) const;
-
-			std::shared_ptr<shader_program> m_load_shader(
-				const std::string& vs_file, 
-				const std::string& ps_file,
-				const std::string& tcs_file, 
-				const std::string& tes_file, 
-				const std::string& gs_file
-			) const;
-
-			std::shared_ptr<texture> m_load_texture(
-				const std::string& file
-			) const;
+			shader_cache::sources_t m_read_shader_sources(const shader_files_t& files) const;
+
+			std::shared_ptr<shader_program> m_load_shader(const shader_files_t& files);
+			shader_future_t m_load_shader_async(const std::string& name, const shader_files_t& files);
+			texture_future_t m_load_texture_async(const std::string& name, const std::string& file);
+			cubemap_future_t m_load_cubemap_async(const std::string& name, const std::array<std::string, 6>& sides);
+			mesh_future_t m_load_mesh_async(const std::string& name, const mesh_file_t& file);
+
+			static std::shared_ptr<shader_program> m_create_shader(const shader_cache::sources_t& sources);
+			void m_store_binary(uint64_t key, const shader_program& shader);
+			void m_finish_link(pending_link_t& link);
+
+			// finishes every queued stage of the named loads right away
+			void m_wait_for(const std::string& name);
+
+			template<typename T> T m_get(std::unordered_map<std::string, slot_t<T>>& slots, const std::string& name);
+			template<typename T> void m_set_ready(std::unordered_map<std::string, slot_t<T>>& slots, 
+				const std::string& name, T handle, std::size_t bytes);
+			template<typename T> void m_set_resident(std::unordered_map<std::string, slot_t<T>>& slots, 
+				const std::string& name, std::size_t bytes);
+
+			static std::size_t m_program_bytes(const shader_program* shader);
+			static std::size_t m_image_bytes(const baked_image& image);
+			static std::size_t m_mesh_bytes(const triangle_mesh& mesh);
+
+			void m_enqueue(
+				const std::string& name, 
+				std::function<upload_t()> stage, 
+				std::function<void(std::exception_ptr)> fail
+			);
+
+			void m_finish_upload(pending_upload_t& upload);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "mapfile.hpp"
+
+namespace mini {
+	// rgba8 image with its full mip chain, level 0 first, either baked in memory or viewed
+	// straight from a mapped cache file
+	class baked_image {
+		public:
+			struct level_t {
+				uint32_t width, height;
+				const unsigned char* data;
+			};
+
+		private:
+			std::shared_ptr<mapped_file> m_file;
+			std::vector<unsigned char> m_storage;
+			std::vector<level_t> m_levels;
+
+		public:
+			baked_image(uint32_t width, uint32_t height, const std::vector<unsigned char>& pixels);
+			baked_image(std::shared_ptr<mapped_file> file, std::vector<level_t> levels);
+
+			baked_image(const baked_image&) = delete;
+			baked_image& operator=(const baked_image&) = delete;
+
+			uint32_t get_width() const;
+			uint32_t get_height() const;
+
+			std::size_t get_num_levels() const;
+			const level_t& get_level(std::size_t level) const;
+	};
+
+	// decoded pngs kept on disk next to the executable, a cache file is reused as long as the
+	// size and modification time of its source match, or failing that its content hash
+	class texture_cache {
+		public:
+			static constexpr uint32_t MAGIC = 0x58544653; // "SFTX"
+			static constexpr uint32_t VERSION = 1;
+
+		private:
+			struct source_stamp_t {
+				uint64_t size;
+				int64_t time;
+				uint64_t hash;
+			};
+
+			std::string m_directory;
+
+		public:
+			texture_cache(const std::string& directory = "cache/textures");
+
+			// safe to call from several threads, bakes and writes the image if needed
+			std::shared_ptr<const baked_image> load(const std::string& source) const;
+			std::string get_cache_path(const std::string& source) const;
+
+			// bakes every png below a directory ahead of time
+			static int run_headless(int argc, char** argv);
+
+		private:
+			std::shared_ptr<const baked_image> m_load_cached(
+				const std::string& path,
+				const std::string& source,
+				const source_stamp_t& stamp
+			) const;
+
+			void m_write(const std::string& path, const source_stamp_t& stamp, const baked_image& image) const;
+			static void m_restamp(const std::string& path, int64_t time);
+
+			static source_stamp_t m_stamp(const std::string& source);
+			static std::vector<unsigned char> m_read_bytes(const std::string& path);
+			static uint64_t m_hash(const unsigned char* data, std::size_t size);
+	};
+}
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include <glad/glad.h>
 
+#include "texcache.hpp"
+
 namespace mini {
 	class texture {
 		private:
@@ -31,6 +33,9 @@ namespace mini {
 			texture (uint32_t width, uint32_t height, unsigned char * data, GLenum format, 
 				unsigned int mipmap_levels = 0, GLenum min_filter = GL_LINEAR, GLenum mag_filter = GL_LINEAR);
 
+			// uploads the whole baked mip chain, no copy of the pixels is kept
+			texture (const baked_image & image, GLenum min_filter = GL_LINEAR_MIPMAP_LINEAR, GLenum mag_filter = GL_LINEAR);
+
 			texture (const texture &) = delete;
 			texture & operator= (const texture &) = delete;
 
@@ -38,11 +43,15 @@ namespace mini {
 
 			void bind (GLenum slot = GL_TEXTURE0) const;
 			void update(unsigned char * data);
+			void update(unsigned char * data, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 
 		private:
 			void m_initialize ();
 
 		public:
 			static std::shared_ptr<texture> load_from_file (const std::string & file);
+
+			// only touches the file and the decoder, safe to call off the gl thread
+			static std::vector<unsigned char> decode_file (const std::string & file, uint32_t & width, uint32_t & height);
 	};
 }
\ No newline at end of file
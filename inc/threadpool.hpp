@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace mini {
+	// fixed set of workers fed from one queue, tasks must not wait on other tasks of the same pool
+	class thread_pool {
+		private:
+			std::vector<std::thread> m_workers;
+			std::deque<std::function<void()>> m_tasks;
+
+			std::mutex m_mutex;
+			std::condition_variable m_condition;
+			bool m_stopping;
+
+		public:
+			thread_pool(std::size_t num_threads = 0);
+			~thread_pool();
+
+			thread_pool(const thread_pool&) = delete;
+			thread_pool& operator=(const thread_pool&) = delete;
+
+			std::size_t get_num_threads() const;
+
+			template<typename F> auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+				using result_t = std::invoke_result_t<F>;
+
+				// packaged tasks are move only, the queue needs copyable callables
+				auto packaged = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(task));
+				auto future = packaged->get_future();
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_tasks.emplace_back([packaged]() { (*packaged)(); });
+				}
+
+				m_condition.notify_one();
+				return future;
+			}
+
+			// splits [begin, end) into chunks of at least grain items and blocks until all are done
+			void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, 
+				const std::function<void(std::size_t, std::size_t)>& body);
+
+		private:
+			void m_worker_loop();
+	};
+}
\ No newline at end of file
@@ -9,10 +9,13 @@ uniform mat4 u_view;
 uniform mat4 u_projection;
 
 uniform vec2 u_resolution;
+uniform vec2 u_jitter;
 uniform samplerCube u_sampler;
+uniform sampler1D u_deflection;
 
 uniform float u_star_mass;
 uniform float u_distance;
+uniform float u_deflection_range;
 
 out vec4 frag_color;
 
@@ -24,59 +27,14 @@ vec3 rodrigues(vec3 v, vec3 k, float theta) {
     return v*c + cross(k,v)*s + k*dot(k,v)*(1.0 - c);
 }
 
-float ff(float b, float M, float w) {
-    return 1.0 - w*w*(1.0 - 2.0*M*w/b);
-}
-
-float f(float b, float M, float w) {
-    return sqrt(max(0.0, 1.0 - w*w*(1.0 - 2.0*M*w/b)));
-}
-
-float find_w1(float b, float M) {
-    float wl = 0.0;
-    float wr = 2.0;
-    float wm = 1.0;
-
-    for (int i = 0; i < 500; ++i) {
-        wm = 0.5 * (wl + wr);
-
-        float hl = ff(b, M, wl);
-        float hm = ff(b, M, wm);
-        float hr = ff(b, M, wr);
-
-        if (hm > 0.0) {
-            wl = wm;
-        } else {
-            wr = wm;
-        }
-    }
-
-    return wl;
-}
-
+// the angle swept by the ray is precomputed over beta = M / b, see deflection_table,
+// and sampled at x = -ln(1 - beta / beta_c) / u_deflection_range
 float find_angle(float b, float M) {
-    float limit = find_w1(b,M);
-    int steps = 2000;
-    float dw = limit / float(steps);
-
-    float wl = 0.0;
-    float F = 0.0;
-
-    for (int i = 0; i < steps; ++i) {
-        float wr = dw * float(i);
-        float hl = f(b, M, wl);
-        float hr = f(b, M, wr);
-
-        hl = 1.0/hl;
-        hr = 1.0/hr;
-
-        float dF = 0.5f * dw * (hl + hr);
-
-        F += dF;
-        wl = wr;
-    }
+    float beta = M / b;
+    float x = -log(max(1.0 - beta * sqrt(27.0), 1e-30)) / u_deflection_range;
+    float n = float(textureSize(u_deflection, 0));
 
-    return F;
+    return texture(u_deflection, (clamp(x, 0.0, 1.0) * (n - 1.0) + 0.5) / n).r;
 }
 
 // assume that the black hole is in (0,0,0)
@@ -87,7 +45,8 @@ void main() {
     float aspect = u_resolution.x / u_resolution.y;
 
     vec3 cam_position = vec3(0.0, 0.0, -1.8);
-    vec3 view_pos = vec3(fs_in.ndc_pos.x * aspect, -fs_in.ndc_pos.y, 0.0);
+    vec2 ndc_pos = fs_in.ndc_pos.xy + u_jitter;
+    vec3 view_pos = vec3(ndc_pos.x * aspect, -ndc_pos.y, 0.0);
     vec3 ray_dir = normalize(view_pos - cam_position);
     //vec3 world_dir = (u_world * vec4(ray_dir, 0.0)).xyz;
     
@@ -108,7 +67,7 @@ void main() {
 
     if (1.0/bsq < 1.0/(Msq * 27.0)) {
         //float dtheta = (1.0 / (1.0 / sqrt(27.0) - M / b) - sqrt(27.0)) / 12.0;
-        float dtheta = 2.0 * find_angle(b, M);
+        float dtheta = find_angle(b, M);
 
         vec3 left = normalize(p0 - star_worldpos);
         vec3 forward = normalize(star_worldpos - cam_worldpos);
@@ -0,0 +1,16 @@
+#version 330
+
+in vec4 vertex_color;
+in vec2 uv;
+
+out vec4 output_color;
+
+void main () {
+    vec2 p = uv - 0.5;
+
+    if (dot(p, p) > 0.25) {
+        discard;
+    }
+
+    output_color = vertex_color;
+}
\ No newline at end of file
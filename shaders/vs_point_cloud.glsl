@@ -0,0 +1,24 @@
+#version 330
+
+layout (location = 0) in vec2 a_corner;
+layout (location = 1) in vec3 a_center;
+layout (location = 2) in vec4 a_color;
+
+uniform mat4 u_world;
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec2 u_resolution;
+uniform float u_size;
+
+out vec4 vertex_color;
+out vec2 uv;
+
+void main () {
+    vertex_color = a_color;
+    uv = 0.5 * a_corner + 0.5;
+
+    gl_Position = u_projection * u_view * u_world * vec4 (a_center, 1.0);
+
+    // offset the corner in clip space so the point keeps its size in pixels
+    gl_Position.xy += a_corner * u_size / u_resolution * gl_Position.w;
+}
\ No newline at end of file
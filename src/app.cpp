@@ -1,4 +1,6 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -23,34 +25,60 @@ namespace mini {
 
 	application::application() : 
 		application_base(1200, 800, "physics application"),
-		m_context(video_mode_t(1200, 800)) {
+		m_context(video_mode_t(1200, 800)),
+		m_workers(PREPARE_THREADS) {
 
 		m_layout_ready = false;
-
-		// load some basic shaders
-		m_store.load_shader("basic", "shaders/vs_basic.glsl", "shaders/fs_basic.glsl");
-		m_store.load_shader("grid_xz", "shaders/vs_grid.glsl", "shaders/fs_grid_xz.glsl");
-		m_store.load_shader("grid_xy", "shaders/vs_grid.glsl", "shaders/fs_grid_xy.glsl");
-		m_store.load_shader("billboard", "shaders/vs_billboard.glsl", "shaders/fs_billboard.glsl");
-		m_store.load_shader("billboard_s", "shaders/vs_billboard_s.glsl", "shaders/fs_billboard.glsl");
-		m_store.load_shader("line", "shaders/vs_basic.glsl", "shaders/fs_solidcolor.glsl", "shaders/gs_lines.glsl");
-		m_store.load_shader("cube", "shaders/vs_shaded.glsl", "shaders/fs_shaded.glsl");
-		m_store.load_shader("room", "shaders/vs_shaded.glsl", "shaders/fs_shaded_room.glsl");
-		m_store.load_shader("gizmo", "shaders/vs_position.glsl", "shaders/fs_solidcolor.glsl");
-		m_store.load_shader("point", "shaders/vs_billboard_s.glsl", "shaders/fs_point.glsl");
-		m_store.load_shader("gelcube", "shaders/vs_gelcube.glsl", "shaders/fs_gelcube.glsl", 
-			"shaders/tcs_gelcube.glsl", "shaders/tes_gelcube.glsl");
-		m_store.load_shader("obstacle", "shaders/vs_basic_tex.glsl", "shaders/fs_solidcolor.glsl");
-		m_store.load_shader("bezier_model", "shaders/vs_beziermodel.glsl", "shaders/fs_beziermodel.glsl");
-		m_store.load_shader("puma", "shaders/vs_shaded.glsl", "shaders/fs_shaded.glsl");
-		m_store.load_shader("blackhole", "shaders/vs_blackhole.glsl", "shaders/fs_blackhole.glsl");
-
-		// load textures
-		m_store.load_texture("slime_albedo", "textures/slime_albedo.png");
-		m_store.load_texture("slime_normal", "textures/slime_normal.png");
-		m_store.load_texture("duck_albedo", "textures/duck.png");
-
-		m_scene = std::make_unique<black_hole_scene>(*this);
+		m_scene_id = scene_id_t::none;
+		m_next_scene_id = scene_id_t::none;
+
+		// nothing is read here, every scene prefetches what it needs and the store drops
+		// what has gone unused once it holds more than the budget
+		m_store.set_memory_budget(RESOURCE_BUDGET);
+
+		m_store.declare_shader("basic", { .vs = "shaders/vs_basic.glsl", .ps = "shaders/fs_basic.glsl" });
+		m_store.declare_shader("grid_xz", { .vs = "shaders/vs_grid.glsl", .ps = "shaders/fs_grid_xz.glsl" });
+		m_store.declare_shader("grid_xy", { .vs = "shaders/vs_grid.glsl", .ps = "shaders/fs_grid_xy.glsl" });
+		m_store.declare_shader("billboard", { .vs = "shaders/vs_billboard.glsl", .ps = "shaders/fs_billboard.glsl" });
+		m_store.declare_shader("billboard_s", { .vs = "shaders/vs_billboard_s.glsl", .ps = "shaders/fs_billboard.glsl" });
+		m_store.declare_shader("line", { .vs = "shaders/vs_basic.glsl", .ps = "shaders/fs_solidcolor.glsl", .gs = "shaders/gs_lines.glsl" });
+		m_store.declare_shader("cube", { .vs = "shaders/vs_shaded.glsl", .ps = "shaders/fs_shaded.glsl" });
+		m_store.declare_shader("room", { .vs = "shaders/vs_shaded.glsl", .ps = "shaders/fs_shaded_room.glsl" });
+		m_store.declare_shader("gizmo", { .vs = "shaders/vs_position.glsl", .ps = "shaders/fs_solidcolor.glsl" });
+		m_store.declare_shader("point", { .vs = "shaders/vs_billboard_s.glsl", .ps = "shaders/fs_point.glsl" });
+		m_store.declare_shader("point_cloud", { .vs = "shaders/vs_point_cloud.glsl", .ps = "shaders/fs_point_cloud.glsl" });
+		m_store.declare_shader("gelcube", { .vs = "shaders/vs_gelcube.glsl", .ps = "shaders/fs_gelcube.glsl", 
+			.tcs = "shaders/tcs_gelcube.glsl", .tes = "shaders/tes_gelcube.glsl" });
+		m_store.declare_shader("obstacle", { .vs = "shaders/vs_basic_tex.glsl", .ps = "shaders/fs_solidcolor.glsl" });
+		m_store.declare_shader("bezier_model", { .vs = "shaders/vs_beziermodel.glsl", .ps = "shaders/fs_beziermodel.glsl" });
+		m_store.declare_shader("puma", { .vs = "shaders/vs_shaded.glsl", .ps = "shaders/fs_shaded.glsl" });
+		m_store.declare_shader("blackhole", { .vs = "shaders/vs_blackhole.glsl", .ps = "shaders/fs_blackhole.glsl" });
+
+		m_store.declare_texture("slime_albedo", "textures/slime_albedo.png");
+		m_store.declare_texture("slime_normal", "textures/slime_normal.png");
+		m_store.declare_texture("duck_albedo", "textures/duck.png");
+
+		m_store.declare_cubemap("bh_milky_way", {
+			"textures/cubemap/px.png",
+			"textures/cubemap/nx.png",
+			"textures/cubemap/py.png",
+			"textures/cubemap/ny.png",
+			"textures/cubemap/pz.png",
+			"textures/cubemap/nz.png"
+		});
+
+		m_store.declare_cubemap("bh_debug", {
+			"textures/testcube/px.png",
+			"textures/testcube/nx.png",
+			"textures/testcube/py.png",
+			"textures/testcube/ny.png",
+			"textures/testcube/pz.png",
+			"textures/testcube/nz.png"
+		});
+
+		m_store.declare_mesh("duck", { .file = "meshes/duck.txt", .offset = { 0.0f, 0.7f, 0.0f }, .scale = { 0.01f, -0.01f, -0.01f } });
+
+		m_load_scene_blackhole();
 	}
 
 	scene_base& application::get_scene() {
@@ -70,6 +98,10 @@ namespace mini {
 	}
 
 	void application::t_integrate(float delta_time) {
+		m_store.process_uploads(UPLOAD_BUDGET);
+		m_poll_next_scene();
+		m_trim_pool();
+
 		if (m_scene) {
 			m_scene->integrate(delta_time);
 		}
@@ -89,6 +121,10 @@ namespace mini {
 		if (m_scene) {
 			m_scene->gui();
 		}
+
+		if (m_next_scene) {
+			m_draw_loading_window();
+		}
 	}
 
 	void application::t_on_character(unsigned int code) {
@@ -278,43 +314,192 @@ namespace mini {
 		ImGui::End();
 	}
 
-	void application::m_load_scene_spring() {
-		m_scene = std::make_unique<spring_scene>(*this);
+	void application::m_draw_loading_window() {
+		ImGui::SetNextWindowPos(ImVec2(get_width() * 0.5f, get_height() * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+		ImGui::Begin("Loading", nullptr, 
+			ImGuiWindowFlags_NoDecoration | 
+			ImGuiWindowFlags_AlwaysAutoResize | 
+			ImGuiWindowFlags_NoDocking | 
+			ImGuiWindowFlags_NoSavedSettings);
+
+		const auto pending = m_store.get_pending_loads(m_next_manifest);
+
+		if (pending > 0) {
+			ImGui::Text("Loading resources (%d left)...", static_cast<int>(pending));
+		} else {
+			ImGui::Text("Preparing scene...");
+		}
+
+		ImGui::End();
+	}
+
+	void application::m_request_scene(scene_id_t id, const resource_manifest_t& manifest, 
+		std::function<std::unique_ptr<scene_base>()> factory, std::function<void()> job) {
+
+		m_store.prefetch(manifest);
+
+		// a pooled scene carries on where it was left, asking for the one showing starts it over
+		auto pooled = std::find_if(m_pool.begin(), m_pool.end(), [id](const pooled_scene_t& entry) {
+			return entry.id == id;
+		});
+
+		if (pooled != m_pool.end()) {
+			auto entry = std::move(*pooled);
+			m_pool.erase(pooled);
+
+			m_next_scene = nullptr;
+			m_next_manifest = {};
+			m_next_scene_id = scene_id_t::none;
+			m_next_job = std::shared_future<void>();
+
+			m_suspend_scene();
+
+			// the window may have been resized in the meantime
+			entry.saved_camera->video_mode_change(m_context.get_video_mode());
+			m_context.set_camera(std::move(entry.saved_camera));
+			m_context.set_clear_color(entry.clear_color);
+
+			m_scene = std::move(entry.scene);
+			m_scene_manifest = std::move(entry.manifest);
+			m_scene_id = id;
+			m_layout_ready = false;
+			return;
+		}
+
+		// the old scene keeps running until the new one can be built
+		m_next_scene = std::move(factory);
+		m_next_manifest = manifest;
+		m_next_scene_id = id;
+		m_next_job = job ? m_workers.submit(std::move(job)).share() : std::shared_future<void>();
+		m_poll_next_scene();
+	}
+
+	void application::m_poll_next_scene() {
+		// loads other scenes left behind do not hold this one up
+		if (!m_next_scene || m_store.get_pending_loads(m_next_manifest) > 0) {
+			return;
+		}
+
+		if (m_next_job.valid() && m_next_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return;
+		}
+
+		auto factory = std::move(m_next_scene);
+		auto manifest = std::move(m_next_manifest);
+		m_next_scene = nullptr;
+		m_next_manifest = {};
+		m_next_job = std::shared_future<void>();
+
+		if (m_next_scene_id == m_scene_id) {
+			m_scene = nullptr;
+		}
+
+		m_suspend_scene();
+
+		m_scene = factory();
+		m_scene_manifest = std::move(manifest);
+		m_scene_id = m_next_scene_id;
+		m_next_scene_id = scene_id_t::none;
 		m_layout_ready = false;
 	}
 
+	template<typename T> void application::m_request_prepared_scene(scene_id_t id) {
+		auto prepared = std::make_shared<std::shared_ptr<typename T::prepared_t>>();
+
+		m_request_scene(id, T::get_manifest(), 
+			[this, prepared]() { return std::make_unique<T>(*this, std::move(*prepared)); },
+			[prepared]() { *prepared = T::prepare(); });
+	}
+
+	void application::m_suspend_scene() {
+		if (!m_scene) {
+			return;
+		}
+
+		// whatever comes next starts from a fresh camera, as the first scene did
+		auto camera = std::make_unique<default_camera>();
+		camera->video_mode_change(m_context.get_video_mode());
+
+		pooled_scene_t entry;
+		entry.id = m_scene_id;
+		entry.scene = std::move(m_scene);
+		entry.manifest = std::move(m_scene_manifest);
+		entry.saved_camera = m_context.set_camera(std::move(camera));
+		entry.clear_color = m_context.get_clear_color();
+
+		m_pool.insert(m_pool.begin(), std::move(entry));
+		m_scene_manifest = {};
+		m_scene_id = scene_id_t::none;
+	}
+
+	void application::m_trim_pool() {
+		if (m_get_pooled_bytes() <= SCENE_POOL_BUDGET) {
+			return;
+		}
+
+		// the least recently shown scenes go first, the store can evict what they held afterwards
+		while (!m_pool.empty() && m_get_pooled_bytes() > SCENE_POOL_BUDGET) {
+			m_pool.pop_back();
+		}
+
+		m_store.evict_unused();
+	}
+
+	std::size_t application::m_get_pooled_bytes() const {
+		resource_manifest_t held;
+
+		auto gather = [&](std::vector<std::string> resource_manifest_t::* names) {
+			auto contains = [](const std::vector<std::string>& list, const std::string& name) {
+				return std::find(list.begin(), list.end(), name) != list.end();
+			};
+
+			for (const auto& entry : m_pool) {
+				for (const auto& name : entry.manifest.*names) {
+					if (!contains(m_scene_manifest.*names, name) && !contains(m_next_manifest.*names, name) && 
+						!contains(held.*names, name)) {
+						(held.*names).push_back(name);
+					}
+				}
+			}
+		};
+
+		gather(&resource_manifest_t::shaders);
+		gather(&resource_manifest_t::textures);
+		gather(&resource_manifest_t::cubemaps);
+		gather(&resource_manifest_t::meshes);
+
+		return m_store.get_resident_bytes(held);
+	}
+
+	void application::m_load_scene_spring() {
+		m_request_scene(scene_id_t::spring, spring_scene::get_manifest(), [this]() { return std::make_unique<spring_scene>(*this); });
+	}
+
 	void application::m_load_scene_top() {
-		m_scene = std::make_unique<top_scene>(*this);
-		m_layout_ready = false;
+		m_request_scene(scene_id_t::top, top_scene::get_manifest(), [this]() { return std::make_unique<top_scene>(*this); });
 	}
 
 	void application::m_load_scene_rotation() {
-		m_scene = std::make_unique<slerp_scene>(*this);
-		m_layout_ready = false;
+		m_request_scene(scene_id_t::rotation, slerp_scene::get_manifest(), [this]() { return std::make_unique<slerp_scene>(*this); });
 	}
 
 	void application::m_load_scene_soft() {
-		m_scene = std::make_unique<gel_scene>(*this);
-		m_layout_ready = false;
+		m_request_scene(scene_id_t::soft, gel_scene::get_manifest(), [this]() { return std::make_unique<gel_scene>(*this); });
 	}
 
 	void application::m_load_scene_ik() {
-		m_scene = std::make_unique<ik_scene>(*this);
-		m_layout_ready = false;
+		m_request_prepared_scene<ik_scene>(scene_id_t::ik);
 	}
 
 	void application::m_load_scene_puma() {
-		m_scene = std::make_unique<puma_scene>(*this);
-		m_layout_ready = false;
+		m_request_scene(scene_id_t::puma, puma_scene::get_manifest(), [this]() { return std::make_unique<puma_scene>(*this); });
 	}
 	
 	void application::m_load_scene_flywheel() {
-		m_scene = std::make_unique<flywheel_scene>(*this);
-		m_layout_ready = false;
+		m_request_scene(scene_id_t::flywheel, flywheel_scene::get_manifest(), [this]() { return std::make_unique<flywheel_scene>(*this); });
 	}
 
 	void application::m_load_scene_blackhole() {
-		m_scene = std::make_unique<black_hole_scene>(*this);
-		m_layout_ready = false;
+		m_request_prepared_scene<black_hole_scene>(scene_id_t::blackhole);
 	}
 }
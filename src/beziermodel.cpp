@@ -56,6 +56,30 @@ namespace mini {
 		}
 
 		context.set_lights(*m_shader);
-		m_mesh->draw();
+
+		// the deformed model stays in the hull of the control points, and a cubic bezier
+		// stretches its parameter by at most three times the longest control polygon leg
+		glm::vec3 min = m_control_points[0], max = m_control_points[0];
+		float leg = 0.0f;
+
+		for (int index = 0; index < BEZIER_POINT_COUNT; ++index) {
+			min = glm::min(min, m_control_points[index]);
+			max = glm::max(max, m_control_points[index]);
+
+			for (int stride : { 1, 4, 16 }) {
+				if ((index / stride) % 4 != 3) {
+					leg = glm::max(leg, glm::distance(m_control_points[index], m_control_points[index + stride]));
+				}
+			}
+		}
+
+		const glm::vec3 center = 0.5f * (min + max);
+		const float radius = 0.5f * glm::distance(min, max);
+		const float depth = -(view_matrix * glm::vec4(center, 1.0f)).z - radius;
+		const float height = static_cast<float>(context.get_video_mode().get_viewport_height());
+
+		// model units span [-1, 1], half of the [0, 1] bezier parameter range
+		const float scale = 1.5f * leg;
+		m_mesh->draw(m_mesh->select_lod(scale * triangle_mesh::get_pixels_per_unit(proj_matrix, height, depth)));
 	}
 }
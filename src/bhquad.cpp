@@ -13,18 +13,67 @@ namespace mini {
 
 	constexpr unsigned int NUM_QUAD_VERTS = 6;
 
+	// stretches the active target over the viewport, linear filtering upscales the preview
+	static const std::string present_vertex_source = R"(
+		#version 330
+		layout (location = 0) in vec3 a_position;
+		out vec2 v_texcoords;
+		void main () {
+			v_texcoords = 0.5 * a_position.xy + 0.5;
+			gl_Position = vec4 (a_position.xy, 0.5, 1.0);
+		}
+	)";
+
+	static const std::string present_fragment_source = R"(
+		#version 330
+		in vec2 v_texcoords;
+		layout (location = 0) out vec4 v_color;
+		uniform sampler2D u_texture;
+		void main () {
+			v_color = vec4 (texture (u_texture, v_texcoords).rgb, 1.0);
+		}
+	)";
+
+	// radical inverse in base b, consecutive samples fill the pixel evenly
+	static float halton(int index, int base) {
+		float result = 0.0f;
+		float fraction = 1.0f / static_cast<float>(base);
+
+		for (int i = index; i > 0; i /= base) {
+			result += fraction * static_cast<float>(i % base);
+			fraction /= static_cast<float>(base);
+		}
+
+		return result;
+	}
+
 	black_hole_quad::black_hole_quad(
 		std::shared_ptr<shader_program> program, 
 		std::shared_ptr<cubemap> cubemap) : 
 		m_program(program), 
 		m_cubemap(cubemap),
+		m_deflection_texture(0),
 		m_distance(1000.0f),
-		m_star_mass(10.0f) {
+		m_star_mass(10.0f),
+		m_target_fbo{ 0, 0 },
+		m_target_texture{ 0, 0 },
+		m_target_width{ 0, 0 },
+		m_target_height{ 0, 0 },
+		m_last_world(1.0f),
+		m_preview_scale(4),
+		m_max_samples(16),
+		m_num_samples(0),
+		m_active_target(PREVIEW),
+		m_restart(true) {
+
+		m_present_program = std::make_unique<shader_program>(present_vertex_source, present_fragment_source);
+		m_present_program->compile();
 
 		glGenVertexArrays(1, &m_vao);
 		glBindVertexArray(m_vao);
 
 		glGenBuffers(1, &m_pos_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_pos_buffer);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * NUM_QUAD_VERTS * 3, QUAD_POSITIONS.data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(float) * 3, (void*)0);
 		glEnableVertexAttribArray(0);
@@ -40,6 +89,20 @@ namespace mini {
 		if (m_pos_buffer) {
 			glDeleteBuffers(1, &m_pos_buffer);
 		}
+
+		if (m_deflection_texture) {
+			glDeleteTextures(1, &m_deflection_texture);
+		}
+
+		for (int target = 0; target < 2; ++target) {
+			if (m_target_fbo[target]) {
+				glDeleteFramebuffers(1, &m_target_fbo[target]);
+			}
+
+			if (m_target_texture[target]) {
+				glDeleteTextures(1, &m_target_texture[target]);
+			}
+		}
 	}
 
     float black_hole_quad::get_star_mass() const {
@@ -50,44 +113,202 @@ namespace mini {
         return m_distance;
     }
 
+    int black_hole_quad::get_preview_scale() const {
+		return m_preview_scale;
+    }
+
+    int black_hole_quad::get_max_samples() const {
+		return m_max_samples;
+    }
+
+    int black_hole_quad::get_num_samples() const {
+		return m_num_samples;
+    }
+
+    bool black_hole_quad::is_converged() const {
+		return m_num_samples >= m_max_samples;
+    }
+
     void black_hole_quad::set_star_mass(float star_mass) {
+		m_restart = m_restart || star_mass != m_star_mass;
 		m_star_mass = star_mass;
     }
 
     void black_hole_quad::set_distance(float distance) {
+		m_restart = m_restart || distance != m_distance;
 		m_distance = distance;
     }
 
+    void black_hole_quad::set_preview_scale(int scale) {
+		m_preview_scale = glm::max(scale, 1);
+    }
+
+    void black_hole_quad::set_max_samples(int samples) {
+		m_restart = m_restart || samples < m_num_samples;
+		m_max_samples = glm::max(samples, 1);
+    }
+
     void black_hole_quad::set_cube_map(std::shared_ptr<cubemap> cubemap) {
+		m_restart = m_restart || cubemap != m_cubemap;
 		m_cubemap = cubemap;
     }
 
-    void black_hole_quad::render(app_context& context, const glm::mat4x4& world_matrix) const {
-		glBindVertexArray(m_vao);
+    void black_hole_quad::set_deflection_table(const deflection_table& table) {
+		if (!m_deflection_texture) {
+			glGenTextures(1, &m_deflection_texture);
+		}
 
-		m_program->bind();
+		const auto& angles = table.get_angles();
+
+		glBindTexture(GL_TEXTURE_1D, m_deflection_texture);
+		glTexImage1D(GL_TEXTURE_1D, 0, GL_R32F, static_cast<GLsizei>(angles.size()), 0, GL_RED, GL_FLOAT, angles.data());
+
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+
+		glBindTexture(GL_TEXTURE_1D, 0);
+    }
+
+    void black_hole_quad::refine(const glm::mat4x4& world_matrix, const video_mode_t& video_mode) {
+		// the sky may still be streaming in, nothing is traced until it arrives
+		if (!m_cubemap) {
+			m_restart = true;
+			return;
+		}
+
+		const int width = video_mode.get_buffer_width();
+		const int height = video_mode.get_buffer_height();
+
+		const bool moved = m_restart || world_matrix != m_last_world || 
+			width != m_target_width[ACCUMULATION] || height != m_target_height[ACCUMULATION];
+
+		m_last_world = world_matrix;
+		m_restart = false;
 
-		// set uniforms
-		const auto& view_matrix = context.get_view_matrix();
-		const auto& proj_matrix = context.get_projection_matrix();
+		const glm::vec2 resolution = { static_cast<float>(width), static_cast<float>(height) };
 
-		const auto& video_mode = context.get_video_mode();
+		if (moved) {
+			// a cheap preview keeps the view responsive, refinement starts over once it settles
+			const int scale = m_preview_scale;
+			m_resize_target(PREVIEW, (width + scale - 1) / scale, (height + scale - 1) / scale);
+			m_resize_target(ACCUMULATION, width, height);
 
-		glm::vec2 resolution = {
-			static_cast<float>(video_mode.get_buffer_width()),
-			static_cast<float>(video_mode.get_buffer_height())
-		};
+			m_trace(PREVIEW, resolution, { 0.0f, 0.0f }, 1.0f);
 
-		m_program->set_uniform("u_world", world_matrix);
-		m_program->set_uniform("u_view", view_matrix);
-		m_program->set_uniform("u_projection", proj_matrix);
+			m_active_target = PREVIEW;
+			m_num_samples = 0;
+			return;
+		}
+
+		if (is_converged()) {
+			return;
+		}
+
+		// the first sample is the pixel centre like the plain shader, later ones are jittered
+		// inside the pixel and averaged in, which antialiases the photon ring
+		glm::vec2 jitter = { 0.0f, 0.0f };
+		if (m_num_samples > 0) {
+			jitter = glm::vec2{ halton(m_num_samples, 2), halton(m_num_samples, 3) } - 0.5f;
+			jitter = 2.0f * jitter / resolution;
+		}
+
+		m_trace(ACCUMULATION, resolution, jitter, 1.0f / static_cast<float>(m_num_samples + 1));
+
+		m_active_target = ACCUMULATION;
+		m_num_samples++;
+    }
+
+    void black_hole_quad::m_resize_target(int target, int width, int height) {
+		if (m_target_fbo[target] && m_target_width[target] == width && m_target_height[target] == height) {
+			return;
+		}
+
+		if (!m_target_fbo[target]) {
+			glGenFramebuffers(1, &m_target_fbo[target]);
+			glGenTextures(1, &m_target_texture[target]);
+		}
+
+		// half floats keep the running average free of 8 bit banding
+		glBindTexture(GL_TEXTURE_2D, m_target_texture[target]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_target_fbo[target]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_target_texture[target], 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("opengl error: black hole target is not complete");
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		m_target_width[target] = width;
+		m_target_height[target] = height;
+    }
+
+    void black_hole_quad::m_trace(int target, const glm::vec2& resolution, const glm::vec2& jitter, float weight) {
+		glBindFramebuffer(GL_FRAMEBUFFER, m_target_fbo[target]);
+		glViewport(0, 0, m_target_width[target], m_target_height[target]);
+		glDisable(GL_DEPTH_TEST);
+
+		// the running average a += (x - a) / n is done by the blender with a constant weight,
+		// the first sample overwrites whatever the fresh texture holds
+		if (weight < 1.0f) {
+			glEnable(GL_BLEND);
+			glBlendColor(0.0f, 0.0f, 0.0f, weight);
+			glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+		} else {
+			glDisable(GL_BLEND);
+		}
+
+		glBindVertexArray(m_vao);
+		m_program->bind();
+
+		m_program->set_uniform("u_world", m_last_world);
 		m_program->set_uniform("u_resolution", resolution);
+		m_program->set_uniform("u_jitter", jitter);
 		m_program->set_uniform("u_distance", m_distance);
 		m_program->set_uniform("u_star_mass", m_star_mass);
+		m_program->set_uniform("u_deflection_range", static_cast<float>(deflection_table::LOG_RANGE));
+		m_program->set_uniform_sampler("u_sampler", 0);
+		m_program->set_uniform_sampler("u_deflection", 1);
+
+		m_cubemap->bind(GL_TEXTURE0);
 
-		m_cubemap->bind();
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_1D, m_deflection_texture);
+		glActiveTexture(GL_TEXTURE0);
 
 		glDrawArrays(GL_TRIANGLES, 0, NUM_QUAD_VERTS);
 		glBindVertexArray(0);
+
+		// the context expects its own blending and depth state back
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_DEPTH_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void black_hole_quad::render(app_context& context, const glm::mat4x4& world_matrix) const {
+		if (!m_cubemap || !m_target_fbo[m_active_target]) {
+			return;
+		}
+
+		glBindVertexArray(m_vao);
+		m_present_program->bind();
+		m_present_program->set_uniform_sampler("u_texture", 0);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_target_texture[m_active_target]);
+
+		glDrawArrays(GL_TRIANGLES, 0, NUM_QUAD_VERTS);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindVertexArray(0);
 	}
-}
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <map>
+#include <stdexcept>
+
+#include <lodepng.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "lanes.hpp"
+#include "bhrender.hpp"
+
+namespace mini {
+	black_hole_renderer::black_hole_renderer(const deflection_table& deflection, std::shared_ptr<const cubemap_image> sky) :
+		m_deflection(deflection),
+		m_sky(sky) { }
+
+	std::vector<std::uint8_t> black_hole_renderer::render(thread_pool& pool, const view_t& view, stats_t* stats) const {
+		std::vector<std::uint8_t> pixels(4 * static_cast<std::size_t>(view.width) * view.height, 0);
+
+		const int tiles_x = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+		const int tiles_y = (view.height + TILE_SIZE - 1) / TILE_SIZE;
+		const int num_tiles = tiles_x * tiles_y;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// every worker keeps claiming the next free tile, so tiles next to the photon ring
+		// that cost more do not hold up the rest
+		std::atomic<int> next_tile = 0;
+		std::vector<std::future<void>> workers;
+
+		for (std::size_t w = 0; w < pool.get_num_threads(); ++w) {
+			workers.push_back(pool.submit([&]() {
+				for (int tile = next_tile++; tile < num_tiles; tile = next_tile++) {
+					const int x0 = (tile % tiles_x) * TILE_SIZE;
+					const int y0 = (tile / tiles_x) * TILE_SIZE;
+
+					m_render_tile(view, x0, y0, std::min(x0 + TILE_SIZE, view.width), 
+						std::min(y0 + TILE_SIZE, view.height), pixels.data());
+				}
+			}));
+		}
+
+		for (auto& worker : workers) {
+			worker.get();
+		}
+
+		if (stats) {
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			stats->seconds = elapsed.count();
+			stats->rays_per_second = static_cast<double>(view.width) * view.height / std::max(elapsed.count(), 1e-9);
+		}
+
+		return pixels;
+	}
+
+	void black_hole_renderer::m_render_tile(const view_t& view, int x0, int y0, int x1, int y1, std::uint8_t* pixels) const {
+		const auto set = lane4_t::set;
+
+		const float width = static_cast<float>(view.width);
+		const float height = static_cast<float>(view.height);
+		const float aspect = width / height;
+
+		const float D = view.distance;
+		const float M = view.star_mass;
+		const float capture = 27.0f * M * M;
+		const glm::mat3 world(view.world);
+
+		float b2[4], theta[4], out[3][4];
+
+		for (int y = y0; y < y1; ++y) {
+			// the viewport shows the framebuffer with its first row on top, ndc y grows with the row
+			const float ndc_y = (static_cast<float>(y) + 0.5f) / height * 2.0f - 1.0f;
+
+			// rays of four neighbouring pixels are traced together
+			for (int x = x0; x < x1; x += 4) {
+				float view_x[4];
+				for (int i = 0; i < 4; ++i) {
+					view_x[i] = ((static_cast<float>(x + i) + 0.5f) / width * 2.0f - 1.0f) * aspect;
+				}
+
+				// ray from the eye at (0, 0, -1.8) through the image plane z = 0
+				const lane4_t vx = lane4_t::load(view_x);
+				const lane4_t vy = set(-ndc_y);
+				const lane4_t vz = set(1.8f);
+
+				const lane4_t inverse = set(1.0f) / lane4_t::sqrt(vx * vx + vy * vy + vz * vz);
+				const lane4_t rx = vx * inverse;
+				const lane4_t ry = vy * inverse;
+				const lane4_t rz = vz * inverse;
+
+				// closest point to the hole along the ray from the camera at (0, 0, -D)
+				const lane4_t t0 = set(D) * rz;
+				const lane4_t px = t0 * rx;
+				const lane4_t py = t0 * ry;
+				const lane4_t pz = t0 * rz - set(D);
+
+				(px * px + py * py + pz * pz).store(b2);
+
+				for (int i = 0; i < 4; ++i) {
+					theta[i] = (b2[i] > capture) ? m_deflection.sample(M / std::sqrt(b2[i])) : 0.0f;
+				}
+
+				// rodrigues around k = left x forward, which like the shader is not normalized
+				const lane4_t inverse_b = set(1.0f) / lane4_t::sqrt(lane4_t::load(b2) + set(1e-30f));
+				const lane4_t kx = py * inverse_b;
+				const lane4_t ky = set(0.0f) - px * inverse_b;
+
+				lane4_t s, c;
+				lane_sincos(lane4_t::load(theta), s, c);
+
+				const lane4_t k_dot_r = kx * rx + ky * ry;
+				const lane4_t one_c = set(1.0f) - c;
+
+				const lane4_t fx = rx * c + ky * rz * s + kx * k_dot_r * one_c;
+				const lane4_t fy = ry * c - kx * rz * s + ky * k_dot_r * one_c;
+				const lane4_t fz = rz * c + (kx * ry - ky * rx) * s;
+
+				for (int row = 0; row < 3; ++row) {
+					(set(world[0][row]) * fx + set(world[1][row]) * fy + set(world[2][row]) * fz).store(out[row]);
+				}
+
+				for (int i = 0; i < 4 && x + i < x1; ++i) {
+					auto* pixel = pixels + 4 * (static_cast<std::size_t>(y) * view.width + x + i);
+					glm::vec3 color(0.0f);
+
+					if (b2[i] > capture && m_sky) {
+						color = m_sky->sample({ out[0][i], out[1][i], out[2][i] });
+					}
+
+					for (int channel = 0; channel < 3; ++channel) {
+						pixel[channel] = static_cast<std::uint8_t>(glm::clamp(color[channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+					}
+
+					pixel[3] = 255;
+				}
+			}
+		}
+	}
+
+	void black_hole_renderer::save_png(const std::string& path, const std::vector<std::uint8_t>& pixels, int width, int height) {
+		unsigned int error = lodepng::encode(path, pixels, width, height);
+
+		if (error != 0) {
+			throw std::runtime_error("failed to save image: " + std::string(lodepng_error_text(error)));
+		}
+	}
+
+	std::vector<std::uint8_t> black_hole_renderer::load_png(const std::string& path, int& width, int& height) {
+		std::vector<std::uint8_t> pixels;
+		unsigned int w = 0, h = 0;
+		unsigned int error = lodepng::decode(pixels, w, h, path);
+
+		if (error != 0) {
+			throw std::runtime_error("failed to load image: " + std::string(lodepng_error_text(error)));
+		}
+
+		width = static_cast<int>(w);
+		height = static_cast<int>(h);
+
+		return pixels;
+	}
+
+	int black_hole_renderer::run_headless(int argc, char** argv) {
+		if (argc < 3) {
+			std::cerr << "usage: " << argv[0] << " --render-blackhole out.png [--option value]..." << std::endl;
+			return 1;
+		}
+
+		const std::string output = argv[2];
+		std::map<std::string, std::string> options = {
+			{ "--width", "1280" },
+			{ "--height", "720" },
+			{ "--mass", "10" },
+			{ "--distance", "1000" },
+			{ "--yaw", "0" },
+			{ "--pitch", "0" },
+			{ "--cubemap", "textures/cubemap" },
+			{ "--repeat", "1" },
+			{ "--reference", "" },
+			{ "--tolerance", "2" }
+		};
+
+		for (int i = 3; i + 1 < argc; i += 2) {
+			if (options.find(argv[i]) == options.end()) {
+				std::cerr << "unknown option: " << argv[i] << std::endl;
+				return 1;
+			}
+
+			options[argv[i]] = argv[i + 1];
+		}
+
+		try {
+			view_t view;
+			view.width = std::max(std::stoi(options["--width"]), 1);
+			view.height = std::max(std::stoi(options["--height"]), 1);
+			view.star_mass = std::stof(options["--mass"]);
+			view.distance = std::stof(options["--distance"]);
+
+			// same camera as black_hole_scene
+			view.world = glm::mat4x4(1.0f);
+			view.world = glm::rotate(view.world, std::stof(options["--yaw"]), glm::vec3{ 0.0f, 1.0f, 0.0f });
+			view.world = glm::rotate(view.world, std::stof(options["--pitch"]), glm::vec3{ 1.0f, 0.0f, 0.0f });
+
+			const auto& dir = options["--cubemap"];
+			auto sky = std::make_shared<cubemap_image>(std::array<std::string, 6> {
+				dir + "/px.png", dir + "/nx.png", dir + "/py.png", dir + "/ny.png", dir + "/pz.png", dir + "/nz.png"
+			});
+
+			thread_pool pool;
+			deflection_table deflection(pool);
+			black_hole_renderer renderer(deflection, sky);
+
+			std::vector<std::uint8_t> pixels;
+			stats_t best = { 0.0, 0.0 };
+
+			const int repeat = std::max(std::stoi(options["--repeat"]), 1);
+			for (int i = 0; i < repeat; ++i) {
+				stats_t stats;
+				pixels = renderer.render(pool, view, &stats);
+
+				if (i == 0 || stats.seconds < best.seconds) {
+					best = stats;
+				}
+			}
+
+			save_png(output, pixels, view.width, view.height);
+
+			std::cout << view.width << "x" << view.height << " on " << pool.get_num_threads() << " threads: " 
+				<< best.seconds * 1000.0 << " ms, " << best.rays_per_second * 1e-6 << " Mrays/s" << std::endl;
+
+			const auto& reference_path = options["--reference"];
+			if (reference_path.empty()) {
+				return 0;
+			}
+
+			int ref_width = 0, ref_height = 0;
+			const auto reference = load_png(reference_path, ref_width, ref_height);
+
+			if (ref_width != view.width || ref_height != view.height) {
+				std::cerr << "reference is " << ref_width << "x" << ref_height << ", expected " 
+					<< view.width << "x" << view.height << std::endl;
+				return 1;
+			}
+
+			int max_error = 0;
+			double sum_error = 0.0;
+
+			for (std::size_t i = 0; i < pixels.size(); ++i) {
+				const int error = std::abs(static_cast<int>(pixels[i]) - static_cast<int>(reference[i]));
+
+				max_error = std::max(max_error, error);
+				sum_error += error;
+			}
+
+			std::cout << "reference difference: max " << max_error << ", mean " << sum_error / pixels.size() << std::endl;
+			return (max_error > std::stoi(options["--tolerance"])) ? 1 : 0;
+		} catch (const std::exception& e) {
+			std::cerr << "render failed: " << e.what() << std::endl;
+			return 1;
+		}
+	}
+}
\ No newline at end of file
@@ -4,11 +4,6 @@
 #include "cubemap.hpp"
 
 namespace mini {
-    struct side_image_source {
-        std::vector<unsigned char> data;
-        unsigned int width, height;
-    };
-
     cubemap::cubemap(const cubemap_info &info) : m_handle(0) {
         GLuint handle = 0;
         glGenTextures(1, &handle);
@@ -32,6 +27,33 @@ namespace mini {
         m_handle = handle;
     }
 
+    cubemap::cubemap(const std::array<std::shared_ptr<const baked_image>, 6>& faces) : m_handle(0) {
+        GLuint handle = 0;
+        glGenTextures(1, &handle);
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, handle);
+
+        // no shader picks a lod and sampling stays on level 0 like cubemap_image, so cpu
+        // reference renders still match, the rest of the baked chain is left in the file
+        for (auto i = 0UL; i < faces.size(); ++i) {
+            const auto& info = faces[i]->get_level(0);
+            glTexImage2D(
+                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                0, GL_RGBA, info.width, info.height, 
+                0, GL_RGBA, GL_UNSIGNED_BYTE, info.data);
+        }
+
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        m_handle = handle;
+    }
+
     cubemap::~cubemap() {
         if (m_handle) {
             glDeleteTextures(1, &m_handle);
@@ -46,45 +68,111 @@ namespace mini {
     }
 
     std::shared_ptr<cubemap> cubemap::load_from_files(const std::array<std::string, 6> &sides) {
-        std::array<side_image_source, 6> side_images;
-        cubemap_info info;
+        cubemap_image image(sides);
+        return std::make_shared<cubemap>(image.get_info());
+    }
 
+    cubemap_image::cubemap_image() : m_widths{}, m_heights{} {}
+
+    cubemap_image::cubemap_image(const std::array<std::string, 6>& sides) : cubemap_image() {
         for (auto side = 0UL; side < sides.size(); ++side) {
-            const auto& path = sides[side]; 
-            std::fstream stream(path, std::ios::binary | std::ios::in);
-
-            if (!stream) {
-			    throw std::runtime_error ("cannot open file: " + path);
-		    }
-
-            stream.seekg(0, std::ios::end);
-            uint64_t size = stream.tellg();
-            stream.seekg(0, std::ios::beg);
-
-            std::vector<uint8_t> buffer;
-            buffer.resize(size);
-
-            stream.read(reinterpret_cast<char *>(buffer.data()), size);
-            stream.close();
-
-            // decode image
-            unsigned int error = lodepng::decode(
-                side_images[side].data, 
-                side_images[side].width, 
-                side_images[side].height, 
-                buffer);
-
-            if (error != 0) { // failed to load image
-			    throw std::runtime_error("failed to load texture: " + 
-                    std::string(lodepng_error_text (error)));
-		    }
-
-            info.sides[side].data = side_images[side].data.data();
-            info.sides[side].width = side_images[side].width;
-            info.sides[side].height = side_images[side].height;
+            load_side(side, sides[side]);
+        }
+    }
+
+    void cubemap_image::load_side(std::size_t side, const std::string& path) {
+        std::fstream stream(path, std::ios::binary | std::ios::in);
+
+        if (!stream) {
+            throw std::runtime_error ("cannot open file: " + path);
+        }
+
+        stream.seekg(0, std::ios::end);
+        uint64_t size = stream.tellg();
+        stream.seekg(0, std::ios::beg);
+
+        std::vector<uint8_t> buffer;
+        buffer.resize(size);
+
+        stream.read(reinterpret_cast<char *>(buffer.data()), size);
+        stream.close();
+
+        // decode image
+        unsigned int error = lodepng::decode(m_faces[side], m_widths[side], m_heights[side], buffer);
+
+        if (error != 0) { // failed to load image
+            throw std::runtime_error("failed to load texture: " + 
+                std::string(lodepng_error_text (error)));
+        }
+    }
+
+    cubemap_info cubemap_image::get_info() {
+        cubemap_info info;
+
+        for (auto side = 0UL; side < m_faces.size(); ++side) {
+            info.sides[side].data = m_faces[side].data();
+            info.sides[side].width = m_widths[side];
+            info.sides[side].height = m_heights[side];
             info.sides[side].format = GL_RGBA;
         }
 
-        return std::make_shared<cubemap>(info);
+        return info;
+    }
+
+    glm::vec3 cubemap_image::sample(const glm::vec3& direction) const {
+        const glm::vec3 a = glm::abs(direction);
+
+        // face selection and (sc, tc, ma) follow the cube map table of the GL specification
+        int face;
+        float sc, tc, ma;
+
+        if (a.x >= a.y && a.x >= a.z) {
+            face = (direction.x >= 0.0f) ? CUBEMAP_SIDE_RIGHT : CUBEMAP_SIDE_LEFT;
+            sc = (direction.x >= 0.0f) ? -direction.z : direction.z;
+            tc = -direction.y;
+            ma = a.x;
+        } else if (a.y >= a.z) {
+            face = (direction.y >= 0.0f) ? CUBEMAP_SIDE_TOP : CUBEMAP_SIDE_BOTTOM;
+            sc = direction.x;
+            tc = (direction.y >= 0.0f) ? direction.z : -direction.z;
+            ma = a.y;
+        } else {
+            face = (direction.z >= 0.0f) ? CUBEMAP_SIDE_FRONT : CUBEMAP_SIDE_BACK;
+            sc = (direction.z >= 0.0f) ? direction.x : -direction.x;
+            tc = -direction.y;
+            ma = a.z;
+        }
+
+        if (ma <= 0.0f) {
+            return glm::vec3{ 0.0f };
+        }
+
+        const auto& pixels = m_faces[face];
+        const int width = static_cast<int>(m_widths[face]);
+        const int height = static_cast<int>(m_heights[face]);
+
+        // bilinear filtering clamped to the edges of the face, the first image row is t = 0
+        const float u = 0.5f * (sc / ma + 1.0f) * width - 0.5f;
+        const float v = 0.5f * (tc / ma + 1.0f) * height - 0.5f;
+
+        const float fu = std::floor(u);
+        const float fv = std::floor(v);
+        const float du = u - fu;
+        const float dv = v - fv;
+
+        const int x0 = glm::clamp(static_cast<int>(fu), 0, width - 1);
+        const int x1 = glm::clamp(static_cast<int>(fu) + 1, 0, width - 1);
+        const int y0 = glm::clamp(static_cast<int>(fv), 0, height - 1);
+        const int y1 = glm::clamp(static_cast<int>(fv) + 1, 0, height - 1);
+
+        const auto texel = [&](int x, int y) {
+            const auto* p = &pixels[4 * (static_cast<std::size_t>(y) * width + x)];
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        const glm::vec3 top = glm::mix(texel(x0, y0), texel(x1, y0), du);
+        const glm::vec3 bottom = glm::mix(texel(x0, y1), texel(x1, y1), du);
+
+        return glm::mix(top, bottom, dv) * (1.0f / 255.0f);
     }
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <cmath>
+#include <algorithm>
+
+#include "deflection.hpp"
+
+namespace mini {
+	// simpson rule on [a, b] refined where the two halves disagree with the whole
+	template<typename F> static double adaptive_simpson(const F& f, double a, double b, double fa, double fm, double fb, 
+		double whole, double tolerance, int depth) {
+
+		const double m = 0.5 * (a + b);
+		const double lm = 0.5 * (a + m);
+		const double rm = 0.5 * (m + b);
+
+		const double flm = f(lm);
+		const double frm = f(rm);
+
+		const double left = (m - a) / 6.0 * (fa + 4.0 * flm + fm);
+		const double right = (b - m) / 6.0 * (fm + 4.0 * frm + fb);
+		const double delta = left + right - whole;
+
+		if (depth <= 0 || std::abs(delta) <= 15.0 * tolerance) {
+			return left + right + delta / 15.0;
+		}
+
+		return adaptive_simpson(f, a, m, fa, flm, fm, left, 0.5 * tolerance, depth - 1) + 
+			adaptive_simpson(f, m, b, fm, frm, fb, right, 0.5 * tolerance, depth - 1);
+	}
+
+	deflection_table::deflection_table(thread_pool& pool, std::size_t size) {
+		m_angles.resize(std::max<std::size_t>(size, 2));
+
+		const double last = static_cast<double>(m_angles.size() - 1);
+
+		// the quadrature near the photon sphere costs far more, small chunks keep workers busy
+		pool.parallel_for(0, m_angles.size(), 16, [this, last](std::size_t first, std::size_t end) {
+			for (std::size_t i = first; i < end; ++i) {
+				m_angles[i] = static_cast<float>(angle(beta_at(static_cast<double>(i) / last)));
+			}
+		});
+	}
+
+	const std::vector<float>& deflection_table::get_angles() const {
+		return m_angles;
+	}
+
+	std::size_t deflection_table::get_size() const {
+		return m_angles.size();
+	}
+
+	float deflection_table::sample(double beta) const {
+		const double last = static_cast<double>(m_angles.size() - 1);
+		const double x = std::clamp(coordinate_of(beta), 0.0, 1.0) * last;
+
+		const auto index = std::min(static_cast<std::size_t>(x), m_angles.size() - 2);
+		const float t = static_cast<float>(x - static_cast<double>(index));
+
+		return (1.0f - t) * m_angles[index] + t * m_angles[index + 1];
+	}
+
+	double deflection_table::critical_beta() {
+		return 1.0 / std::sqrt(27.0);
+	}
+
+	double deflection_table::beta_at(double x) {
+		return critical_beta() * -std::expm1(-LOG_RANGE * x);
+	}
+
+	double deflection_table::coordinate_of(double beta) {
+		return -std::log1p(-beta / critical_beta()) / LOG_RANGE;
+	}
+
+	double deflection_table::turning_point(double beta) {
+		// with w = b / r the orbit satisfies (dw/dphi)^2 = g(w) = 1 - w^2 + 2 beta w^3, the ray
+		// turns at the first root of g, which lies between 1 and the minimum of g at 1 / (3 beta)
+		const auto g = [beta](double w) { 
+			return 1.0 - w * w + 2.0 * beta * w * w * w; 
+		};
+
+		double lo = 1.0;
+		double hi = (beta > 0.0) ? std::min(1.0 / (3.0 * beta), 2.0) : 1.0;
+
+		for (int i = 0; i < 200 && hi - lo > 1e-15; ++i) {
+			const double mid = 0.5 * (lo + hi);
+
+			if (g(mid) > 0.0) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+
+		return 0.5 * (lo + hi);
+	}
+
+	double deflection_table::angle(double beta, double tolerance) {
+		const double w1 = turning_point(beta);
+
+		// g(w) = (w1 - w) q(w), substituting w = w1 - s^2 cancels the inverse square root at the
+		// turning point and leaves the smooth integrand 2 / sqrt(q(w1 - s^2))
+		const double c1 = 2.0 * beta * w1 - 1.0;
+		const auto f = [beta, w1, c1](double s) {
+			const double w = w1 - s * s;
+			const double q = -(2.0 * beta * w * w + c1 * w + c1 * w1);
+
+			return 2.0 / std::sqrt(std::max(q, 1e-300));
+		};
+
+		const double a = 0.0;
+		const double b = std::sqrt(w1);
+		const double fa = f(a), fm = f(0.5 * b), fb = f(b);
+		const double whole = b / 6.0 * (fa + 4.0 * fm + fb);
+
+		// the ray approaches and leaves symmetrically, the table holds the whole sweep
+		return 2.0 * adaptive_simpson(f, a, b, fa, fm, fb, whole, tolerance, 48);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "fft.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace mini {
+	constexpr double TWO_PI = 6.283185307179586;
+
+	fft_plan::fft_plan(std::size_t size) : m_size(std::max<std::size_t>(size, 1)) {
+		std::size_t rest = m_size;
+
+		for (std::size_t radix : { 4, 2, 3, 5 }) {
+			while (rest % radix == 0) {
+				m_factors.push_back(radix);
+				rest /= radix;
+			}
+		}
+
+		for (std::size_t radix = 7; rest > 1; radix += 2) {
+			while (rest % radix == 0) {
+				m_factors.push_back(radix);
+				rest /= radix;
+			}
+		}
+
+		if (m_factors.empty()) {
+			m_factors.push_back(1);
+		}
+
+		m_twiddles.resize(m_size);
+
+		for (std::size_t i = 0; i < m_size; ++i) {
+			const double angle = -TWO_PI * static_cast<double>(i) / static_cast<double>(m_size);
+			m_twiddles[i] = { static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)) };
+		}
+	}
+
+	std::size_t fft_plan::size() const {
+		return m_size;
+	}
+
+	void fft_plan::forward(const complex_t* input, complex_t* output) const {
+		m_transform(input, output, 1, 0);
+	}
+
+	void fft_plan::m_transform(const complex_t* input, complex_t* output, std::size_t stride, std::size_t factor) const {
+		// decimation in time, the input is split into p interleaved parts that are
+		// transformed into consecutive blocks of m outputs and then merged in place
+		const std::size_t p = m_factors[factor];
+		const std::size_t m = m_size / (stride * p);
+
+		if (m == 1) {
+			for (std::size_t j = 0; j < p; ++j) {
+				output[j] = input[j * stride];
+			}
+		} else {
+			for (std::size_t j = 0; j < p; ++j) {
+				m_transform(input + j * stride, output + j * m, stride * p, factor + 1);
+			}
+		}
+
+		if (p == 1) {
+			return;
+		}
+
+		if (p == 2) {
+			for (std::size_t k = 0; k < m; ++k) {
+				const complex_t a = output[k];
+				const complex_t b = output[k + m] * m_twiddles[k * stride];
+
+				output[k] = a + b;
+				output[k + m] = a - b;
+			}
+
+			return;
+		}
+
+		if (p == 4) {
+			for (std::size_t k = 0; k < m; ++k) {
+				const complex_t a = output[k];
+				const complex_t b = output[k + m] * m_twiddles[k * stride];
+				const complex_t c = output[k + 2 * m] * m_twiddles[2 * k * stride];
+				const complex_t d = output[k + 3 * m] * m_twiddles[3 * k * stride];
+
+				// multiplying by -i swaps the parts and negates the new imaginary one
+				const complex_t s0 = a + c, s1 = a - c;
+				const complex_t s2 = b + d, s3 = b - d;
+				const complex_t s3i = { s3.imag(), -s3.real() };
+
+				output[k] = s0 + s2;
+				output[k + m] = s1 + s3i;
+				output[k + 2 * m] = s0 - s2;
+				output[k + 3 * m] = s1 - s3i;
+			}
+
+			return;
+		}
+
+		// any other radix is a small dft over the twiddled inputs
+		std::vector<complex_t> scratch(p);
+		const std::size_t root = m_size / p;
+
+		for (std::size_t k = 0; k < m; ++k) {
+			for (std::size_t j = 0; j < p; ++j) {
+				scratch[j] = output[k + j * m] * m_twiddles[(j * k * stride) % m_size];
+			}
+
+			for (std::size_t q = 0; q < p; ++q) {
+				complex_t sum = scratch[0];
+				for (std::size_t j = 1; j < p; ++j) {
+					sum += scratch[j] * m_twiddles[((j * q) % p) * root];
+				}
+
+				output[k + q * m] = sum;
+			}
+		}
+	}
+
+	real_fft::real_fft(std::size_t size) :
+		m_size(std::max<std::size_t>(size, 2)),
+		m_plan((m_size % 2 == 0) ? m_size / 2 : m_size) {
+
+		if (m_size % 2 == 0) {
+			const std::size_t half = m_size / 2;
+			m_twiddles.resize(half + 1);
+
+			for (std::size_t k = 0; k <= half; ++k) {
+				const double angle = -TWO_PI * static_cast<double>(k) / static_cast<double>(m_size);
+				m_twiddles[k] = { static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)) };
+			}
+		}
+
+		m_packed.resize(m_plan.size());
+		m_spectrum.resize(m_plan.size());
+	}
+
+	std::size_t real_fft::size() const {
+		return m_size;
+	}
+
+	std::size_t real_fft::num_bins() const {
+		return m_size / 2 + 1;
+	}
+
+	void real_fft::forward(const float* input, complex_t* output) const {
+		if (m_size % 2 != 0) {
+			for (std::size_t i = 0; i < m_size; ++i) {
+				m_packed[i] = input[i];
+			}
+
+			m_plan.forward(m_packed.data(), m_spectrum.data());
+			std::copy(m_spectrum.begin(), m_spectrum.begin() + num_bins(), output);
+
+			return;
+		}
+
+		const std::size_t half = m_size / 2;
+
+		for (std::size_t i = 0; i < half; ++i) {
+			m_packed[i] = { input[2 * i], input[2 * i + 1] };
+		}
+
+		m_plan.forward(m_packed.data(), m_spectrum.data());
+
+		// the even and odd samples are split back out of z = even + i odd
+		for (std::size_t k = 0; k <= half; ++k) {
+			const complex_t z = m_spectrum[k % half];
+			const complex_t zc = std::conj(m_spectrum[(half - k) % half]);
+
+			const complex_t even = 0.5f * (z + zc);
+			const complex_t odd = complex_t(0.0f, -0.5f) * (z - zc);
+
+			output[k] = even + m_twiddles[k] * odd;
+		}
+	}
+
+	spectrum_stream::spectrum_stream() :
+		m_window_size(0),
+		m_hop(1),
+		m_position(0),
+		m_num_samples(0),
+		m_num_windows(0),
+		m_window_norm(1.0) { }
+
+	void spectrum_stream::configure(std::size_t window_size, std::size_t hop) {
+		m_window_size = std::max<std::size_t>(window_size, 2);
+		m_hop = std::clamp<std::size_t>(hop, 1, m_window_size);
+		m_fft = real_fft(m_window_size);
+
+		m_window.resize(m_window_size);
+		m_history.resize(m_window_size);
+		m_frame.resize(m_window_size);
+		m_bins.resize(m_fft.num_bins());
+
+		// periodic hann window, the sum is used to undo its gain on a sine
+		double sum = 0.0;
+		for (std::size_t i = 0; i < m_window_size; ++i) {
+			const double value = 0.5 - 0.5 * std::cos(TWO_PI * static_cast<double>(i) / static_cast<double>(m_window_size));
+			m_window[i] = static_cast<float>(value);
+			sum += value;
+		}
+
+		m_window_norm = sum;
+		reset();
+	}
+
+	void spectrum_stream::reset() {
+		std::fill(m_history.begin(), m_history.end(), 0.0f);
+		m_power_sum.assign(m_bins.size(), 0.0);
+
+		m_position = 0;
+		m_num_samples = 0;
+		m_num_windows = 0;
+	}
+
+	void spectrum_stream::push(float sample) {
+		if (m_window_size == 0) {
+			return;
+		}
+
+		m_history[m_position] = sample;
+		m_position = (m_position + 1) % m_window_size;
+		++m_num_samples;
+
+		if (m_num_samples < m_window_size || (m_num_samples - m_window_size) % m_hop != 0) {
+			return;
+		}
+
+		// the ring buffer starts at the oldest sample
+		for (std::size_t i = 0; i < m_window_size; ++i) {
+			m_frame[i] = m_window[i] * m_history[(m_position + i) % m_window_size];
+		}
+
+		m_fft.forward(m_frame.data(), m_bins.data());
+
+		for (std::size_t k = 0; k < m_bins.size(); ++k) {
+			m_power_sum[k] += std::norm(m_bins[k]);
+		}
+
+		++m_num_windows;
+	}
+
+	std::size_t spectrum_stream::get_window_size() const {
+		return m_window_size;
+	}
+
+	std::size_t spectrum_stream::get_num_windows() const {
+		return m_num_windows;
+	}
+
+	void spectrum_stream::amplitude(std::vector<float>& result) const {
+		result.assign(m_power_sum.size(), 0.0f);
+
+		if (m_num_windows == 0) {
+			return;
+		}
+
+		const double scale = 1.0 / static_cast<double>(m_num_windows);
+
+		for (std::size_t k = 0; k < result.size(); ++k) {
+			// bins other than dc and nyquist also hold the negative frequency half
+			const bool edge = (k == 0) || (2 * k == m_window_size);
+			const double gain = (edge ? 1.0 : 2.0) / m_window_norm;
+
+			result[k] = static_cast<float>(gain * std::sqrt(m_power_sum[k] * scale));
+		}
+	}
+}
@@ -1,13 +1,30 @@
 #define IMGUI_DEFINE_MATH_OPERATORS
 
 #include <iostream>
+#include <string>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "app.hpp"
+#include "bhrender.hpp"
+#include "texcache.hpp"
+#include "mesh.hpp"
 
 int main(int argc, char** argv) {
+	// reference renders need neither a window nor a gl context
+	if (argc > 1 && std::string(argv[1]) == "--render-blackhole") {
+		return mini::black_hole_renderer::run_headless(argc, argv);
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bake-textures") {
+		return mini::texture_cache::run_headless(argc, argv);
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--convert-mesh") {
+		return mini::triangle_mesh::run_headless(argc, argv);
+	}
+
 	// initialize glfw
 	if (!glfwInit()) {
 		std::cerr << "fatal: failed to initialize glfw!" << std::endl;
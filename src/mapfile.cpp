@@ -0,0 +1,128 @@
+#include "mapfile.hpp"
+
+#include <ios>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace mini {
+	mapped_file::mapped_file(const std::string& path) :
+		m_data(nullptr),
+		m_size(0),
+		m_file_handle(nullptr),
+		m_map_handle(nullptr) {
+
+#if defined(__unix__)
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("cannot open file: " + path);
+		}
+
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			::close(fd);
+			throw std::runtime_error("cannot stat file: " + path);
+		}
+
+		m_size = static_cast<std::size_t>(info.st_size);
+
+		if (m_size > 0) {
+			void* view = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (view == MAP_FAILED) {
+				::close(fd);
+				throw std::runtime_error("cannot map file: " + path);
+			}
+
+			// start reading ahead now so the upload on the gl thread does not fault
+			::madvise(view, m_size, MADV_WILLNEED);
+
+			m_map_handle = view;
+			m_data = static_cast<const unsigned char*>(view);
+		}
+
+		// the mapping stays valid after the descriptor is closed
+		::close(fd);
+#elif defined(_WIN32)
+		HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("cannot open file: " + path);
+		}
+
+		LARGE_INTEGER size;
+		if (!::GetFileSizeEx(file, &size)) {
+			::CloseHandle(file);
+			throw std::runtime_error("cannot stat file: " + path);
+		}
+
+		m_file_handle = file;
+		m_size = static_cast<std::size_t>(size.QuadPart);
+
+		if (m_size > 0) {
+			HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			void* view = mapping ? ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+			if (!view) {
+				if (mapping) {
+					::CloseHandle(mapping);
+				}
+
+				::CloseHandle(file);
+				throw std::runtime_error("cannot map file: " + path);
+			}
+
+			m_map_handle = mapping;
+			m_data = static_cast<const unsigned char*>(view);
+		}
+#else
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream) {
+			throw std::runtime_error("cannot open file: " + path);
+		}
+
+		m_fallback.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		m_size = m_fallback.size();
+		m_data = m_fallback.data();
+#endif
+	}
+
+	mapped_file::~mapped_file() {
+#if defined(__unix__)
+		if (m_map_handle) {
+			::munmap(m_map_handle, m_size);
+		}
+#elif defined(_WIN32)
+		if (m_data) {
+			::UnmapViewOfFile(m_data);
+		}
+
+		if (m_map_handle) {
+			::CloseHandle(m_map_handle);
+		}
+
+		if (m_file_handle) {
+			::CloseHandle(m_file_handle);
+		}
+#endif
+	}
+
+	const unsigned char* mapped_file::get_data() const {
+		return m_data;
+	}
+
+	std::size_t mapped_file::get_size() const {
+		return m_size;
+	}
+}
\ No newline at end of file
@@ -1,44 +1,443 @@
 #include <fstream>
+#include <iostream>
+#include <chrono>
 #include <array>
 #include <map>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
 
 #include <glm/gtc/constants.hpp>
 
 #include "mesh.hpp"
+#include "meshopt.hpp"
+#include "mapfile.hpp"
 
 namespace mini {
 	constexpr const uint32_t LAYOUT_POSITION = 0;
 	constexpr const uint32_t LAYOUT_NORMAL = 1;
 	constexpr const uint32_t LAYOUT_UV = 2;
 
-	const std::vector<float>& triangle_mesh::get_positions() const {
-		return m_positions;
-	}
+	static_assert(sizeof(triangle_mesh::vertex_t) == 8 * sizeof(float), "vertex records must be tightly packed");
+	static_assert(sizeof(triangle_mesh::lod_t) == 12, "lod records must be tightly packed");
+
+	namespace {
+		struct binary_header_t {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t num_vertices;
+			uint64_t num_indices;
+			uint64_t num_lods;
+		};
+
+		constexpr uint32_t NO_INDEX = 0xffffffff;
+
+		// walks a mapped text file, numbers go through from_chars so the locale never matters
+		class text_cursor {
+			private:
+				const char* m_current;
+				const char* m_end;
+				std::size_t m_line;
+
+			public:
+				text_cursor(const char* begin, const char* end) : 
+					m_current(begin), 
+					m_end(end), 
+					m_line(1) {}
+
+				std::size_t get_line() const {
+					return m_line;
+				}
+
+				bool at_end() const {
+					return m_current >= m_end;
+				}
+
+				bool at_line_end() const {
+					return m_current >= m_end || *m_current == '\n' || *m_current == '\r' || *m_current == '#';
+				}
+
+				void skip_spaces() {
+					while (m_current < m_end && (*m_current == ' ' || *m_current == '\t')) {
+						++m_current;
+					}
+				}
+
+				void skip_whitespace() {
+					while (m_current < m_end && (*m_current == ' ' || *m_current == '\t' || *m_current == '\r' || *m_current == '\n')) {
+						m_line += (*m_current == '\n') ? 1 : 0;
+						++m_current;
+					}
+				}
+
+				void skip_line() {
+					while (m_current < m_end && *m_current != '\n') {
+						++m_current;
+					}
+
+					if (m_current < m_end) {
+						++m_current;
+						++m_line;
+					}
+				}
+
+				bool consume(char c) {
+					if (m_current < m_end && *m_current == c) {
+						++m_current;
+						return true;
+					}
+
+					return false;
+				}
+
+				std::string_view read_word() {
+					skip_spaces();
+
+					const char* begin = m_current;
+					while (m_current < m_end && *m_current != ' ' && *m_current != '\t' && *m_current != '\r' && *m_current != '\n') {
+						++m_current;
+					}
+
+					return std::string_view(begin, m_current - begin);
+				}
+
+				// reads right at the cursor, callers skip the separators they allow
+				template<typename T> bool read(T& value) {
+					auto [next, error] = std::from_chars(m_current, m_end, value);
+					if (error != std::errc()) {
+						return false;
+					}
+
+					m_current = next;
+					return true;
+				}
+		};
+
+		template<typename T> T expect(text_cursor& cursor, const std::string& path) {
+			T value;
+			cursor.skip_whitespace();
+
+			if (!cursor.read(value)) {
+				throw std::runtime_error(path + ":" + std::to_string(cursor.get_line()) + ": expected a number");
+			}
+
+			return value;
+		}
+
+		triangle_mesh::mesh_data_t parse_text(const char* begin, const char* end, const std::string& path) {
+			text_cursor cursor(begin, end);
+			triangle_mesh::mesh_data_t data;
+
+			const auto num_vertices = expect<uint32_t>(cursor, path);
+			const auto num_indices = expect<uint32_t>(cursor, path);
+
+			data.vertices.resize(num_vertices);
+			data.indices.resize(num_indices);
+
+			for (auto& vertex : data.vertices) {
+				for (int i = 0; i < 3; ++i) {
+					vertex.position[i] = expect<float>(cursor, path);
+				}
+
+				for (int i = 0; i < 3; ++i) {
+					vertex.normal[i] = expect<float>(cursor, path);
+				}
+
+				for (int i = 0; i < 2; ++i) {
+					vertex.uv[i] = expect<float>(cursor, path);
+				}
+			}
+
+			for (auto& index : data.indices) {
+				index = expect<uint32_t>(cursor, path);
+
+				if (index >= num_vertices) {
+					throw std::runtime_error(path + ":" + std::to_string(cursor.get_line()) + ": index out of range");
+				}
+			}
+
+			return data;
+		}
+
+		struct obj_corner_t {
+			uint32_t position, uv, normal;
+		};
+
+		triangle_mesh::mesh_data_t parse_obj(const char* begin, const char* end, const std::string& path) {
+			text_cursor cursor(begin, end);
+			triangle_mesh::mesh_data_t data;
+
+			std::vector<glm::vec3> positions, normals;
+			std::vector<glm::vec2> uvs;
+
+			// every distinct position/uv/normal triple becomes one vertex, the vertices made
+			// from one position are chained so finding a triple is a short walk, not a hash
+			std::vector<uint32_t> position_first;
+			std::vector<uint32_t> vertex_next;
+			std::vector<obj_corner_t> vertex_corners;
+			std::vector<uint32_t> face;
+			bool missing_normals = false;
+
+			auto fail = [&](const char* message) {
+				throw std::runtime_error(path + ":" + std::to_string(cursor.get_line()) + ": " + message);
+			};
+
+			// obj indices start at 1, negative ones count back from the last element
+			auto resolve = [&](int64_t index, std::size_t count) -> uint32_t {
+				const int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(count) + index;
+
+				if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+					fail("index out of range");
+				}
+
+				return static_cast<uint32_t>(resolved);
+			};
+
+			while (true) {
+				cursor.skip_whitespace();
+				if (cursor.at_end()) {
+					break;
+				}
+
+				const auto keyword = cursor.read_word();
+
+				if (keyword == "v" || keyword == "vn") {
+					glm::vec3 value;
+					for (int i = 0; i < 3; ++i) {
+						cursor.skip_spaces();
+						if (!cursor.read(value[i])) {
+							fail("expected a number");
+						}
+					}
+
+					(keyword == "v" ? positions : normals).push_back(value);
+				} else if (keyword == "vt") {
+					glm::vec2 value;
+					for (int i = 0; i < 2; ++i) {
+						cursor.skip_spaces();
+						if (!cursor.read(value[i])) {
+							fail("expected a number");
+						}
+					}
+
+					uvs.push_back(value);
+				} else if (keyword == "f") {
+					face.clear();
+
+					while (true) {
+						cursor.skip_spaces();
+						if (cursor.at_line_end()) {
+							break;
+						}
+
+						int64_t index = 0;
+						obj_corner_t corner = { 0, NO_INDEX, NO_INDEX };
+
+						if (!cursor.read(index)) {
+							fail("malformed face");
+						}
+
+						corner.position = resolve(index, positions.size());
+
+						// v, v/vt, v//vn and v/vt/vn
+						if (cursor.consume('/')) {
+							if (!cursor.consume('/')) {
+								if (!cursor.read(index)) {
+									fail("malformed face");
+								}
+
+								corner.uv = resolve(index, uvs.size());
+								cursor.consume('/');
+							}
+
+							if (cursor.read(index)) {
+								corner.normal = resolve(index, normals.size());
+							}
+						}
+
+						if (position_first.size() < positions.size()) {
+							position_first.resize(positions.size(), NO_INDEX);
+						}
+
+						uint32_t vertex_index = position_first[corner.position];
+						while (vertex_index != NO_INDEX && 
+							(vertex_corners[vertex_index].uv != corner.uv || vertex_corners[vertex_index].normal != corner.normal)) {
+							vertex_index = vertex_next[vertex_index];
+						}
+
+						if (vertex_index == NO_INDEX) {
+							vertex_index = static_cast<uint32_t>(data.vertices.size());
+							vertex_next.push_back(position_first[corner.position]);
+							vertex_corners.push_back(corner);
+							position_first[corner.position] = vertex_index;
+
+							triangle_mesh::vertex_t vertex;
+							vertex.position = positions[corner.position];
+							vertex.uv = corner.uv != NO_INDEX ? uvs[corner.uv] : glm::vec2(0.0f);
+							vertex.normal = corner.normal != NO_INDEX ? normals[corner.normal] : glm::vec3(0.0f);
+
+							missing_normals = missing_normals || corner.normal == NO_INDEX;
+							data.vertices.push_back(vertex);
+						}
+
+						face.push_back(vertex_index);
+					}
+
+					if (face.size() < 3) {
+						fail("face with less than three corners");
+					}
+
+					// polygons are assumed convex and split into a fan
+					for (auto i = 1UL; i + 1 < face.size(); ++i) {
+						data.indices.insert(data.indices.end(), { face[0], face[i], face[i + 1] });
+					}
+				}
+
+				// groups, materials and smoothing groups are not used
+				cursor.skip_line();
+			}
+
+			if (missing_normals) {
+				// smooth normals weighted by triangle area for vertices the file gave none
+				std::vector<glm::vec3> accumulated(data.vertices.size(), glm::vec3(0.0f));
+
+				for (auto i = 0UL; i + 2 < data.indices.size(); i += 3) {
+					const auto& a = data.vertices[data.indices[i + 0]].position;
+					const auto& b = data.vertices[data.indices[i + 1]].position;
+					const auto& c = data.vertices[data.indices[i + 2]].position;
+
+					const auto normal = glm::cross(b - a, c - a);
+					for (auto k = 0; k < 3; ++k) {
+						accumulated[data.indices[i + k]] += normal;
+					}
+				}
+
+				for (auto i = 0UL; i < data.vertices.size(); ++i) {
+					auto& vertex = data.vertices[i];
+					if (vertex.normal == glm::vec3(0.0f) && glm::dot(accumulated[i], accumulated[i]) > 0.0f) {
+						vertex.normal = glm::normalize(accumulated[i]);
+					}
+				}
+			}
+
+			return data;
+		}
+
+		triangle_mesh::mesh_data_t parse_binary(const unsigned char* begin, std::size_t size, const std::string& path) {
+			binary_header_t header;
+
+			if (size < sizeof(header)) {
+				throw std::runtime_error(path + ": truncated mesh");
+			}
+
+			std::memcpy(&header, begin, sizeof(header));
 
-	const std::vector<float>& triangle_mesh::get_normals() const {
-		return m_normals;
+			if (header.magic != triangle_mesh::BINARY_MAGIC || header.version != triangle_mesh::BINARY_VERSION) {
+				throw std::runtime_error(path + ": not a mesh file or unsupported version");
+			}
+
+			const uint64_t vertex_bytes = header.num_vertices * sizeof(triangle_mesh::vertex_t);
+			const uint64_t index_bytes = header.num_indices * sizeof(uint32_t);
+			const uint64_t lod_bytes = header.num_lods * sizeof(triangle_mesh::lod_t);
+
+			if (header.num_vertices > size || header.num_indices > size || header.num_lods > size ||
+				size - sizeof(header) < vertex_bytes + index_bytes + lod_bytes) {
+				throw std::runtime_error(path + ": truncated mesh");
+			}
+
+			triangle_mesh::mesh_data_t data;
+			data.vertices.resize(header.num_vertices);
+			data.indices.resize(header.num_indices);
+			data.lods.resize(header.num_lods);
+
+			std::memcpy(data.vertices.data(), begin + sizeof(header), vertex_bytes);
+			std::memcpy(data.indices.data(), begin + sizeof(header) + vertex_bytes, index_bytes);
+			std::memcpy(data.lods.data(), begin + sizeof(header) + vertex_bytes + index_bytes, lod_bytes);
+
+			for (const auto index : data.indices) {
+				if (index >= header.num_vertices) {
+					throw std::runtime_error(path + ": index out of range");
+				}
+			}
+
+			for (const auto& lod : data.lods) {
+				if (lod.first_index > header.num_indices || lod.num_indices > header.num_indices - lod.first_index) {
+					throw std::runtime_error(path + ": lod out of range");
+				}
+			}
+
+			return data;
+		}
 	}
 
-	const std::vector<float>& triangle_mesh::get_uvs() const {
-		return m_uvs;
+	const std::vector<triangle_mesh::vertex_t>& triangle_mesh::get_vertices() const {
+		return m_vertices;
 	}
 
 	const std::vector<uint32_t>& triangle_mesh::get_indices() const {
 		return m_indices;
 	}
 
+	const std::vector<triangle_mesh::lod_t>& triangle_mesh::get_lods() const {
+		return m_lods;
+	}
+
+	const glm::vec3& triangle_mesh::get_bounds_center() const {
+		return m_bounds_center;
+	}
+
+	float triangle_mesh::get_bounds_radius() const {
+		return m_bounds_radius;
+	}
+
 	triangle_mesh::triangle_mesh(
 		const std::vector<float>& positions, 
 		const std::vector<float>& normals, 
 		const std::vector<float>& uvs, 
 		const std::vector<uint32_t>& indices) {
 
-		m_positions = positions;
-		m_normals = normals;
+		m_vertices.resize(positions.size() / 3);
+
+		for (auto i = 0UL; i < m_vertices.size(); ++i) {
+			auto& vertex = m_vertices[i];
+			vertex.position = { positions[3 * i + 0], positions[3 * i + 1], positions[3 * i + 2] };
+			vertex.normal = glm::vec3(0.0f);
+			vertex.uv = glm::vec2(0.0f);
+
+			if (3 * i + 2 < normals.size()) {
+				vertex.normal = { normals[3 * i + 0], normals[3 * i + 1], normals[3 * i + 2] };
+			}
+
+			if (2 * i + 1 < uvs.size()) {
+				vertex.uv = { uvs[2 * i + 0], uvs[2 * i + 1] };
+			}
+		}
+
 		m_indices = indices;
-		m_uvs = uvs;
+		m_lods = { { 0, static_cast<uint32_t>(m_indices.size()), 0.0f } };
+
+		m_compute_bounds();
+
+		m_array_object = m_vertex_buffer = m_index_buffer = 0;
+		m_initialize();
+	}
+
+	triangle_mesh::triangle_mesh(mesh_data_t data) {
+		m_vertices = std::move(data.vertices);
+		m_indices = std::move(data.indices);
+		m_lods = std::move(data.lods);
+
+		if (m_lods.empty()) {
+			m_lods = { { 0, static_cast<uint32_t>(m_indices.size()), 0.0f } };
+		}
+
+		m_compute_bounds();
 
-		m_array_object = m_position_buffer = m_normal_buffer = m_index_buffer = m_uv_buffer = 0;
+		m_array_object = m_vertex_buffer = m_index_buffer = 0;
 		m_initialize();
 	}
 
@@ -47,58 +446,94 @@ namespace mini {
 	}
 
 	triangle_mesh::triangle_mesh(const triangle_mesh& mesh) {
-		m_positions = mesh.m_positions;
-		m_normals = mesh.m_normals;
+		m_vertices = mesh.m_vertices;
 		m_indices = mesh.m_indices;
-		m_uvs = mesh.m_uvs;
+		m_lods = mesh.m_lods;
+		m_bounds_center = mesh.m_bounds_center;
+		m_bounds_radius = mesh.m_bounds_radius;
 
-		m_array_object = m_position_buffer = m_normal_buffer = m_index_buffer = m_uv_buffer = 0;
+		m_array_object = m_vertex_buffer = m_index_buffer = 0;
 		m_initialize();
 	}
 
 	triangle_mesh& triangle_mesh::operator=(const triangle_mesh& mesh) {
 		m_destroy();
 
-		m_positions = mesh.m_positions;
-		m_normals = mesh.m_normals;
+		m_vertices = mesh.m_vertices;
 		m_indices = mesh.m_indices;
-		m_uvs = mesh.m_uvs;
+		m_lods = mesh.m_lods;
+		m_bounds_center = mesh.m_bounds_center;
+		m_bounds_radius = mesh.m_bounds_radius;
 
-		m_array_object = m_position_buffer = m_normal_buffer = m_index_buffer = m_uv_buffer = 0;
+		m_array_object = m_vertex_buffer = m_index_buffer = 0;
 		m_initialize();
 
 		return (*this);
 	}
 
-	void triangle_mesh::draw() {
+	void triangle_mesh::draw(std::size_t lod) {
+		const auto& level = m_lods[std::min(lod, m_lods.size() - 1)];
+
 		glBindVertexArray(m_array_object);
-		glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, NULL);
+		glDrawElements(GL_TRIANGLES, level.num_indices, GL_UNSIGNED_INT, 
+			reinterpret_cast<const void*>(sizeof(uint32_t) * level.first_index));
 		glBindVertexArray(0);
 	}
 
+	std::size_t triangle_mesh::select_lod(float pixels_per_unit, float max_error) const {
+		std::size_t lod = 0;
+
+		// errors grow with the level, so the first one over the limit ends the search
+		while (lod + 1 < m_lods.size() && m_lods[lod + 1].error * pixels_per_unit <= max_error) {
+			lod++;
+		}
+
+		return lod;
+	}
+
+	float triangle_mesh::get_pixels_per_unit(const glm::mat4x4& projection, float viewport_height, float depth) {
+		// projection[1][1] is the cotangent of half the vertical field of view
+		return projection[1][1] * viewport_height * 0.5f / std::max(depth, 1e-4f);
+	}
+
+	void triangle_mesh::m_compute_bounds() {
+		// center of the box, not the smallest sphere, but good enough for lod picking
+		glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+
+		for (const auto& vertex : m_vertices) {
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+
+		m_bounds_center = m_vertices.empty() ? glm::vec3(0.0f) : 0.5f * (min + max);
+		m_bounds_radius = 0.0f;
+
+		for (const auto& vertex : m_vertices) {
+			m_bounds_radius = std::max(m_bounds_radius, glm::length(vertex.position - m_bounds_center));
+		}
+	}
+
 	void triangle_mesh::m_initialize() {
 		glGenVertexArrays(1, &m_array_object);
-		glGenBuffers(1, &m_position_buffer);
-		glGenBuffers(1, &m_normal_buffer);
-		glGenBuffers(1, &m_uv_buffer);
+		glGenBuffers(1, &m_vertex_buffer);
 		glGenBuffers(1, &m_index_buffer);
 
 		glBindVertexArray(m_array_object);
 
-		// initialize buffers with data
-		glBindBuffer(GL_ARRAY_BUFFER, m_position_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_positions.size(), m_positions.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(LAYOUT_POSITION, 3, GL_FLOAT, false, sizeof(float) * 3, nullptr);
+		// one interleaved buffer, each attribute reads its slice of the vertex record
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_t) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+
+		glVertexAttribPointer(LAYOUT_POSITION, 3, GL_FLOAT, false, sizeof(vertex_t), 
+			reinterpret_cast<const void*>(offsetof(vertex_t, position)));
 		glEnableVertexAttribArray(LAYOUT_POSITION);
 
-		glBindBuffer(GL_ARRAY_BUFFER, m_normal_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_normals.size(), m_normals.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(LAYOUT_NORMAL, 3, GL_FLOAT, false, sizeof(float) * 3, nullptr);
+		glVertexAttribPointer(LAYOUT_NORMAL, 3, GL_FLOAT, false, sizeof(vertex_t), 
+			reinterpret_cast<const void*>(offsetof(vertex_t, normal)));
 		glEnableVertexAttribArray(LAYOUT_NORMAL);
 
-		glBindBuffer(GL_ARRAY_BUFFER, m_uv_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_uvs.size(), m_uvs.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(LAYOUT_UV, 2, GL_FLOAT, false, sizeof(float) * 2, nullptr);
+		glVertexAttribPointer(LAYOUT_UV, 2, GL_FLOAT, false, sizeof(vertex_t), 
+			reinterpret_cast<const void*>(offsetof(vertex_t, uv)));
 		glEnableVertexAttribArray(LAYOUT_UV);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
@@ -112,77 +547,130 @@ namespace mini {
 			glDeleteVertexArrays(1, &m_array_object);
 		}
 
-		if (m_position_buffer != 0) {
-			glDeleteBuffers(1, &m_position_buffer);
+		if (m_vertex_buffer != 0) {
+			glDeleteBuffers(1, &m_vertex_buffer);
 		}
 
-		if (m_normal_buffer != 0) {
-			glDeleteBuffers(1, &m_normal_buffer);
+		if (m_index_buffer != 0) {
+			glDeleteBuffers(1, &m_index_buffer);
 		}
 
-		if (m_uv_buffer != 0) {
-			glDeleteBuffers(1, &m_uv_buffer);
+		m_array_object = m_vertex_buffer = m_index_buffer = 0;
+	}
+
+	triangle_mesh::mesh_data_t triangle_mesh::read_data_from_file(const fs::path& path) {
+		std::unique_ptr<mapped_file> file;
+
+		try {
+			file = std::make_unique<mapped_file>(path.string());
+		} catch (const std::exception&) {
+			throw std::runtime_error("failed to open " + path.string());
 		}
 
-		if (m_index_buffer != 0) {
-			glDeleteBuffers(1, &m_index_buffer);
+		const auto* begin = file->get_data();
+		const auto size = file->get_size();
+		const auto* text = reinterpret_cast<const char*>(begin);
+		const auto extension = path.extension().string();
+
+		if (extension == ".mesh") {
+			return parse_binary(begin, size, path.string());
+		}
+
+		if (extension == ".obj") {
+			return parse_obj(text, text + size, path.string());
+		}
+
+		return parse_text(text, text + size, path.string());
+	}
+
+	triangle_mesh::mesh_data_t triangle_mesh::read_data_from_file(const fs::path& path, const glm::vec3& offset, const glm::vec3& scale) {
+		mesh_data_t data = read_data_from_file(path);
+
+		// normals get the same scale as the positions, the shaders normalize them
+		for (auto& vertex : data.vertices) {
+			vertex.position = vertex.position * scale + offset;
+			vertex.normal = vertex.normal * scale;
 		}
 
-		m_array_object = m_position_buffer = m_normal_buffer = m_index_buffer = 0;
+		// baked lods were measured in file units
+		if (data.lods.empty()) {
+			mesh_optimizer::optimize(data);
+		} else {
+			const auto factor = glm::max(glm::abs(scale.x), glm::max(glm::abs(scale.y), glm::abs(scale.z)));
+			for (auto& lod : data.lods) {
+				lod.error *= factor;
+			}
+		}
+
+		return data;
 	}
 
 	std::shared_ptr<triangle_mesh> triangle_mesh::read_from_file(const fs::path& path, const glm::vec3& offset, const glm::vec3& scale) {
-		std::ifstream file(path);
+		return std::make_shared<triangle_mesh>(read_data_from_file(path, offset, scale));
+	}
+
+	void triangle_mesh::write_data_to_file(const fs::path& path, const mesh_data_t& data) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
 
 		if (!file) {
-			throw new std::runtime_error("failed to open " + path.string());
+			throw std::runtime_error("failed to open " + path.string());
 		}
 
-		std::vector<float> positions;
-		std::vector<float> normals;
-		std::vector<float> uv;
-		std::vector<uint32_t> indices;
+		binary_header_t header = {};
+		header.magic = BINARY_MAGIC;
+		header.version = BINARY_VERSION;
+		header.num_vertices = data.vertices.size();
+		header.num_indices = data.indices.size();
+		header.num_lods = data.lods.size();
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data.vertices.data()), sizeof(vertex_t) * data.vertices.size());
+		file.write(reinterpret_cast<const char*>(data.indices.data()), sizeof(uint32_t) * data.indices.size());
+		file.write(reinterpret_cast<const char*>(data.lods.data()), sizeof(lod_t) * data.lods.size());
 
-		int num_vertices = 0;
-		int num_indices = 0;
+		if (!file) {
+			throw std::runtime_error("failed to write " + path.string());
+		}
+	}
 
-		file >> num_vertices >> num_indices;
+	int triangle_mesh::run_headless(int argc, char** argv) {
+		if (argc < 4) {
+			std::cerr << "usage: " << argv[0] << " --convert-mesh input output.mesh" << std::endl;
+			return 1;
+		}
 
-		positions.resize(num_vertices * 3);
-		normals.resize(num_vertices * 3);
-		uv.resize(num_vertices * 2);
-		indices.resize(num_indices);
-		
-		for (auto i = 0; i < num_vertices; ++i) {
-			file >> positions[3 * i + 0];
-			file >> positions[3 * i + 1];
-			file >> positions[3 * i + 2];
+		using clock = std::chrono::steady_clock;
 
-			positions[3 * i + 0] *= scale.x;
-			positions[3 * i + 1] *= scale.y;
-			positions[3 * i + 2] *= scale.z;
+		try {
+			const auto start = clock::now();
+			auto data = read_data_from_file(argv[2]);
+			const std::chrono::duration<double, std::milli> parse_time = clock::now() - start;
 
-			positions[3 * i + 0] += offset.x;
-			positions[3 * i + 1] += offset.y;
-			positions[3 * i + 2] += offset.z;
+			const auto optimize_start = clock::now();
+			const auto input_triangles = data.indices.size() / 3;
+			mesh_optimizer::optimize(data);
+			const std::chrono::duration<double, std::milli> optimize_time = clock::now() - optimize_start;
 
-			file >> normals[3 * i + 0];
-			file >> normals[3 * i + 1];
-			file >> normals[3 * i + 2];
+			write_data_to_file(argv[3], data);
 
-			normals[3 * i + 0] *= scale.x;
-			normals[3 * i + 1] *= scale.y;
-			normals[3 * i + 2] *= scale.z;
+			const auto reload_start = clock::now();
+			const auto reloaded = read_data_from_file(argv[3]);
+			const std::chrono::duration<double, std::milli> reload_time = clock::now() - reload_start;
 
-			file >> uv[2 * i + 0];
-			file >> uv[2 * i + 1];
-		}
+			std::cout << data.vertices.size() << " vertices, " << input_triangles << " triangles, parsed in " 
+				<< parse_time.count() << " ms, optimized in " << optimize_time.count() << " ms, binary loads in " 
+				<< reload_time.count() << " ms" << std::endl;
 
-		for (auto i = 0; i < num_indices; ++i) {
-			file >> indices[i];
+			for (auto i = 0UL; i < reloaded.lods.size(); ++i) {
+				std::cout << "  lod " << i << ": " << reloaded.lods[i].num_indices / 3 << " triangles, error " 
+					<< reloaded.lods[i].error << std::endl;
+			}
+		} catch (const std::exception& e) {
+			std::cerr << "conversion failed: " << e.what() << std::endl;
+			return 1;
 		}
 
-		return std::make_shared<triangle_mesh>(positions, normals, uv, indices);
+		return 0;
 	}
 
 	std::shared_ptr<triangle_mesh> triangle_mesh::make_plane_mesh() {
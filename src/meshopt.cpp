@@ -0,0 +1,592 @@
+#include "meshopt.hpp"
+
+#include <cmath>
+#include <array>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <cstring>
+#include <algorithm>
+
+namespace mini {
+	namespace {
+		constexpr uint32_t NO_INDEX = 0xffffffff;
+
+		// extra weight of the planes that hold open borders in place
+		constexpr double BORDER_WEIGHT = 10.0;
+
+		enum vertex_kind_t : uint8_t {
+			VERTEX_INTERIOR,
+			VERTEX_BORDER,
+			VERTEX_LOCKED
+		};
+
+		// symmetric 4x4 plane quadric, sum of squared distances to a set of planes
+		struct quadric_t {
+			double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+			void add_plane(const glm::dvec3& n, double d, double weight) {
+				a2 += weight * n.x * n.x; ab += weight * n.x * n.y; ac += weight * n.x * n.z; ad += weight * n.x * d;
+				b2 += weight * n.y * n.y; bc += weight * n.y * n.z; bd += weight * n.y * d;
+				c2 += weight * n.z * n.z; cd += weight * n.z * d;
+				d2 += weight * d * d;
+			}
+
+			void add(const quadric_t& q) {
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+				bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+			}
+
+			double evaluate(const glm::dvec3& p) const {
+				const double value =
+					a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+					2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+					2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+
+				return std::max(value, 0.0);
+			}
+		};
+
+		struct collapse_t {
+			double cost;
+			uint32_t from, to;
+		};
+
+		uint64_t edge_key(uint32_t a, uint32_t b) {
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		// vertex -> triangles in compressed rows
+		void build_adjacency(const std::vector<uint32_t>& indices, std::size_t num_vertices,
+			std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles) {
+
+			offsets.assign(num_vertices + 1, 0);
+			for (const auto index : indices) {
+				offsets[index + 1]++;
+			}
+
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			triangles.resize(indices.size());
+
+			for (auto i = 0UL; i < indices.size(); ++i) {
+				triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	}
+
+	void mesh_optimizer::optimize(mesh_data_t& data) {
+		if (!data.lods.empty() || data.indices.empty()) {
+			return;
+		}
+
+		deduplicate(data);
+
+		std::vector<std::vector<uint32_t>> levels = { data.indices };
+		std::vector<float> errors = { 0.0f };
+
+		optimize_vertex_cache(levels[0], data.vertices.size());
+
+		// each level is simplified from the previous one, the errors add up as a bound
+		while (levels.size() < MAX_LODS) {
+			const std::size_t num_triangles = levels.back().size() / 3;
+			const auto target = static_cast<std::size_t>(static_cast<float>(num_triangles) * LOD_RATIO);
+
+			if (target < MIN_LOD_TRIANGLES) {
+				break;
+			}
+
+			float error = 0.0f;
+			auto level = simplify(data.vertices, levels.back(), target, error);
+
+			// locked seams and borders can stop the collapse early
+			if (level.size() / 3 > num_triangles * 9 / 10) {
+				break;
+			}
+
+			optimize_vertex_cache(level, data.vertices.size());
+
+			errors.push_back(errors.back() + error);
+			levels.push_back(std::move(level));
+		}
+
+		data.indices.clear();
+
+		for (auto i = 0UL; i < levels.size(); ++i) {
+			triangle_mesh::lod_t lod;
+			lod.first_index = static_cast<uint32_t>(data.indices.size());
+			lod.num_indices = static_cast<uint32_t>(levels[i].size());
+			lod.error = errors[i];
+
+			data.lods.push_back(lod);
+			data.indices.insert(data.indices.end(), levels[i].begin(), levels[i].end());
+		}
+
+		optimize_vertex_fetch(data);
+	}
+
+	void mesh_optimizer::deduplicate(mesh_data_t& data) {
+		const auto& vertices = data.vertices;
+
+		std::vector<uint32_t> order(vertices.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		std::sort(order.begin(), order.end(), [&vertices](uint32_t a, uint32_t b) {
+			return std::memcmp(&vertices[a], &vertices[b], sizeof(vertex_t)) < 0;
+		});
+
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<vertex_t> unique;
+		unique.reserve(vertices.size());
+
+		for (auto i = 0UL; i < order.size(); ++i) {
+			if (i == 0 || std::memcmp(&vertices[order[i]], &vertices[order[i - 1]], sizeof(vertex_t)) != 0) {
+				unique.push_back(vertices[order[i]]);
+			}
+
+			remap[order[i]] = static_cast<uint32_t>(unique.size() - 1);
+		}
+
+		for (auto& index : data.indices) {
+			index = remap[index];
+		}
+
+		data.vertices = std::move(unique);
+	}
+
+	void mesh_optimizer::optimize_vertex_cache(std::vector<uint32_t>& indices, std::size_t num_vertices) {
+		const std::size_t num_triangles = indices.size() / 3;
+		if (num_triangles == 0) {
+			return;
+		}
+
+		std::vector<uint32_t> offsets, adjacency;
+		build_adjacency(indices, num_vertices, offsets, adjacency);
+
+		std::vector<uint32_t> live(num_vertices);
+		for (auto v = 0UL; v < num_vertices; ++v) {
+			live[v] = offsets[v + 1] - offsets[v];
+		}
+
+		std::vector<uint32_t> cache_time(num_vertices, 0);
+		std::vector<bool> emitted(num_triangles, false);
+		std::vector<uint32_t> dead_end, candidates, result;
+		result.reserve(indices.size());
+
+		const auto cache_size = static_cast<uint32_t>(CACHE_SIZE);
+		uint32_t time = cache_size + 1;
+		std::size_t cursor = 0;
+
+		// the first vertex with triangles starts the first fan
+		while (cursor < num_vertices && live[cursor] == 0) {
+			cursor++;
+		}
+
+		int64_t fanning = cursor < num_vertices ? static_cast<int64_t>(cursor) : -1;
+
+		while (fanning >= 0) {
+			candidates.clear();
+
+			for (auto k = offsets[fanning]; k < offsets[fanning + 1]; ++k) {
+				const auto triangle = adjacency[k];
+				if (emitted[triangle]) {
+					continue;
+				}
+
+				for (int corner = 0; corner < 3; ++corner) {
+					const auto v = indices[3 * triangle + corner];
+
+					result.push_back(v);
+					dead_end.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+
+					if (time - cache_time[v] > cache_size) {
+						cache_time[v] = time++;
+					}
+				}
+
+				emitted[triangle] = true;
+			}
+
+			// prefer the candidate that stays in the cache longest and still has work left
+			int64_t best = -1;
+			int64_t best_priority = -1;
+
+			for (const auto v : candidates) {
+				if (live[v] == 0) {
+					continue;
+				}
+
+				int64_t priority = 0;
+				if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+					priority = time - cache_time[v];
+				}
+
+				if (priority > best_priority) {
+					best_priority = priority;
+					best = v;
+				}
+			}
+
+			if (best < 0) {
+				while (!dead_end.empty() && best < 0) {
+					const auto v = dead_end.back();
+					dead_end.pop_back();
+
+					if (live[v] > 0) {
+						best = v;
+					}
+				}
+			}
+
+			while (best < 0 && cursor < num_vertices) {
+				if (live[cursor] > 0) {
+					best = static_cast<int64_t>(cursor);
+				}
+
+				cursor++;
+			}
+
+			fanning = best;
+		}
+
+		indices = std::move(result);
+	}
+
+	void mesh_optimizer::optimize_vertex_fetch(mesh_data_t& data) {
+		std::vector<uint32_t> remap(data.vertices.size(), NO_INDEX);
+		std::vector<vertex_t> ordered;
+		ordered.reserve(data.vertices.size());
+
+		for (auto& index : data.indices) {
+			if (remap[index] == NO_INDEX) {
+				remap[index] = static_cast<uint32_t>(ordered.size());
+				ordered.push_back(data.vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		data.vertices = std::move(ordered);
+	}
+
+	std::vector<uint32_t> mesh_optimizer::simplify(
+		const std::vector<vertex_t>& vertices,
+		const std::vector<uint32_t>& indices,
+		std::size_t target_triangles,
+		float& error) {
+
+		const std::size_t num_vertices = vertices.size();
+		std::vector<uint32_t> result(indices);
+		double max_error = 0.0;
+
+		// vertices that share a position are one surface point split by uvs or normals,
+		// edges are compared by position so such seams are not taken for open borders
+		std::vector<uint32_t> group(num_vertices);
+		std::vector<uint32_t> group_size(num_vertices, 0);
+		{
+			std::vector<uint32_t> order(num_vertices);
+			std::iota(order.begin(), order.end(), 0);
+
+			auto less = [&vertices](uint32_t a, uint32_t b) {
+				const auto& pa = vertices[a].position;
+				const auto& pb = vertices[b].position;
+				return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+			};
+
+			std::sort(order.begin(), order.end(), less);
+
+			for (auto i = 0UL; i < order.size(); ++i) {
+				const bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+				group[order[i]] = same ? group[order[i - 1]] : order[i];
+				group_size[group[order[i]]]++;
+			}
+		}
+
+		auto position = [&vertices](uint32_t v) {
+			return glm::dvec3(vertices[v].position);
+		};
+
+		std::vector<uint64_t> edges, border_edges;
+		std::vector<uint8_t> border_count(num_vertices);
+		std::vector<vertex_kind_t> kind(num_vertices);
+
+		// border edges appear in exactly one triangle
+		auto classify = [&]() {
+			edges.clear();
+			for (auto i = 0UL; i < result.size(); i += 3) {
+				for (int k = 0; k < 3; ++k) {
+					edges.push_back(edge_key(group[result[i + k]], group[result[i + (k + 1) % 3]]));
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+
+			border_edges.clear();
+			for (auto i = 0UL; i < edges.size(); ) {
+				auto j = i;
+				while (j < edges.size() && edges[j] == edges[i]) {
+					j++;
+				}
+
+				if (j - i == 1) {
+					border_edges.push_back(edges[i]);
+				}
+
+				i = j;
+			}
+
+			std::fill(border_count.begin(), border_count.end(), 0);
+			for (const auto key : border_edges) {
+				const auto a = static_cast<uint32_t>(key >> 32);
+				const auto b = static_cast<uint32_t>(key & 0xffffffff);
+				border_count[a] = static_cast<uint8_t>(std::min(border_count[a] + 1, 255));
+				border_count[b] = static_cast<uint8_t>(std::min(border_count[b] + 1, 255));
+			}
+
+			for (auto v = 0UL; v < num_vertices; ++v) {
+				const auto count = border_count[group[v]];
+
+				if (group_size[group[v]] > 1 || (count != 0 && count != 2)) {
+					kind[v] = VERTEX_LOCKED;
+				} else {
+					kind[v] = count == 2 ? VERTEX_BORDER : VERTEX_INTERIOR;
+				}
+			}
+		};
+
+		auto is_border_edge = [&](uint32_t a, uint32_t b) {
+			return std::binary_search(border_edges.begin(), border_edges.end(), edge_key(group[a], group[b]));
+		};
+
+		classify();
+
+		// area weighted face planes, plus planes standing on the borders
+		std::vector<quadric_t> quadrics(num_vertices, quadric_t{});
+		std::vector<double> weights(num_vertices, 0.0);
+
+		for (auto i = 0UL; i < result.size(); i += 3) {
+			const glm::dvec3 p0 = position(result[i + 0]);
+			const glm::dvec3 p1 = position(result[i + 1]);
+			const glm::dvec3 p2 = position(result[i + 2]);
+
+			const glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+			const double length = glm::length(cross);
+			if (length <= 0.0) {
+				continue;
+			}
+
+			const glm::dvec3 normal = cross / length;
+			const double area = 0.5 * length;
+
+			for (int k = 0; k < 3; ++k) {
+				const auto v = result[i + k];
+				quadrics[v].add_plane(normal, -glm::dot(normal, p0), area);
+				weights[v] += area;
+
+				const auto w = result[i + (k + 1) % 3];
+				if (is_border_edge(v, w)) {
+					const glm::dvec3 edge = position(w) - position(v);
+					const glm::dvec3 side = glm::normalize(glm::cross(edge, normal));
+					const double edge_weight = BORDER_WEIGHT * glm::dot(edge, edge);
+
+					quadrics[v].add_plane(side, -glm::dot(side, position(v)), edge_weight);
+					quadrics[w].add_plane(side, -glm::dot(side, position(v)), edge_weight);
+				}
+			}
+		}
+
+		std::vector<uint32_t> offsets, adjacency;
+		std::vector<collapse_t> collapses;
+		std::vector<uint32_t> remap(num_vertices);
+		std::vector<bool> touched(num_vertices);
+
+		// the vertex each input vertex was collapsed into, collapses never move a vertex so
+		// the removed ones still say where the input surface was
+		std::vector<uint32_t> owner(num_vertices);
+		std::iota(owner.begin(), owner.end(), 0);
+
+		// moving from onto to must not turn any remaining triangle of from over
+		auto flips = [&](uint32_t from, uint32_t to) {
+			for (auto k = offsets[from]; k < offsets[from + 1]; ++k) {
+				const auto* triangle = &result[3 * adjacency[k]];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+					continue;
+				}
+
+				std::array<glm::dvec3, 3> before, after;
+				for (int c = 0; c < 3; ++c) {
+					before[c] = position(triangle[c]);
+					after[c] = position(triangle[c] == from ? to : triangle[c]);
+				}
+
+				const auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+				if (glm::dot(n0, n1) <= 0.25 * glm::length(n0) * glm::length(n1)) {
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		// independent collapses are picked greedily per pass, cheapest first
+		while (result.size() / 3 > target_triangles) {
+			build_adjacency(result, num_vertices, offsets, adjacency);
+
+			collapses.clear();
+			for (auto i = 0UL; i < result.size(); i += 3) {
+				for (int k = 0; k < 3; ++k) {
+					const auto a = result[i + k];
+					const auto b = result[i + (k + 1) % 3];
+
+					// the neighbour across an inner edge offers the other direction
+					const bool border = (kind[a] == VERTEX_BORDER || kind[b] == VERTEX_BORDER) && is_border_edge(a, b);
+
+					for (const auto& [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+						if (kind[from] == VERTEX_LOCKED || (kind[from] == VERTEX_BORDER && !border)) {
+							continue;
+						}
+
+						const double cost = quadrics[from].evaluate(position(to)) / std::max(weights[from], 1e-12);
+						collapses.push_back({ cost, from, to });
+
+						if (!border) {
+							break;
+						}
+					}
+				}
+			}
+
+			if (collapses.empty()) {
+				break;
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const collapse_t& a, const collapse_t& b) {
+				return a.cost < b.cost;
+			});
+
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), false);
+
+			const std::size_t to_remove = result.size() / 3 - target_triangles;
+			std::size_t removed = 0;
+			std::size_t num_collapsed = 0;
+
+			for (const auto& collapse : collapses) {
+				if (removed >= to_remove) {
+					break;
+				}
+
+				if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to)) {
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				weights[collapse.to] += weights[collapse.from];
+
+
+				// keep neighbourhoods apart so every flip test in this pass stays valid
+				for (auto k = offsets[collapse.from]; k < offsets[collapse.from + 1]; ++k) {
+					const auto* triangle = &result[3 * adjacency[k]];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+
+				touched[collapse.to] = true;
+				removed += kind[collapse.from] == VERTEX_BORDER ? 1 : 2;
+				num_collapsed++;
+			}
+
+			if (num_collapsed == 0) {
+				break;
+			}
+
+			// drop the triangles that lost an edge
+			std::size_t write = 0;
+			for (auto i = 0UL; i < result.size(); i += 3) {
+				const auto a = remap[result[i + 0]];
+				const auto b = remap[result[i + 1]];
+				const auto c = remap[result[i + 2]];
+
+				if (a != b && b != c && a != c) {
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+			}
+
+			result.resize(write);
+			classify();
+
+			for (auto& v : owner) {
+				v = remap[v];
+			}
+		}
+
+		// the costs only rank collapses by a mean over each quadric's planes, the error is the
+		// farthest any removed vertex lies from the triangles around the vertex that took it
+		build_adjacency(result, num_vertices, offsets, adjacency);
+
+		for (const auto v : indices) {
+			const auto kept = owner[v];
+			if (kept == v) {
+				continue;
+			}
+
+			const glm::dvec3 p = position(v);
+			double nearest = std::numeric_limits<double>::max();
+
+			for (auto k = offsets[kept]; k < offsets[kept + 1]; ++k) {
+				const auto* triangle = &result[3 * adjacency[k]];
+				const glm::dvec3 p0 = position(triangle[0]);
+				const glm::dvec3 cross = glm::cross(position(triangle[1]) - p0, position(triangle[2]) - p0);
+				const double length = glm::length(cross);
+
+				if (length > 0.0) {
+					nearest = std::min(nearest, std::abs(glm::dot(cross, p - p0)) / length);
+				}
+			}
+
+			// a vertex whose triangles all collapsed away is measured to the one it went to
+			if (nearest == std::numeric_limits<double>::max()) {
+				nearest = glm::distance(p, position(kept));
+			}
+
+			max_error = std::max(max_error, nearest);
+		}
+
+		error = static_cast<float>(max_error);
+		return result;
+	}
+
+	float mesh_optimizer::average_cache_miss_ratio(const std::vector<uint32_t>& indices, std::size_t num_vertices) {
+		if (indices.size() < 3) {
+			return 0.0f;
+		}
+
+		std::deque<uint32_t> cache;
+		std::vector<bool> cached(num_vertices, false);
+		std::size_t misses = 0;
+
+		for (const auto index : indices) {
+			if (cached[index]) {
+				continue;
+			}
+
+			misses++;
+			cache.push_back(index);
+			cached[index] = true;
+
+			if (cache.size() > CACHE_SIZE) {
+				cached[cache.front()] = false;
+				cache.pop_front();
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	}
+}
\ No newline at end of file
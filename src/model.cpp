@@ -28,6 +28,15 @@ namespace mini {
 		m_shader->set_uniform("u_shininess", 0.0f);
 
 		context.set_lights(*m_shader);
-		m_mesh->draw();
+
+		// the bounding sphere goes through the world matrix, its nearest point sets the detail
+		const glm::vec3 center = view_matrix * world_matrix * glm::vec4(m_mesh->get_bounds_center(), 1.0f);
+		const float scale = glm::max(glm::length(glm::vec3(world_matrix[0])),
+			glm::max(glm::length(glm::vec3(world_matrix[1])), glm::length(glm::vec3(world_matrix[2]))));
+
+		const float depth = -center.z - scale * m_mesh->get_bounds_radius();
+		const float height = static_cast<float>(context.get_video_mode().get_viewport_height());
+
+		m_mesh->draw(m_mesh->select_lod(scale * triangle_mesh::get_pixels_per_unit(proj_matrix, height, depth)));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <array>
+
+#include "pointcloud.hpp"
+
+namespace mini {
+	constexpr std::array<float, 8> point_cloud_quad = {
+		-1.0f, -1.0f,
+		 1.0f, -1.0f,
+		-1.0f,  1.0f,
+		 1.0f,  1.0f
+	};
+
+	point_cloud::point_cloud(std::shared_ptr<shader_program> shader) {
+		m_shader = shader;
+
+		m_vao = 0;
+		m_quad_buffer = 0;
+		m_instance_buffer = 0;
+		m_num_points = 0;
+		m_point_size = 6.0f;
+		m_ready = false;
+	}
+
+	point_cloud::~point_cloud() {
+		m_free_buffers();
+	}
+
+	float point_cloud::get_point_size() const {
+		return m_point_size;
+	}
+
+	void point_cloud::set_point_size(float size) {
+		m_point_size = size;
+	}
+
+	std::size_t point_cloud::get_num_points() const {
+		return m_num_points;
+	}
+
+	void point_cloud::clear() {
+		m_instances.clear();
+	}
+
+	void point_cloud::add_point(const glm::vec3& position, const glm::vec4& color) {
+		m_instances.push_back(position.x);
+		m_instances.push_back(position.y);
+		m_instances.push_back(position.z);
+		m_instances.push_back(color.r);
+		m_instances.push_back(color.g);
+		m_instances.push_back(color.b);
+		m_instances.push_back(color.a);
+	}
+
+	void point_cloud::rebuild_buffers() {
+		constexpr GLuint a_corner = 0;
+		constexpr GLuint a_center = 1;
+		constexpr GLuint a_color = 2;
+		constexpr GLsizei stride = sizeof(float) * 7;
+
+		if (!m_ready) {
+			glGenVertexArrays(1, &m_vao);
+			glGenBuffers(1, &m_quad_buffer);
+			glGenBuffers(1, &m_instance_buffer);
+
+			glBindVertexArray(m_vao);
+
+			glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * point_cloud_quad.size(), point_cloud_quad.data(), GL_STATIC_DRAW);
+			glVertexAttribPointer(a_corner, 2, GL_FLOAT, false, sizeof(float) * 2, (void*)0);
+			glEnableVertexAttribArray(a_corner);
+
+			// per instance attributes advance once per point instead of once per corner
+			glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+			glVertexAttribPointer(a_center, 3, GL_FLOAT, false, stride, (void*)0);
+			glEnableVertexAttribArray(a_center);
+			glVertexAttribDivisor(a_center, 1);
+
+			glVertexAttribPointer(a_color, 4, GL_FLOAT, false, stride, (void*)(sizeof(float) * 3));
+			glEnableVertexAttribArray(a_color);
+			glVertexAttribDivisor(a_color, 1);
+
+			glBindVertexArray(0);
+			m_ready = true;
+		}
+
+		m_num_points = m_instances.size() / 7;
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_instances.size(), m_instances.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void point_cloud::render(app_context& context, const glm::mat4x4& world_matrix) const {
+		if (!m_ready || m_num_points == 0) {
+			return;
+		}
+
+		const auto& view_matrix = context.get_view_matrix();
+		const auto& proj_matrix = context.get_projection_matrix();
+		const auto& video_mode = context.get_video_mode();
+
+		glm::vec2 resolution = {
+			static_cast<float> (video_mode.get_buffer_width()),
+			static_cast<float> (video_mode.get_buffer_height())
+		};
+
+		m_shader->bind();
+		m_shader->set_uniform("u_world", world_matrix);
+		m_shader->set_uniform("u_view", view_matrix);
+		m_shader->set_uniform("u_projection", proj_matrix);
+		m_shader->set_uniform("u_resolution", resolution);
+		m_shader->set_uniform("u_size", m_point_size);
+
+		glBindVertexArray(m_vao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(m_num_points));
+		glBindVertexArray(0);
+	}
+
+	void point_cloud::m_free_buffers() {
+		if (m_vao) {
+			glDeleteVertexArrays(1, &m_vao);
+			m_vao = 0;
+		}
+
+		if (m_quad_buffer) {
+			glDeleteBuffers(1, &m_quad_buffer);
+			m_quad_buffer = 0;
+		}
+
+		if (m_instance_buffer) {
+			glDeleteBuffers(1, &m_instance_buffer);
+			m_instance_buffer = 0;
+		}
+
+		m_ready = false;
+	}
+}
\ No newline at end of file
@@ -1,39 +1,49 @@
 #include <iostream>
+#include <format>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "gui.hpp"
 #include "scenes/blackhole.hpp"
 
 namespace mini {
-	black_hole_scene::black_hole_scene(application_base& app) : 
+	resource_manifest_t black_hole_scene::get_manifest() {
+		return { .shaders = { "blackhole" }, .cubemaps = { "bh_milky_way", "bh_debug" } };
+	}
+
+	std::shared_ptr<black_hole_scene::prepared_t> black_hole_scene::prepare() {
+		auto workers = std::make_unique<thread_pool>();
+		deflection_table deflection(*workers);
+
+		return std::make_shared<prepared_t>(prepared_t { std::move(workers), std::move(deflection) });
+	}
+
+	black_hole_scene::black_hole_scene(application_base& app, std::shared_ptr<prepared_t> prepared) : 
+		black_hole_scene(app, std::move(*(prepared ? prepared : prepare()))) {
+	}
+
+	black_hole_scene::black_hole_scene(application_base& app, prepared_t&& prepared) : 
 		scene_base(app), 
+		m_workers(std::move(prepared.workers)),
+		m_deflection(std::move(prepared.deflection)),
 		m_last_vp_width(0), 
 		m_last_vp_height(0),
 		m_selected_map(0),
 		m_cam_pitch(0.0f),
 		m_cam_yaw(0.0f),
-		m_viewport_focus(false) {
-
-		const std::array<std::string, 6> test_cubemap_files = {
-			"textures/testcube/px.png",
-			"textures/testcube/nx.png",
-			"textures/testcube/py.png",
-			"textures/testcube/ny.png",
-			"textures/testcube/pz.png",
-			"textures/testcube/nz.png"
-		};
-
-		const std::array<std::string, 6> space_cubemap_files = {
-			"textures/cubemap/px.png",
-			"textures/cubemap/nx.png",
-			"textures/cubemap/py.png",
-			"textures/cubemap/ny.png",
-			"textures/cubemap/pz.png",
-			"textures/cubemap/nz.png"
-		};
-
-		m_cubemaps.push_back({ "Milky Way", cubemap::load_from_files(space_cubemap_files) });
-		m_cubemaps.push_back({ "Debug", cubemap::load_from_files(test_cubemap_files) });
+		m_viewport_focus(false),
+		m_reference_path("blackhole_reference.png") {
+
+		// the faces are decoded in the background, the sky shows up once they are uploaded
+		auto& store = app.get_store();
+		m_cubemap_requests.push_back(store.get_cubemap("bh_milky_way"));
+		m_cubemap_requests.push_back(store.get_cubemap("bh_debug"));
+
+		m_cubemaps.push_back({ "Milky Way", nullptr });
+		m_cubemaps.push_back({ "Debug", nullptr });
+
+		// the cpu reference render reads the same faces
+		m_cubemap_files.push_back(store.get_cubemap_files("bh_milky_way"));
+		m_cubemap_files.push_back(store.get_cubemap_files("bh_debug"));
 
 		auto bh_shader = app.get_store().get_shader("blackhole");
 		if (!bh_shader) {
@@ -42,6 +52,10 @@ namespace mini {
 		
 		m_screenquad = std::make_shared<black_hole_quad>(
 			bh_shader, m_cubemaps[m_selected_map].second);
+		m_screenquad->set_deflection_table(m_deflection);
+
+		// maps loaded by an earlier visit are ready right away
+		m_poll_cubemaps();
 	}
 
 	black_hole_scene::~black_hole_scene() {
@@ -56,6 +70,9 @@ namespace mini {
 	}
 
 	void black_hole_scene::integrate(float delta_time) {
+		m_poll_cubemaps();
+		m_poll_reference_render();
+
 		if (get_app().is_left_click() && m_viewport_focus) {
 			const offset_t& last_pos = get_app().get_last_mouse_offset();
 			const offset_t& curr_pos = get_app().get_mouse_offset();
@@ -75,10 +92,9 @@ namespace mini {
 	}
 
 	void black_hole_scene::render(app_context& context) {
-		glm::mat4x4 world(1.0f);
-		world = glm::rotate(world, m_cam_yaw, glm::vec3 {0.0f, 1.0f, 0.0f});
-		world = glm::rotate(world, m_cam_pitch, glm::vec3 {1.0f, 0.0f, 0.0f});
+		const auto world = m_world_matrix();
 
+		m_screenquad->refine(world, context.get_video_mode());
 		context.draw(m_screenquad, world);
 	}
 
@@ -93,6 +109,81 @@ namespace mini {
 		}
 	}
 
+	glm::mat4x4 black_hole_scene::m_world_matrix() const {
+		glm::mat4x4 world(1.0f);
+		world = glm::rotate(world, m_cam_yaw, glm::vec3 {0.0f, 1.0f, 0.0f});
+		world = glm::rotate(world, m_cam_pitch, glm::vec3 {1.0f, 0.0f, 0.0f});
+
+		return world;
+	}
+
+	void black_hole_scene::m_start_reference_render() {
+		if (m_reference_task.valid()) {
+			return;
+		}
+
+		// the cpu render matches what the viewport currently shows
+		black_hole_renderer::view_t view;
+		view.width = std::max(m_last_vp_width, 1);
+		view.height = std::max(m_last_vp_height, 1);
+		view.world = m_world_matrix();
+		view.distance = m_screenquad->get_distance();
+		view.star_mass = m_screenquad->get_star_mass();
+
+		auto files = m_cubemap_files[m_selected_map];
+		auto path = m_reference_path;
+
+		// tiles go to the pool, so the job that waits on them runs on its own thread
+		m_reference_task = std::async(std::launch::async, [this, view, files, path]() -> std::string {
+			try {
+				auto sky = std::make_shared<cubemap_image>(files);
+				black_hole_renderer renderer(m_deflection, sky);
+
+				black_hole_renderer::stats_t stats;
+				auto pixels = renderer.render(*m_workers, view, &stats);
+				black_hole_renderer::save_png(path, pixels, view.width, view.height);
+
+				return std::format("{}x{} in {:.1f} ms ({:.2f} Mrays/s), saved to {}", view.width, view.height, 
+					stats.seconds * 1000.0, stats.rays_per_second * 1e-6, path);
+			} catch (const std::exception& e) {
+				return std::string("render failed: ") + e.what();
+			}
+		});
+	}
+
+	void black_hole_scene::m_poll_cubemaps() {
+		for (auto i = 0UL; i < m_cubemap_requests.size(); ++i) {
+			auto& request = m_cubemap_requests[i];
+
+			if (!request.valid() || request.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				continue;
+			}
+
+			// the store already reported the failure, the map just stays empty
+			try {
+				m_cubemaps[i].second = request.get();
+			} catch (const std::exception&) {
+				m_cubemaps[i].second = nullptr;
+			}
+
+			request = cubemap_future_t();
+
+			if (static_cast<int>(i) == m_selected_map) {
+				m_screenquad->set_cube_map(m_cubemaps[i].second);
+			}
+		}
+	}
+
+	void black_hole_scene::m_poll_reference_render() {
+		if (!m_reference_task.valid()) {
+			return;
+		}
+
+		if (m_reference_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			m_reference_status = m_reference_task.get();
+		}
+	}
+
 	void black_hole_scene::m_gui_viewport() {
 		auto& context = get_app().get_context();
 
@@ -166,9 +257,56 @@ namespace mini {
 			ImGui::EndCombo();
 		}
 
+		if (m_cubemap_requests[m_selected_map].valid()) {
+			ImGui::Text("Loading cubemap...");
+		} else if (!m_cubemaps[m_selected_map].second) {
+			ImGui::Text("Cubemap failed to load");
+		}
+
 		m_screenquad->set_distance(distance);
 		m_screenquad->set_star_mass(star_mass);
 
+		if (ImGui::CollapsingHeader("Progressive Rendering", ImGuiTreeNodeFlags_DefaultOpen)) {
+			constexpr const char* scales[] = { "1/1", "1/2", "1/4", "1/8" };
+
+			int scale_id = 0;
+			while ((1 << (scale_id + 1)) <= m_screenquad->get_preview_scale() && scale_id < 3) {
+				scale_id++;
+			}
+
+			gui::prefix_label("Preview res.: ", 250.0f);
+			if (ImGui::Combo("##bh_preview_scale", &scale_id, scales, 4)) {
+				m_screenquad->set_preview_scale(1 << scale_id);
+			}
+
+			int samples = m_screenquad->get_max_samples();
+			gui::prefix_label("Samples: ", 250.0f);
+			if (ImGui::SliderInt("##bh_samples", &samples, 1, 64)) {
+				m_screenquad->set_max_samples(samples);
+			}
+
+			if (m_screenquad->is_converged()) {
+				ImGui::Text("Converged after %d samples", m_screenquad->get_num_samples());
+			} else {
+				ImGui::Text("Refining %d / %d", m_screenquad->get_num_samples(), m_screenquad->get_max_samples());
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Reference Render")) {
+			gui::prefix_label("Output: ", 250.0f);
+			ImGui::InputText("##bh_ref_path", &m_reference_path);
+
+			const bool running = m_reference_task.valid();
+			ImGui::BeginDisabled(running);
+
+			if (ImGui::Button(running ? "Rendering..." : "Render on CPU")) {
+				m_start_reference_render();
+			}
+
+			ImGui::EndDisabled();
+			ImGui::TextWrapped("%s", m_reference_status.c_str());
+		}
+
 		ImGui::End();
 		ImGui::PopStyleVar(1);
 	}
@@ -1,8 +1,70 @@
+#include <chrono>
+#include <thread>
+
 #include "gui.hpp"
 #include "camera.hpp"
 #include "scenes/flywheel.hpp"
 
 namespace mini {
+	// philox 4x32-10, a counter based generator: the output only depends on the counter and
+	// the key, so every realization owns an independent stream no matter which thread runs it
+	static std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key) {
+		constexpr std::uint64_t m0 = 0xD2511F53u;
+		constexpr std::uint64_t m1 = 0xCD9E8D57u;
+
+		for (int round = 0; round < 10; ++round) {
+			const std::uint64_t p0 = m0 * counter[0];
+			const std::uint64_t p1 = m1 * counter[2];
+
+			counter = {
+				static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+				static_cast<std::uint32_t>(p1),
+				static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+				static_cast<std::uint32_t>(p0)
+			};
+
+			key[0] += 0x9E3779B9u;
+			key[1] += 0xBB67AE85u;
+		}
+
+		return counter;
+	}
+
+	// four standard normal samples from one philox block by box-muller
+	static std::array<double, 4> philox_normal(std::uint32_t block, std::uint32_t stream, std::uint32_t seed) {
+		constexpr double two_pi = 6.283185307179586;
+		constexpr double scale = 1.0 / 4294967296.0;
+
+		const auto bits = philox({ block, stream, 0u, 0u }, { seed, 0x5851F42Du });
+
+		std::array<double, 4> result;
+		for (int i = 0; i < 4; i += 2) {
+			const double u1 = (static_cast<double>(bits[i]) + 0.5) * scale;
+			const double u2 = (static_cast<double>(bits[i + 1]) + 0.5) * scale;
+			const double r = std::sqrt(-2.0 * std::log(u1));
+
+			result[i] = r * std::cos(two_pi * u2);
+			result[i + 1] = r * std::sin(two_pi * u2);
+		}
+
+		return result;
+	}
+
+	// noise free mass position and its time derivatives for a wheel turning at a constant speed
+	static glm::dvec3 crank_kinematics(double radius, double length, double speed, double time) {
+		const double angle = speed * time;
+		const double s = std::sin(angle);
+		const double c = std::cos(angle);
+		const double d = std::sqrt(length * length - radius * radius * s * s);
+
+		const double r2 = radius * radius;
+		const double x = radius * c - radius + d;
+		const double v = -speed * (radius * s + r2 * s * c / d);
+		const double a = -speed * speed * (radius * c + r2 * (c * c - s * s) / d + r2 * r2 * s * s * c * c / (d * d * d));
+
+		return { x, v, a };
+	}
+
 	flywheel_scene::time_series_t::time_series_t(std::size_t samples) : num_samples(samples), index(0UL) {
 		time.resize(num_samples);
 		data.resize(num_samples);
@@ -28,6 +90,260 @@ namespace mini {
 		index = 0UL;
 	}
 
+	flywheel_scene::derivative_filter_t::derivative_filter_t(int method) :
+		method_id(method),
+		window(31),
+		head(0UL),
+		count(0UL),
+		since_refresh(0UL),
+		moments{0.0, 0.0, 0.0},
+		alpha(0.3f),
+		beta(0.05f),
+		gamma(0.005f),
+		process_noise(100.0f),
+		measurement_noise(0.0025f),
+		started(false),
+		last_time(0.0f),
+		state{0.0, 0.0, 0.0},
+		covariance(1.0) {
+		reset();
+	}
+
+	void flywheel_scene::derivative_filter_t::reset() {
+		window = glm::max(window | 1, 5);
+
+		values.assign(window, 0.0f);
+		times.assign(window, 0.0f);
+
+		head = 0UL;
+		count = 0UL;
+		since_refresh = 0UL;
+		moments[0] = moments[1] = moments[2] = 0.0;
+
+		started = false;
+		last_time = 0.0f;
+		state = glm::dvec3{0.0};
+		covariance = glm::dmat3(1.0);
+	}
+
+	bool flywheel_scene::derivative_filter_t::push(float time, float value, derivative_estimate_t& estimate) {
+		const std::size_t size = values.size();
+		const double oldest = (count == size) ? values[head] : 0.0;
+		const double last = static_cast<double>(count == size ? size - 1 : count);
+
+		// every sample ages by one, sum(y (j+1)^k) expands into the old moments
+		double m0 = moments[0] - oldest;
+		double m1 = moments[1] - last * oldest;
+		double m2 = moments[2] - last * last * oldest;
+
+		moments[2] = m2 + 2.0 * m1 + m0;
+		moments[1] = m1 + m0;
+		moments[0] = m0 + value;
+
+		values[head] = value;
+		times[head] = time;
+		head = (head + 1) % size;
+		count = glm::min(count + 1, size);
+
+		// rounding accumulates in the running sums, rebuilding them once per window keeps
+		// the cost per sample constant
+		if (++since_refresh >= size) {
+			m_refresh_moments();
+		}
+
+		switch (method_id) {
+			case 1:
+				return m_push_savitzky_golay(estimate);
+
+			case 2:
+				m_push_tracker(time, value, estimate);
+				return true;
+
+			case 3:
+				m_push_kalman(time, value, estimate);
+				return true;
+
+			default:
+				return m_push_difference(estimate);
+		}
+	}
+
+	void flywheel_scene::derivative_filter_t::m_refresh_moments() {
+		const std::size_t size = values.size();
+		moments[0] = moments[1] = moments[2] = 0.0;
+
+		for (std::size_t j = 0; j < count; ++j) {
+			const double y = values[(head + size - 1 - j) % size];
+			const double age = static_cast<double>(j);
+
+			moments[0] += y;
+			moments[1] += y * age;
+			moments[2] += y * age * age;
+		}
+
+		since_refresh = 0UL;
+	}
+
+	bool flywheel_scene::derivative_filter_t::m_push_difference(derivative_estimate_t& estimate) const {
+		if (count < 3) {
+			return false;
+		}
+
+		const std::size_t size = values.size();
+		const auto next = (head + size - 1) % size;
+		const auto curr = (head + size - 2) % size;
+		const auto prev = (head + size - 3) % size;
+
+		float t1 = times[prev], t2 = times[curr], t3 = times[next];
+		float y1 = values[prev], y2 = values[curr], y3 = values[next];
+
+		float d = 0.0f;
+		d += 2.0f * y1 / ((t2 - t1) * (t3 - t1));
+		d -= 2.0f * y2 / ((t3 - t2) * (t2 - t1));
+		d += 2.0f * y3 / ((t3 - t2) * (t3 - t1));
+
+		estimate.time = t2;
+		estimate.value = y2;
+		estimate.first = (y3 - y2) / (t3 - t2);
+		estimate.second = d;
+
+		return true;
+	}
+
+	bool flywheel_scene::derivative_filter_t::m_push_savitzky_golay(derivative_estimate_t& estimate) const {
+		const std::size_t size = values.size();
+		if (count < size) {
+			return false;
+		}
+
+		// fit y = a + b u + c u^2 around the middle sample, u = j - h, the odd
+		// moments of a symmetric window vanish so the normal equations split
+		const double h = 0.5 * static_cast<double>(size - 1);
+		const double n = static_cast<double>(size);
+		const double u2 = h * (h + 1.0) * n / 3.0;
+		const double u4 = u2 * (3.0 * h * h + 3.0 * h - 1.0) / 5.0;
+
+		const double s0 = moments[0];
+		const double s1 = moments[1] - h * moments[0];
+		const double s2 = moments[2] - 2.0 * h * moments[1] + h * h * moments[0];
+
+		const double det = n * u4 - u2 * u2;
+		const double a = (u4 * s0 - u2 * s2) / det;
+		const double b = s1 / u2;
+		const double c = (n * s2 - u2 * s0) / det;
+
+		// the ages are in samples, the mean spacing turns them into seconds
+		const float newest = times[(head + size - 1) % size];
+		const float oldest = times[head];
+		const double dt = static_cast<double>(newest - oldest) / (n - 1.0);
+
+		if (dt <= 0.0) {
+			return false;
+		}
+
+		estimate.time = times[(head + size - 1 - size / 2) % size];
+		estimate.value = static_cast<float>(a);
+		estimate.first = static_cast<float>(-b / dt);
+		estimate.second = static_cast<float>(2.0 * c / (dt * dt));
+
+		return true;
+	}
+
+	void flywheel_scene::derivative_filter_t::m_push_tracker(float time, float value, derivative_estimate_t& estimate) {
+		const double dt = time - last_time;
+
+		if (!started) {
+			state = glm::dvec3{value, 0.0, 0.0};
+			started = true;
+		} else if (dt > 0.0) {
+			// constant acceleration prediction corrected by the residual
+			double x = state.x + state.y * dt + 0.5 * state.z * dt * dt;
+			double v = state.y + state.z * dt;
+			double r = value - x;
+
+			state.x = x + alpha * r;
+			state.y = v + beta * r / dt;
+			state.z = state.z + 2.0 * gamma * r / (dt * dt);
+		}
+
+		last_time = time;
+
+		estimate.time = time;
+		estimate.value = static_cast<float>(state.x);
+		estimate.first = static_cast<float>(state.y);
+		estimate.second = static_cast<float>(state.z);
+	}
+
+	void flywheel_scene::derivative_filter_t::m_push_kalman(float time, float value, derivative_estimate_t& estimate) {
+		const double dt = time - last_time;
+		const double R = glm::max(static_cast<double>(measurement_noise), 1e-10);
+
+		if (!started) {
+			state = glm::dvec3{value, 0.0, 0.0};
+			covariance = glm::dmat3(1.0);
+			covariance[0][0] = R;
+			covariance[1][1] = 1e4;
+			covariance[2][2] = 1e6;
+			started = true;
+		} else if (dt > 0.0) {
+			// constant acceleration model driven by white jerk
+			glm::dmat3 F(1.0);
+			F[1][0] = dt;
+			F[2][0] = 0.5 * dt * dt;
+			F[2][1] = dt;
+
+			const double dt2 = dt * dt, dt3 = dt2 * dt;
+			const double q = process_noise;
+
+			glm::dmat3 Q;
+			Q[0] = q * glm::dvec3{dt3 * dt2 / 20.0, dt2 * dt2 / 8.0, dt3 / 6.0};
+			Q[1] = q * glm::dvec3{dt2 * dt2 / 8.0, dt3 / 3.0, dt2 / 2.0};
+			Q[2] = q * glm::dvec3{dt3 / 6.0, dt2 / 2.0, dt};
+
+			state = F * state;
+			covariance = F * covariance * glm::transpose(F) + Q;
+
+			// only the position is measured, so the gain is the first column of P
+			const glm::dvec3 PH = covariance[0];
+			const glm::dvec3 K = PH / (PH.x + R);
+
+			state += K * (value - state.x);
+			covariance = covariance - glm::outerProduct(K, PH);
+		}
+
+		last_time = time;
+
+		estimate.time = time;
+		estimate.value = static_cast<float>(state.x);
+		estimate.first = static_cast<float>(state.y);
+		estimate.second = static_cast<float>(state.z);
+	}
+
+	void flywheel_scene::running_moments_t::add(double x) {
+		count += 1.0;
+
+		const double delta = x - mean;
+		mean += delta / count;
+		m2 += delta * (x - mean);
+	}
+
+	void flywheel_scene::running_moments_t::merge(const running_moments_t& other) {
+		if (other.count == 0.0) {
+			return;
+		}
+
+		const double total = count + other.count;
+		const double delta = other.mean - mean;
+
+		mean += delta * other.count / total;
+		m2 += other.m2 + delta * delta * count * other.count / total;
+		count = total;
+	}
+
+	double flywheel_scene::running_moments_t::variance() const {
+		return (count > 1.0) ? m2 / (count - 1.0) : 0.0;
+	}
+
 	void flywheel_scene::simulation_state_t::integrate(float delta_time) {
 		time = time + delta_time * flywheel_speed;
 		time_total = time_total + delta_time;
@@ -54,12 +370,22 @@ namespace mini {
 		};
 	}
 
+	resource_manifest_t flywheel_scene::get_manifest() {
+		return { { "grid_xy", "line" } };
+	}
+
 	flywheel_scene::flywheel_scene(application_base & app) : 
 		scene_base(app),
 		m_pos_series(NUM_DATA_POINTS),
 		m_speed_series(NUM_DATA_POINTS),
 		m_accel_series(NUM_DATA_POINTS),
 		m_hodograph(NUM_DATA_POINTS),
+		m_speed_filter(1),
+		m_accel_filter(1),
+		m_samples_per_frame(1),
+		m_mc_settings{ 2048, 60.0f, 2.0f * glm::pi<float>(), 0.0f, 0.0f, 0.0f, 0.0f, 1u },
+		m_mc_result{},
+		m_mc_band(1.96f),
 		m_last_vp_width(0),
 		m_last_vp_height(0),
 		m_mouse_in_viewport(false),
@@ -108,58 +434,50 @@ namespace mini {
 		ImGui::DockBuilderDockWindow("Simulation Settings", dock_id_right);
 		ImGui::DockBuilderDockWindow("Simulation Data", dock_id_bottom_right);
 		ImGui::DockBuilderDockWindow("Trajectory", dock_id_bottom_right);
+		ImGui::DockBuilderDockWindow("Monte Carlo", dock_id_bottom_right);
 	}
 	
 	void flywheel_scene::integrate(float delta_time) {
+		m_poll_monte_carlo();
+
 		if (delta_time > 0.1f) {
 			delta_time = 0.1f;
 		}
 
-		m_state.integrate(delta_time);
-		
-		// update curves based on current state
-		m_stick_curve->update_point(0, glm::vec3(m_state.origin_pos, 0.0f));
-		m_stick_curve->update_point(1, glm::vec3(m_state.mass_pos, 0.0f));
-		m_stick_curve->rebuild_buffers();
-
-		// store data from this frame
-		if (m_state.error) {
-			m_pos_series.store(m_state.time_total, m_state.mass_pos.x + m_distr(m_generator));
-		} else {
-			m_pos_series.store(m_state.time_total, m_state.mass_pos.x);
-		}
-
-		if (m_pos_series.index > 1) {
-			auto curr = m_pos_series.index - 1;
-			auto prev = m_pos_series.index - 2;
+		// the sensor may sample faster than the frame rate
+		const int samples = glm::max(m_samples_per_frame, 1);
+		const float step = delta_time / static_cast<float>(samples);
 
-			float dt = m_pos_series.time[curr] - m_pos_series.time[prev];
-			float dx = m_pos_series.data[curr] - m_pos_series.data[prev];
+		const float noise = m_state.error ? m_state.eps * m_state.eps : 0.0f;
+		m_speed_filter.measurement_noise = noise;
+		m_accel_filter.measurement_noise = noise;
 
-			m_speed_series.store(m_pos_series.time[prev], dx / dt);
-			m_hodograph.store(m_speed_series.data[m_speed_series.index - 1], m_pos_series.data[curr]);
-		}
-
-		if (m_pos_series.index > 2) {
-			auto next = m_pos_series.index - 1;
-			auto curr = m_pos_series.index - 2;
-			auto prev = m_pos_series.index - 3;
+		for (int i = 0; i < samples; ++i) {
+			m_state.integrate(step);
 
-			float t1 = m_pos_series.time[prev];
-			float t2 = m_pos_series.time[curr];
-			float t3 = m_pos_series.time[next];
+			// store data from this sample
+			float x = m_state.mass_pos.x;
+			if (m_state.error) {
+				x += m_distr(m_generator);
+			}
 
-			float y1 = m_pos_series.data[prev];
-			float y2 = m_pos_series.data[curr];
-			float y3 = m_pos_series.data[next];
+			m_pos_series.store(m_state.time_total, x);
 
-			float d = 0.0f;
-			d += 2.0f * y1 / ((t2 - t1) * (t3 - t1));
-			d -= 2.0f * y2 / ((t3 - t2) * (t2 - t1));
-			d += 2.0f * y3 / ((t3 - t2) * (t3 - t1));
+			derivative_estimate_t estimate;
+			if (m_speed_filter.push(m_state.time_total, x, estimate)) {
+				m_speed_series.store(estimate.time, estimate.first);
+				m_hodograph.store(estimate.first, estimate.value);
+			}
 
-			m_accel_series.store(t2, d);
+			if (m_accel_filter.push(m_state.time_total, x, estimate)) {
+				m_accel_series.store(estimate.time, estimate.second);
+			}
 		}
+		
+		// update curves based on current state
+		m_stick_curve->update_point(0, glm::vec3(m_state.origin_pos, 0.0f));
+		m_stick_curve->update_point(1, glm::vec3(m_state.mass_pos, 0.0f));
+		m_stick_curve->rebuild_buffers();
 	}
 	
 	void flywheel_scene::render(app_context& context) {
@@ -201,6 +519,7 @@ namespace mini {
 		m_gui_viewport();
 		m_gui_graphs();
 		m_gui_curve_graph();
+		m_gui_monte_carlo();
 	}
 	
 	void flywheel_scene::on_scroll(double offset_x, double offset_y) {
@@ -271,19 +590,69 @@ namespace mini {
 		gui::prefix_label("Error: ", 250.0f);
 		ImGui::Checkbox("##fwh_error", &m_state.error);
 
-		if (ImGui::Button("Reset")) {
-			m_pos_series.clear();
-			m_speed_series.clear();
-			m_accel_series.clear();
-			m_hodograph.clear();
+		gui::prefix_label("Samples/frame: ", 250.0f);
+		ImGui::SliderInt("##fwh_samples", &m_samples_per_frame, 1, 64);
 
-			m_state.time = 0.0f;
-			m_state.time_total = 0.0f;
+		if (ImGui::CollapsingHeader("Speed Filter", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::PushID("##fwh_speed_filter");
+			m_gui_filter(m_speed_filter);
+			ImGui::PopID();
+		}
+
+		if (ImGui::CollapsingHeader("Acceleration Filter", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::PushID("##fwh_accel_filter");
+			m_gui_filter(m_accel_filter);
+			ImGui::PopID();
+		}
+
+		if (ImGui::Button("Reset")) {
+			m_reset_series();
 		}
 		
 		ImGui::End();
 		ImGui::PopStyleVar(1);
 	}
+
+	void flywheel_scene::m_gui_filter(derivative_filter_t& filter) {
+		constexpr const char* methods[] = { "Finite Difference", "Savitzky-Golay", "Alpha-Beta-Gamma", "Kalman" };
+
+		gui::prefix_label("Method: ", 250.0f);
+		if (ImGui::Combo("##fwh_filter_method", &filter.method_id, methods, 4)) {
+			m_reset_series();
+		}
+
+		if (filter.method_id == 1) {
+			gui::prefix_label("Window: ", 250.0f);
+			if (ImGui::SliderInt("##fwh_filter_window", &filter.window, 5, 255)) {
+				m_reset_series();
+			}
+		} else if (filter.method_id == 2) {
+			gui::prefix_label("Alpha: ", 250.0f);
+			ImGui::SliderFloat("##fwh_filter_alpha", &filter.alpha, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+
+			gui::prefix_label("Beta: ", 250.0f);
+			ImGui::SliderFloat("##fwh_filter_beta", &filter.beta, 0.0001f, 1.0f, "%.4f", ImGuiSliderFlags_Logarithmic);
+
+			gui::prefix_label("Gamma: ", 250.0f);
+			ImGui::SliderFloat("##fwh_filter_gamma", &filter.gamma, 0.00001f, 0.5f, "%.5f", ImGuiSliderFlags_Logarithmic);
+		} else if (filter.method_id == 3) {
+			gui::prefix_label("Jerk noise: ", 250.0f);
+			ImGui::SliderFloat("##fwh_filter_q", &filter.process_noise, 0.01f, 1e5f, "%.2f", ImGuiSliderFlags_Logarithmic);
+		}
+	}
+
+	void flywheel_scene::m_reset_series() {
+		m_pos_series.clear();
+		m_speed_series.clear();
+		m_accel_series.clear();
+		m_hodograph.clear();
+
+		m_speed_filter.reset();
+		m_accel_filter.reset();
+
+		m_state.time = 0.0f;
+		m_state.time_total = 0.0f;
+	}
 	
 	void flywheel_scene::m_gui_viewport() {
 		auto& context = get_app().get_context();
@@ -358,6 +727,226 @@ namespace mini {
 		ImGui::PopStyleVar(1);
 	}
 
+	void flywheel_scene::m_gui_monte_carlo() {
+		ImGui::PushStyleVar(ImGuiStyleVar_WindowMinSize, ImVec2(270, 450));
+		ImGui::Begin("Monte Carlo", NULL);
+		ImGui::SetWindowPos(ImVec2(30, 30), ImGuiCond_Once);
+		ImGui::SetWindowSize(ImVec2(270, 450), ImGuiCond_Once);
+
+		auto& settings = m_mc_settings;
+
+		gui::prefix_label("Realizations: ", 250.0f);
+		if (ImGui::InputInt("##fwh_mc_count", &settings.realizations)) {
+			gui::clamp(settings.realizations, 2, 1 << 20);
+		}
+
+		gui::prefix_label("Sample rate: ", 250.0f);
+		ImGui::InputFloat("##fwh_mc_rate", &settings.sample_rate);
+		gui::clamp(settings.sample_rate, 1.0f, 10000.0f);
+
+		gui::prefix_label("Duration: ", 250.0f);
+		ImGui::InputFloat("##fwh_mc_duration", &settings.duration);
+		gui::clamp(settings.duration, 0.1f, 100.0f);
+
+		int seed = static_cast<int>(settings.seed);
+		gui::prefix_label("Seed: ", 250.0f);
+		if (ImGui::InputInt("##fwh_mc_seed", &seed)) {
+			settings.seed = static_cast<std::uint32_t>(seed);
+		}
+
+		gui::prefix_label("Band (z): ", 250.0f);
+		ImGui::SliderFloat("##fwh_mc_band", &m_mc_band, 0.0f, 4.0f);
+
+		const bool running = m_mc_task.valid();
+		ImGui::BeginDisabled(running);
+
+		if (ImGui::Button(running ? "Running..." : "Run Monte Carlo")) {
+			m_start_monte_carlo();
+		}
+
+		ImGui::EndDisabled();
+
+		const auto& result = m_mc_result;
+		constexpr const char* names[] = { "x(t)", "x'(t)", "x''(t)" };
+
+		if (result.realizations > 0) {
+			ImGui::Text("%d realizations", result.realizations);
+
+			for (int q = 0; q < 3; ++q) {
+				ImGui::Text("%s: mean std. dev. %.4g, rms bias %.4g", names[q], result.mean_deviation[q], result.bias[q]);
+			}
+		}
+
+		auto size = ImVec2(-1.0f, 200.0f);
+		std::vector<float> lower, upper;
+
+		for (int q = 0; q < 3; ++q) {
+			if (ImPlot::BeginPlot(names[q], size, ImPlotFlags_None)) {
+				ImPlot::SetupAxis(ImAxis_X1, "t", ImPlotAxisFlags_AutoFit);
+				ImPlot::SetupAxis(ImAxis_Y1, "##y", ImPlotAxisFlags_AutoFit);
+
+				const auto& time = result.time[q];
+				const auto& mean = result.mean[q];
+				const auto& deviation = result.deviation[q];
+				const int count = static_cast<int>(time.size());
+
+				lower.resize(count);
+				upper.resize(count);
+
+				for (int i = 0; i < count; ++i) {
+					lower[i] = mean[i] - m_mc_band * deviation[i];
+					upper[i] = mean[i] + m_mc_band * deviation[i];
+				}
+
+				ImPlot::SetNextFillStyle(IMPLOT_AUTO_COL, 0.35f);
+				ImPlot::PlotShaded("band", time.data(), lower.data(), upper.data(), count);
+				ImPlot::PlotLine("mean", time.data(), mean.data(), count);
+				ImPlot::PlotLine("exact", time.data(), result.exact[q].data(), count);
+				ImPlot::EndPlot();
+			}
+		}
+
+		ImGui::End();
+		ImGui::PopStyleVar(1);
+	}
+
+	void flywheel_scene::m_start_monte_carlo() {
+		if (m_mc_task.valid()) {
+			return;
+		}
+
+		// realizations run on the current geometry, noise level and derivative filters
+		auto settings = m_mc_settings;
+		settings.wheel_radius = m_state.wheel_radius;
+		settings.stick_length = m_state.stick_length;
+		settings.flywheel_speed = m_state.flywheel_speed;
+		settings.eps = m_state.eps;
+
+		m_mc_task = std::async(std::launch::async, &flywheel_scene::m_run_monte_carlo, std::ref(m_workers), settings, 
+			m_speed_filter, m_accel_filter);
+	}
+
+	void flywheel_scene::m_poll_monte_carlo() {
+		if (!m_mc_task.valid()) {
+			return;
+		}
+
+		if (m_mc_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			m_mc_result = m_mc_task.get();
+		}
+	}
+
+	flywheel_scene::monte_carlo_result_t flywheel_scene::m_run_monte_carlo(thread_pool& workers, monte_carlo_settings_t settings, 
+		derivative_filter_t speed_filter, derivative_filter_t accel_filter) {
+
+		constexpr std::size_t max_bins = 1 << 16;
+
+		const std::size_t bins = glm::clamp(static_cast<std::size_t>(settings.duration * settings.sample_rate), 
+			std::size_t(3), max_bins);
+		const double step = 1.0 / settings.sample_rate;
+		const int n = settings.realizations;
+
+		speed_filter.measurement_noise = settings.eps * settings.eps;
+		accel_filter.measurement_noise = settings.eps * settings.eps;
+
+		// every task keeps its own moments per bin and quantity, only o(bins) memory
+		// is needed no matter how many realizations run
+		const int num_tasks = glm::clamp(static_cast<int>(workers.get_num_threads()), 1, n);
+		std::vector<std::vector<running_moments_t>> partial(num_tasks);
+
+		const auto run = [&](int w) {
+			auto& moments = partial[w];
+			moments.assign(3 * bins, running_moments_t{ 0.0, 0.0, 0.0 });
+
+			derivative_filter_t speed = speed_filter;
+			derivative_filter_t accel = accel_filter;
+
+			const auto bin_of = [&](float time) {
+				return static_cast<std::size_t>(std::lround(time / step)) - 1;
+			};
+
+			for (int r = w; r < n; r += num_tasks) {
+				speed.reset();
+				accel.reset();
+
+				std::array<double, 4> noise;
+
+				for (std::size_t i = 0; i < bins; ++i) {
+					if (i % 4 == 0) {
+						noise = philox_normal(static_cast<std::uint32_t>(i / 4), static_cast<std::uint32_t>(r), settings.seed);
+					}
+
+					const double t = static_cast<double>(i + 1) * step;
+					const auto exact = crank_kinematics(settings.wheel_radius, settings.stick_length, settings.flywheel_speed, t);
+					const float x = static_cast<float>(exact.x + settings.eps * noise[i % 4]);
+					const float time = static_cast<float>(t);
+
+					moments[i].add(x);
+
+					derivative_estimate_t estimate;
+					if (speed.push(time, x, estimate)) {
+						const auto bin = bin_of(estimate.time);
+						if (bin < bins) {
+							moments[bins + bin].add(estimate.first);
+						}
+					}
+
+					if (accel.push(time, x, estimate)) {
+						const auto bin = bin_of(estimate.time);
+						if (bin < bins) {
+							moments[2 * bins + bin].add(estimate.second);
+						}
+					}
+				}
+			}
+		};
+
+		workers.parallel_for(0, num_tasks, 1, [&](std::size_t first, std::size_t last) {
+			for (std::size_t w = first; w < last; ++w) {
+				run(static_cast<int>(w));
+			}
+		});
+
+		for (int w = 1; w < num_tasks; ++w) {
+			for (std::size_t i = 0; i < 3 * bins; ++i) {
+				partial[0][i].merge(partial[w][i]);
+			}
+		}
+
+		monte_carlo_result_t result;
+		result.realizations = n;
+
+		// bins the filters never reached, like the start of a savitzky-golay window, are left out
+		for (int q = 0; q < 3; ++q) {
+			double deviation_sum = 0.0, bias_sum = 0.0;
+
+			for (std::size_t i = 0; i < bins; ++i) {
+				const auto& m = partial[0][q * bins + i];
+				if (m.count == 0.0) {
+					continue;
+				}
+
+				const double t = static_cast<double>(i + 1) * step;
+				const double exact = crank_kinematics(settings.wheel_radius, settings.stick_length, settings.flywheel_speed, t)[q];
+				const double deviation = std::sqrt(m.variance());
+
+				result.time[q].push_back(static_cast<float>(t));
+				result.mean[q].push_back(static_cast<float>(m.mean));
+				result.deviation[q].push_back(static_cast<float>(deviation));
+				result.exact[q].push_back(static_cast<float>(exact));
+
+				deviation_sum += deviation;
+				bias_sum += (m.mean - exact) * (m.mean - exact);
+			}
+
+			const double count = static_cast<double>(glm::max(result.time[q].size(), std::size_t(1)));
+			result.mean_deviation[q] = static_cast<float>(deviation_sum / count);
+			result.bias[q] = static_cast<float>(std::sqrt(bias_sum / count));
+		}
+
+		return result;
+	}
+
 	void flywheel_scene::m_plot_series(const time_series_t& series, const std::string & name, const ImVec2& size, 
 		const float min_range_x) {
 
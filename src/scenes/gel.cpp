@@ -398,6 +398,15 @@ namespace mini {
 		}
 	}
 
+	resource_manifest_t gel_scene::get_manifest() {
+		resource_manifest_t manifest;
+		manifest.shaders = { "line", "room", "grid_xz", "point", "gelcube", "bezier_model" };
+		manifest.textures = { "slime_albedo", "slime_normal", "duck_albedo" };
+		manifest.meshes = { "duck" };
+
+		return manifest;
+	}
+
 	gel_scene::gel_scene(application_base& app) : 
 		scene_base(app),
 		m_state(m_settings),
@@ -422,6 +431,7 @@ namespace mini {
 		auto slime_albedo = get_app().get_store().get_texture("slime_albedo");
 		auto slime_normal = get_app().get_store().get_texture("slime_normal");
 		auto duck_albedo = get_app().get_store().get_texture("duck_albedo");
+		auto duck_mesh = get_app().get_store().get_mesh("duck");
 
 		get_app().get_context().set_clear_color({ 0.75f, 0.75f, 0.9f });
 
@@ -454,12 +464,8 @@ namespace mini {
 			m_bounds_object->set_cull_mode(cube_object::culling_mode_t::front);
 		}
 
-		if (model_shader) {
-			m_bezier_model = std::make_shared<bezier_model_object>(
-				model_shader, triangle_mesh::read_from_file("meshes/duck.txt",
-					{0.0f, 0.7f, 0.0f},
-					{0.01f, -0.01f, -0.01f}), duck_albedo
-			);
+		if (model_shader && duck_mesh) {
+			m_bezier_model = std::make_shared<bezier_model_object>(model_shader, duck_mesh, duck_albedo);
 		}
 
 		auto camera = std::make_unique<default_camera>();
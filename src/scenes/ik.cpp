@@ -1,5 +1,9 @@
 #include <iostream>
-#include <deque>
+#include <algorithm>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <limits>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "gui.hpp"
@@ -61,193 +65,1713 @@ namespace mini {
 		return true;
 	}
 
+	inline bool intersect_box(
+		const glm::vec2& s,
+		const glm::vec2& e,
+		const glm::vec2& box_min,
+		const glm::vec2& box_max
+	) {
+		const glm::vec2 q1 = { box_min.x, box_max.y };
+		const glm::vec2 q2 = { box_max.x, box_max.y };
+		const glm::vec2 q3 = { box_max.x, box_min.y };
+		const glm::vec2 q4 = { box_min.x, box_min.y };
+		glm::vec2 _r;
+
+		return intersect_segment(s, e, q1, q2, _r) ||
+			intersect_segment(s, e, q2, q3, _r) ||
+			intersect_segment(s, e, q3, q4, _r) ||
+			intersect_segment(s, e, q4, q1, _r);
+	}
+
+	inline float distance_point_box(
+		const glm::vec2& p,
+		const glm::vec2& box_min,
+		const glm::vec2& box_max
+	) {
+		return glm::distance(p, glm::clamp(p, box_min, box_max));
+	}
+
+	inline float distance_point_segment(
+		const glm::vec2& p,
+		const glm::vec2& s,
+		const glm::vec2& e
+	) {
+		const glm::vec2 d = e - s;
+		const float len_sq = glm::dot(d, d);
+		const float t = (len_sq > 0.0f) ? glm::clamp(glm::dot(p - s, d) / len_sq, 0.0f, 1.0f) : 0.0f;
+
+		return glm::distance(p, s + t * d);
+	}
+
+	// liang-barsky clipping, true if any part of the segment lies inside the closed box
+	inline bool clip_segment_box(
+		const glm::vec2& s,
+		const glm::vec2& e,
+		const glm::vec2& box_min,
+		const glm::vec2& box_max
+	) {
+		const glm::vec2 d = e - s;
+		float t0 = 0.0f, t1 = 1.0f;
+
+		for (int axis = 0; axis < 2; ++axis) {
+			if (d[axis] == 0.0f) {
+				if (s[axis] < box_min[axis] || s[axis] > box_max[axis]) {
+					return false;
+				}
+
+				continue;
+			}
+
+			float ta = (box_min[axis] - s[axis]) / d[axis];
+			float tb = (box_max[axis] - s[axis]) / d[axis];
+
+			if (ta > tb) {
+				std::swap(ta, tb);
+			}
+
+			t0 = glm::max(t0, ta);
+			t1 = glm::min(t1, tb);
+
+			if (t0 > t1) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	inline float distance_segment_box(
+		const glm::vec2& s,
+		const glm::vec2& e,
+		const glm::vec2& box_min,
+		const glm::vec2& box_max
+	) {
+		if (clip_segment_box(s, e, box_min, box_max)) {
+			return 0.0f;
+		}
+
+		float dist = glm::min(distance_point_box(s, box_min, box_max), distance_point_box(e, box_min, box_max));
+		dist = glm::min(dist, distance_point_segment({ box_min.x, box_min.y }, s, e));
+		dist = glm::min(dist, distance_point_segment({ box_max.x, box_min.y }, s, e));
+		dist = glm::min(dist, distance_point_segment({ box_max.x, box_max.y }, s, e));
+		dist = glm::min(dist, distance_point_segment({ box_min.x, box_max.y }, s, e));
+
+		return dist;
+	}
+
+	// true if every segment within distance margin of the given one crosses the boundary of the box,
+	// that is when the segment reaches deep inside the box and also has an end far outside of it
+	inline bool always_crosses_box(
+		const glm::vec2& s,
+		const glm::vec2& e,
+		const glm::vec2& box_min,
+		const glm::vec2& box_max,
+		float margin
+	) {
+		const glm::vec2 inner_min = box_min + glm::vec2{ margin, margin };
+		const glm::vec2 inner_max = box_max - glm::vec2{ margin, margin };
+
+		if (inner_min.x > inner_max.x || inner_min.y > inner_max.y) {
+			return false;
+		}
+
+		const bool outside = distance_point_box(s, box_min, box_max) > margin || 
+			distance_point_box(e, box_min, box_max) > margin;
+
+		return outside && clip_segment_box(s, e, inner_min, inner_max);
+	}
+
 	ik_scene::configuration_space_t::configuration_space_t(int rx, int ry) {
 		res_x = rx;
 		res_y = ry;
 
-		data.resize(rx * ry * 3);
-		std::fill(data.begin(), data.end(), 0);
+		occupancy.assign((rx * ry + 63) / 64, 0);
+		on_path.assign((rx * ry + 63) / 64, 0);
+		depth.assign(rx * ry, 0);
+
+		dirty_min_x = res_x;
+		dirty_min_y = res_y;
+		dirty_max_x = -1;
+		dirty_max_y = -1;
+		has_path = false;
+
+		field_goal = -1;
+		field_dirs = 0;
+		field_painted = false;
+	}
+
+	void ik_scene::configuration_space_t::create_texture(std::vector<unsigned char>&& pixels) {
+		texture = std::make_shared<mini::texture>(res_x, res_y, pixels.data(), GL_RGB);
+	}
+
+	std::vector<unsigned char> ik_scene::configuration_space_t::get_pixels() const {
+		std::vector<unsigned char> pixels;
+		m_fill_pixels(0, 0, res_x, res_y, pixels);
+
+		return pixels;
+	}
+
+	bool ik_scene::configuration_space_t::is_collision(int x, int y) const {
+		int index = y * res_x + x;
+		return (occupancy[index >> 6] >> (index & 63)) & 1;
+	}
+
+	void ik_scene::configuration_space_t::set_footprint(std::size_t obstacle, std::vector<int>&& cells) {
+		if (footprints.size() <= obstacle) {
+			footprints.resize(obstacle + 1);
+		}
+
+		if (!footprints[obstacle].empty() || !cells.empty()) {
+			field_goal = -1;
+		}
+
+		std::sort(cells.begin(), cells.end());
+
+		auto old_cells = std::move(footprints[obstacle]);
+		footprints[obstacle] = std::move(cells);
+
+		const auto is_blocked_elsewhere = [&](int index) {
+			for (std::size_t other = 0; other < footprints.size(); ++other) {
+				if (other != obstacle && std::binary_search(footprints[other].begin(), footprints[other].end(), index)) {
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		// only cells that switch between free and blocked have to be touched in the texture,
+		// the new footprint is checked first, it is usually the old one moved a little
+		for (int index : old_cells) {
+			if (std::binary_search(footprints[obstacle].begin(), footprints[obstacle].end(), index) || is_blocked_elsewhere(index)) {
+				continue;
+			}
+
+			occupancy[index >> 6] &= ~(uint64_t(1) << (index & 63));
+			mark_dirty(index % res_x, index / res_x);
+		}
+
+		for (int index : footprints[obstacle]) {
+			if (!is_collision(index % res_x, index / res_x)) {
+				occupancy[index >> 6] |= uint64_t(1) << (index & 63);
+				mark_dirty(index % res_x, index / res_x);
+			}
+		}
+	}
+
+	void ik_scene::configuration_space_t::remove_footprint(std::size_t obstacle) {
+		if (obstacle >= footprints.size()) {
+			return;
+		}
+
+		set_footprint(obstacle, {});
+		footprints.erase(footprints.begin() + obstacle);
+	}
+
+	void ik_scene::configuration_space_t::clear_footprints() {
+		footprints.clear();
+		field_goal = -1;
+		std::fill(occupancy.begin(), occupancy.end(), 0);
+
+		mark_all_dirty();
+	}
+
+	void ik_scene::configuration_space_t::mark_dirty(int x, int y) {
+		dirty_min_x = glm::min(dirty_min_x, x);
+		dirty_min_y = glm::min(dirty_min_y, y);
+		dirty_max_x = glm::max(dirty_max_x, x);
+		dirty_max_y = glm::max(dirty_max_y, y);
+	}
+
+	void ik_scene::configuration_space_t::mark_all_dirty() {
+		mark_dirty(0, 0);
+		mark_dirty(res_x - 1, res_y - 1);
+	}
+
+	void ik_scene::configuration_space_t::update_texture() {
+		if (dirty_max_x < dirty_min_x || dirty_max_y < dirty_min_y) {
+			return;
+		}
+
+		const int width = dirty_max_x - dirty_min_x + 1;
+		const int height = dirty_max_y - dirty_min_y + 1;
+
+		// the pixels only exist for the upload, collisions are red, the search depth green
+		// and the path blue
+		std::vector<unsigned char> pixels;
+		m_fill_pixels(dirty_min_x, dirty_min_y, width, height, pixels);
+
+		if (width == res_x && height == res_y) {
+			texture->update(pixels.data());
+		} else {
+			texture->update(pixels.data(), dirty_min_x, dirty_min_y, width, height);
+		}
+
+		dirty_min_x = res_x;
+		dirty_min_y = res_y;
+		dirty_max_x = -1;
+		dirty_max_y = -1;
+	}
+
+	void ik_scene::configuration_space_t::clear_path() {
+		if (!has_path) {
+			return;
+		}
+
+		m_clear_overlay();
+	}
+
+	void ik_scene::configuration_space_t::m_clear_overlay() {
+		std::fill(depth.begin(), depth.end(), 0);
+		std::fill(on_path.begin(), on_path.end(), 0);
+
+		path_cells.clear();
+		has_path = false;
+		field_painted = false;
+		mark_all_dirty();
+	}
+
+	void ik_scene::configuration_space_t::m_set_path_cell(int index, bool value) {
+		if (value) {
+			on_path[index >> 6] |= uint64_t(1) << (index & 63);
+		} else {
+			on_path[index >> 6] &= ~(uint64_t(1) << (index & 63));
+		}
+
+		mark_dirty(index % res_x, index / res_x);
+	}
+
+	void ik_scene::configuration_space_t::m_fill_pixels(int x0, int y0, int width, int height, std::vector<unsigned char>& pixels) const {
+		pixels.resize(3 * width * height);
+
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const int index = (y0 + y) * res_x + (x0 + x);
+				unsigned char* pixel = &pixels[3 * (y * width + x)];
+
+				pixel[0] = is_collision(x0 + x, y0 + y) ? 255 : 0;
+				pixel[1] = depth[index];
+				pixel[2] = ((on_path[index >> 6] >> (index & 63)) & 1) ? 255 : 0;
+			}
+		}
+	}
+
+	unsigned char ik_scene::configuration_space_t::m_get_code(const std::vector<unsigned char>& codes, int index) {
+		return (codes[index >> 1] >> ((index & 1) * 4)) & 0x0F;
+	}
+
+	void ik_scene::configuration_space_t::m_set_code(std::vector<unsigned char>& codes, int index, unsigned char code) {
+		const int shift = (index & 1) * 4;
+		codes[index >> 1] = static_cast<unsigned char>((codes[index >> 1] & ~(0x0F << shift)) | (code << shift));
+	}
+
+	namespace {
+		// the first four directions are the axis aligned moves, the last four are diagonal
+		constexpr int DIR_X[8] = { 1, -1, 0,  0, 1, -1,  1, -1 };
+		constexpr int DIR_Y[8] = { 0,  0, 1, -1, 1,  1, -1, -1 };
+
+		// eight directions fit in the low three bits of a move code, these two use the fourth
+		constexpr unsigned char NO_PARENT = 0x0F;
+		constexpr unsigned char ROOT_CELL = 0x0E;
+	}
+
+	int ik_scene::configuration_space_t::m_config_to_cell(const robot_configuration_t& config) const {
+		constexpr float pi = glm::pi<float>();
+		float alpha = 0.5f * (config.theta1 + pi) / pi;
+		float beta = 0.5f * (config.theta2 + pi) / pi;
+
+		int x = static_cast<int>(roundf(alpha * res_x)) % res_x;
+		int y = static_cast<int>(roundf(beta * res_y)) % res_y;
+
+		x = (x < 0) ? x + res_x : x;
+		y = (y < 0) ? y + res_y : y;
+
+		return y * res_x + x;
+	}
+
+	ik_scene::robot_configuration_t ik_scene::configuration_space_t::m_point_to_config(const glm::vec2& point) const {
+		constexpr float pi = glm::pi<float>();
+		const float rx = static_cast<float>(res_x);
+		const float ry = static_cast<float>(res_y);
+		const float alpha = ((point.x / rx) * 2.0f * pi) - pi;
+		const float beta = ((point.y / ry) * 2.0f * pi) - pi;
+
+		return {alpha, beta};
+	}
+
+	int ik_scene::configuration_space_t::m_neighbor(int index, int dir) const {
+		int x = (index % res_x) + DIR_X[dir];
+		int y = (index / res_x) + DIR_Y[dir];
+
+		// the configuration space is a torus
+		x = (x < 0) ? x + res_x : ((x >= res_x) ? x - res_x : x);
+		y = (y < 0) ? y + res_y : ((y >= res_y) ? y - res_y : y);
+
+		return y * res_x + x;
+	}
+
+	bool ik_scene::configuration_space_t::m_can_move(int index, int dir) const {
+		const int target = m_neighbor(index, dir);
+		if (is_collision(target % res_x, target / res_x)) {
+			return false;
+		}
+
+		if (dir < 4) {
+			return true;
+		}
+
+		// diagonal moves may not cut the corners of blocked cells
+		const int side_x = m_neighbor(index, (DIR_X[dir] > 0) ? 0 : 1);
+		const int side_y = m_neighbor(index, (DIR_Y[dir] > 0) ? 2 : 3);
+
+		return !is_collision(side_x % res_x, side_x / res_x) && 
+			!is_collision(side_y % res_x, side_y / res_x);
+	}
+
+	bool ik_scene::configuration_space_t::m_is_line_free(const glm::vec2& from, const glm::vec2& to) const {
+		const glm::vec2 delta = to - from;
+		const int steps = 2 * static_cast<int>(glm::ceil(glm::max(glm::abs(delta.x), glm::abs(delta.y)))) + 1;
+
+		for (int i = 0; i <= steps; ++i) {
+			const glm::vec2 p = from + delta * (static_cast<float>(i) / static_cast<float>(steps));
+
+			int x = static_cast<int>(roundf(p.x)) % res_x;
+			int y = static_cast<int>(roundf(p.y)) % res_y;
+
+			x = (x < 0) ? x + res_x : x;
+			y = (y < 0) ? y + res_y : y;
+
+			if (is_collision(x, y)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void ik_scene::configuration_space_t::m_search_bfs(int start, int end, int num_dirs) {
+		// plain fifo search expanded one level at a time, every cell is visited at most once
+		std::vector<int> frontier, next;
+		frontier.push_back(start);
+
+		int level = 0;
+		while (!frontier.empty() && m_get_code(parents, end) == NO_PARENT) {
+			++level;
+			next.clear();
+
+			for (int current : frontier) {
+				for (int dir = 0; dir < num_dirs; ++dir) {
+					const int neighbor = m_neighbor(current, dir);
+
+					if (m_get_code(parents, neighbor) != NO_PARENT || !m_can_move(current, dir)) {
+						continue;
+					}
+
+					m_set_code(parents, neighbor, static_cast<unsigned char>(dir));
+					depth[neighbor] = static_cast<unsigned char>(glm::min(level, 255));
+					next.push_back(neighbor);
+				}
+			}
+
+			std::swap(frontier, next);
+		}
+	}
+
+	void ik_scene::configuration_space_t::m_search_astar(int start, int end, int num_dirs) {
+		constexpr float sqrt2 = 1.41421356f;
+
+		const int end_x = end % res_x;
+		const int end_y = end / res_x;
+
+		// octile (or manhattan) distance measured around the torus
+		const auto heuristic = [&](int index) -> float {
+			int dx = glm::abs(index % res_x - end_x);
+			int dy = glm::abs(index / res_x - end_y);
+
+			dx = glm::min(dx, res_x - dx);
+			dy = glm::min(dy, res_y - dy);
+
+			if (num_dirs == 4) {
+				return static_cast<float>(dx + dy);
+			}
+
+			return static_cast<float>(glm::max(dx, dy)) + (sqrt2 - 1.0f) * static_cast<float>(glm::min(dx, dy));
+		};
+
+		// entries are (f, g, cell, direction), stale entries are skipped when popped so
+		// no per cell cost array is needed, the parents array doubles as the closed set
+		using open_entry_t = std::tuple<float, float, int, int>;
+		std::priority_queue<open_entry_t, std::vector<open_entry_t>, std::greater<open_entry_t>> open;
+
+		open.emplace(heuristic(start), 0.0f, start, static_cast<int>(ROOT_CELL));
+
+		while (!open.empty()) {
+			const auto [f, g, current, dir] = open.top();
+			open.pop();
+
+			if (m_get_code(parents, current) != NO_PARENT) {
+				continue;
+			}
+
+			m_set_code(parents, current, static_cast<unsigned char>(dir));
+			depth[current] = static_cast<unsigned char>(glm::min(static_cast<int>(g), 255));
+
+			if (current == end) {
+				break;
+			}
+
+			for (int d = 0; d < num_dirs; ++d) {
+				const int neighbor = m_neighbor(current, d);
+
+				if (m_get_code(parents, neighbor) != NO_PARENT || !m_can_move(current, d)) {
+					continue;
+				}
+
+				const float cost = g + ((d < 4) ? 1.0f : sqrt2);
+				open.emplace(cost + heuristic(neighbor), cost, neighbor, d);
+			}
+		}
+	}
+
+	void ik_scene::configuration_space_t::m_build_field(int goal, int num_dirs) {
+		field.assign((res_x * res_y + 1) / 2, 0xFF);
 
-		texture = std::make_shared<mini::texture>(res_x, res_y, data.data(), GL_RGB);
+		field_goal = goal;
+		field_dirs = num_dirs;
+		field_painted = true;
+		m_set_code(field, goal, ROOT_CELL);
+
+		// moves are symmetric so a search from the goal gives the way back from any cell
+		std::vector<int> frontier, next;
+		frontier.push_back(goal);
+
+		int level = 0;
+		while (!frontier.empty()) {
+			++level;
+			next.clear();
+
+			for (int current : frontier) {
+				for (int dir = 0; dir < num_dirs; ++dir) {
+					const int neighbor = m_neighbor(current, dir);
+
+					if (m_get_code(field, neighbor) != NO_PARENT || !m_can_move(current, dir)) {
+						continue;
+					}
+
+					m_set_code(field, neighbor, static_cast<unsigned char>((dir < 4) ? (dir ^ 1) : (11 - dir)));
+					depth[neighbor] = static_cast<unsigned char>(glm::min(level, 255));
+					next.push_back(neighbor);
+				}
+			}
+
+			std::swap(frontier, next);
+		}
 	}
 
-	bool ik_scene::configuration_space_t::is_collision(int x, int y) const {
-		int index = y * res_x + x;
-		int base = 3 * index;
+	bool ik_scene::configuration_space_t::find_path(
+		const robot_configuration_t& start, 
+		const robot_configuration_t& end, 
+		const planner_settings_t& settings,
+		std::vector<robot_configuration_t>& path) {
+		
+		const int num_cells = res_x * res_y;
+		const int num_dirs = (settings.diagonal) ? 8 : 4;
+
+		const int start_cell = m_config_to_cell(start);
+		const int end_cell = m_config_to_cell(end);
+
+		if (is_collision(start_cell % res_x, start_cell / res_x) || is_collision(end_cell % res_x, end_cell / res_x)) {
+			return false;
+		}
+
+		std::vector<glm::vec2> points;
+		glm::vec2 point = { static_cast<float>(start_cell % res_x), static_cast<float>(start_cell / res_x) };
+
+		if (settings.planner == planner_t::distance_field) {
+			// only the painted path has to be cleared while the cached field is valid and shown
+			if (field_goal != end_cell || field_dirs != num_dirs || !field_painted) {
+				m_clear_overlay();
+				m_build_field(end_cell, num_dirs);
+			} else {
+				for (int index : path_cells) {
+					m_set_path_cell(index, false);
+				}
+
+				path_cells.clear();
+			}
+
+			has_path = true;
+
+			if (m_get_code(field, start_cell) == NO_PARENT) {
+				update_texture();
+				return false;
+			}
+
+			// descend the field, this is linear in the length of the path
+			int current = start_cell;
+
+			points.push_back(point);
+			while (m_get_code(field, current) != ROOT_CELL) {
+				const int dir = m_get_code(field, current);
+
+				current = m_neighbor(current, dir);
+				point.x += static_cast<float>(DIR_X[dir]);
+				point.y += static_cast<float>(DIR_Y[dir]);
+
+				points.push_back(point);
+			}
+		} else {
+			m_clear_overlay();
+			has_path = true;
+
+			parents.assign((num_cells + 1) / 2, 0xFF);
+
+			if (settings.planner == planner_t::bfs) {
+				m_set_code(parents, start_cell, ROOT_CELL);
+				m_search_bfs(start_cell, end_cell, num_dirs);
+			} else {
+				m_search_astar(start_cell, end_cell, num_dirs);
+			}
+
+			if (m_get_code(parents, end_cell) == NO_PARENT) {
+				update_texture();
+				return false;
+			}
+
+			// walk back to the start, the cells are unwrapped so the path is continuous
+			int current = end_cell;
+			point = { static_cast<float>(end_cell % res_x), static_cast<float>(end_cell / res_x) };
+
+			points.push_back(point);
+			while (m_get_code(parents, current) != ROOT_CELL) {
+				const int dir = m_get_code(parents, current);
+				const int back_dir = (dir < 4) ? (dir ^ 1) : (11 - dir);
+
+				current = m_neighbor(current, back_dir);
+				point.x -= static_cast<float>(DIR_X[dir]);
+				point.y -= static_cast<float>(DIR_Y[dir]);
+
+				points.push_back(point);
+			}
+
+			std::reverse(points.begin(), points.end());
+		}
+
+		if (settings.shortcut && points.size() > 2) {
+			std::vector<glm::vec2> shortcut;
+			std::size_t i = 0;
+
+			shortcut.push_back(points[0]);
+			while (i + 1 < points.size()) {
+				std::size_t j = i + 1;
+				while (j + 1 < points.size() && m_is_line_free(points[i], points[j + 1])) {
+					++j;
+				}
+
+				// resample the straight segment so the animation keeps a constant speed
+				const glm::vec2 delta = points[j] - points[i];
+				const int steps = glm::max(1, static_cast<int>(glm::ceil(glm::max(glm::abs(delta.x), glm::abs(delta.y)))));
+
+				for (int s = 1; s <= steps; ++s) {
+					shortcut.push_back(points[i] + delta * (static_cast<float>(s) / static_cast<float>(steps)));
+				}
+
+				i = j;
+			}
+
+			points = std::move(shortcut);
+		}
+
+		path.resize(points.size());
+		for (std::size_t i = 0; i < points.size(); ++i) {
+			path[i] = m_point_to_config(points[i]);
+
+			int x = static_cast<int>(roundf(points[i].x)) % res_x;
+			int y = static_cast<int>(roundf(points[i].y)) % res_y;
+
+			x = (x < 0) ? x + res_x : x;
+			y = (y < 0) ? y + res_y : y;
+
+			const int index = y * res_x + x;
+
+			m_set_path_cell(index, true);
+			path_cells.push_back(index);
+		}
+
+		update_texture();
+		return true;
+	}
+
+	void ik_scene::configuration_space_t::show_path(const std::vector<robot_configuration_t>& path) {
+		m_clear_overlay();
+		has_path = true;
+
+		for (const auto& config : path) {
+			const int index = m_config_to_cell(config);
+
+			m_set_path_cell(index, true);
+			path_cells.push_back(index);
+		}
+
+		update_texture();
+	}
+
+	ik_scene::occupancy_pyramid_t::occupancy_pyramid_t() :
+		levels(0),
+		resolution(1),
+		num_nodes(0),
+		valid(false) { }
+
+	bool ik_scene::occupancy_pyramid_t::m_get_bit(const std::vector<uint64_t>& bits, int level, int x, int y) const {
+		const int index = y * (resolution >> level) + x;
+		return (bits[index >> 6] >> (index & 63)) & 1;
+	}
+
+	void ik_scene::occupancy_pyramid_t::m_set_bit(std::vector<uint64_t>& bits, int level, int x, int y) {
+		const int index = y * (resolution >> level) + x;
+		bits[index >> 6] |= uint64_t(1) << (index & 63);
+	}
+
+	void ik_scene::occupancy_pyramid_t::build(int num_levels, const classifier_t& classify) {
+		levels = num_levels;
+		resolution = 1 << levels;
+		num_nodes = 0;
+
+		any_blocked.resize(levels + 1);
+		all_blocked.resize(levels + 1);
+
+		for (int level = 0; level <= levels; ++level) {
+			const std::size_t size = resolution >> level;
+			const std::size_t words = (size * size + 63) / 64;
+
+			any_blocked[level].assign(words, 0);
+			all_blocked[level].assign(words, 0);
+		}
+
+		std::vector<std::tuple<int, int, int>> stack;
+		stack.emplace_back(levels, 0, 0);
+
+		while (!stack.empty()) {
+			const auto [level, x, y] = stack.back();
+			stack.pop_back();
+			++num_nodes;
+
+			const cell_state_t state = classify(level, x, y);
+
+			if (state == cell_state_t::free) {
+				continue;
+			}
+
+			m_set_bit(any_blocked[level], level, x, y);
+
+			if (state == cell_state_t::blocked || level == 0) {
+				m_set_bit(all_blocked[level], level, x, y);
+				continue;
+			}
+
+			stack.emplace_back(level - 1, 2 * x + 0, 2 * y + 0);
+			stack.emplace_back(level - 1, 2 * x + 1, 2 * y + 0);
+			stack.emplace_back(level - 1, 2 * x + 0, 2 * y + 1);
+			stack.emplace_back(level - 1, 2 * x + 1, 2 * y + 1);
+		}
+
+		valid = true;
+	}
+
+	ik_scene::occupancy_pyramid_t::leaf_t ik_scene::occupancy_pyramid_t::m_find_leaf(int x, int y) const {
+		for (int level = levels; level > 0; --level) {
+			const int lx = x >> level;
+			const int ly = y >> level;
+
+			if (!m_get_bit(any_blocked[level], level, lx, ly)) {
+				return { level, lx, ly, false };
+			}
+
+			if (m_get_bit(all_blocked[level], level, lx, ly)) {
+				return { level, lx, ly, true };
+			}
+		}
+
+		return { 0, x, y, m_get_bit(any_blocked[0], 0, x, y) };
+	}
+
+	bool ik_scene::occupancy_pyramid_t::is_collision(int x, int y) const {
+		return m_find_leaf(x, y).blocked;
+	}
+
+	int ik_scene::occupancy_pyramid_t::m_config_to_cell(float theta) const {
+		constexpr float pi = glm::pi<float>();
+		int x = static_cast<int>(roundf(0.5f * (theta + pi) / pi * resolution)) % resolution;
+		return (x < 0) ? x + resolution : x;
+	}
+
+	bool ik_scene::occupancy_pyramid_t::find_path(
+		const robot_configuration_t& start,
+		const robot_configuration_t& end,
+		std::vector<robot_configuration_t>& path) const {
+
+		if (!valid) {
+			return false;
+		}
+
+		const int n = resolution;
+		const glm::vec2 start_cell = glm::vec2(glm::ivec2{ m_config_to_cell(start.theta1), m_config_to_cell(start.theta2) });
+		const glm::vec2 end_cell = glm::vec2(glm::ivec2{ m_config_to_cell(end.theta1), m_config_to_cell(end.theta2) });
+
+		const leaf_t start_leaf = m_find_leaf(static_cast<int>(start_cell.x), static_cast<int>(start_cell.y));
+		const leaf_t end_leaf = m_find_leaf(static_cast<int>(end_cell.x), static_cast<int>(end_cell.y));
+
+		if (start_leaf.blocked || end_leaf.blocked) {
+			return false;
+		}
+
+		const auto leaf_id = [](const leaf_t& leaf) -> uint64_t {
+			return (uint64_t(leaf.level) << 48) | (uint64_t(leaf.y) << 24) | uint64_t(leaf.x);
+		};
+
+		const auto leaf_center = [](const leaf_t& leaf) -> glm::vec2 {
+			const float size = static_cast<float>(1 << leaf.level);
+			return { leaf.x * size + 0.5f * (size - 1.0f), leaf.y * size + 0.5f * (size - 1.0f) };
+		};
+
+		const auto wrap_delta = [n](glm::vec2 delta) -> glm::vec2 {
+			const float half = 0.5f * static_cast<float>(n);
+
+			for (int axis = 0; axis < 2; ++axis) {
+				if (delta[axis] > half) {
+					delta[axis] -= static_cast<float>(n);
+				} else if (delta[axis] < -half) {
+					delta[axis] += static_cast<float>(n);
+				}
+			}
+
+			return delta;
+		};
+
+		const auto torus_distance = [&](const glm::vec2& a, const glm::vec2& b) -> float {
+			return glm::length(wrap_delta(b - a));
+		};
+
+		// a* over the free leaves of the pyramid, two neighboring leaves are connected through
+		// a pair of adjacent finest cells (a portal) on their shared border
+		struct node_t {
+			leaf_t leaf;
+			uint64_t parent;
+			glm::vec2 portal_in, portal_out;
+			float cost;
+			bool closed;
+		};
+
+		std::unordered_map<uint64_t, node_t> nodes;
+		std::priority_queue<std::pair<float, uint64_t>, std::vector<std::pair<float, uint64_t>>, std::greater<>> open;
+
+		const uint64_t start_id = leaf_id(start_leaf);
+		const uint64_t end_id = leaf_id(end_leaf);
+
+		nodes[start_id] = { start_leaf, start_id, start_cell, start_cell, 0.0f, false };
+		open.emplace(torus_distance(leaf_center(start_leaf), end_cell), start_id);
+
+		while (!open.empty()) {
+			const uint64_t id = open.top().second;
+			open.pop();
+
+			node_t& node = nodes[id];
+			if (node.closed) {
+				continue;
+			}
+
+			node.closed = true;
+			if (id == end_id) {
+				break;
+			}
+
+			const leaf_t leaf = node.leaf;
+			const float cost = node.cost;
+			const glm::vec2 center = leaf_center(leaf);
+			const int size = 1 << leaf.level;
+			const int x0 = leaf.x * size;
+			const int y0 = leaf.y * size;
+
+			uint64_t last_id = id;
+			for (int side = 0; side < 4; ++side) {
+				for (int i = 0; i < size; ++i) {
+					glm::ivec2 inside, outside;
+
+					switch (side) {
+						case 0: inside = { x0, y0 + i }; outside = { x0 - 1, y0 + i }; break;
+						case 1: inside = { x0 + size - 1, y0 + i }; outside = { x0 + size, y0 + i }; break;
+						case 2: inside = { x0 + i, y0 }; outside = { x0 + i, y0 - 1 }; break;
+						default: inside = { x0 + i, y0 + size - 1 }; outside = { x0 + i, y0 + size }; break;
+					}
+
+					outside.x = (outside.x + n) % n;
+					outside.y = (outside.y + n) % n;
+
+					const leaf_t neighbor = m_find_leaf(outside.x, outside.y);
+					const uint64_t neighbor_id = leaf_id(neighbor);
+
+					if (neighbor.blocked || neighbor_id == last_id || neighbor_id == id) {
+						continue;
+					}
+
+					last_id = neighbor_id;
+
+					const glm::vec2 portal_in = glm::vec2(inside);
+					const glm::vec2 portal_out = glm::vec2(outside);
+					const float new_cost = cost + 
+						torus_distance(center, portal_in) + 
+						torus_distance(portal_in, portal_out) + 
+						torus_distance(portal_out, leaf_center(neighbor));
+
+					auto it = nodes.find(neighbor_id);
+					if (it == nodes.end() || (!it->second.closed && new_cost < it->second.cost)) {
+						nodes[neighbor_id] = { neighbor, id, portal_in, portal_out, new_cost, false };
+						open.emplace(new_cost + torus_distance(leaf_center(neighbor), end_cell), neighbor_id);
+					}
+				}
+			}
+		}
+
+		auto end_it = nodes.find(end_id);
+		if (end_it == nodes.end() || !end_it->second.closed) {
+			return false;
+		}
+
+		// waypoints: start cell, start leaf center, portals and centers of every leaf, end cell
+		std::vector<uint64_t> chain;
+		for (uint64_t id = end_id; ; id = nodes[id].parent) {
+			chain.push_back(id);
+
+			if (id == start_id) {
+				break;
+			}
+		}
+
+		std::reverse(chain.begin(), chain.end());
+
+		std::vector<glm::vec2> waypoints;
+		waypoints.push_back(start_cell);
+		waypoints.push_back(leaf_center(start_leaf));
+
+		for (std::size_t i = 1; i < chain.size(); ++i) {
+			const node_t& node = nodes[chain[i]];
+
+			waypoints.push_back(node.portal_in);
+			waypoints.push_back(node.portal_out);
+			waypoints.push_back(leaf_center(node.leaf));
+		}
+
+		waypoints.push_back(end_cell);
+
+		// every segment stays inside a free leaf or between two adjacent cells, so it is enough to
+		// resample them at one cell per step, unwrapping the torus on the way
+		constexpr float pi = glm::pi<float>();
+		const float step = 2.0f * pi / static_cast<float>(n);
+
+		glm::vec2 position = start_cell;
+		path.clear();
+		path.push_back({ step * position.x - pi, step * position.y - pi });
+
+		for (std::size_t i = 1; i < waypoints.size(); ++i) {
+			const glm::vec2 delta = wrap_delta(waypoints[i] - waypoints[i - 1]);
+			const int steps = static_cast<int>(glm::ceil(glm::max(glm::abs(delta.x), glm::abs(delta.y))));
+
+			for (int s = 1; s <= steps; ++s) {
+				const glm::vec2 p = position + delta * (static_cast<float>(s) / static_cast<float>(steps));
+				path.push_back({ step * p.x - pi, step * p.y - pi });
+			}
+
+			position += delta;
+		}
+
+		return true;
+	}
+
+	namespace {
+		constexpr unsigned char EDGE_UNKNOWN = 0;
+		constexpr unsigned char EDGE_FREE = 1;
+		constexpr unsigned char EDGE_BLOCKED = 2;
+
+		constexpr int EXTEND_TRAPPED = 0;
+		constexpr int EXTEND_ADVANCED = 1;
+		constexpr int EXTEND_REACHED = 2;
+
+		// shortest signed rotation from one angle to the other, in [-pi, pi)
+		inline float angle_delta(float from, float to) {
+			constexpr float pi = glm::pi<float>();
+			const float d = to - from;
+			return d - 2.0f * pi * std::floor((d + pi) / (2.0f * pi));
+		}
+
+		inline float wrap_angle(float angle) {
+			return angle_delta(0.0f, angle);
+		}
+
+		// the sum stops early once it exceeds bound, nearest neighbour queries only need to
+		// know that a point is too far away and most points in joint space are
+		inline float joint_distance_sq(const float* a, const float* b, int dimension, 
+			float bound = std::numeric_limits<float>::infinity()) {
+
+			float sum = 0.0f;
+			for (int i = 0; i < dimension && sum <= bound; ++i) {
+				const float d = angle_delta(a[i], b[i]);
+				sum += d * d;
+			}
+
+			return sum;
+		}
+	}
+
+	int ik_scene::arm_chain_t::dimension() const {
+		return static_cast<int>(lengths.size());
+	}
+
+	void ik_scene::arm_chain_t::set_obstacles(const std::vector<obstacle_t>& obstacles) {
+		float reach = 0.0f;
+		for (const float length : lengths) {
+			reach += glm::abs(length);
+		}
+
+		box_min.clear();
+		box_max.clear();
+
+		for (const auto& obstacle : obstacles) {
+			const glm::vec2 min = { obstacle.position.x, -obstacle.position.y - obstacle.size.y };
+			const glm::vec2 max = { obstacle.position.x + obstacle.size.x, -obstacle.position.y };
+
+			if (distance_point_box({ 0.0f, 0.0f }, min, max) <= reach) {
+				box_min.push_back(min);
+				box_max.push_back(max);
+			}
+		}
+	}
+
+	void ik_scene::arm_chain_t::forward(const float* joints, std::vector<glm::vec2>& points) const {
+		const int n = dimension();
+		points.resize(n + 1);
+		points[0] = { 0.0f, 0.0f };
+
+		float angle = 0.0f;
+		for (int i = 0; i < n; ++i) {
+			angle += joints[i];
+			points[i + 1] = points[i] + lengths[i] * glm::vec2{ cosf(angle), sinf(angle) };
+		}
+	}
+
+	float ik_scene::arm_chain_t::displacement(const float* from, const float* to) const {
+		// joint i swings every point after it by at most the change of its angle times
+		// the remaining length of the arm, this bounds how far any point of the arm moves
+		float bound = 0.0f, radius = 0.0f;
+		for (int i = dimension() - 1; i >= 0; --i) {
+			radius += glm::abs(lengths[i]);
+			bound += glm::abs(angle_delta(from[i], to[i])) * radius;
+		}
+
+		return bound;
+	}
+
+	bool ik_scene::arm_chain_t::collides(const float* joints) const {
+		if (box_min.empty()) {
+			return false;
+		}
+
+		glm::vec2 s = { 0.0f, 0.0f };
+		float angle = 0.0f;
+
+		for (int i = 0; i < dimension(); ++i) {
+			angle += joints[i];
+			const glm::vec2 e = s + lengths[i] * glm::vec2{ cosf(angle), sinf(angle) };
+			const glm::vec2 link_min = glm::min(s, e);
+			const glm::vec2 link_max = glm::max(s, e);
+
+			// short links can end up fully inside a box, so test overlap instead of crossing,
+			// most boxes are rejected by their bounds before the segment is clipped
+			for (std::size_t j = 0; j < box_min.size(); ++j) {
+				if (link_max.x < box_min[j].x || link_min.x > box_max[j].x ||
+					link_max.y < box_min[j].y || link_min.y > box_max[j].y) {
+					continue;
+				}
+
+				if (clip_segment_box(s, e, box_min[j], box_max[j])) {
+					return true;
+				}
+			}
+
+			s = e;
+		}
+
+		return false;
+	}
+
+	ik_scene::kd_tree_t::kd_tree_t() : 
+		dimension(0),
+		approximation(1.0f) { }
+
+	void ik_scene::kd_tree_t::clear(int dim) {
+		dimension = dim;
+		points.clear();
+		left.clear();
+		right.clear();
+	}
+
+	int ik_scene::kd_tree_t::insert(const float* point) {
+		const int index = size();
+
+		points.insert(points.end(), point, point + dimension);
+		left.push_back(-1);
+		right.push_back(-1);
+
+		if (index == 0) {
+			return index;
+		}
+
+		for (int node = 0, depth = 0;; ++depth) {
+			const int axis = depth % dimension;
+			int& child = (point[axis] < points[node * dimension + axis]) ? left[node] : right[node];
+
+			if (child < 0) {
+				child = index;
+				return index;
+			}
+
+			node = child;
+		}
+	}
+
+	void ik_scene::kd_tree_t::remove_last() {
+		const int index = size() - 1;
+		const float* last = point(index);
+
+		// the last point is always a leaf, found along the same path insert took
+		for (int node = 0, depth = 0; node != index; ++depth) {
+			const int axis = depth % dimension;
+			int& child = (last[axis] < points[node * dimension + axis]) ? left[node] : right[node];
+
+			if (child == index) {
+				child = -1;
+				break;
+			}
+
+			node = child;
+		}
+
+		points.resize(static_cast<std::size_t>(index) * dimension);
+		left.pop_back();
+		right.pop_back();
+	}
+
+	int ik_scene::kd_tree_t::size() const {
+		return static_cast<int>(left.size());
+	}
+
+	const float* ik_scene::kd_tree_t::point(int index) const {
+		return points.data() + static_cast<std::size_t>(index) * dimension;
+	}
+
+	int ik_scene::kd_tree_t::nearest(const float* query) const {
+		std::vector<int> result;
+		k_nearest(query, 1, result);
+
+		return (result.empty()) ? -1 : result[0];
+	}
+
+	void ik_scene::kd_tree_t::k_nearest(const float* query, int k, std::vector<int>& result) const {
+		result.clear();
+
+		if (size() == 0 || k <= 0) {
+			return;
+		}
+
+		search_t search;
+		search.query = query;
+		search.k = static_cast<std::size_t>(k);
+		search.offsets.assign(dimension, 0.0f);
+		search.heap.reserve(k + 1);
+
+		m_search(0, 0, 0.0f, search);
+		std::sort_heap(search.heap.begin(), search.heap.end());
+
+		for (const auto& [distance, index] : search.heap) {
+			result.push_back(index);
+		}
+	}
+
+	void ik_scene::kd_tree_t::m_search(int node, int depth, float bound, search_t& search) const {
+		constexpr float pi = glm::pi<float>();
+		constexpr float infinity = std::numeric_limits<float>::infinity();
+
+		auto& heap = search.heap;
+		const float* query = search.query;
+		const float* p = point(node);
+
+		const float worst = (heap.size() < search.k) ? infinity : heap.front().first;
+		const float distance = joint_distance_sq(query, p, dimension, worst);
+
+		if (heap.size() < search.k) {
+			heap.emplace_back(distance, node);
+			std::push_heap(heap.begin(), heap.end());
+		} else if (distance < heap.front().first) {
+			std::pop_heap(heap.begin(), heap.end());
+			heap.back() = { distance, node };
+			std::push_heap(heap.begin(), heap.end());
+		}
+
+		const int axis = depth % dimension;
+		const float diff = query[axis] - p[axis];
+		const int near_child = (diff < 0.0f) ? left[node] : right[node];
+		const int far_child = (diff < 0.0f) ? right[node] : left[node];
+
+		if (near_child >= 0) {
+			m_search(near_child, depth + 1, bound, search);
+		}
+
+		if (far_child < 0) {
+			return;
+		}
+
+		// the far side can be reached across the split or across the seam at +-pi, the bound
+		// collects the squared distance to the subtree over all axes split on the way down
+		const float seam = (diff < 0.0f) ? query[axis] + pi : pi - query[axis];
+		const float old_offset = search.offsets[axis];
+		const float new_offset = glm::max(old_offset, glm::min(glm::abs(diff), seam));
+		const float far_bound = bound - old_offset * old_offset + new_offset * new_offset;
+
+		const float scale = approximation * approximation;
+		if (heap.size() < search.k || far_bound * scale < heap.front().first) {
+			search.offsets[axis] = new_offset;
+			m_search(far_child, depth + 1, far_bound, search);
+			search.offsets[axis] = old_offset;
+		}
+	}
+
+	ik_scene::sampling_planner_t::sampling_planner_t() :
+		random(5489u),
+		num_samples(0),
+		num_checks(0) { }
+
+	void ik_scene::sampling_planner_t::reset(std::vector<float>&& lengths, const std::vector<obstacle_t>& obstacles) {
+		chain.lengths = std::move(lengths);
+		chain.set_obstacles(obstacles);
+
+		// roadmap edges only need to connect nearby vertices, not strictly the nearest ones,
+		// and exact queries in ten dimensions end up visiting most of the tree
+		roadmap.clear(chain.dimension());
+		roadmap.approximation = 2.0f;
+		adjacency.clear();
+		edge_from.clear();
+		edge_to.clear();
+		edge_length.clear();
+		edge_state.clear();
+	}
+
+	bool ik_scene::sampling_planner_t::find_path(
+		const chain_configuration_t& start,
+		const chain_configuration_t& end,
+		const sampling_settings_t& settings,
+		std::vector<chain_configuration_t>& path) {
+
+		path.clear();
+		num_samples = 0;
+		num_checks = 0;
+
+		const std::size_t n = static_cast<std::size_t>(chain.dimension());
+		if (n == 0 || start.size() != n || end.size() != n) {
+			return false;
+		}
+
+		if (chain.collides(start.data()) || chain.collides(end.data())) {
+			return false;
+		}
+
+		const bool found = (settings.sampler == sampler_t::rrt_connect) ?
+			m_rrt_connect(start, end, settings, path) :
+			m_lazy_prm(start, end, settings, path);
+
+		if (!found) {
+			path.clear();
+			return false;
+		}
+
+		if (settings.shortcut) {
+			m_shortcut(path, settings.resolution);
+		}
+
+		m_densify(path, settings.resolution);
+		return true;
+	}
+
+	void ik_scene::sampling_planner_t::m_sample(float* out) {
+		constexpr float pi = glm::pi<float>();
+		std::uniform_real_distribution<float> angle(-pi, pi);
+
+		for (int i = 0; i < chain.dimension(); ++i) {
+			out[i] = angle(random);
+		}
+	}
+
+	void ik_scene::sampling_planner_t::m_steer(const float* from, const float* to, float range, float* out) const {
+		const int n = chain.dimension();
+		const float distance = glm::sqrt(joint_distance_sq(from, to, n));
+		const float t = (distance > range) ? range / distance : 1.0f;
+
+		for (int i = 0; i < n; ++i) {
+			out[i] = wrap_angle(from[i] + t * angle_delta(from[i], to[i]));
+		}
+	}
+
+	bool ik_scene::sampling_planner_t::m_is_edge_free(const float* from, const float* to, float resolution) {
+		const int n = chain.dimension();
+		const int steps = static_cast<int>(std::ceil(chain.displacement(from, to) / resolution));
+
+		std::vector<float> delta(n), q(n);
+		for (int i = 0; i < n; ++i) {
+			delta[i] = angle_delta(from[i], to[i]);
+		}
+
+		// the end points are checked by the caller, inner points go in bisection order
+		// so a blocked edge is usually rejected after a couple of samples
+		for (int level = 1; (1 << (level - 1)) < steps; ++level) {
+			const int count = 1 << level;
+
+			for (int j = 1; j < count; j += 2) {
+				const float t = static_cast<float>(j) / static_cast<float>(count);
+				for (int i = 0; i < n; ++i) {
+					q[i] = from[i] + t * delta[i];
+				}
+
+				++num_checks;
+				if (chain.collides(q.data())) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void ik_scene::sampling_planner_t::m_check_edges(const std::vector<int>& edges, float resolution) {
+		const int n = chain.dimension();
+		std::vector<int> pending;
+		std::vector<float> q(n);
+
+		for (const int edge : edges) {
+			if (edge_state[edge] == EDGE_UNKNOWN) {
+				pending.push_back(edge);
+			}
+		}
+
+		// all edges of a candidate path are refined together one bisection level at a time,
+		// the first blocked edge is usually found long before any edge is fully verified
+		for (int level = 1; !pending.empty(); ++level) {
+			const int count = 1 << level;
+			bool any_blocked = false;
+
+			for (std::size_t k = 0; k < pending.size();) {
+				const int edge = pending[k];
+				const float* from = roadmap.point(edge_from[edge]);
+				const float* to = roadmap.point(edge_to[edge]);
+				const int steps = static_cast<int>(std::ceil(chain.displacement(from, to) / resolution));
+
+				bool blocked = false;
+				if ((1 << (level - 1)) < steps) {
+					for (int j = 1; j < count && !blocked; j += 2) {
+						const float t = static_cast<float>(j) / static_cast<float>(count);
+						for (int i = 0; i < n; ++i) {
+							q[i] = from[i] + t * angle_delta(from[i], to[i]);
+						}
+
+						++num_checks;
+						blocked = chain.collides(q.data());
+					}
+
+					if (!blocked) {
+						++k;
+						continue;
+					}
+				}
+
+				edge_state[edge] = (blocked) ? EDGE_BLOCKED : EDGE_FREE;
+				any_blocked = any_blocked || blocked;
+
+				pending[k] = pending.back();
+				pending.pop_back();
+			}
+
+			if (any_blocked) {
+				return;
+			}
+		}
+	}
+
+	int ik_scene::sampling_planner_t::m_add_vertex(const float* joints, int neighbors) {
+		std::vector<int> near;
+		roadmap.k_nearest(joints, neighbors, near);
+
+		const int index = roadmap.insert(joints);
+		adjacency.emplace_back();
+
+		for (const int other : near) {
+			const int edge = static_cast<int>(edge_state.size());
+
+			edge_from.push_back(index);
+			edge_to.push_back(other);
+			edge_length.push_back(glm::sqrt(joint_distance_sq(roadmap.point(index), roadmap.point(other), roadmap.dimension)));
+			edge_state.push_back(EDGE_UNKNOWN);
+
+			adjacency[index].push_back(edge);
+			adjacency[other].push_back(edge);
+		}
+
+		return index;
+	}
+
+	void ik_scene::sampling_planner_t::m_remove_last_vertex() {
+		const int index = roadmap.size() - 1;
+
+		// the edges of the last vertex are the last ones added, and the last ones in the
+		// adjacency list of every neighbour
+		for (std::size_t k = adjacency[index].size(); k-- > 0;) {
+			const int edge = adjacency[index][k];
+			const int other = (edge_from[edge] == index) ? edge_to[edge] : edge_from[edge];
+
+			adjacency[other].pop_back();
+			edge_from.pop_back();
+			edge_to.pop_back();
+			edge_length.pop_back();
+			edge_state.pop_back();
+		}
+
+		adjacency.pop_back();
+		roadmap.remove_last();
+	}
+
+	bool ik_scene::sampling_planner_t::m_rrt_connect(
+		const chain_configuration_t& start,
+		const chain_configuration_t& end,
+		const sampling_settings_t& settings,
+		std::vector<chain_configuration_t>& path) {
+
+		const int n = chain.dimension();
+
+		kd_tree_t trees[2];
+		std::vector<int> parents[2];
+		std::vector<float> target(n), q_new(n);
+
+		for (int i = 0; i < n; ++i) {
+			target[i] = wrap_angle(start[i]);
+			q_new[i] = wrap_angle(end[i]);
+		}
+
+		trees[0].clear(n);
+		trees[1].clear(n);
+		trees[0].insert(target.data());
+		trees[1].insert(q_new.data());
+		parents[0].push_back(-1);
+		parents[1].push_back(-1);
+
+		const auto extend = [&](int tree, const float* goal) -> int {
+			const int near = trees[tree].nearest(goal);
+			const float* from = trees[tree].point(near);
+			const bool reaches = joint_distance_sq(from, goal, n) <= settings.range * settings.range;
+
+			m_steer(from, goal, settings.range, q_new.data());
+
+			++num_checks;
+			if (chain.collides(q_new.data()) || !m_is_edge_free(from, q_new.data(), settings.resolution)) {
+				return EXTEND_TRAPPED;
+			}
+
+			trees[tree].insert(q_new.data());
+			parents[tree].push_back(near);
+
+			return (reaches) ? EXTEND_REACHED : EXTEND_ADVANCED;
+		};
+
+		const auto trace = [&](int tree, int node, std::vector<chain_configuration_t>& out) {
+			for (; node >= 0; node = parents[tree][node]) {
+				const float* p = trees[tree].point(node);
+				out.emplace_back(p, p + n);
+			}
+		};
+
+		for (int a = 0; num_samples < static_cast<std::size_t>(settings.max_samples); a = 1 - a) {
+			m_sample(target.data());
+			++num_samples;
+
+			if (extend(a, target.data()) == EXTEND_TRAPPED) {
+				continue;
+			}
+
+			// the other tree greedily grows towards the node that was just added
+			const int joined = trees[a].size() - 1;
+			std::copy(trees[a].point(joined), trees[a].point(joined) + n, target.begin());
+
+			int status = EXTEND_ADVANCED;
+			while (status == EXTEND_ADVANCED) {
+				status = extend(1 - a, target.data());
+			}
+
+			if (status != EXTEND_REACHED) {
+				continue;
+			}
+
+			// both trees now hold the joined configuration, the copy in tree b is skipped
+			std::vector<chain_configuration_t> half_a, half_b;
+			const int b = 1 - a;
+
+			trace(a, joined, half_a);
+			trace(b, parents[b][trees[b].size() - 1], half_b);
+			std::reverse(half_a.begin(), half_a.end());
+
+			path = std::move(half_a);
+			path.insert(path.end(), half_b.begin(), half_b.end());
+
+			if (a == 1) {
+				std::reverse(path.begin(), path.end());
+			}
+
+			path.front() = start;
+			path.back() = end;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ik_scene::sampling_planner_t::m_lazy_prm(
+		const chain_configuration_t& start,
+		const chain_configuration_t& end,
+		const sampling_settings_t& settings,
+		std::vector<chain_configuration_t>& path) {
+
+		constexpr int batch_size = 500;
+
+		// every blocked edge on a candidate path costs another graph search, when too many
+		// candidates fail in a row the roadmap is grown instead of searching it again
+		constexpr int max_failures = 16;
+
+		const int n = chain.dimension();
+
+		std::vector<float> sample(n);
+		const auto grow = [&]() {
+			// the roadmap doubles whenever it turns out too sparse, so even a query that fails
+			// only goes through a logarithmic number of rounds
+			const int count = glm::min(settings.max_samples - roadmap.size(), glm::max(batch_size, roadmap.size()));
+			const int target = roadmap.size() + count;
+
+			for (int attempt = 0; attempt < 4 * count && roadmap.size() < target; ++attempt) {
+				m_sample(sample.data());
+				++num_samples;
+
+				// vertices are cheap to check up front, edges are only checked when a path uses them
+				++num_checks;
+				if (!chain.collides(sample.data())) {
+					m_add_vertex(sample.data(), settings.neighbors);
+				}
+			}
+		};
+
+		if (roadmap.size() == 0) {
+			grow();
+		}
+
+		// the query end points only join the roadmap for the search, otherwise every query
+		// would leave two vertices behind and use up max_samples on them
+		int source = -1, target = -1;
+		const auto connect = [&]() {
+			for (int i = 0; i < n; ++i) {
+				sample[i] = wrap_angle(start[i]);
+			}
+
+			source = m_add_vertex(sample.data(), settings.neighbors);
+
+			for (int i = 0; i < n; ++i) {
+				sample[i] = wrap_angle(end[i]);
+			}
+
+			target = m_add_vertex(sample.data(), settings.neighbors);
+		};
+
+		const auto disconnect = [&]() {
+			m_remove_last_vertex();
+			m_remove_last_vertex();
+		};
+
+		connect();
+
+		std::vector<float> cost;
+		std::vector<int> via;
+		std::vector<int> path_edges;
+
+		using entry_t = std::pair<float, int>;
 
-		return (data[base + 0] != 0);
-	}
+		for (int failures = 0;;) {
+			const auto heuristic = [&](int vertex) -> float {
+				return glm::sqrt(joint_distance_sq(roadmap.point(vertex), roadmap.point(target), n));
+			};
 
-	void ik_scene::configuration_space_t::set_collision(int x, int y, bool collision) {
-		int index = y * res_x + x;
-		int base = 3 * index;
+			cost.assign(roadmap.size(), std::numeric_limits<float>::infinity());
+			via.assign(roadmap.size(), -1);
 
-		unsigned char val = (collision) ? 255 : 0;
-		data[base + 0] = val;
-	}
+			std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+			cost[source] = 0.0f;
+			open.push({ heuristic(source), source });
 
-	void ik_scene::configuration_space_t::update_texture() {
-		texture->update(data.data());
-	}
+			bool found = false;
+			while (!open.empty()) {
+				const auto [estimate, vertex] = open.top();
+				open.pop();
 
-	void ik_scene::configuration_space_t::clear_texture() {
-		std::fill(data.begin(), data.end(), 0);
-	}
+				if (vertex == target) {
+					found = true;
+					break;
+				}
 
-	bool ik_scene::configuration_space_t::find_path(
-		const robot_configuration_t& start, 
-		const robot_configuration_t& end, 
-		std::vector<robot_configuration_t>& path) {
-		
-		if (dist.size() != static_cast<std::size_t>(res_x * res_y)) {
-			dist.resize(res_x * res_y);
-		}
+				if (estimate > cost[vertex] + heuristic(vertex)) {
+					continue;
+				}
 
-		constexpr int INF_DIST = 999999;
-		std::fill(dist.begin(), dist.end(), INF_DIST);
+				for (const int edge : adjacency[vertex]) {
+					if (edge_state[edge] == EDGE_BLOCKED) {
+						continue;
+					}
 
-		const auto config_to_coords = [&](const robot_configuration_t & config) -> std::pair<int, int> {
-			constexpr float pi = glm::pi<float>();
-			float alpha = 0.5f * (config.theta1 + pi) / pi;
-			float beta = 0.5f * (config.theta2 + pi) / pi;
+					const int other = (edge_from[edge] == vertex) ? edge_to[edge] : edge_from[edge];
+					const float next = cost[vertex] + edge_length[edge];
 
-			int x = static_cast<int>(roundf(alpha * res_x));
-			int y = static_cast<int>(roundf(beta * res_y));
+					if (next < cost[other]) {
+						cost[other] = next;
+						via[other] = edge;
+						open.push({ next + heuristic(other), other });
+					}
+				}
+			}
 
-			return {x,y};
-		};
+			if (!found || failures >= max_failures) {
+				disconnect();
 
-		const auto add_wrapped = [&](const std::pair<int, int>& cell, int dx, int dy) -> std::pair<int, int> {
-			std::pair<int,int> val = cell;
+				if (roadmap.size() >= settings.max_samples) {
+					return false;
+				}
 
-			val.first += dx;
-			val.second += dy;
+				grow();
+				connect();
 
-			if (val.first >= res_x) {
-				val.first = val.first % res_x;
-			} else if (val.first < 0) {
-				val.first = res_x + (val.first % res_x);
+				failures = 0;
+				continue;
 			}
 
-			if (val.second >= res_y) {
-				val.second = val.second % res_y;
-			} else if (val.second < 0) {
-				val.second = res_y + (val.second % res_y);
+			path_edges.clear();
+			for (int vertex = target; vertex != source;) {
+				const int edge = via[vertex];
+				path_edges.push_back(edge);
+				vertex = (edge_from[edge] == vertex) ? edge_to[edge] : edge_from[edge];
 			}
 
-			return val;
-		};
+			m_check_edges(path_edges, settings.resolution);
 
-		auto start_cell = config_to_coords(start);
-		auto end_cell = config_to_coords(end);
+			const bool valid = std::all_of(path_edges.begin(), path_edges.end(), [&](int edge) {
+				return edge_state[edge] == EDGE_FREE;
+			});
 
-		std::deque<std::pair<int,int>> s;
-		s.push_back(start_cell);
+			if (!valid) {
+				++failures;
+				continue;
+			}
 
-		int idx_start = start_cell.second * res_x + start_cell.first;
-		//int idx_end = end_cell.second * res_x + end_cell.first;
+			path.clear();
+			for (int vertex = target;;) {
+				const float* p = roadmap.point(vertex);
+				path.emplace_back(p, p + n);
 
-		dist[idx_start] = 0;
+				if (vertex == source) {
+					break;
+				}
 
-		const auto handle_neighbor = [&](const std::pair<int, int>& cell, const std::pair<int, int>& neighbor) -> void {
-			if (is_collision(neighbor.first, neighbor.second)) {
-				return;
+				const int edge = via[vertex];
+				vertex = (edge_from[edge] == vertex) ? edge_to[edge] : edge_from[edge];
 			}
 
-			int idx1 = cell.second * res_x + cell.first;
-			int idx2 = neighbor.second * res_x + neighbor.first;
+			disconnect();
 
-			int d = dist[idx1] + 1;
-			if (dist[idx2] > d) {
-				dist[idx2] = d;
-				s.push_front(neighbor);
-
-				data[3*idx2 + 1] = glm::min(d,255);
-			}
-		};
+			std::reverse(path.begin(), path.end());
+			path.front() = start;
+			path.back() = end;
+			return true;
+		}
+	}
 
-		while (!s.empty()) {
-			auto current = s.back();
-			s.pop_back();
+	void ik_scene::sampling_planner_t::m_shortcut(std::vector<chain_configuration_t>& path, float resolution) {
+		for (int attempt = 0; attempt < 100 && path.size() > 2; ++attempt) {
+			std::uniform_int_distribution<std::size_t> pick(0, path.size() - 1);
+			std::size_t i = pick(random), j = pick(random);
 
-			auto up = add_wrapped(current, 0, -1);
-			auto down = add_wrapped(current, 0, 1);
-			auto left = add_wrapped(current, -1, 0);
-			auto right = add_wrapped(current, 1, 0);
+			if (i > j) {
+				std::swap(i, j);
+			}
 
-			handle_neighbor(current, up);
-			handle_neighbor(current, down);
-			handle_neighbor(current, left);
-			handle_neighbor(current, right);
+			if (j - i >= 2 && m_is_edge_free(path[i].data(), path[j].data(), resolution)) {
+				path.erase(path.begin() + i + 1, path.begin() + j);
+			}
 		}
+	}
 
-		const auto convert_to_config = [&](const std::pair<int, int>& cell) -> robot_configuration_t {
-			constexpr float pi = glm::pi<float>();
-			const float rx = static_cast<float>(res_x);
-			const float ry = static_cast<float>(res_y);
-			const float fx = static_cast<float>(cell.first);
-			const float fy = static_cast<float>(cell.second);
-			const float alpha = ((fx / rx) * 2.0f * pi) - pi;
-			const float beta = ((fy / ry) * 2.0f * pi) - pi;
-
-			return {alpha, beta};
-		};
+	void ik_scene::sampling_planner_t::m_densify(std::vector<chain_configuration_t>& path, float resolution) const {
+		const int n = chain.dimension();
+		std::vector<chain_configuration_t> result;
 
-		std::vector<std::pair<int,int>> inv_path;
-		auto curr = end_cell;
+		for (std::size_t k = 0; k < path.size(); ++k) {
+			result.push_back(path[k]);
 
-		inv_path.push_back(curr);
-		while (curr != start_cell) {
-			int idx = curr.second * res_x + curr.first;
-			if (dist[idx] >= INF_DIST) {
-				return false;
+			if (k + 1 == path.size()) {
+				break;
 			}
 
-			auto up = add_wrapped(curr, 0, -1);
-			auto down = add_wrapped(curr, 0, 1);
-			auto left = add_wrapped(curr, -1, 0);
-			auto right = add_wrapped(curr, 1, 0);
-
-			int up_idx = up.second * res_x + up.first;
-			int down_idx = down.second * res_x + down.first;
-			int left_idx = left.second * res_x + left.first;
-			int right_idx = right.second * res_x + right.first;
-
-			int d = dist[idx];
-			if (dist[up_idx] == d - 1) {
-				curr = up;
-				data[3 * up_idx + 2] = 255;
-				inv_path.push_back(curr);
-			} else if (dist[down_idx] == d - 1) {
-				curr = down;
-				data[3 * down_idx + 2] = 255;
-				inv_path.push_back(curr);
-			} else if (dist[left_idx] == d - 1) {
-				curr = left;
-				data[3 * left_idx + 2] = 255;
-				inv_path.push_back(curr);
-			} else if (dist[right_idx] == d - 1) {
-				curr = right;
-				data[3 * right_idx + 2] = 255;
-				inv_path.push_back(curr);
-			} else {
-				return false;
+			const auto& from = path[k];
+			const auto& to = path[k + 1];
+			const int steps = static_cast<int>(std::ceil(chain.displacement(from.data(), to.data()) / resolution));
+
+			for (int s = 1; s < steps; ++s) {
+				const float t = static_cast<float>(s) / static_cast<float>(steps);
+				chain_configuration_t q(n);
+
+				for (int i = 0; i < n; ++i) {
+					q[i] = from[i] + t * angle_delta(from[i], to[i]);
+				}
+
+				result.push_back(std::move(q));
 			}
 		}
 
-		path.resize(inv_path.size());
-		int i = 0;
-		for (auto it = inv_path.rbegin(); it != inv_path.rend(); ++it) {
-			path[i++] = convert_to_config(*it);
-		}
+		path = std::move(result);
+	}
 
-		update_texture();
-		return true;
+	resource_manifest_t ik_scene::get_manifest() {
+		return { { "grid_xy", "line", "obstacle" } };
+	}
+
+	std::shared_ptr<ik_scene::prepared_t> ik_scene::prepare() {
+		// a new scene has no obstacles yet, so there are no footprints to rasterize and the
+		// space is its grids and the image the texture starts from
+		configuration_space_t conf(360, 360);
+		auto pixels = conf.get_pixels();
+
+		return std::make_shared<prepared_t>(prepared_t { std::move(conf), std::move(pixels) });
+	}
+
+	ik_scene::ik_scene(application_base& app, std::shared_ptr<prepared_t> prepared) : 
+		ik_scene(app, std::move(*(prepared ? prepared : prepare()))) {
 	}
 
-	ik_scene::ik_scene(application_base& app) : 
+	ik_scene::ik_scene(application_base& app, prepared_t&& prepared) : 
 		scene_base(app),
-		m_conf(360, 360),
+		m_conf(std::move(prepared.conf)),
+		m_planner_id(0),
+		m_pyramid_levels(9),
+		m_sampler_id(0),
+		m_chain_mode(false),
+		m_chain_links(6),
+		m_chain_link_len(2.0f),
 		m_arm1_len(5.0f),
 		m_arm2_len(6.0f),
 		m_mouse_tool_id(0),
@@ -263,6 +1787,8 @@ namespace mini {
 		m_is_end_collision(false),
 		m_show_path_error(false),
 		m_loop_animation(false),
+		m_live_replanning(false),
+		m_is_dragging_start(false),
 		m_vp_mouse_offset{0, 0},
 		m_start_point{0.0f, 11.0f},
 		m_end_point{11.0f, 0.0f},
@@ -284,9 +1810,9 @@ namespace mini {
 		}
 
 		if (line_shader) {
-			m_robot_arm_start = m_build_robot_arm(line_shader);
-			m_robot_arm_end = m_build_robot_arm(line_shader);
-			m_robot_arm_curr = m_build_robot_arm(line_shader);
+			m_robot_arm_start = m_build_robot_arm(line_shader, 2);
+			m_robot_arm_end = m_build_robot_arm(line_shader, 2);
+			m_robot_arm_curr = m_build_robot_arm(line_shader, 2);
 
 			m_robot_arm_start->set_color({ 0.85f, 0.3f, 0.3f, 1.0f });
 			m_robot_arm_end->set_color({ 0.3f, 0.3f, 0.85f, 1.0f });
@@ -316,15 +1842,17 @@ namespace mini {
 		m_solve_start_ik();
 		m_solve_end_ik();
 
-		m_rebuild_configuration();
+		m_chain_changed();
+		m_conf.create_texture(std::move(prepared.pixels));
 	}
 
-	std::shared_ptr<segments_array> ik_scene::m_build_robot_arm(std::shared_ptr<shader_program> line_shader) const {
-		auto arm = std::make_shared<segments_array>(line_shader, 3);
+	std::shared_ptr<segments_array> ik_scene::m_build_robot_arm(
+		std::shared_ptr<shader_program> line_shader, std::size_t num_links) const {
+		auto arm = std::make_shared<segments_array>(line_shader, num_links + 1);
 
-		arm->add_segment(0, 1);
-		arm->add_segment(1, 2);
-		arm->add_segment(2, 3);
+		for (std::size_t i = 0; i < num_links; ++i) {
+			arm->add_segment(i, i + 1);
+		}
 
 		arm->set_line_width(4.0f);
 		arm->set_color({0.0f, 0.0f, 0.0f, 1.0f});
@@ -341,9 +1869,15 @@ namespace mini {
 	}
 
 	void ik_scene::integrate(float delta_time) {
-		m_configure_robot_arm(m_robot_arm_start, m_start_config);
-		m_configure_robot_arm(m_robot_arm_curr, m_current_config);
-		m_configure_robot_arm(m_robot_arm_end, m_end_config);
+		if (m_chain_mode) {
+			m_configure_chain_arm(m_chain_arm_start, m_chain_start);
+			m_configure_chain_arm(m_chain_arm_curr, m_chain_current);
+			m_configure_chain_arm(m_chain_arm_end, m_chain_end);
+		} else {
+			m_configure_robot_arm(m_robot_arm_start, m_start_config);
+			m_configure_robot_arm(m_robot_arm_curr, m_current_config);
+			m_configure_robot_arm(m_robot_arm_end, m_end_config);
+		}
 
 		if (m_is_adding_obstacle) {
 			if (!m_viewport_focus) {
@@ -365,11 +1899,26 @@ namespace mini {
 			m_curr_obstacle.size = {width, height};
 		}
 
-		if (m_animation_playing) {
-			if (m_path.size() == 0) {
-				m_animation_playing = false;
+		if (m_is_dragging_start && (!m_viewport_focus || !get_app().is_left_click())) {
+			m_is_dragging_start = false;
+		}
+
+		if (m_is_dragging_start) {
+			// with a cached distance field every query is cheap enough to run each frame
+			m_start_point = m_get_mouse_world();
+			m_solve_start_ik();
+
+			if (m_live_replanning) {
+				m_replan_path();
 			}
+		}
+
+		const std::size_t path_size = (m_chain_mode) ? m_chain_path.size() : m_path.size();
+		if (m_animation_playing && path_size == 0) {
+			m_animation_playing = false;
+		}
 
+		if (m_animation_playing) {
 			m_animation_timer += 0.25f * delta_time;
 			if (m_animation_timer >= 1.0f) {
 				if (m_loop_animation) {
@@ -380,8 +1929,12 @@ namespace mini {
 				}
 			}
 
-			int anim_frame = static_cast<int>(m_animation_timer * static_cast<float>(m_path.size() - 1));
-			m_current_config = m_path[anim_frame];
+			int anim_frame = static_cast<int>(m_animation_timer * static_cast<float>(path_size - 1));
+			if (m_chain_mode) {
+				m_chain_current = m_chain_path[anim_frame];
+			} else {
+				m_current_config = m_path[anim_frame];
+			}
 		}
 
 		m_check_collisions();
@@ -425,6 +1978,17 @@ namespace mini {
 		}
 
 		auto arm_model = glm::mat4x4(1.0f);
+		if (m_chain_mode) {
+			context.draw(m_chain_arm_start, arm_model);
+			context.draw(m_chain_arm_end, arm_model);
+
+			if (m_animation_playing) {
+				context.draw(m_chain_arm_curr, arm_model);
+			}
+
+			return;
+		}
+
 		context.draw(m_robot_arm_start, arm_model);
 		context.draw(m_robot_arm_end, arm_model);
 		
@@ -509,6 +2073,31 @@ namespace mini {
 				m_mode_changed();
 			}
 
+			if (ImGui::TreeNode("N-Link Arm")) {
+				bool chain_changed = false;
+
+				gui::prefix_label("Enabled:", 250.0f);
+				chain_changed = ImGui::Checkbox("##ik_chain_mode", &m_chain_mode) || chain_changed;
+
+				gui::prefix_label("Links:", 250.0f);
+				if (ImGui::InputInt("##ik_chain_links", &m_chain_links)) {
+					gui::clamp(m_chain_links, 2, 10);
+					chain_changed = true;
+				}
+
+				gui::prefix_label("Link Len. :", 250.0f);
+				if (ImGui::InputFloat("##ik_chain_len", &m_chain_link_len)) {
+					m_chain_link_len = glm::max(0.1f, m_chain_link_len);
+					chain_changed = true;
+				}
+
+				if (chain_changed) {
+					m_chain_changed();
+				}
+
+				ImGui::TreePop();
+			}
+
 			ImGui::SetNextItemOpen(true, ImGuiCond_Once);
 			if (ImGui::TreeNode("Start Point")) {
 				bool start_changed = false;
@@ -571,11 +2160,86 @@ namespace mini {
 			if (ImGui::TreeNode("Pathfinding")) {
 				gui::prefix_label("Loop Anim. :", 250.0f);
 				ImGui::Checkbox("##ik_loop_anim", &m_loop_animation);
+
+				if (m_chain_mode) {
+					constexpr const char* samplers[] = { "RRT-Connect", "Lazy PRM" };
+					gui::prefix_label("Planner:", 250.0f);
+
+					if (ImGui::Combo("##ik_sampler", &m_sampler_id, samplers, 2)) {
+						m_sampling.sampler = (m_sampler_id == 0) ? sampler_t::rrt_connect : sampler_t::lazy_prm;
+					}
+
+					gui::prefix_label("Max Samples:", 250.0f);
+					if (ImGui::InputInt("##ik_max_samples", &m_sampling.max_samples)) {
+						gui::clamp(m_sampling.max_samples, 100, 200000);
+					}
+
+					if (m_sampling.sampler == sampler_t::lazy_prm) {
+						gui::prefix_label("Neighbors:", 250.0f);
+						if (ImGui::InputInt("##ik_neighbors", &m_sampling.neighbors)) {
+							gui::clamp(m_sampling.neighbors, 2, 30);
+							m_reset_sampler();
+						}
+					}
+
+					gui::prefix_label("Step Size:", 250.0f);
+					if (ImGui::InputFloat("##ik_sampling_range", &m_sampling.range)) {
+						gui::clamp(m_sampling.range, 0.05f, glm::pi<float>());
+					}
+
+					gui::prefix_label("Check Res. :", 250.0f);
+					if (ImGui::InputFloat("##ik_sampling_res", &m_sampling.resolution)) {
+						gui::clamp(m_sampling.resolution, 0.01f, 1.0f);
+					}
+
+					gui::prefix_label("Shortcut Path:", 250.0f);
+					ImGui::Checkbox("##ik_sampling_shortcut", &m_sampling.shortcut);
+
+					ImGui::Text("Samples: %zu, Checks: %zu", m_sampler.num_samples, m_sampler.num_checks);
+					if (m_sampling.sampler == sampler_t::lazy_prm) {
+						ImGui::Text("Roadmap: %d vertices", m_sampler.roadmap.size());
+					}
+				} else {
+					constexpr const char* planners[] = { "BFS", "A*", "Distance Field", "Hierarchical" };
+					gui::prefix_label("Planner:", 250.0f);
+
+					if (ImGui::Combo("##ik_planner", &m_planner_id, planners, 4)) {
+						switch (m_planner_id) {
+							case 0: m_planner.planner = planner_t::bfs; break;
+							case 1: m_planner.planner = planner_t::astar; break;
+							case 2: m_planner.planner = planner_t::distance_field; break;
+							case 3: m_planner.planner = planner_t::hierarchical; break;
+						}
+					}
+
+					if (m_planner.planner == planner_t::hierarchical) {
+						gui::prefix_label("Pyramid Levels:", 250.0f);
+						if (ImGui::InputInt("##ik_pyramid_levels", &m_pyramid_levels)) {
+							gui::clamp(m_pyramid_levels, 4, 12);
+						}
+
+						if (m_pyramid.valid) {
+							const int res = m_pyramid.resolution;
+							ImGui::Text("Nodes: %zu (%d x %d grid)", m_pyramid.num_nodes, res, res);
+						}
+					}
+				}
+
+				gui::prefix_label("Live Replanning:", 250.0f);
+				ImGui::Checkbox("##ik_live_replan", &m_live_replanning);
+
+				if (!m_chain_mode) {
+					gui::prefix_label("Diagonal Moves:", 250.0f);
+					ImGui::Checkbox("##ik_diagonal", &m_planner.diagonal);
+
+					gui::prefix_label("Shortcut Path:", 250.0f);
+					ImGui::Checkbox("##ik_shortcut", &m_planner.shortcut);
+				}
+
 				ImGui::NewLine();
 
 				if (ImGui::Button("Find Path")) {
-					m_rebuild_configuration();
-					m_show_path_error = !m_conf.find_path(m_start_config, m_end_config, m_path);
+					m_replan_path();
 
 					if (!m_show_path_error) {
 						m_animation_playing = true;
@@ -585,7 +2249,7 @@ namespace mini {
 
 				ImGui::SameLine();
 				if (ImGui::Button("Play Anim")) {
-					if (m_path.size() > 0) {
+					if ((m_chain_mode) ? !m_chain_path.empty() : !m_path.empty()) {
 						m_animation_playing = true;
 						m_animation_timer = 0.0f;
 					}
@@ -638,24 +2302,37 @@ namespace mini {
 					ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);					
 				} else {
 					auto& obstacle = m_obstacles[m_selected_obstacle];
+					bool obstacle_changed = false;
+
 					gui::prefix_label("Obstacle X:", 250.0f);
-					ImGui::SliderFloat("##ik_obstacle_x", &obstacle.position.x, -20.0f, 20.0f);
+					obstacle_changed = ImGui::SliderFloat("##ik_obstacle_x", &obstacle.position.x, -20.0f, 20.0f) || obstacle_changed;
 					gui::prefix_label("Obstacle Y:", 250.0f);
-					ImGui::SliderFloat("##ik_obstacle_y", &obstacle.position.y, -20.0f, 20.0f);
+					obstacle_changed = ImGui::SliderFloat("##ik_obstacle_y", &obstacle.position.y, -20.0f, 20.0f) || obstacle_changed;
 					gui::prefix_label("Obstacle Width:", 250.0f);
-					ImGui::SliderFloat("##ik_obstacle_w", &obstacle.size.x, 0.1f, 20.0f);
+					obstacle_changed = ImGui::SliderFloat("##ik_obstacle_w", &obstacle.size.x, 0.1f, 20.0f) || obstacle_changed;
 					gui::prefix_label("Obstacle Height:", 250.0f);
-					ImGui::SliderFloat("##ik_obstacle_h", &obstacle.size.y, 0.1f, 20.0f);
+					obstacle_changed = ImGui::SliderFloat("##ik_obstacle_h", &obstacle.size.y, 0.1f, 20.0f) || obstacle_changed;
 
 					obstacle.size.x = glm::max(0.1f, obstacle.size.x);
 					obstacle.size.y = glm::max(0.1f, obstacle.size.y);
+
+					if (obstacle_changed) {
+						m_obstacle_changed(m_selected_obstacle);
+					}
 				}
 
 				bool deleted = false;
 
 				if (ImGui::Button("Delete", ImVec2(-1.0f, 24.0f))) {
 					m_obstacles.erase(m_obstacles.begin() + m_selected_obstacle);
-					m_rebuild_configuration();
+					m_conf.clear_path();
+					m_conf.remove_footprint(m_selected_obstacle);
+					m_pyramid.valid = false;
+					m_conf.update_texture();
+					m_path.clear();
+					m_chain_path.clear();
+					m_reset_sampler();
+					m_check_collisions();
 					m_selected_obstacle = -1;
 					deleted = true;
 				}
@@ -748,6 +2425,7 @@ namespace mini {
 		switch (m_mouse_mode) {
 			case mouse_mode_t::start_config:
 				m_start_point = {x, y};
+				m_is_dragging_start = true;
 				m_solve_start_ik();
 				break;
 
@@ -766,11 +2444,13 @@ namespace mini {
 	}
 
 	void ik_scene::m_handle_mouse_release(float x, float y) {
+		m_is_dragging_start = false;
+
 		if (m_is_adding_obstacle) {
 			m_obstacles.push_back(m_curr_obstacle);
 			m_is_adding_obstacle = false;
 
-			m_rebuild_configuration();
+			m_obstacle_changed(static_cast<int>(m_obstacles.size()) - 1);
 		}
 	}
 
@@ -853,6 +2533,20 @@ namespace mini {
 		arm->rebuild_buffers();
 	}
 
+	void ik_scene::m_configure_chain_arm(
+		std::shared_ptr<segments_array>& arm,
+		const chain_configuration_t& config) {
+
+		std::vector<glm::vec2> points;
+		m_sampler.chain.forward(config.data(), points);
+
+		for (std::size_t i = 0; i < points.size(); ++i) {
+			arm->update_point(i, { points[i].x, points[i].y, 0.0f });
+		}
+
+		arm->rebuild_buffers();
+	}
+
 	glm::vec2 ik_scene::m_get_mouse_world() const {
 		float mx = m_vp_mouse_offset.x;
 		float my = m_vp_mouse_offset.y;
@@ -873,6 +2567,16 @@ namespace mini {
 	}
 
 	inline bool ik_scene::m_collides(float alpha, float beta) const {
+		for (const auto& obstacle : m_obstacles) {
+			if (m_collides(alpha, beta, obstacle)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	inline bool ik_scene::m_collides(float alpha, float beta, const obstacle_t& obstacle) const {
 		const float l1 = m_arm1_len;
 		const float l2 = m_arm2_len;
 
@@ -883,57 +2587,158 @@ namespace mini {
 			l2 * sinf(alpha + beta) + l1 * sinf(alpha),
 		};
 
-		bool collision = false;
+		const glm::vec2 box_min = { obstacle.position.x, -obstacle.position.y - obstacle.size.y };
+		const glm::vec2 box_max = { obstacle.position.x + obstacle.size.x, -obstacle.position.y };
+
+		return intersect_box(p0, p1, box_min, box_max) || intersect_box(p1, p2, box_min, box_max);
+	}
+
+	std::vector<int> ik_scene::m_rasterize_obstacle(const obstacle_t& obstacle) const {
+		std::vector<int> cells;
+
+		constexpr float pi = glm::pi<float>();
+		const float step_x = 2.0f * pi / static_cast<float>(m_conf.res_x);
+		const float step_y = 2.0f * pi / static_cast<float>(m_conf.res_y);
+
+		const float l1 = m_arm1_len;
+		const float l2 = m_arm2_len;
+
+		const glm::vec2 box_min = { obstacle.position.x, -obstacle.position.y - obstacle.size.y };
+		const glm::vec2 box_max = { obstacle.position.x + obstacle.size.x, -obstacle.position.y };
+
+		const auto distance_to_box = [&](const glm::vec2& p) -> float {
+			return glm::distance(p, glm::clamp(p, box_min, box_max));
+		};
+
+		// the obstacle is out of reach of the whole arm
+		if (distance_to_box({ 0.0f, 0.0f }) > glm::abs(l1) + glm::abs(l2)) {
+			return cells;
+		}
+
+		for (int x = 0; x < m_conf.res_x; ++x) {
+			const float alpha = step_x * x - pi;
+			const glm::vec2 p1 = { l1 * cosf(alpha), l1 * sinf(alpha) };
+
+			// if the first link hits the obstacle the whole column is blocked, if the second
+			// link cannot reach it for any beta the whole column is free
+			const bool first_link = intersect_box({ 0.0f, 0.0f }, p1, box_min, box_max);
+
+			if (!first_link && distance_to_box(p1) > glm::abs(l2)) {
+				continue;
+			}
+
+			for (int y = 0; y < m_conf.res_y; ++y) {
+				const float beta = step_y * y - pi;
+				const glm::vec2 p2 = {
+					l2 * cosf(alpha + beta) + p1.x,
+					l2 * sinf(alpha + beta) + p1.y,
+				};
+
+				if (first_link || intersect_box(p1, p2, box_min, box_max)) {
+					cells.push_back(y * m_conf.res_x + x);
+				}
+			}
+		}
+
+		return cells;
+	}
+
+	ik_scene::cell_state_t ik_scene::m_classify_region(float alpha, float beta, float half_alpha, float half_beta) const {
+		const float l1 = m_arm1_len;
+		const float l2 = m_arm2_len;
+
+		const glm::vec2 p0 = { 0.0f, 0.0f };
+		const glm::vec2 p1 = { l1 * cosf(alpha), l1 * sinf(alpha) };
+		const glm::vec2 p2 = {
+			l2 * cosf(alpha + beta) + p1.x,
+			l2 * sinf(alpha + beta) + p1.y,
+		};
+
+		// a point at distance s along a link moves by at most s times the change of its angle,
+		// so every configuration in the region keeps the links within these margins
+		const float margin1 = glm::abs(l1) * half_alpha;
+		const float margin2 = margin1 + glm::abs(l2) * (half_alpha + half_beta);
+
+		bool mixed = false;
 		for (const auto& obstacle : m_obstacles) {
-			const glm::vec2 q1 = { obstacle.position.x, -obstacle.position.y };
-			const glm::vec2 q2 = { q1.x + obstacle.size.x, q1.y };
-			const glm::vec2 q3 = { q1.x + obstacle.size.x, q1.y - obstacle.size.y };
-			const glm::vec2 q4 = { q1.x, q1.y - obstacle.size.y };
-			glm::vec2 _r;
-
-			collision = collision || intersect_segment(p0, p1, q1, q2, _r);
-			collision = collision || intersect_segment(p0, p1, q2, q3, _r);
-			collision = collision || intersect_segment(p0, p1, q3, q4, _r);
-			collision = collision || intersect_segment(p0, p1, q4, q1, _r);
-
-			collision = collision || intersect_segment(p1, p2, q1, q2, _r);
-			collision = collision || intersect_segment(p1, p2, q2, q3, _r);
-			collision = collision || intersect_segment(p1, p2, q3, q4, _r);
-			collision = collision || intersect_segment(p1, p2, q4, q1, _r);
-
-			if (collision) {
-				break;
+			const glm::vec2 box_min = { obstacle.position.x, -obstacle.position.y - obstacle.size.y };
+			const glm::vec2 box_max = { obstacle.position.x + obstacle.size.x, -obstacle.position.y };
+
+			if (distance_segment_box(p0, p1, box_min, box_max) > margin1 && 
+				distance_segment_box(p1, p2, box_min, box_max) > margin2) {
+				continue;
+			}
+
+			if (always_crosses_box(p0, p1, box_min, box_max, margin1) || 
+				always_crosses_box(p1, p2, box_min, box_max, margin2)) {
+				return cell_state_t::blocked;
 			}
+
+			mixed = true;
 		}
 
-		return collision;
+		return (mixed) ? cell_state_t::mixed : cell_state_t::free;
+	}
+
+	void ik_scene::m_build_pyramid() {
+		constexpr float pi = glm::pi<float>();
+		const float step = 2.0f * pi / static_cast<float>(1 << m_pyramid_levels);
+
+		m_pyramid.build(m_pyramid_levels, [&](int level, int x, int y) -> cell_state_t {
+			// finest cells are centered on their sample configuration, same as in m_conf
+			const int size = 1 << level;
+			const float alpha = step * (x * size + 0.5f * (size - 1)) - pi;
+			const float beta = step * (y * size + 0.5f * (size - 1)) - pi;
+
+			if (level == 0) {
+				return m_collides(alpha, beta) ? cell_state_t::blocked : cell_state_t::free;
+			}
+
+			const float half = 0.5f * step * static_cast<float>(size);
+			return m_classify_region(alpha, beta, half, half);
+		});
 	}
 
 	void ik_scene::m_check_collisions() {
+		if (m_chain_mode) {
+			m_is_start_collision = m_sampler.chain.collides(m_chain_start.data());
+			m_is_end_collision = m_sampler.chain.collides(m_chain_end.data());
+			return;
+		}
+
 		m_is_start_collision = m_collides(m_start_config.theta1, m_start_config.theta2);
 		m_is_end_collision = m_collides(m_end_config.theta1, m_end_config.theta2);
 	}
 
 	void ik_scene::m_rebuild_configuration() {
-		m_conf.clear_texture();
+		m_pyramid.valid = false;
+		m_conf.clear_path();
+		m_conf.clear_footprints();
 		m_path.clear();
+		m_chain_path.clear();
+
+		m_reset_sampler();
 
 		m_check_collisions();
 
-		constexpr float pi = glm::pi<float>();
-		const float step_x = 2.0f * pi / static_cast<float>(m_conf.res_x);
-		const float step_y = 2.0f * pi / static_cast<float>(m_conf.res_y);
+		for (std::size_t i = 0; i < m_obstacles.size(); ++i) {
+			m_conf.set_footprint(i, m_rasterize_obstacle(m_obstacles[i]));
+		}
 
-		for (int x = 0; x < m_conf.res_x; ++x) {
-			for (int y = 0; y < m_conf.res_y; ++y) {
-				const float alpha = step_x * x - pi;
-				const float beta = step_y * y - pi;
+		m_conf.update_texture();
+	}
 
-				auto collision = m_collides(alpha, beta);
-				m_conf.set_collision(x, y, collision);
-			}
-		}
+	void ik_scene::m_obstacle_changed(int index) {
+		m_pyramid.valid = false;
+		m_conf.clear_path();
+		m_path.clear();
+		m_chain_path.clear();
+
+		m_reset_sampler();
+
+		m_check_collisions();
 
+		m_conf.set_footprint(index, m_rasterize_obstacle(m_obstacles[index]));
 		m_conf.update_texture();
 	}
 
@@ -982,13 +2787,120 @@ namespace mini {
 		m_rebuild_configuration();
 	}
 
+	void ik_scene::m_chain_changed() {
+		const std::size_t num_links = static_cast<std::size_t>(m_chain_links);
+
+		// new joints start slightly bent so the ik has a direction to rotate in
+		m_chain_start.resize(num_links, 0.1f);
+		m_chain_end.resize(num_links, 0.1f);
+		m_chain_current = m_chain_start;
+		m_chain_path.clear();
+		m_animation_playing = false;
+
+		auto line_shader = get_app().get_store().get_shader("line");
+		if (line_shader) {
+			m_chain_arm_start = m_build_robot_arm(line_shader, num_links);
+			m_chain_arm_end = m_build_robot_arm(line_shader, num_links);
+			m_chain_arm_curr = m_build_robot_arm(line_shader, num_links);
+
+			m_chain_arm_start->set_color({ 0.85f, 0.3f, 0.3f, 1.0f });
+			m_chain_arm_end->set_color({ 0.3f, 0.3f, 0.85f, 1.0f });
+		}
+
+		m_reset_sampler();
+		m_solve_start_ik();
+		m_solve_end_ik();
+	}
+
+	void ik_scene::m_reset_sampler() {
+		m_sampler.reset(std::vector<float>(m_chain_links, m_chain_link_len), m_obstacles);
+	}
+
+	void ik_scene::m_replan_path() {
+		if (!m_is_start_ok || !m_is_end_ok) {
+			m_show_path_error = true;
+			return;
+		}
+
+		if (m_chain_mode) {
+			m_show_path_error = !m_sampler.find_path(m_chain_start, m_chain_end, m_sampling, m_chain_path);
+			return;
+		}
+
+		if (m_planner.planner == planner_t::hierarchical) {
+			if (!m_pyramid.valid || m_pyramid.levels != m_pyramid_levels) {
+				m_build_pyramid();
+			}
+
+			m_show_path_error = !m_pyramid.find_path(m_start_config, m_end_config, m_path);
+
+			if (!m_show_path_error) {
+				m_conf.show_path(m_path);
+			}
+
+			return;
+		}
+
+		m_show_path_error = !m_conf.find_path(m_start_config, m_end_config, m_planner, m_path);
+	}
+
 	void ik_scene::m_solve_start_ik() {
-		m_is_start_ok = m_solve_arm_ik(m_start_config, m_start_point.x, m_start_point.y, m_alt_solution_start);
+		if (m_chain_mode) {
+			m_is_start_ok = m_solve_chain_ik(m_chain_start, m_start_point.x, m_start_point.y);
+		} else {
+			m_is_start_ok = m_solve_arm_ik(m_start_config, m_start_point.x, m_start_point.y, m_alt_solution_start);
+		}
+
 		m_check_collisions();
 	}
 
 	void ik_scene::m_solve_end_ik() {
-		m_is_end_ok = m_solve_arm_ik(m_end_config, m_end_point.x, m_end_point.y, m_alt_solution_end);
+		if (m_chain_mode) {
+			m_is_end_ok = m_solve_chain_ik(m_chain_end, m_end_point.x, m_end_point.y);
+		} else {
+			m_is_end_ok = m_solve_arm_ik(m_end_config, m_end_point.x, m_end_point.y, m_alt_solution_end);
+		}
+
 		m_check_collisions();
 	}
+
+	bool ik_scene::m_solve_chain_ik(chain_configuration_t& config, float x, float y) const {
+		const auto& chain = m_sampler.chain;
+		const int n = chain.dimension();
+
+		if (n == 0 || static_cast<int>(config.size()) != n) {
+			return false;
+		}
+
+		// points entered by the user have y flipped with respect to the arm, see m_length_changed
+		const glm::vec2 target = { x, -y };
+		std::vector<glm::vec2> points;
+
+		// cyclic coordinate descent, starting from the previous solution so the arm keeps
+		// its shape while the point is dragged around
+		for (int iteration = 0; iteration < 64; ++iteration) {
+			chain.forward(config.data(), points);
+
+			if (glm::distance(points[n], target) < 1e-3f) {
+				return true;
+			}
+
+			for (int i = n - 1; i >= 0; --i) {
+				chain.forward(config.data(), points);
+
+				const glm::vec2 to_tip = points[n] - points[i];
+				const glm::vec2 to_target = target - points[i];
+
+				if (glm::dot(to_tip, to_tip) < 1e-8f || glm::dot(to_target, to_target) < 1e-8f) {
+					continue;
+				}
+
+				const float cross = to_tip.x * to_target.y - to_tip.y * to_target.x;
+				config[i] = wrap_angle(config[i] + atan2f(cross, glm::dot(to_tip, to_target)));
+			}
+		}
+
+		chain.forward(config.data(), points);
+		return glm::distance(points[n], target) < 1e-2f;
+	}
 }
\ No newline at end of file
@@ -1,7 +1,14 @@
 #include "gui.hpp"
 #include "scenes/puma.hpp"
+#include "lanes.hpp"
 
 #include <glm/gtx/vector_angle.hpp>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include <limits>
 
 namespace mini {
 	constexpr auto AXIS_X = glm::vec3{ 1.0f, 0.0f, 0.0f };
@@ -10,6 +17,19 @@ namespace mini {
 	constexpr auto PI = glm::pi<float>();
 	constexpr auto HPI = 0.5f * PI;
 
+	constexpr glm::mat4x4 EFFECTOR_TO_WORLD = {
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+
+	// same range as the q3 slider
+	constexpr float MAX_EXTENSION = 10.0f;
+	constexpr float WORKSPACE_TOLERANCE = 1e-3f;
+	constexpr float COLINEAR_RADIUS = 0.25f;
+	constexpr std::uint32_t WORKSPACE_MAGIC = 0x31535750;
+
 	inline float deg_to_rad(float deg) {
 		constexpr auto pi = glm::pi<float>();
 		return (deg / 180.0f) * pi;
@@ -20,6 +40,10 @@ namespace mini {
 		return (rad / pi) * 180.0f;
 	}
 
+	resource_manifest_t puma_scene::get_manifest() {
+		return { { "grid_xz", "puma", "point", "line", "point_cloud" } };
+	}
+
 	puma_scene::puma_scene(application_base& app) : 
 		scene_base(app), 
 		m_context1(app.get_context()),
@@ -39,7 +63,30 @@ namespace mini {
 		m_anim_time(0.0f),
 		m_anim_speed(0.5f),
 		m_anim_active(false),
-		m_anim_paused(false) {
+		m_anim_paused(false),
+		m_trajectory_dirty(true),
+		m_bake_samples(1024),
+		m_baked_playback(true),
+		m_ik_solver_id(0),
+		m_dh_chain_id(0),
+		m_analytic_time(0.0f),
+		m_numeric_time(0.0f),
+		m_numeric_result{ 0, 0.0f, false },
+		m_multi_robot(false),
+		m_num_robots(1024),
+		m_robot_spacing(6.0f),
+		m_batch_time(0.0f),
+		m_reference_time(0.0f),
+		m_reference_error(0.0f),
+		m_workspace_progress(0),
+		m_workspace_cancel(false),
+		m_workspace_total(0),
+		m_workspace_metric(workspace_metric_t::reachability),
+		m_workspace_metric_id(0),
+		m_workspace_resolution(20),
+		m_workspace_orientations(24),
+		m_workspace_extent(8.0f),
+		m_show_workspace(false) {
 
 		m_context1.set_clear_color({ 0.75f, 0.75f, 0.9f });
 		m_context2.set_clear_color({ 0.75f, 0.75f, 0.9f });
@@ -48,6 +95,7 @@ namespace mini {
 		auto puma_shader = get_app().get_store().get_shader("puma");
 		auto point_shader = get_app().get_store().get_shader("point");
 		auto line_shader = get_app().get_store().get_shader("line");
+		auto cloud_shader = get_app().get_store().get_shader("point_cloud");
 
 		if (grid_shader) {
 			m_grid = std::make_shared<grid_object>(grid_shader);
@@ -64,6 +112,10 @@ namespace mini {
 			m_point_object->set_size({ 16.0f, 16.0f });
 		}
 
+		if (cloud_shader) {
+			m_workspace_cloud = std::make_shared<point_cloud>(cloud_shader);
+		}
+
 		if (puma_shader) {
 			m_effector_mesh = m_make_effector_mesh();
 			m_arm_mesh = triangle_mesh::make_cylinder(0.3f, 1.0f, 50, 20);
@@ -92,11 +144,21 @@ namespace mini {
 		m_solve_ik(m_config1, m_meta1, m_puma_start, ik_mode_t::default_solution);
 		m_solve_ik(m_config2, m_meta2, m_puma_start, ik_mode_t::default_solution);
 
+		m_configure_chain();
+
 		auto camera = std::make_unique<default_camera>();
 		camera->video_mode_change(get_app().get_context().get_video_mode());
 		get_app().get_context().set_camera(std::move(camera));
 	}
 
+	puma_scene::~puma_scene() {
+		m_workspace_cancel = true;
+
+		if (m_workspace_task.valid()) {
+			m_workspace_task.wait();
+		}
+	}
+
 	void puma_scene::layout(ImGuiID dockspace_id) {
 		auto dock_id_bottom = ImGui::DockBuilderSplitNode(dockspace_id, ImGuiDir_Down, 0.4f, nullptr, &dockspace_id);
 		auto dock_id_top_left = ImGui::DockBuilderSplitNode(dockspace_id, ImGuiDir_Left, 0.5f, nullptr, &dockspace_id);
@@ -124,6 +186,8 @@ namespace mini {
 		m_viewport1.update(delta_time);
 		m_viewport2.update(delta_time);
 
+		m_poll_workspace_analysis();
+
 		m_viewport1.set_distance(m_distance);
 		m_viewport2.set_distance(m_distance);
 
@@ -172,13 +236,75 @@ namespace mini {
 				m_current_target.position = glm::mix(m_puma_start.position, m_puma_end.position, m_anim_time);
 				m_current_target.rotation = glm::slerp(m_puma_start.rotation, m_puma_end.rotation, m_anim_time);
 
-				// use closest distance mode to avoid snapping
-				m_solve_ik(m_config2, m_meta2, m_current_target, ik_mode_t::closest_distance);
+				if (m_ik_solver_id == 1) {
+					m_solve_numeric(m_current_target);
+				} else if (m_baked_playback) {
+					m_poll_trajectory_bake();
+
+					// the baked path does not depend on frame timing, so any time can be shown,
+					// before the first bake is in the effector is solved directly
+					if (m_trajectory.valid) {
+						m_trajectory.sample(m_anim_time, m_config2, m_meta2);
+					} else {
+						m_solve_ik(m_config2, m_meta2, m_current_target, ik_mode_t::closest_distance);
+					}
+				} else {
+					// use closest distance mode to avoid snapping
+					m_solve_ik(m_config2, m_meta2, m_current_target, ik_mode_t::closest_distance);
+				}
 			}
 		} else {
 			m_anim_active = false;
 			m_config2 = m_config1;
 		}
+
+		if (m_multi_robot) {
+			m_update_batch();
+		}
+	}
+
+	inline float wrap_angle(float angle) {
+		return angle - 2.0f * PI * floorf((angle + PI) / (2.0f * PI));
+	}
+
+	void puma_scene::puma_trajectory_t::sample(float t, puma_config_t& config, puma_solution_meta_t& meta) const {
+		if (num_samples < 2) {
+			return;
+		}
+
+		const float u = glm::clamp(t, 0.0f, 1.0f) * static_cast<float>(num_samples - 1);
+		const int i = glm::min(static_cast<int>(u), num_samples - 2);
+		const float s = u - static_cast<float>(i);
+
+		const int i0 = glm::max(i - 1, 0);
+		const int i3 = glm::min(i + 2, num_samples - 1);
+
+		float q[6];
+		for (int k = 0; k < 6; ++k) {
+			const float p0 = joints[6 * i0 + k];
+			const float p1 = joints[6 * i + k];
+			const float p2 = joints[6 * (i + 1) + k];
+			const float p3 = joints[6 * i3 + k];
+
+			// catmull-rom with uniform knots
+			q[k] = p1 + 0.5f * s * ((p2 - p0) + s * ((2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) + 
+				s * (3.0f * (p1 - p2) + p3 - p0)));
+		}
+
+		config.q1 = wrap_angle(q[0]);
+		config.q2 = wrap_angle(q[1]);
+		config.q3 = q[2];
+		config.q4 = wrap_angle(q[3]);
+		config.q5 = wrap_angle(q[4]);
+		config.q6 = wrap_angle(q[5]);
+
+		const auto& a = metas[i];
+		const auto& b = metas[i + 1];
+
+		meta.p1 = glm::mix(a.p1, b.p1, s);
+		meta.p2 = glm::mix(a.p2, b.p2, s);
+		meta.p3 = glm::mix(a.p3, b.p3, s);
+		meta.p4 = glm::mix(a.p4, b.p4, s);
 	}
 
 	inline glm::mat4x4 rotation_mat(const glm::vec3& axis, float angle) {
@@ -387,6 +513,1198 @@ namespace mini {
 		meta.p4 = p4;
 	}
 
+	puma_scene::puma_trajectory_t puma_scene::m_bake_trajectory(thread_pool& workers, bake_request_t request) const {
+		const int n = glm::max(request.num_samples, 2);
+		std::vector<puma_config_t> configs(n);
+		std::vector<puma_solution_meta_t> metas(n);
+
+		const auto target_at = [&](int index) -> puma_target_t {
+			const float t = static_cast<float>(index) / static_cast<float>(n - 1);
+			return puma_target_t(
+				glm::mix(request.start.position, request.end.position, t), 
+				glm::slerp(request.start.rotation, request.end.rotation, t));
+		};
+
+		const int num_chunks = glm::clamp(static_cast<int>(workers.get_num_threads()), 1, n / 16 + 1);
+		const int chunk_size = (n + num_chunks - 1) / num_chunks;
+
+		// closest distance mode picks the solution nearest to the previous one, so every
+		// chunk needs a seed on the right branch, these are found by a sequential pass over
+		// the first sample of each chunk
+		std::vector<puma_config_t> seed_configs(num_chunks);
+		std::vector<puma_solution_meta_t> seed_metas(num_chunks);
+
+		puma_config_t config = request.config;
+		puma_solution_meta_t meta = request.meta;
+
+		for (int c = 0; c < num_chunks; ++c) {
+			m_solve_ik(config, meta, target_at(glm::min(c * chunk_size, n - 1)), ik_mode_t::closest_distance);
+			seed_configs[c] = config;
+			seed_metas[c] = meta;
+		}
+
+		const auto solve_chunk = [&](int c, puma_config_t config, puma_solution_meta_t meta) {
+			const int end = glm::min((c + 1) * chunk_size, n);
+			for (int i = c * chunk_size; i < end; ++i) {
+				m_solve_ik(config, meta, target_at(i), ik_mode_t::closest_distance);
+				configs[i] = config;
+				metas[i] = meta;
+			}
+		};
+
+		workers.parallel_for(0, num_chunks, 1, [&](std::size_t first, std::size_t last) {
+			for (int c = static_cast<int>(first); c < static_cast<int>(last); ++c) {
+				solve_chunk(c, seed_configs[c], seed_metas[c]);
+			}
+		});
+
+		// a seed can land on the other branch when the coarse pass skips over a flip, in
+		// that case the chunk is solved again continuing from the end of the previous one
+		for (int c = 1; c < num_chunks && c * chunk_size < n; ++c) {
+			const int first = c * chunk_size;
+
+			config = configs[first - 1];
+			meta = metas[first - 1];
+			m_solve_ik(config, meta, target_at(first), ik_mode_t::closest_distance);
+
+			if (glm::distance2(meta.p2, metas[first].p2) > 1e-6f) {
+				solve_chunk(c, configs[first - 1], metas[first - 1]);
+			}
+		}
+
+		puma_trajectory_t trajectory;
+		trajectory.joints.resize(6 * n);
+		trajectory.metas = std::move(metas);
+		trajectory.num_samples = n;
+
+		float previous[6] = { 0.0f };
+		for (int i = 0; i < n; ++i) {
+			const auto& c = configs[i];
+			const float q[6] = { c.q1, c.q2, c.q3, c.q4, c.q5, c.q6 };
+
+			for (int k = 0; k < 6; ++k) {
+				float value = q[k];
+
+				// q3 is a length, every other joint is unwrapped against the previous sample
+				if (k != 2 && i > 0) {
+					value = previous[k] + wrap_angle(value - previous[k]);
+				}
+
+				trajectory.joints[6 * i + k] = previous[k] = value;
+			}
+		}
+
+		trajectory.valid = true;
+		return trajectory;
+	}
+
+	void puma_scene::m_poll_trajectory_bake() {
+		if (m_bake_task.valid()) {
+			if (m_bake_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				return;
+			}
+
+			m_trajectory = m_bake_task.get();
+		}
+
+		if (!m_trajectory_dirty) {
+			return;
+		}
+
+		m_trajectory_dirty = false;
+
+		bake_request_t request;
+		request.start = m_puma_start;
+		request.end = m_puma_end;
+		request.config = m_start_config;
+		request.meta = m_start_meta;
+		request.num_samples = m_bake_samples;
+
+		// chunks go to the pool, so the job that waits on them runs on its own thread
+		m_bake_task = std::async(std::launch::async, &puma_scene::m_bake_trajectory, this, std::ref(m_workers), request);
+	}
+
+	glm::mat4x4 puma_scene::m_forward_kinematics(const puma_config_t& config) const {
+		// the same chain as m_draw_puma without the joint and scale matrices
+		auto transform = rotation_mat(AXIS_X, HPI) * rotation_mat(AXIS_Z, -config.q1);
+		transform = transform * translation_mat({ 0.0f, 0.0f, config.l1 }) * rotation_mat(AXIS_Y, -HPI + config.q2);
+		transform = transform * translation_mat({ 0.0f, 0.0f, config.q3 }) * rotation_mat(AXIS_Y, -HPI - config.q4) * 
+			rotation_mat(AXIS_Z, config.q5);
+		transform = transform * translation_mat({ 0.0f, 0.0f, config.l2 }) * rotation_mat(AXIS_Y, HPI);
+
+		return transform * translation_mat({ 0.0f, 0.0f, config.l3 }) * rotation_mat(AXIS_Z, -config.q6) * EFFECTOR_TO_WORLD;
+	}
+
+	// the frame is 9 rotation lanes (column major) and 3 translation lanes, elementary
+	// transforms are multiplied from the right and only touch the columns they change
+	inline void frame_rotate_y(lane4_t* r, const lane4_t& c, const lane4_t& s) {
+		for (int k = 0; k < 3; ++k) {
+			const auto x = r[k];
+			const auto z = r[6 + k];
+			r[k] = c * x - s * z;
+			r[6 + k] = s * x + c * z;
+		}
+	}
+
+	inline void frame_rotate_z(lane4_t* r, const lane4_t& c, const lane4_t& s) {
+		for (int k = 0; k < 3; ++k) {
+			const auto x = r[k];
+			const auto y = r[3 + k];
+			r[k] = c * x + s * y;
+			r[3 + k] = c * y - s * x;
+		}
+	}
+
+	inline void frame_translate_z(const lane4_t* r, lane4_t* t, const lane4_t& d) {
+		for (int k = 0; k < 3; ++k) {
+			t[k] = t[k] + d * r[6 + k];
+		}
+	}
+
+	void puma_scene::puma_batch_t::resize(int count) {
+		const int padded = ((count + LANES - 1) / LANES) * LANES;
+		this->count = count;
+
+		for (auto& joint : joints) {
+			joint.assign(padded, 0.0f);
+		}
+
+		for (auto& point : points) {
+			point.assign(padded, 0.0f);
+		}
+
+		for (auto& column : rotation) {
+			column.assign(padded, 0.0f);
+		}
+	}
+
+	void puma_scene::puma_batch_t::evaluate() {
+		const int padded = static_cast<int>(joints[0].size());
+
+		const auto zero = lane4_t::set(0.0f);
+		const auto hpi = lane4_t::set(HPI);
+		const auto len1 = lane4_t::set(l1);
+		const auto len2 = lane4_t::set(l2);
+		const auto len3 = lane4_t::set(l3);
+
+		// same chain as m_forward_kinematics
+		for (int i = 0; i < padded; i += LANES) {
+			lane4_t s1, c1, s2, c2, s4, c4, s5, c5, s6, c6;
+			lane_sincos(zero - lane4_t::load(&joints[0][i]), s1, c1);
+			lane_sincos(lane4_t::load(&joints[1][i]) - hpi, s2, c2);
+			lane_sincos(zero - hpi - lane4_t::load(&joints[3][i]), s4, c4);
+			lane_sincos(lane4_t::load(&joints[4][i]), s5, c5);
+			lane_sincos(zero - lane4_t::load(&joints[5][i]), s6, c6);
+
+			const auto q3 = lane4_t::load(&joints[2][i]);
+
+			// rx(pi/2) * rz(-q1) written out
+			lane4_t r[9] = { 
+				c1, zero, s1, 
+				zero - s1, zero, c1, 
+				zero, lane4_t::set(-1.0f), zero 
+			};
+
+			lane4_t t[3] = { zero, zero, zero };
+
+			frame_translate_z(r, t, len1);
+			t[0].store(&points[0][i]);
+			t[1].store(&points[1][i]);
+			t[2].store(&points[2][i]);
+
+			frame_rotate_y(r, c2, s2);
+			frame_translate_z(r, t, q3);
+			t[0].store(&points[3][i]);
+			t[1].store(&points[4][i]);
+			t[2].store(&points[5][i]);
+
+			frame_rotate_y(r, c4, s4);
+			frame_rotate_z(r, c5, s5);
+			frame_translate_z(r, t, len2);
+			t[0].store(&points[6][i]);
+			t[1].store(&points[7][i]);
+			t[2].store(&points[8][i]);
+
+			// ry(pi/2) replaces x with -z and z with x
+			for (int k = 0; k < 3; ++k) {
+				const auto x = r[k];
+				r[k] = zero - r[6 + k];
+				r[6 + k] = x;
+			}
+
+			frame_translate_z(r, t, len3);
+			t[0].store(&points[9][i]);
+			t[1].store(&points[10][i]);
+			t[2].store(&points[11][i]);
+
+			frame_rotate_z(r, c6, s6);
+
+			// effector to world swaps the x and z columns
+			for (int k = 0; k < 3; ++k) {
+				r[6 + k].store(&rotation[k][i]);
+				r[3 + k].store(&rotation[3 + k][i]);
+				r[k].store(&rotation[6 + k][i]);
+			}
+		}
+	}
+
+	// inverse of a transform made only of rotations and translations
+	inline glm::mat4x4 rigid_inverse(const glm::mat4x4& transform) {
+		const auto rotation = glm::transpose(glm::mat3x3(transform));
+		const auto translation = -(rotation * glm::vec3(transform[3]));
+
+		glm::mat4x4 result(rotation);
+		result[3] = glm::vec4(translation, 1.0f);
+
+		return result;
+	}
+
+	// solves a x = b for a symmetric positive definite 6x6 matrix, only the lower
+	// triangle of a is read and it is overwritten by the factor
+	inline void cholesky_solve(double a[6][6], const double b[6], double x[6]) {
+		for (int c = 0; c < 6; ++c) {
+			double diag = a[c][c];
+			for (int k = 0; k < c; ++k) {
+				diag -= a[c][k] * a[c][k];
+			}
+
+			a[c][c] = std::sqrt(glm::max(diag, 1e-12));
+
+			for (int r = c + 1; r < 6; ++r) {
+				double sum = a[r][c];
+				for (int k = 0; k < c; ++k) {
+					sum -= a[r][k] * a[c][k];
+				}
+
+				a[r][c] = sum / a[c][c];
+			}
+		}
+
+		for (int r = 0; r < 6; ++r) {
+			double sum = b[r];
+			for (int k = 0; k < r; ++k) {
+				sum -= a[r][k] * x[k];
+			}
+
+			x[r] = sum / a[r][r];
+		}
+
+		for (int r = 5; r >= 0; --r) {
+			double sum = x[r];
+			for (int k = r + 1; k < 6; ++k) {
+				sum -= a[k][r] * x[k];
+			}
+
+			x[r] = sum / a[r][r];
+		}
+	}
+
+	int puma_scene::dh_chain_t::dimension() const {
+		return static_cast<int>(joints.size());
+	}
+
+	void puma_scene::dh_chain_t::frames(const float* q, std::vector<glm::mat4x4>& frames) const {
+		const int n = dimension();
+		frames.resize(n + 1);
+		frames[0] = base;
+
+		for (int i = 0; i < n; ++i) {
+			const auto& joint = joints[i];
+			const float theta = joint.prismatic ? joint.theta : joint.theta + q[i];
+			const float d = joint.prismatic ? joint.d + q[i] : joint.d;
+
+			const float ct = cosf(theta), st = sinf(theta);
+			const float ca = cosf(joint.alpha), sa = sinf(joint.alpha);
+
+			// rz(theta) * tz(d) * tx(a) * rx(alpha)
+			const glm::mat4x4 link = {
+				ct, st, 0.0f, 0.0f,
+				-st * ca, ct * ca, sa, 0.0f,
+				st * sa, -ct * sa, ca, 0.0f,
+				joint.a * ct, joint.a * st, d, 1.0f
+			};
+
+			frames[i + 1] = frames[i] * link;
+		}
+	}
+
+	glm::mat4x4 puma_scene::dh_chain_t::forward(const float* q) const {
+		std::vector<glm::mat4x4> result;
+		frames(q, result);
+
+		return result.back() * tool;
+	}
+
+	puma_scene::dls_result_t puma_scene::dh_chain_t::solve(const glm::mat4x4& target, float* q, 
+		const dls_settings_t& settings) const {
+
+		const int n = dimension();
+		const float w = settings.orientation_weight;
+
+		std::vector<glm::mat4x4> frame;
+		std::vector<double> jacobian(6 * n), delta(n);
+		std::vector<char> locked(n);
+
+		dls_result_t result = { 0, 0.0f, false };
+
+		for (result.iterations = 0; ; ++result.iterations) {
+			frames(q, frame);
+			const auto effector = frame[n] * tool;
+			const auto position = glm::vec3(effector[3]);
+
+			// orientation error is the rotation vector that aligns the axes for small angles
+			const auto ep = glm::vec3(target[3]) - position;
+			const auto eo = 0.5f * w * (
+				glm::cross(glm::vec3(effector[0]), glm::vec3(target[0])) +
+				glm::cross(glm::vec3(effector[1]), glm::vec3(target[1])) +
+				glm::cross(glm::vec3(effector[2]), glm::vec3(target[2])));
+
+			const double error[6] = { ep.x, ep.y, ep.z, eo.x, eo.y, eo.z };
+			result.error = sqrtf(glm::length2(ep) + glm::length2(eo));
+
+			if (result.error < settings.tolerance) {
+				result.converged = true;
+				break;
+			}
+
+			if (result.iterations >= settings.max_iterations) {
+				break;
+			}
+
+			// joint i moves about or along the z axis of the frame before it
+			for (int i = 0; i < n; ++i) {
+				const auto axis = glm::vec3(frame[i][2]);
+				glm::vec3 linear = axis, angular = { 0.0f, 0.0f, 0.0f };
+
+				if (!joints[i].prismatic) {
+					linear = glm::cross(axis, position - glm::vec3(frame[i][3]));
+					angular = w * axis;
+				}
+
+				double* column = &jacobian[6 * i];
+				column[0] = linear.x;
+				column[1] = linear.y;
+				column[2] = linear.z;
+				column[3] = angular.x;
+				column[4] = angular.y;
+				column[5] = angular.z;
+			}
+
+			// damping fades out near the target so the last steps are not slowed down
+			const double lambda = settings.damping * glm::min(result.error, 1.0f);
+			const double lambda2 = lambda * lambda;
+
+			// dq = J^T (J J^T + lambda^2 I)^-1 e, joints that would be pushed past a limit
+			// are taken out of J and the rest solve again, so they can still make progress
+			std::fill(locked.begin(), locked.end(), 0);
+
+			float largest = 0.0f;
+			for (bool relocked = true; relocked; ) {
+				double a[6][6], y[6];
+				for (int r = 0; r < 6; ++r) {
+					for (int c = 0; c <= r; ++c) {
+						double sum = (r == c) ? lambda2 : 0.0;
+						for (int i = 0; i < n; ++i) {
+							if (!locked[i]) {
+								sum += jacobian[6 * i + r] * jacobian[6 * i + c];
+							}
+						}
+
+						a[r][c] = sum;
+					}
+				}
+
+				cholesky_solve(a, error, y);
+
+				relocked = false;
+				largest = 0.0f;
+
+				for (int i = 0; i < n; ++i) {
+					double dq = 0.0;
+					if (!locked[i]) {
+						for (int r = 0; r < 6; ++r) {
+							dq += jacobian[6 * i + r] * y[r];
+						}
+					}
+
+					if ((q[i] <= joints[i].lower && dq < 0.0) || (q[i] >= joints[i].upper && dq > 0.0)) {
+						locked[i] = 1;
+						relocked = true;
+						dq = 0.0;
+					}
+
+					delta[i] = dq;
+					largest = glm::max(largest, static_cast<float>(std::abs(dq)));
+				}
+			}
+
+			// long steps are shortened as a whole so the direction is kept
+			const float step = (largest > settings.max_step) ? settings.max_step / largest : 1.0f;
+
+			for (int i = 0; i < n; ++i) {
+				const float value = q[i] + step * static_cast<float>(delta[i]);
+				q[i] = glm::clamp(value, joints[i].lower, joints[i].upper);
+			}
+		}
+
+		return result;
+	}
+
+	void puma_scene::dh_chain_t::solve_batch(thread_pool& workers, const std::vector<glm::mat4x4>& targets, const float* seed, 
+		std::vector<float>& solutions, std::vector<dls_result_t>& results, const dls_settings_t& settings) const {
+
+		const int n = dimension();
+		const int count = static_cast<int>(targets.size());
+
+		solutions.resize(count * n);
+		results.resize(count);
+
+		if (count == 0) {
+			return;
+		}
+
+		const int num_chunks = glm::clamp(static_cast<int>(workers.get_num_threads()), 1, count);
+		const int chunk_size = (count + num_chunks - 1) / num_chunks;
+
+		const auto solve_chunk = [&](int c) {
+			std::vector<float> q(seed, seed + n);
+			const int end = glm::min((c + 1) * chunk_size, count);
+
+			for (int i = c * chunk_size; i < end; ++i) {
+				results[i] = solve(targets[i], q.data(), settings);
+				std::copy(q.begin(), q.end(), solutions.begin() + i * n);
+			}
+		};
+
+		workers.parallel_for(0, num_chunks, 1, [&](std::size_t first, std::size_t last) {
+			for (int c = static_cast<int>(first); c < static_cast<int>(last); ++c) {
+				solve_chunk(c);
+			}
+		});
+	}
+
+	void puma_scene::m_configure_chain() {
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		const auto& config = m_start_config;
+
+		m_dh_chain = dh_chain_t();
+
+		if (m_dh_chain_id == 0) {
+			// the puma of m_forward_kinematics with its y and negative z rotations turned into
+			// dh z rotations, the joint values are the same as q1 to q6
+			m_dh_chain.base = rotation_mat(AXIS_X, -HPI);
+			m_dh_chain.joints = {
+				{ 0.0f, -config.l1, 0.0f, HPI, false, -inf, inf },
+				{ -HPI, 0.0f, 0.0f, HPI, false, -inf, inf },
+				{ 0.0f, 0.0f, 0.0f, HPI, true, 0.0f, MAX_EXTENSION },
+				{ HPI, 0.0f, 0.0f, -HPI, false, -inf, inf },
+				{ HPI, config.l2, 0.0f, -HPI, false, -inf, inf },
+				{ 0.0f, -config.l3, 0.0f, 0.0f, false, -inf, inf }
+			};
+
+			// whatever rotation is left at the effector is fixed, so it is read off the zero pose
+			puma_config_t zero = config;
+			zero.q1 = zero.q2 = zero.q3 = zero.q4 = zero.q5 = zero.q6 = 0.0f;
+
+			const float q[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+			m_dh_chain.tool = rigid_inverse(m_dh_chain.forward(q)) * m_forward_kinematics(zero);
+		} else {
+			// redundant arm with alternating roll and pitch joints, standing on the same base
+			constexpr float roll = 2.96f;
+			constexpr float pitch = 2.09f;
+
+			// same up direction as CONVERT_MTX, but a proper rotation so joint axes keep their sense
+			m_dh_chain.base = rotation_mat(AXIS_X, HPI);
+			m_dh_chain.joints = {
+				{ 0.0f, config.l1, 0.0f, -HPI, false, -roll, roll },
+				{ 0.0f, 0.0f, 0.0f, HPI, false, -pitch, pitch },
+				{ 0.0f, config.l2, 0.0f, HPI, false, -roll, roll },
+				{ 0.0f, 0.0f, 0.0f, -HPI, false, -pitch, pitch },
+				{ 0.0f, config.l2, 0.0f, -HPI, false, -roll, roll },
+				{ 0.0f, 0.0f, 0.0f, HPI, false, -pitch, pitch },
+				{ 0.0f, config.l3, 0.0f, 0.0f, false, -roll, roll }
+			};
+
+			// the effector x axis points along the last z axis
+			m_dh_chain.tool = {
+				0.0f, 0.0f, 1.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				-1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f
+			};
+		}
+
+		auto line_shader = get_app().get_store().get_shader("line");
+		const int n = m_dh_chain.dimension();
+
+		m_dh_lines = nullptr;
+
+		if (line_shader) {
+			m_dh_lines = std::make_shared<segments_array>(line_shader, n + 2);
+			m_dh_lines->set_color({ 0.0f, 0.4f, 0.9f, 1.0f });
+			m_dh_lines->set_line_width(4.0f);
+
+			for (int i = 0; i <= n; ++i) {
+				m_dh_lines->add_segment(i, i + 1);
+			}
+		}
+
+		m_solver_stats = solver_stats_t();
+		m_reset_numeric();
+	}
+
+	void puma_scene::m_reset_numeric() {
+		const int n = m_dh_chain.dimension();
+
+		if (m_dh_chain_id == 0) {
+			m_dh_joints = { 
+				m_start_config.q1, m_start_config.q2, m_start_config.q3, 
+				m_start_config.q4, m_start_config.q5, m_start_config.q6 
+			};
+		} else {
+			// bent away from the straight pose, which is singular
+			m_dh_joints.assign(n, 0.0f);
+			for (int i = 1; i < n; i += 2) {
+				m_dh_joints[i] = 0.5f;
+			}
+
+			dls_settings_t settings = m_dls;
+			settings.max_iterations = glm::max(settings.max_iterations, 500);
+			m_dh_chain.solve(m_puma_start.build_matrix(), m_dh_joints.data(), settings);
+		}
+
+		m_numeric_result = { 0, 0.0f, false };
+	}
+
+	void puma_scene::m_solve_numeric(const puma_target_t& target) {
+		const auto goal = target.build_matrix();
+
+		// the previous frame's solution is the warm start
+		auto start = std::chrono::steady_clock::now();
+		m_numeric_result = m_dh_chain.solve(goal, m_dh_joints.data(), m_dls);
+		m_numeric_time = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		m_dh_chain.frames(m_dh_joints.data(), m_dh_frames);
+
+		const auto point = [&](int i) -> glm::vec3 {
+			return glm::vec3(m_dh_frames[i][3]);
+		};
+
+		if (m_dh_chain_id == 0) {
+			m_config2.q1 = wrap_angle(m_dh_joints[0]);
+			m_config2.q2 = wrap_angle(m_dh_joints[1]);
+			m_config2.q3 = m_dh_joints[2];
+			m_config2.q4 = wrap_angle(m_dh_joints[3]);
+			m_config2.q5 = wrap_angle(m_dh_joints[4]);
+			m_config2.q6 = wrap_angle(m_dh_joints[5]);
+
+			// debug points are kept in the solver frame
+			const auto to_solver = glm::transpose(glm::mat3x3(CONVERT_MTX));
+			m_meta2.p1 = to_solver * point(1);
+			m_meta2.p2 = to_solver * point(3);
+			m_meta2.p3 = to_solver * point(5);
+			m_meta2.p4 = to_solver * point(6);
+
+			// the same target through the closed form solver, for comparison
+			puma_config_t config = m_config2;
+			puma_solution_meta_t meta = m_meta2;
+
+			start = std::chrono::steady_clock::now();
+			m_solve_ik(config, meta, target, ik_mode_t::closest_distance);
+			m_analytic_time = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+		} else if (m_dh_lines) {
+			const int n = m_dh_chain.dimension();
+
+			for (int i = 0; i <= n; ++i) {
+				m_dh_lines->update_point(i, point(i));
+			}
+
+			m_effector2 = glm::vec3((m_dh_frames[n] * m_dh_chain.tool)[3]);
+			m_dh_lines->update_point(n + 1, m_effector2);
+			m_dh_lines->rebuild_buffers();
+		}
+	}
+
+	void puma_scene::m_compare_solvers() {
+		const int n = glm::max(m_bake_samples, 2);
+		std::vector<puma_target_t> targets(n);
+		std::vector<glm::mat4x4> goals(n);
+
+		for (int i = 0; i < n; ++i) {
+			const float t = static_cast<float>(i) / static_cast<float>(n - 1);
+			targets[i] = puma_target_t(
+				glm::mix(m_puma_start.position, m_puma_end.position, t), 
+				glm::slerp(m_puma_start.rotation, m_puma_end.rotation, t));
+			goals[i] = targets[i].build_matrix();
+		}
+
+		auto& stats = m_solver_stats;
+		stats = solver_stats_t();
+		stats.samples = n;
+
+		// the closed form path only exists for the puma, solved in order like the bake
+		if (m_dh_chain_id == 0) {
+			puma_config_t config = m_start_config;
+			puma_solution_meta_t meta = m_start_meta;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (const auto& target : targets) {
+				m_solve_ik(config, meta, target, ik_mode_t::closest_distance);
+			}
+
+			stats.analytic_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		m_reset_numeric();
+
+		std::vector<float> solutions;
+		std::vector<dls_result_t> results;
+
+		const auto start = std::chrono::steady_clock::now();
+		m_dh_chain.solve_batch(m_workers, goals, m_dh_joints.data(), solutions, results, m_dls);
+		stats.numeric_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		for (const auto& result : results) {
+			stats.mean_iterations += static_cast<float>(result.iterations);
+			stats.max_iterations = glm::max(stats.max_iterations, result.iterations);
+			stats.max_error = glm::max(stats.max_error, result.error);
+			stats.failures += result.converged ? 0 : 1;
+		}
+
+		stats.mean_iterations /= static_cast<float>(n);
+	}
+
+	void puma_scene::m_configure_batch() {
+		m_batch.l1 = m_start_config.l1;
+		m_batch.l2 = m_start_config.l2;
+		m_batch.l3 = m_start_config.l3;
+		m_batch.resize(m_num_robots);
+
+		m_reference_time = 0.0f;
+
+		auto line_shader = get_app().get_store().get_shader("line");
+		if (!line_shader) {
+			m_batch_lines = nullptr;
+			return;
+		}
+
+		// base, joints, effector and the tip of the effector x axis
+		m_batch_lines = std::make_shared<segments_array>(line_shader, 6 * m_num_robots);
+		m_batch_lines->set_color({ 0.1f, 0.5f, 0.2f, 1.0f });
+		m_batch_lines->set_line_width(1.5f);
+
+		for (int i = 0; i < m_num_robots; ++i) {
+			for (int k = 0; k < 5; ++k) {
+				m_batch_lines->add_segment(6 * i + k, 6 * i + k + 1);
+			}
+		}
+	}
+
+	void puma_scene::m_update_batch() {
+		const int n = m_batch.count;
+		auto& joints = m_batch.joints;
+
+		// every arm plays the angle interpolation with its own phase
+		for (int i = 0; i < n; ++i) {
+			const float t = fmodf(m_anim_time + 0.618034f * static_cast<float>(i), 1.0f);
+
+			joints[0][i] = angle_lerp(m_start_config.q1, m_end_config.q1, t);
+			joints[1][i] = angle_lerp(m_start_config.q2, m_end_config.q2, t);
+			joints[2][i] = glm::mix(m_start_config.q3, m_end_config.q3, t);
+			joints[3][i] = angle_lerp(m_start_config.q4, m_end_config.q4, t);
+			joints[4][i] = angle_lerp(m_start_config.q5, m_end_config.q5, t);
+			joints[5][i] = angle_lerp(m_start_config.q6, m_end_config.q6, t);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		m_batch.evaluate();
+		m_batch_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (!m_batch_lines) {
+			return;
+		}
+
+		const auto& points = m_batch.points;
+		const auto& rotation = m_batch.rotation;
+
+		const int side = static_cast<int>(ceilf(sqrtf(static_cast<float>(n))));
+		const float half = 0.5f * static_cast<float>(side - 1);
+
+		for (int i = 0; i < n; ++i) {
+			const glm::vec3 base = {
+				(static_cast<float>(i % side) - half) * m_robot_spacing,
+				0.0f,
+				(static_cast<float>(i / side) - half) * m_robot_spacing
+			};
+
+			m_batch_lines->update_point(6 * i, base);
+
+			for (int k = 0; k < 4; ++k) {
+				m_batch_lines->update_point(6 * i + k + 1, base + glm::vec3{ points[3 * k][i], points[3 * k + 1][i], points[3 * k + 2][i] });
+			}
+
+			const glm::vec3 effector = { points[9][i], points[10][i], points[11][i] };
+			const glm::vec3 forward = { rotation[0][i], rotation[1][i], rotation[2][i] };
+			m_batch_lines->update_point(6 * i + 5, base + effector + 0.75f * forward);
+		}
+
+		m_batch_lines->rebuild_buffers();
+	}
+
+	void puma_scene::m_benchmark_batch() {
+		const int n = m_batch.count;
+		const auto& joints = m_batch.joints;
+		std::vector<glm::mat4x4> reference(n);
+
+		auto start = std::chrono::steady_clock::now();
+		m_batch.evaluate();
+		m_batch_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// the same arms through the full matrix chain
+		puma_config_t config = m_start_config;
+		start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < n; ++i) {
+			config.q1 = joints[0][i];
+			config.q2 = joints[1][i];
+			config.q3 = joints[2][i];
+			config.q4 = joints[3][i];
+			config.q5 = joints[4][i];
+			config.q6 = joints[5][i];
+
+			reference[i] = m_forward_kinematics(config);
+		}
+
+		m_reference_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_reference_error = 0.0f;
+
+		for (int i = 0; i < n; ++i) {
+			for (int k = 0; k < 3; ++k) {
+				m_reference_error = glm::max(m_reference_error, glm::abs(reference[i][3][k] - m_batch.points[9 + k][i]));
+
+				for (int c = 0; c < 3; ++c) {
+					m_reference_error = glm::max(m_reference_error, glm::abs(reference[i][c][k] - m_batch.rotation[3 * c + k][i]));
+				}
+			}
+		}
+	}
+
+	// cyclic jacobi rotations, the matrix is destroyed and its eigenvalues are left on the diagonal
+	inline void symmetric_eigenvalues(double a[6][6]) {
+		for (int sweep = 0; sweep < 32; ++sweep) {
+			double off = 0.0;
+			for (int p = 0; p < 6; ++p) {
+				for (int q = p + 1; q < 6; ++q) {
+					off += a[p][q] * a[p][q];
+				}
+			}
+
+			if (off < 1e-24) {
+				return;
+			}
+
+			for (int p = 0; p < 6; ++p) {
+				for (int q = p + 1; q < 6; ++q) {
+					if (std::abs(a[p][q]) < 1e-30) {
+						continue;
+					}
+
+					const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+					const double c = 1.0 / std::sqrt(t * t + 1.0);
+					const double s = t * c;
+
+					for (int k = 0; k < 6; ++k) {
+						const double akp = a[k][p];
+						const double akq = a[k][q];
+						a[k][p] = c * akp - s * akq;
+						a[k][q] = s * akp + c * akq;
+					}
+
+					for (int k = 0; k < 6; ++k) {
+						const double apk = a[p][k];
+						const double aqk = a[q][k];
+						a[p][k] = c * apk - s * aqk;
+						a[q][k] = s * apk + c * aqk;
+					}
+				}
+			}
+		}
+	}
+
+	float puma_scene::m_inverse_condition(const puma_config_t& config) const {
+		constexpr float h = 1e-3f;
+		constexpr float puma_config_t::* joints[] = {
+			&puma_config_t::q1, &puma_config_t::q2, &puma_config_t::q3,
+			&puma_config_t::q4, &puma_config_t::q5, &puma_config_t::q6
+		};
+
+		// positions are divided by the arm length so both halves of the jacobian are unitless
+		const float scale = 1.0f / (config.l1 + config.l2 + config.l3);
+		const auto rotation = glm::transpose(glm::mat3x3(m_forward_kinematics(config)));
+
+		double jacobian[6][6];
+		for (int k = 0; k < 6; ++k) {
+			auto plus = config;
+			auto minus = config;
+			plus.*joints[k] += h;
+			minus.*joints[k] -= h;
+
+			const auto a = m_forward_kinematics(plus);
+			const auto b = m_forward_kinematics(minus);
+
+			const auto dp = (glm::vec3(a[3]) - glm::vec3(b[3])) * (scale / (2.0f * h));
+
+			// angular velocity from the skew symmetric part of dR * R^T
+			const auto w = (glm::mat3x3(a) - glm::mat3x3(b)) * rotation;
+			const auto dr = glm::vec3(w[1][2] - w[2][1], w[2][0] - w[0][2], w[0][1] - w[1][0]) * (0.25f / h);
+
+			jacobian[k][0] = dp.x;
+			jacobian[k][1] = dp.y;
+			jacobian[k][2] = dp.z;
+			jacobian[k][3] = dr.x;
+			jacobian[k][4] = dr.y;
+			jacobian[k][5] = dr.z;
+		}
+
+		// singular values of J are the square roots of the eigenvalues of J^T J
+		double normal[6][6];
+		for (int i = 0; i < 6; ++i) {
+			for (int j = 0; j < 6; ++j) {
+				double sum = 0.0;
+				for (int r = 0; r < 6; ++r) {
+					sum += jacobian[i][r] * jacobian[j][r];
+				}
+
+				normal[i][j] = sum;
+			}
+		}
+
+		symmetric_eigenvalues(normal);
+
+		double lo = normal[0][0];
+		double hi = normal[0][0];
+		for (int i = 1; i < 6; ++i) {
+			lo = glm::min(lo, normal[i][i]);
+			hi = glm::max(hi, normal[i][i]);
+		}
+
+		if (!(hi > 0.0)) {
+			return 0.0f;
+		}
+
+		return static_cast<float>(std::sqrt(glm::max(lo, 0.0) / hi));
+	}
+
+	puma_scene::workspace_voxel_t puma_scene::m_analyze_voxel(const puma_config_t& base, const glm::vec3& position, 
+		const std::vector<glm::quat>& orientations) const {
+
+		workspace_voxel_t voxel = { 0.0f, 0.0f, 0.0f, 0.0f };
+		int num_reached = 0;
+		int num_branches = 0;
+		int num_colinear = 0;
+
+		for (const auto& rotation : orientations) {
+			const puma_target_t target(position, rotation);
+			const auto goal = target.build_matrix();
+
+			const auto is_valid = [&](const puma_config_t& config) -> bool {
+				if (!(config.q3 >= 0.0f && config.q3 <= MAX_EXTENSION)) {
+					return false;
+				}
+
+				// the solver never reports failure, so the result is checked against the target
+				const auto reached = m_forward_kinematics(config);
+				for (int i = 0; i < 4; ++i) {
+					for (int j = 0; j < 4; ++j) {
+						if (!(glm::abs(reached[i][j] - goal[i][j]) < WORKSPACE_TOLERANCE)) {
+							return false;
+						}
+					}
+				}
+
+				return true;
+			};
+
+			puma_config_t config1 = base, config2 = base;
+			puma_solution_meta_t meta1, meta2;
+
+			m_solve_ik(config1, meta1, target, ik_mode_t::default_solution);
+			m_solve_ik(config2, meta2, target, ik_mode_t::alter_solution);
+
+			// the exact colinear case is never hit on a grid, so the wrist centre is tested
+			// against a band around the base axis where the arm plane is poorly defined
+			const bool colinear = glm::length2(glm::vec2(meta1.p3)) < COLINEAR_RADIUS * COLINEAR_RADIUS;
+
+			const bool valid1 = is_valid(config1);
+			const bool valid2 = is_valid(config2) && (!valid1 || glm::distance2(meta1.p2, meta2.p2) > 1e-6f);
+
+			num_colinear += colinear;
+			num_branches += valid1 + valid2;
+
+			if (valid1 || valid2) {
+				voxel.conditioning += m_inverse_condition(valid1 ? config1 : config2);
+				num_reached++;
+			}
+		}
+
+		const float count = static_cast<float>(orientations.size());
+
+		voxel.reachability = static_cast<float>(num_reached) / count;
+		voxel.branches = static_cast<float>(num_branches) / count;
+		voxel.colinear = static_cast<float>(num_colinear) / count;
+
+		if (num_reached > 0) {
+			voxel.conditioning /= static_cast<float>(num_reached);
+		}
+
+		return voxel;
+	}
+
+	puma_scene::workspace_map_t puma_scene::m_analyze_workspace(workspace_map_t map) {
+		const int res = map.resolution;
+		map.voxels.assign(res * res * res, { 0.0f, 0.0f, 0.0f, 0.0f });
+
+		puma_config_t base;
+		base.l1 = map.l1;
+		base.l2 = map.l2;
+		base.l3 = map.l3;
+
+		// effector x axes on a fibonacci lattice over the sphere, each with a different roll
+		std::vector<glm::quat> orientations(map.orientations);
+		const float golden = PI * (3.0f - sqrtf(5.0f));
+
+		for (int i = 0; i < map.orientations; ++i) {
+			const float z = 1.0f - 2.0f * (static_cast<float>(i) + 0.5f) / static_cast<float>(map.orientations);
+			const float r = sqrtf(glm::max(1.0f - z * z, 0.0f));
+			const float phi = golden * static_cast<float>(i);
+			const glm::vec3 dir = { r * cosf(phi), r * sinf(phi), z };
+
+			glm::quat align = { 1.0f, 0.0f, 0.0f, 0.0f };
+			const auto axis = glm::cross(AXIS_X, dir);
+
+			if (glm::length2(axis) > 1e-8f) {
+				align = glm::angleAxis(acosf(glm::clamp(dir.x, -1.0f, 1.0f)), glm::normalize(axis));
+			} else if (dir.x < 0.0f) {
+				align = glm::angleAxis(PI, AXIS_Z);
+			}
+
+			const float roll = 2.0f * PI * fmodf(0.7548777f * static_cast<float>(i), 1.0f);
+			orientations[i] = glm::angleAxis(roll, dir) * align;
+		}
+
+		// tasks take whole z slices
+		m_workspace_workers.parallel_for(0, res, 1, [&](std::size_t first, std::size_t last) {
+			for (int z = static_cast<int>(first); z < static_cast<int>(last) && !m_workspace_cancel; ++z) {
+				for (int y = 0; y < res; ++y) {
+					for (int x = 0; x < res; ++x) {
+						map.voxels[x + res * (y + res * z)] = m_analyze_voxel(base, map.voxel_center(x, y, z), orientations);
+					}
+				}
+
+				m_workspace_progress += res * res;
+			}
+		});
+
+		if (m_workspace_cancel) {
+			map.voxels.clear();
+		}
+
+		return map;
+	}
+
+	void puma_scene::m_start_workspace_analysis() {
+		if (m_workspace_task.valid()) {
+			return;
+		}
+
+		workspace_map_t map;
+		map.l1 = m_start_config.l1;
+		map.l2 = m_start_config.l2;
+		map.l3 = m_start_config.l3;
+		map.extent = m_workspace_extent;
+		map.resolution = m_workspace_resolution;
+		map.orientations = m_workspace_orientations;
+
+		if (!m_workspace.voxels.empty() && m_workspace.same_settings(map)) {
+			return;
+		}
+
+		if (map.load()) {
+			m_workspace = std::move(map);
+			m_rebuild_workspace_cloud();
+			return;
+		}
+
+		m_workspace_progress = 0;
+		m_workspace_cancel = false;
+		m_workspace_total = map.resolution * map.resolution * map.resolution;
+		m_workspace_task = std::async(std::launch::async, &puma_scene::m_analyze_workspace, this, std::move(map));
+	}
+
+	void puma_scene::m_poll_workspace_analysis() {
+		if (!m_workspace_task.valid()) {
+			return;
+		}
+
+		if (m_workspace_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return;
+		}
+
+		auto map = m_workspace_task.get();
+
+		// an empty map means the analysis was cancelled
+		if (!map.voxels.empty()) {
+			map.save();
+			m_workspace = std::move(map);
+			m_rebuild_workspace_cloud();
+		}
+	}
+
+	void puma_scene::m_rebuild_workspace_cloud() {
+		if (!m_workspace_cloud) {
+			return;
+		}
+
+		m_workspace_cloud->clear();
+
+		const int res = m_workspace.resolution;
+
+		// conditioning depends on the length scale, so it is shown relative to the best voxel
+		float best_conditioning = 0.0f;
+		for (const auto& voxel : m_workspace.voxels) {
+			best_conditioning = glm::max(best_conditioning, voxel.conditioning);
+		}
+
+		for (int z = 0; z < res; ++z) {
+			for (int y = 0; y < res; ++y) {
+				for (int x = 0; x < res; ++x) {
+					const auto& voxel = m_workspace.voxels[x + res * (y + res * z)];
+
+					if (voxel.reachability <= 0.0f) {
+						continue;
+					}
+
+					float value = 0.0f;
+					switch (m_workspace_metric) {
+						case workspace_metric_t::reachability:
+							value = voxel.reachability;
+							break;
+
+						case workspace_metric_t::branches:
+							value = 0.5f * voxel.branches;
+							break;
+
+						case workspace_metric_t::conditioning:
+							value = voxel.conditioning / glm::max(best_conditioning, 1e-6f);
+							break;
+
+						case workspace_metric_t::colinear:
+							value = 1.0f - voxel.colinear;
+							break;
+					}
+
+					// red marks poor values, through yellow to green for good ones
+					constexpr glm::vec4 low = { 0.9f, 0.1f, 0.1f, 1.0f };
+					constexpr glm::vec4 mid = { 0.9f, 0.9f, 0.1f, 1.0f };
+					constexpr glm::vec4 high = { 0.1f, 0.8f, 0.2f, 1.0f };
+
+					value = glm::clamp(value, 0.0f, 1.0f);
+					const auto color = (value < 0.5f) ? 
+						glm::mix(low, mid, 2.0f * value) : 
+						glm::mix(mid, high, 2.0f * value - 1.0f);
+
+					m_workspace_cloud->add_point(m_workspace.voxel_center(x, y, z), color);
+				}
+			}
+		}
+
+		m_workspace_cloud->rebuild_buffers();
+	}
+
+	glm::vec3 puma_scene::workspace_map_t::voxel_center(int x, int y, int z) const {
+		const float step = 2.0f * extent / static_cast<float>(resolution);
+		return {
+			-extent + (static_cast<float>(x) + 0.5f) * step,
+			-extent + (static_cast<float>(y) + 0.5f) * step,
+			-extent + (static_cast<float>(z) + 0.5f) * step
+		};
+	}
+
+	bool puma_scene::workspace_map_t::same_settings(const workspace_map_t& other) const {
+		return l1 == other.l1 && l2 == other.l2 && l3 == other.l3 && extent == other.extent && 
+			resolution == other.resolution && orientations == other.orientations;
+	}
+
+	std::string puma_scene::workspace_map_t::cache_path() const {
+		return std::format("cache/puma_workspace_{:.3f}_{:.3f}_{:.3f}.bin", l1, l2, l3);
+	}
+
+	template<typename T> inline void write_value(std::ostream& stream, const T& value) {
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T> inline void read_value(std::istream& stream, T& value) {
+		stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	bool puma_scene::workspace_map_t::load() {
+		std::ifstream stream(cache_path(), std::ios::binary);
+
+		if (!stream) {
+			return false;
+		}
+
+		std::uint32_t magic = 0;
+		workspace_map_t header;
+
+		read_value(stream, magic);
+		read_value(stream, header.l1);
+		read_value(stream, header.l2);
+		read_value(stream, header.l3);
+		read_value(stream, header.extent);
+		read_value(stream, header.resolution);
+		read_value(stream, header.orientations);
+
+		// the file only stores the last grid computed for these link lengths
+		if (!stream || magic != WORKSPACE_MAGIC || !same_settings(header)) {
+			return false;
+		}
+
+		voxels.resize(resolution * resolution * resolution);
+		stream.read(reinterpret_cast<char*>(voxels.data()), sizeof(workspace_voxel_t) * voxels.size());
+
+		if (!stream) {
+			voxels.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool puma_scene::workspace_map_t::save() const {
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(cache_path()).parent_path(), error);
+
+		std::ofstream stream(cache_path(), std::ios::binary);
+
+		if (!stream) {
+			return false;
+		}
+
+		write_value(stream, WORKSPACE_MAGIC);
+		write_value(stream, l1);
+		write_value(stream, l2);
+		write_value(stream, l3);
+		write_value(stream, extent);
+		write_value(stream, resolution);
+		write_value(stream, orientations);
+
+		stream.write(reinterpret_cast<const char*>(voxels.data()), sizeof(workspace_voxel_t) * voxels.size());
+
+		return static_cast<bool>(stream);
+	}
+
 	void puma_scene::m_draw_puma(app_context& context, const puma_config_t& config, glm::vec3& effector_pos) const {
 		std::array<glm::mat4x4, 4> arm_matrix;
 		std::array<glm::mat4x4, 5> joint_matrix;
@@ -422,13 +1740,6 @@ namespace mini {
 		joint_matrix[3] = joint_matrix[3] * rotation_mat(AXIS_Y, HPI) * translation_mat({ 0.0f, 0.0f, -0.35f });
 		joint_matrix[4] = joint_matrix[4] * translation_mat({ 0.0f, 0.0f, -0.35f });
 
-		constexpr glm::mat4x4 EFFECTOR_TO_WORLD = {
-			0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		};
-
 		effector_matrix = arm_matrix[3] * translation_mat({ 0.0f, 0.0f, config.l3 }) * rotation_mat(AXIS_Z, -config.q6) * EFFECTOR_TO_WORLD;
 		effector_pos = arm_matrix[3] * translation_mat({ 0.0f, 0.0f, config.l3 }) * rotation_mat(AXIS_Z, -config.q6) * EFFECTOR_TO_WORLD * 
 			glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
@@ -500,7 +1811,13 @@ namespace mini {
 
 		if (m_arm_mesh) {
 			m_draw_puma(m_context1, m_config1, m_effector1);
-			m_draw_puma(m_context2, m_config2, m_effector2);
+
+			// arms other than the puma only have a dh description, drawn as lines
+			if (m_ik_solver_id == 1 && m_dh_chain_id != 0 && m_dh_lines) {
+				m_context2.draw(m_dh_lines, glm::mat4x4(1.0f));
+			} else {
+				m_draw_puma(m_context2, m_config2, m_effector2);
+			}
 
 			m_draw_frame(m_context1, m_puma_start.build_matrix());
 			m_draw_frame(m_context1, m_puma_end.build_matrix());
@@ -509,6 +1826,16 @@ namespace mini {
 			m_draw_frame(m_context2, m_puma_end.build_matrix());
 		}
 
+		if (m_multi_robot && m_batch_lines) {
+			m_context1.draw(m_batch_lines, glm::mat4x4(1.0f));
+			m_context2.draw(m_batch_lines, glm::mat4x4(1.0f));
+		}
+
+		if (m_show_workspace && m_workspace_cloud) {
+			m_context1.draw(m_workspace_cloud, CONVERT_MTX);
+			m_context2.draw(m_workspace_cloud, CONVERT_MTX);
+		}
+
 		if (m_debug_points) {
 			if (!m_anim_active) {
 				m_draw_debug_mesh(m_context1, m_debug_lines1, m_meta1);
@@ -742,6 +2069,7 @@ namespace mini {
 		if (m_end_changed || m_begin_changed) {
 			m_anim_time = 0.0f;
 			m_anim_active = false;
+			m_trajectory_dirty = true;
 		}
 
 		if (m_begin_changed || m_end_changed) {
@@ -764,6 +2092,10 @@ namespace mini {
 			m_meta1 = m_meta2 = m_start_meta;
 		}
 
+		if (m_begin_changed || m_end_changed) {
+			m_reset_numeric();
+		}
+
 		if (m_end_changed) {
 			m_config1 = m_config2 = m_end_config;
 			m_meta1 = m_meta2 = m_end_meta;
@@ -812,11 +2144,23 @@ namespace mini {
 				gui::prefix_label("Anim. Speed: ", 100.0f);
 				ImGui::SliderFloat("##puma_anim_speed", &m_anim_speed, 0.1f, 5.0f);
 
+				gui::prefix_label("Baked Path: ", 100.0f);
+				ImGui::Checkbox("##puma_baked", &m_baked_playback);
+
+				if (m_baked_playback) {
+					gui::prefix_label("Bake Samples: ", 100.0f);
+					if (ImGui::InputInt("##puma_bake_samples", &m_bake_samples)) {
+						gui::clamp(m_bake_samples, 16, 65536);
+						m_trajectory_dirty = true;
+					}
+				}
+
 				gui::prefix_label("Anim. Time: ", 100.0f);
 				if (ImGui::SliderFloat("##puma_anim_time", &m_anim_time, 0.0f, 1.0f)) {
 					if (!m_anim_active) {
 						m_config1 = m_config2 = m_start_config;
 						m_meta1 = m_meta2 = m_start_meta;
+						m_reset_numeric();
 					}
 
 					m_anim_active = true;
@@ -827,6 +2171,7 @@ namespace mini {
 					if (!m_anim_active) {
 						m_config1 = m_config2 = m_start_config;
 						m_meta1 = m_meta2 = m_start_meta;
+						m_reset_numeric();
 					}
 
 					m_anim_active = true;
@@ -836,6 +2181,7 @@ namespace mini {
 						m_anim_time = 0.0f;
 						m_config1 = m_config2 = m_start_config;
 						m_meta1 = m_meta2 = m_start_meta;
+						m_reset_numeric();
 					}
 				}
 
@@ -852,7 +2198,138 @@ namespace mini {
 					m_anim_time = 0.0f;
 					m_config1 = m_config2 = m_start_config;
 					m_meta1 = m_meta2 = m_start_meta;
+					m_reset_numeric();
+				}
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Numerical IK")) {
+			constexpr const char* solvers[] = { "Analytic", "Damped LS" };
+			gui::prefix_label("Solver: ", 100.0f);
+
+			if (ImGui::Combo("##puma_ik_solver", &m_ik_solver_id, solvers, 2)) {
+				m_reset_numeric();
+			}
+
+			constexpr const char* chains[] = { "PUMA", "7-DOF Arm" };
+			gui::prefix_label("Chain: ", 100.0f);
+
+			if (ImGui::Combo("##puma_dh_chain", &m_dh_chain_id, chains, 2)) {
+				m_configure_chain();
+			}
+
+			gui::prefix_label("Max Iter.: ", 100.0f);
+			if (ImGui::InputInt("##puma_dls_iterations", &m_dls.max_iterations)) {
+				gui::clamp(m_dls.max_iterations, 1, 1000);
+			}
+
+			gui::prefix_label("Damping: ", 100.0f);
+			ImGui::SliderFloat("##puma_dls_damping", &m_dls.damping, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+
+			gui::prefix_label("Max Step: ", 100.0f);
+			ImGui::SliderFloat("##puma_dls_step", &m_dls.max_step, 0.01f, 2.0f);
+
+			gui::prefix_label("Orient. Weight: ", 100.0f);
+			ImGui::SliderFloat("##puma_dls_weight", &m_dls.orientation_weight, 0.0f, 10.0f);
+
+			if (m_ik_solver_id == 1) {
+				ImGui::Text("Damped LS: %.1f us, %d iter., err. %.1e", 
+					m_numeric_time, m_numeric_result.iterations, m_numeric_result.error);
+
+				if (m_dh_chain_id == 0) {
+					ImGui::Text("Analytic: %.1f us", m_analytic_time);
+				}
+			}
+
+			if (ImGui::Button("Compare", ImVec2(width * 0.1f, 25.0f))) {
+				m_compare_solvers();
+			}
+
+			if (m_solver_stats.samples > 0) {
+				const auto& stats = m_solver_stats;
+				ImGui::Text("%d targets along the path", stats.samples);
+
+				if (stats.analytic_time > 0.0f) {
+					ImGui::Text("Analytic: %.3f ms", stats.analytic_time);
+				}
+
+				ImGui::Text("Damped LS batch: %.3f ms", stats.numeric_time);
+				ImGui::Text("Iterations: %.1f mean, %d max", stats.mean_iterations, stats.max_iterations);
+				ImGui::Text("Max Error: %.1e, %d failed", stats.max_error, stats.failures);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Multi Robot")) {
+			gui::prefix_label("Enabled: ", 100.0f);
+			if (ImGui::Checkbox("##puma_multi", &m_multi_robot) && m_multi_robot) {
+				m_configure_batch();
+			}
+
+			gui::prefix_label("Robots: ", 100.0f);
+			if (ImGui::InputInt("##puma_num_robots", &m_num_robots)) {
+				gui::clamp(m_num_robots, 1, 20000);
+				m_configure_batch();
+			}
+
+			gui::prefix_label("Spacing: ", 100.0f);
+			ImGui::SliderFloat("##puma_robot_spacing", &m_robot_spacing, 2.0f, 20.0f);
+
+			if (m_multi_robot) {
+				ImGui::Text("Batched FK: %.3f ms", m_batch_time);
+
+				if (ImGui::Button("Benchmark", ImVec2(width * 0.1f, 25.0f))) {
+					m_benchmark_batch();
 				}
+
+				if (m_reference_time > 0.0f) {
+					ImGui::Text("Matrix FK: %.3f ms", m_reference_time);
+					ImGui::Text("Max Error: %.2e", m_reference_error);
+				}
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Workspace")) {
+			gui::prefix_label("Show Map: ", 100.0f);
+			ImGui::Checkbox("##puma_ws_show", &m_show_workspace);
+
+			constexpr const char* metrics[] = { "Reachability", "Branches", "Conditioning", "Colinear" };
+			gui::prefix_label("Color By: ", 100.0f);
+
+			if (ImGui::Combo("##puma_ws_metric", &m_workspace_metric_id, metrics, 4)) {
+				m_workspace_metric = static_cast<workspace_metric_t>(m_workspace_metric_id);
+				m_rebuild_workspace_cloud();
+			}
+
+			gui::prefix_label("Resolution: ", 100.0f);
+			if (ImGui::InputInt("##puma_ws_resolution", &m_workspace_resolution)) {
+				gui::clamp(m_workspace_resolution, 4, 64);
+			}
+
+			gui::prefix_label("Orientations: ", 100.0f);
+			if (ImGui::InputInt("##puma_ws_orientations", &m_workspace_orientations)) {
+				gui::clamp(m_workspace_orientations, 1, 256);
+			}
+
+			gui::prefix_label("Extent: ", 100.0f);
+			ImGui::SliderFloat("##puma_ws_extent", &m_workspace_extent, 1.0f, 20.0f);
+
+			if (m_workspace_task.valid()) {
+				const float progress = static_cast<float>(m_workspace_progress) / static_cast<float>(glm::max(m_workspace_total, 1));
+				ImGui::ProgressBar(progress, ImVec2(width * 0.2f, 0.0f));
+				ImGui::SameLine();
+
+				if (ImGui::Button("Cancel", ImVec2(width * 0.1f, 0.0f))) {
+					m_workspace_cancel = true;
+				}
+			} else if (ImGui::Button("Analyze", ImVec2(width * 0.1f, 25.0f))) {
+				m_start_workspace_analysis();
+				m_show_workspace = true;
+			}
+
+			if (m_workspace_cloud && !m_workspace.voxels.empty()) {
+				ImGui::Text("Reachable: %d of %d voxels", 
+					static_cast<int>(m_workspace_cloud->get_num_points()), 
+					static_cast<int>(m_workspace.voxels.size()));
 			}
 		}
 
@@ -876,7 +2353,8 @@ namespace mini {
 			m_distance = m_distance - (static_cast<float> (offset_y) / 2.0f);
 		}
 
-		m_distance = glm::clamp(m_distance, 1.0f, 30.0f);
+		// a grid of robots needs more room than a single arm
+		m_distance = glm::clamp(m_distance, 1.0f, m_multi_robot ? 300.0f : 30.0f);
 	}
 
 	std::shared_ptr<triangle_mesh> puma_scene::m_make_effector_mesh() {
@@ -231,6 +231,10 @@ namespace mini {
 		return transform;
 	}
 
+	resource_manifest_t slerp_scene::get_manifest() {
+		return { { "grid_xz", "gizmo" } };
+	}
+
 	slerp_scene::slerp_scene(application_base& app) : 
 		scene_base(app),
 		m_context1(app.get_context()),
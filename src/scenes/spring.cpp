@@ -2,6 +2,7 @@
 #include <fstream>
 #include <ios>
 #include <chrono>
+#include <thread>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/constants.hpp>
@@ -14,6 +15,41 @@
 namespace mini {
 	constexpr float FLOAT_MIN = std::numeric_limits<float>::min();
 
+	// x'' = c(w - x)/m - k x'/m + h/m is y' = A y + (0, (c w + h)/m) for y = (x, x'), the
+	// exponential of a 2x2 matrix has a closed form through the eigenvalues of A
+	static glm::mat2x2 oscillator_exponential(double mass, double spring, double friction, double t) {
+		const double tau = -friction / mass;
+		const double delta = spring / mass;
+		const double disc = 0.25 * tau * tau - delta;
+
+		// e^(At) = e^(tau t/2) (a I + b (A - tau/2 I))
+		double a, b;
+
+		if (disc > 1e-12) {
+			const double mu = std::sqrt(disc);
+			a = std::cosh(mu * t);
+			b = std::sinh(mu * t) / mu;
+		} else if (disc < -1e-12) {
+			const double omega = std::sqrt(-disc);
+			a = std::cos(omega * t);
+			b = std::sin(omega * t) / omega;
+		} else {
+			a = 1.0;
+			b = t;
+		}
+
+		const double e = std::exp(0.5 * tau * t);
+
+		// columns of A - tau/2 I are (-tau/2, -delta) and (1, tau/2)
+		return glm::mat2x2(
+			static_cast<float>(e * (a - 0.5 * tau * b)), static_cast<float>(e * (-delta * b)),
+			static_cast<float>(e * b), static_cast<float>(e * (a + 0.5 * tau * b)));
+	}
+
+	resource_manifest_t spring_scene::get_manifest() {
+		return { { "line", "grid_xy" } };
+	}
+
 	spring_scene::spring_scene(application_base& app) : scene_base(app),
 		m_time(0.0f),
 		m_k0(0.7f),
@@ -27,8 +63,14 @@ namespace mini {
 		m_last_vp_width(0),
 		m_last_vp_height(0),
 		m_paused(false),
+		m_integrator_id(0),
+		m_step_exp(1.0f),
 		m_w_expression("0"),
-		m_h_expression("sin(t)+cos(t)") {
+		m_h_expression("sin(t)+cos(t)"),
+		m_spectrum_enabled(true),
+		m_spectrum_window(4096),
+		m_spectrum_series_id(0),
+		m_sweep_settings{ 1.0f, 10.0f, 0.7f, 0.05f, 2.0f, 1.0f, 200, 16 } {
 
 		// initialize functions
 		m_fw = mk_const(0.0f);
@@ -117,6 +159,7 @@ namespace mini {
 		ImGui::DockBuilderDockWindow("Trajectory", dock_id_right);
 		ImGui::DockBuilderDockWindow("Simulation Graph", dock_id_bottom);
 		ImGui::DockBuilderDockWindow("Velocity Graph", dock_id_bottom);
+		ImGui::DockBuilderDockWindow("Frequency Response", dock_id_bottom);
 	}
 
 	inline std::tm localtime_xp(std::time_t timer) {
@@ -225,10 +268,14 @@ namespace mini {
 		m_dx = m_dx0;
 		m_ddx = (c * (w - m_x) - k * m_dx + h) * mi;
 
+		m_prepare_exact_step();
+		m_reset_spectra();
 		m_push_data_point(m_time, c * (w - m_x0), -k * m_dx0, h, m_x, m_dx, m_ddx);
 	}
 
 	void spring_scene::integrate(float delta_time) {
+		m_poll_sweep();
+
 		if (m_paused) {
 			return;
 		}
@@ -242,30 +289,38 @@ namespace mini {
 		m_step_timer += delta_time;
 		
 		while (m_step_timer > m_step) {
-			const float step = m_step;
-			const float mi = m_mass_inv;
 			const float c = m_spring_coefficient;
 			const float k = m_friction_coefficient;
 
 			float w = m_fw->value(t0);
 			float h = m_fh->value(t0);
 
-			//const float dw = m_fw->derivative(t0);
-			//const float dh = m_fh->derivative(t0);
-
 			float x0 = m_x;
 			float dx0 = m_dx;
-			float ddx0 = m_ddx;
 
-			// euler method
-			const float x1 = x0 + step * dx0;
-			const float dx1 = dx0 + step * ddx0;
-			const float ddx1 = (c * (w - x1) - k * dx1 + h) * mi;
+			switch (m_integrator_id) {
+				case 1:
+					m_step_verlet(t0, w, h);
+					break;
 
-			// set new values
-			m_ddx = ddx1;
-			m_dx = dx1;
-			m_x = x1;
+				case 2:
+					m_step_rk4(t0);
+					break;
+
+				case 3:
+					m_step_exact(t0);
+					break;
+
+				default:
+					m_step_euler(t0, w, h);
+					break;
+			}
+
+			if (m_spectrum_enabled) {
+				m_spectra[0].push(m_x);
+				m_spectra[1].push(m_dx);
+				m_spectra[2].push(m_ddx);
+			}
 
 			t0 = t0 + m_step;
 			m_step_timer -= m_step;
@@ -280,6 +335,235 @@ namespace mini {
 		m_time += delta_time;
 	}
 
+	void spring_scene::m_prepare_exact_step() {
+		const auto exponential = [this](double t) -> glm::mat2x2 {
+			return oscillator_exponential(m_mass, m_spring_coefficient, m_friction_coefficient, t);
+		};
+
+		m_step_exp = exponential(m_step);
+
+		// three point gauss-legendre on panels short enough to follow the forcing
+		constexpr double nodes[] = { -0.774596669241483, 0.0, 0.774596669241483 };
+		constexpr double weights[] = { 5.0 / 9.0, 8.0 / 9.0, 5.0 / 9.0 };
+
+		const int panels = glm::max(static_cast<int>(std::ceil(m_step / MAX_PANEL_WIDTH)), 1);
+		const double width = static_cast<double>(m_step) / panels;
+
+		m_forcing_nodes.clear();
+		m_forcing_kernel.clear();
+
+		for (int p = 0; p < panels; ++p) {
+			for (int j = 0; j < 3; ++j) {
+				const double s = width * (p + 0.5 + 0.5 * nodes[j]);
+				const auto response = exponential(m_step - s)[1];
+
+				m_forcing_nodes.push_back(static_cast<float>(s));
+				m_forcing_kernel.push_back(static_cast<float>(0.5 * width * weights[j] * m_mass_inv) * response);
+			}
+		}
+	}
+
+	void spring_scene::m_step_euler(float t0, float w, float h) {
+		const float step = m_step;
+		const float mi = m_mass_inv;
+		const float c = m_spring_coefficient;
+		const float k = m_friction_coefficient;
+
+		const float x1 = m_x + step * m_dx;
+		const float dx1 = m_dx + step * m_ddx;
+
+		m_ddx = (c * (w - x1) - k * dx1 + h) * mi;
+		m_dx = dx1;
+		m_x = x1;
+	}
+
+	void spring_scene::m_step_verlet(float t0, float w, float h) {
+		const float step = m_step;
+		const float mi = m_mass_inv;
+		const float c = m_spring_coefficient;
+		const float k = m_friction_coefficient;
+
+		const float w1 = m_fw->value(t0 + step);
+		const float h1 = m_fh->value(t0 + step);
+
+		const float dx_half = m_dx + 0.5f * step * m_ddx;
+		const float x1 = m_x + step * dx_half;
+
+		// the second half kick depends on the new velocity through damping, it is linear so
+		// it is solved directly instead of lagging the velocity
+		const float dx1 = (dx_half + 0.5f * step * (c * (w1 - x1) + h1) * mi) / (1.0f + 0.5f * step * k * mi);
+
+		m_x = x1;
+		m_dx = dx1;
+		m_ddx = (c * (w1 - x1) - k * dx1 + h1) * mi;
+	}
+
+	void spring_scene::m_step_rk4(float t0) {
+		const float step = m_step;
+		const float mi = m_mass_inv;
+		const float c = m_spring_coefficient;
+		const float k = m_friction_coefficient;
+
+		const auto f = [&](float t, const glm::vec2& y) -> glm::vec2 {
+			return { y.y, (c * (m_fw->value(t) - y.x) - k * y.y + m_fh->value(t)) * mi };
+		};
+
+		const glm::vec2 y = { m_x, m_dx };
+
+		const auto k1 = f(t0, y);
+		const auto k2 = f(t0 + 0.5f * step, y + 0.5f * step * k1);
+		const auto k3 = f(t0 + 0.5f * step, y + 0.5f * step * k2);
+		const auto k4 = f(t0 + step, y + step * k3);
+
+		const auto y1 = y + step * (k1 + 2.0f * k2 + 2.0f * k3 + k4) / 6.0f;
+
+		m_x = y1.x;
+		m_dx = y1.y;
+		m_ddx = f(t0 + step, y1).y;
+	}
+
+	void spring_scene::m_step_exact(float t0) {
+		const float c = m_spring_coefficient;
+		const float k = m_friction_coefficient;
+
+		// the free motion is exact for any step, only the forcing integral is approximated
+		auto y = m_step_exp * glm::vec2{ m_x, m_dx };
+
+		for (std::size_t i = 0; i < m_forcing_nodes.size(); ++i) {
+			const float t = t0 + m_forcing_nodes[i];
+			y += (c * m_fw->value(t) + m_fh->value(t)) * m_forcing_kernel[i];
+		}
+
+		const float t1 = t0 + m_step;
+
+		m_x = y.x;
+		m_dx = y.y;
+		m_ddx = (c * (m_fw->value(t1) - m_x) - k * m_dx + m_fh->value(t1)) * m_mass_inv;
+	}
+
+	void spring_scene::m_reset_spectra() {
+		const auto window = static_cast<std::size_t>(m_spectrum_window);
+
+		for (auto& stream : m_spectra) {
+			stream.configure(window, window / 2);
+		}
+	}
+
+	void spring_scene::m_start_sweep() {
+		if (m_sweep_task.valid()) {
+			return;
+		}
+
+		// the sweep runs on the coefficients of the current simulation
+		auto settings = m_sweep_settings;
+		settings.mass = m_mass;
+		settings.spring = m_spring_coefficient;
+		settings.friction = m_friction_coefficient;
+
+		m_sweep_task = std::async(std::launch::async, &spring_scene::m_run_sweep, std::ref(m_workers), settings);
+	}
+
+	void spring_scene::m_poll_sweep() {
+		if (!m_sweep_task.valid()) {
+			return;
+		}
+
+		if (m_sweep_task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			m_sweep = m_sweep_task.get();
+		}
+	}
+
+	spring_scene::sweep_result_t spring_scene::m_run_sweep(thread_pool& workers, sweep_settings_t settings) {
+		constexpr int steps_per_period = 64;
+		constexpr int min_settle_periods = 16;
+		constexpr int max_settle_steps = 1 << 20;
+		constexpr double two_pi = 6.283185307179586;
+
+		const int n = settings.num_points;
+		const double m = settings.mass;
+		const double c = settings.spring;
+		const double k = settings.friction;
+
+		sweep_result_t result;
+		result.frequency.resize(n);
+		result.amplitude.resize(n);
+		result.phase.resize(n);
+		result.model_amplitude.resize(n);
+		result.model_phase.resize(n);
+
+		// log spaced so the resonance and both tails get enough points
+		const double ratio = static_cast<double>(settings.max_frequency) / settings.min_frequency;
+
+		const auto solve = [&](int i) {
+			const double frequency = settings.min_frequency * std::pow(ratio, static_cast<double>(i) / (n - 1));
+			const double omega = two_pi * frequency;
+			const double step = 1.0 / (frequency * steps_per_period);
+
+			// exact step with the forcing integrated by gauss-legendre over the step
+			const auto transition = oscillator_exponential(m, c, k, step);
+			const double nodes[] = { 0.5 - 0.5 * 0.774596669241483, 0.5, 0.5 + 0.5 * 0.774596669241483 };
+			const double weights[] = { 5.0 / 18.0, 8.0 / 18.0, 5.0 / 18.0 };
+
+			glm::vec2 kernel[3];
+			for (int j = 0; j < 3; ++j) {
+				kernel[j] = static_cast<float>(weights[j] * step / m) * oscillator_exponential(m, c, k, step * (1.0 - nodes[j]))[1];
+			}
+
+			// the start transient decays as e^(-k t / 2m), it is skipped until it is below 1e-4,
+			// without friction it never decays and only the fixed minimum is skipped
+			const double settle_time = (k > 0.0) ? 2.0 * m / k * std::log(1e4) : 0.0;
+			const int settle_steps = static_cast<int>(std::clamp(std::ceil(settle_time / step / steps_per_period) * steps_per_period, 
+				static_cast<double>(min_settle_periods * steps_per_period), static_cast<double>(max_settle_steps)));
+			const int measure_steps = settings.num_periods * steps_per_period;
+
+			glm::vec2 y = { 0.0f, 0.0f };
+			double in_phase = 0.0, quadrature = 0.0;
+
+			for (int s = 0; s < settle_steps + measure_steps; ++s) {
+				// whole periods are stepped, so the phase only depends on the step index
+				const double t = static_cast<double>(s % steps_per_period) * step;
+
+				y = transition * y;
+				for (int j = 0; j < 3; ++j) {
+					y += static_cast<float>(settings.amplitude * std::sin(omega * (t + nodes[j] * step))) * kernel[j];
+				}
+
+				// x = X sin(w t + phi) correlates to X/2 cos(phi) and X/2 sin(phi)
+				if (s >= settle_steps) {
+					const double t1 = t + step;
+					in_phase += y.x * std::sin(omega * t1);
+					quadrature += y.x * std::cos(omega * t1);
+				}
+			}
+
+			const double scale = 2.0 / measure_steps;
+			const double amplitude = scale * std::hypot(in_phase, quadrature) / settings.amplitude;
+			const double phase = std::atan2(quadrature, in_phase);
+
+			const double real = c - m * omega * omega;
+			const double imaginary = k * omega;
+
+			result.frequency[i] = static_cast<float>(frequency);
+			result.amplitude[i] = static_cast<float>(amplitude);
+			result.phase[i] = static_cast<float>(glm::degrees(phase));
+			result.model_amplitude[i] = static_cast<float>(1.0 / std::hypot(real, imaginary));
+			result.model_phase[i] = static_cast<float>(glm::degrees(-std::atan2(imaginary, real)));
+		};
+
+		// frequencies are interleaved across tasks, the high ones take more steps to settle
+		const int num_tasks = glm::clamp(static_cast<int>(workers.get_num_threads()), 1, n);
+
+		workers.parallel_for(0, num_tasks, 1, [&](std::size_t first, std::size_t last) {
+			for (int w = static_cast<int>(first); w < static_cast<int>(last); ++w) {
+				for (int i = w; i < n; i += num_tasks) {
+					solve(i);
+				}
+			}
+		});
+
+		return result;
+	}
+
 	void spring_scene::render(app_context& context) {
 		// setup scene
 		m_distance = glm::clamp(m_distance, 1.0f, 15.0f);
@@ -324,6 +608,7 @@ namespace mini {
 		m_gui_settings();
 		m_gui_viewport();
 		m_gui_trajectory();
+		m_gui_frequency();
 	}
 
 	void spring_scene::menu() {
@@ -497,6 +782,122 @@ namespace mini {
 		ImGui::PopStyleVar(1);
 	}
 
+	void spring_scene::m_gui_frequency() {
+		ImGui::PushStyleVar(ImGuiStyleVar_WindowMinSize, ImVec2(270, 450));
+		ImGui::Begin("Frequency Response", NULL);
+		ImGui::SetWindowPos(ImVec2(30, 30), ImGuiCond_Once);
+		ImGui::SetWindowSize(ImVec2(270, 450), ImGuiCond_Once);
+
+		auto min = ImGui::GetWindowContentRegionMin();
+		auto max = ImGui::GetWindowContentRegionMax();
+
+		auto width = max.x - min.x;
+		auto height = max.y - min.y;
+
+		ImGui::BeginChild("##spring_frequency_settings", ImVec2(width * 0.25f, height - 15.0f));
+
+		if (ImGui::CollapsingHeader("Spectrum", ImGuiTreeNodeFlags_DefaultOpen)) {
+			gui::prefix_label("Record: ", 100.0f);
+			ImGui::Checkbox("##spring_spectrum_on", &m_spectrum_enabled);
+
+			gui::prefix_label("Window: ", 100.0f);
+			if (ImGui::InputInt("##spring_spectrum_window", &m_spectrum_window, 256, 1024)) {
+				gui::clamp(m_spectrum_window, 16, 65536);
+				m_reset_spectra();
+			}
+
+			constexpr const char* series[] = { "x(t)", "dx(t)", "ddx(t)" };
+			gui::prefix_label("Series: ", 100.0f);
+			ImGui::Combo("##spring_spectrum_series", &m_spectrum_series_id, series, 3);
+
+			ImGui::Text("Windows: %d", static_cast<int>(m_spectra[m_spectrum_series_id].get_num_windows()));
+		}
+
+		if (ImGui::CollapsingHeader("Sweep", ImGuiTreeNodeFlags_DefaultOpen)) {
+			auto& settings = m_sweep_settings;
+
+			gui::prefix_label("Min. Freq.: ", 100.0f);
+			ImGui::InputFloat("##spring_sweep_min", &settings.min_frequency);
+			gui::clamp(settings.min_frequency, 0.001f, 100.0f);
+
+			gui::prefix_label("Max. Freq.: ", 100.0f);
+			ImGui::InputFloat("##spring_sweep_max", &settings.max_frequency);
+			gui::clamp(settings.max_frequency, settings.min_frequency, 100.0f);
+
+			gui::prefix_label("Amplitude: ", 100.0f);
+			ImGui::InputFloat("##spring_sweep_amp", &settings.amplitude);
+
+			gui::prefix_label("Points: ", 100.0f);
+			if (ImGui::InputInt("##spring_sweep_points", &settings.num_points)) {
+				gui::clamp(settings.num_points, 2, 4096);
+			}
+
+			gui::prefix_label("Periods: ", 100.0f);
+			if (ImGui::InputInt("##spring_sweep_periods", &settings.num_periods)) {
+				gui::clamp(settings.num_periods, 1, 1000);
+			}
+
+			const bool running = m_sweep_task.valid();
+			ImGui::BeginDisabled(running);
+
+			if (ImGui::Button(running ? "Sweeping..." : "Run Sweep")) {
+				m_start_sweep();
+			}
+
+			ImGui::EndDisabled();
+		}
+
+		ImGui::EndChild();
+
+		const ImVec2 plot_size = { width * 0.245f, height - 15.0f };
+
+		ImGui::SameLine();
+		if (ImPlot::BeginPlot("Spectrum", plot_size, ImPlotFlags_NoBoxSelect)) {
+			const auto& stream = m_spectra[m_spectrum_series_id];
+			stream.amplitude(m_spectrum_amplitude);
+
+			// bin k of a window of n samples taken every h seconds is at k / (n h) hz
+			const float bin_width = 1.0f / (static_cast<float>(stream.get_window_size()) * m_step);
+
+			m_spectrum_frequency.resize(m_spectrum_amplitude.size());
+			for (std::size_t k = 0; k < m_spectrum_frequency.size(); ++k) {
+				m_spectrum_frequency[k] = bin_width * static_cast<float>(k);
+			}
+
+			ImPlot::SetupAxis(ImAxis_X1, "f [Hz]", ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxis(ImAxis_Y1, "##y", ImPlotAxisFlags_AutoFit);
+
+			ImPlot::PlotLine("amplitude", m_spectrum_frequency.data(), m_spectrum_amplitude.data(), 
+				static_cast<int>(m_spectrum_amplitude.size()));
+			ImPlot::EndPlot();
+		}
+
+		const int num_sweep = static_cast<int>(m_sweep.frequency.size());
+
+		ImGui::SameLine();
+		if (ImPlot::BeginPlot("Amplitude Response", plot_size, ImPlotFlags_NoBoxSelect)) {
+			ImPlot::SetupAxis(ImAxis_X1, "f [Hz]", ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxis(ImAxis_Y1, "##y", ImPlotAxisFlags_AutoFit);
+
+			ImPlot::PlotLine("measured", m_sweep.frequency.data(), m_sweep.amplitude.data(), num_sweep);
+			ImPlot::PlotLine("model", m_sweep.frequency.data(), m_sweep.model_amplitude.data(), num_sweep);
+			ImPlot::EndPlot();
+		}
+
+		ImGui::SameLine();
+		if (ImPlot::BeginPlot("Phase Response", plot_size, ImPlotFlags_NoBoxSelect)) {
+			ImPlot::SetupAxis(ImAxis_X1, "f [Hz]", ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxis(ImAxis_Y1, "deg", ImPlotAxisFlags_AutoFit);
+
+			ImPlot::PlotLine("measured", m_sweep.frequency.data(), m_sweep.phase.data(), num_sweep);
+			ImPlot::PlotLine("model", m_sweep.frequency.data(), m_sweep.model_phase.data(), num_sweep);
+			ImPlot::EndPlot();
+		}
+
+		ImGui::End();
+		ImGui::PopStyleVar(1);
+	}
+
 	void spring_scene::m_gui_settings() {
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowMinSize, ImVec2(270, 450));
 		ImGui::Begin("Simulation Settings", NULL);
@@ -522,7 +923,9 @@ namespace mini {
 
 			gui::prefix_label("h = ");
 			ImGui::InputFloat("##spring_sim_step", &m_h0);
-			gui::clamp(m_h0, 0.0001f, 0.1f);
+
+			// the exact solver stays stable and accurate for any step
+			gui::clamp(m_h0, 0.0001f, (m_integrator_id == 3) ? 10.0f : 0.1f);
 
 			gui::prefix_label("w(t) = ");
 			ImGui::InputText("##spring_w_func", &m_w_expression);
@@ -547,6 +950,18 @@ namespace mini {
 			gui::prefix_label ("Pause Simulation: ", 250.0f);
 			ImGui::Checkbox ("##spring_sim_paused", &m_paused);
 
+			constexpr const char* integrators[] = { "Euler", "Velocity Verlet", "RK4", "Exact" };
+			gui::prefix_label("Integrator: ", 250.0f);
+			if (ImGui::Combo("##spring_integrator", &m_integrator_id, integrators, 4)) {
+				// a step only the exact solver can take must not carry over to the others
+				const float max_step = (m_integrator_id == 3) ? 10.0f : 0.1f;
+				gui::clamp(m_h0, 0.0001f, max_step);
+
+				if (m_step > max_step) {
+					m_start_simulation();
+				}
+			}
+
 			if (ImGui::Button("Reset Simulation")) {
 				m_start_simulation();
 			}
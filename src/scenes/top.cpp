@@ -1,8 +1,12 @@
 #include "gui.hpp"
 #include "scenes/top.hpp"
+#include "lanes.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <random>
+#include <thread>
+#include <chrono>
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -43,8 +47,15 @@ namespace mini {
 		parameters(parameters),
 		W(1.0f, 1.0f, 1.0f),
 		Q(1.0f, 0.0f, 0.0f, 0.0f),
+		L(0.0f, 0.0f, 0.0f),
 		time(0.0f), 
-		step_timer(0.0f) {
+		step_timer(0.0f),
+		energy_start(0.0f),
+		momentum_start(0.0f),
+		energy_drift(0.0f),
+		momentum_drift(0.0f),
+		max_energy_drift(0.0f),
+		max_momentum_drift(0.0f) {
 
 		// initial angular speed
 		W = W * parameters.angular_velocity;
@@ -67,72 +78,328 @@ namespace mini {
 			mass, 
 			inertia_tensor, 
 			inertia_tensor_inv);
+
+		L = inertia_tensor * W;
+		reset_invariants();
 	}
 
 	void top_scene::simulation_state_t::integrate(float delta_time) {
-		const auto& I = inertia_tensor;
-		const auto& Iinv = inertia_tensor_inv;
-
-		constexpr auto diag_local = glm::vec3{1.0f, 1.0f, 1.0f} * SQRT3INV;
-
 		// window was dragged probably
 		if (delta_time > 0.1f) {
 			delta_time = 0.1f;
 		}
 
-		float t0 = time;
 		step_timer += delta_time;
 
+		while (step_timer > parameters.int_step) {
+			if (parameters.integrator_id == 1) {
+				step_splitting(parameters.int_step);
+			} else {
+				step_rk4(parameters.int_step);
+			}
+
+			step_timer -= parameters.int_step;
+		}
+
+		time += delta_time;
+
+		energy_drift = glm::abs(energy() - energy_start) / glm::max(glm::abs(energy_start), 1e-6f);
+		momentum_drift = glm::abs(momentum().y - momentum_start) / glm::max(glm::length(momentum()), 1e-6f);
+		max_energy_drift = glm::max(max_energy_drift, energy_drift);
+		max_momentum_drift = glm::max(max_momentum_drift, momentum_drift);
+	}
+
+	void top_scene::simulation_state_t::step_rk4(float h) {
+		const auto& I = inertia_tensor;
+		const auto& Iinv = inertia_tensor_inv;
+
 		// dW/dt
-		const auto f = [&](const float t, const glm::vec3& N, const glm::vec3& W) -> glm::vec3 {
+		const auto f = [&](const glm::vec3& N, const glm::vec3& W) -> glm::vec3 {
 			return Iinv * (N + glm::cross((I * W), W));
 		};
 
 		// dQ/dt
-		const auto g = [&](const float t, const glm::quat& Q, const glm::vec3& W) -> glm::quat {
+		const auto g = [&](const glm::quat& Q, const glm::vec3& W) -> glm::quat {
 			return 0.5f * Q * glm::quat(0.0f, W.x, W.y, W.z);
 		};
 
-		while (step_timer > parameters.int_step) {
-			const float h = parameters.int_step;
+		const glm::vec3 N = torque();
 
-			glm::vec3 N {0.0f, 0.0f, 0.0f};
+		// first equation IWt = N + (IW)xW
+		// denoted Wt = f(t,W)
+		{
+			auto k1w = f(N, W);
+			auto k2w = f(N, W + 0.5f * h * k1w);
+			auto k3w = f(N, W + 0.5f * h * k2w);
+			auto k4w = f(N, W + h * k3w);
 
-			if (world_params->gravity_enabled) {
-				const glm::vec3& world_up = { 0.0f, -1.0f, 0.0f };
-				const glm::vec3& to_center = 0.5f * diag_local * parameters.diagonal_length;
-				const glm::vec3& local_up = glm::rotate(glm::conjugate(Q), world_up);
-				N = mass * world_params->gravity * glm::cross(-local_up, to_center);
-			}
+			W = W + h * (k1w + 2.0f * k2w + 2.0f * k3w + k4w) / 6.0f;
+		}
 
-			// first equation IWt = N + (IW)xW
-			// denoted Wt = f(t,W)
-			{
-				auto k1w = f(t0, N, W);
-				auto k2w = f(t0 + 0.5f * h, N, W + 0.5f * h * k1w);
-				auto k3w = f(t0 + 0.5f * h, N, W + 0.5f * h * k2w);
-				auto k4w = f(t0 + h, N, W + h * k3w);
+		// second equation Qt = Q*W/2
+		// denoted Qt = g(t,Q)
+		{
+			auto k1q = g(Q, W);
+			auto k2q = g(Q + 0.5f * h * k1q, W);
+			auto k3q = g(Q + 0.5f * h * k2q, W);
+			auto k4q = g(Q + h * k3q, W);
 
-				W = W + h * (k1w + 2.0f * k2w + 2.0f * k3w + k4w) / 6.0f;
-			}
+			Q = Q + h * (k1q + 2.0f * k2q + 2.0f * k3q + k4q) / 6.0f;
+			Q = glm::normalize(Q);
+		}
 
-			// second equation Qt = Q*W/2
-			// denoted Qt = g(t,Q)
-			{
-				auto k1q = g(t0, Q, W);
-				auto k2q = g(t0 + 0.5f * h, Q + 0.5f * h * k1q, W);
-				auto k3q = g(t0 + 0.5f * h, Q + 0.5f * h * k2q, W);
-				auto k4q = g(t0 + h, Q + h * k3q, W);
+		L = I * W;
+	}
 
-				Q = Q + h * (k1q + 2.0f * k2q + 2.0f * k3q + k4q) / 6.0f;
-				Q = glm::normalize(Q);
-			}
+	void top_scene::simulation_state_t::step_splitting(float h) {
+		constexpr auto axis = glm::vec3{ 1.0f, 1.0f, 1.0f } * SQRT3INV;
 
-			t0 = t0 + parameters.int_step;
-			step_timer -= parameters.int_step;
+		// the cube about its corner is a symmetric top, i1 across the diagonal and i3 along it
+		const float i1 = inertia_tensor[0][0] - inertia_tensor[0][1];
+		const float i3 = inertia_tensor[0][0] + 2.0f * inertia_tensor[0][1];
+
+		// half kick from gravity, the rotation does not change during it
+		L = L + 0.5f * h * torque();
+
+		// the free motion splits into |L|^2/(2 i1), which turns the body about L without changing L, and
+		// (1/i3 - 1/i1) L3^2 / 2, which turns it about the diagonal, both flows are exact rotations and commute
+		const float length = glm::length(L);
+
+		if (length > 0.0f) {
+			Q = Q * glm::angleAxis(h * length / i1, L / length);
+		}
+
+		const float L3 = glm::dot(L, axis);
+		const float spin = h * (1.0f / i3 - 1.0f / i1) * L3;
+		const auto across = L - L3 * axis;
+
+		Q = Q * glm::angleAxis(spin, axis);
+		L = L3 * axis + glm::cos(spin) * across - glm::sin(spin) * glm::cross(axis, across);
+
+		// unit length is kept by construction, this only removes rounding
+		Q = glm::normalize(Q);
+
+		L = L + 0.5f * h * torque();
+
+		// W is only derived from L, so the tensors never round trip
+		const float L3_end = glm::dot(L, axis);
+		W = (L3_end / i3) * axis + (L - L3_end * axis) / i1;
+	}
+
+	glm::vec3 top_scene::simulation_state_t::torque() const {
+		constexpr auto diag_local = glm::vec3{ 1.0f, 1.0f, 1.0f } * SQRT3INV;
+
+		if (!world_params->gravity_enabled) {
+			return { 0.0f, 0.0f, 0.0f };
+		}
+
+		const glm::vec3& world_up = { 0.0f, -1.0f, 0.0f };
+		const glm::vec3& to_center = 0.5f * diag_local * parameters.diagonal_length;
+		const glm::vec3& local_up = glm::rotate(glm::conjugate(Q), world_up);
+
+		return mass * world_params->gravity * glm::cross(-local_up, to_center);
+	}
+
+	glm::vec3 top_scene::simulation_state_t::momentum() const {
+		return glm::rotate(Q, inertia_tensor * W);
+	}
+
+	float top_scene::simulation_state_t::energy() const {
+		constexpr auto diag_local = glm::vec3{ 1.0f, 1.0f, 1.0f } * SQRT3INV;
+
+		const float kinetic = 0.5f * glm::dot(W, inertia_tensor * W);
+
+		if (!world_params->gravity_enabled) {
+			return kinetic;
+		}
+
+		// gravity pulls along world_up in torque(), so the height is measured along +y
+		const auto center = glm::rotate(Q, 0.5f * diag_local * parameters.diagonal_length);
+		return kinetic + mass * world_params->gravity * center.y;
+	}
+
+	void top_scene::simulation_state_t::reset_invariants() {
+		energy_start = energy();
+		momentum_start = momentum().y;
+
+		energy_drift = momentum_drift = 0.0f;
+		max_energy_drift = max_momentum_drift = 0.0f;
+	}
+
+	top_scene::ensemble_t::ensemble_t() :
+		count(0),
+		time(0.0f),
+		step_timer(0.0f) { }
+
+	void top_scene::ensemble_t::resize(std::size_t count) {
+		const std::size_t padded = (count + LANES - 1) / LANES * LANES;
+		this->count = count;
+
+		for (auto* values : { &wx, &wy, &wz, &qw, &qx, &qy, &qz }) {
+			values->assign(padded, 0.0f);
+		}
+
+		for (auto* values : { &inertia_diag, &inertia_off, &inverse_diag, &inverse_off, &lever, &diagonal }) {
+			values->assign(padded, 0.0f);
+		}
+
+		// padding lanes are resting unit cubes, so they never produce nans
+		for (std::size_t i = count; i < padded; ++i) {
+			qw[i] = 1.0f;
+			inertia_diag[i] = inverse_diag[i] = 1.0f;
+		}
+
+		time = 0.0f;
+		step_timer = 0.0f;
+	}
+
+	void top_scene::ensemble_t::set(std::size_t index, const simulation_state_t& state) {
+		wx[index] = state.W.x;
+		wy[index] = state.W.y;
+		wz[index] = state.W.z;
+
+		qw[index] = state.Q.w;
+		qx[index] = state.Q.x;
+		qy[index] = state.Q.y;
+		qz[index] = state.Q.z;
+
+		inertia_diag[index] = state.inertia_tensor[0][0];
+		inertia_off[index] = state.inertia_tensor[0][1];
+		inverse_diag[index] = state.inertia_tensor_inv[0][0];
+		inverse_off[index] = state.inertia_tensor_inv[0][1];
+
+		diagonal[index] = state.parameters.diagonal_length;
+		lever[index] = state.mass * 0.5f * SQRT3INV * state.parameters.diagonal_length;
+	}
+
+	void top_scene::ensemble_t::integrate(thread_pool& workers, float delta_time, float int_step, float gravity) {
+		// window was dragged probably
+		if (delta_time > 0.1f) {
+			delta_time = 0.1f;
 		}
 
+		step_timer += delta_time;
 		time += delta_time;
+
+		int steps = 0;
+		while (step_timer > int_step) {
+			step_timer -= int_step;
+			++steps;
+		}
+
+		const std::size_t padded = wx.size();
+
+		if (steps == 0 || padded == 0) {
+			return;
+		}
+
+		// chunks are whole simd blocks, small ensembles are not worth a task
+		workers.parallel_for(0, padded / LANES, 64, [&](std::size_t first, std::size_t last) {
+			integrate_range(first * LANES, last * LANES, steps, int_step, gravity);
+		});
+	}
+
+	void top_scene::ensemble_t::integrate_range(std::size_t first, std::size_t last, int steps, float h, float gravity) {
+		const auto set = lane4_t::set;
+		const auto load = lane4_t::load;
+
+		const auto one = set(1.0f);
+		const auto two = set(2.0f);
+		const auto half = set(0.5f);
+		const auto half_h = set(0.5f * h);
+		const auto full_h = set(h);
+		const auto sixth_h = set(h / 6.0f);
+
+		for (std::size_t i = first; i < last; i += LANES) {
+			auto Wx = load(&wx[i]), Wy = load(&wy[i]), Wz = load(&wz[i]);
+			auto Qw = load(&qw[i]), Qx = load(&qx[i]), Qy = load(&qy[i]), Qz = load(&qz[i]);
+
+			// with a tensor d * identity + o * ones the product is (d - o) * v + o * sum(v)
+			const auto Io = load(&inertia_off[i]);
+			const auto Id = load(&inertia_diag[i]) - Io;
+			const auto Jo = load(&inverse_off[i]);
+			const auto Jd = load(&inverse_diag[i]) - Jo;
+			const auto k = load(&lever[i]) * set(gravity);
+
+			// dW/dt
+			const auto f = [&](const lane4_t* N, const lane4_t& x, const lane4_t& y, const lane4_t& z, lane4_t* out) {
+				const auto sum = Io * (x + y + z);
+				const auto ix = Id * x + sum, iy = Id * y + sum, iz = Id * z + sum;
+
+				const auto cx = N[0] + (iy * z - iz * y);
+				const auto cy = N[1] + (iz * x - ix * z);
+				const auto cz = N[2] + (ix * y - iy * x);
+
+				const auto csum = Jo * (cx + cy + cz);
+				out[0] = Jd * cx + csum;
+				out[1] = Jd * cy + csum;
+				out[2] = Jd * cz + csum;
+			};
+
+			// dQ/dt
+			const auto g = [&](const lane4_t& w, const lane4_t& x, const lane4_t& y, const lane4_t& z, lane4_t* out) {
+				out[0] = half * (set(0.0f) - (x * Wx + y * Wy + z * Wz));
+				out[1] = half * (w * Wx + y * Wz - z * Wy);
+				out[2] = half * (w * Wy + z * Wx - x * Wz);
+				out[3] = half * (w * Wz + x * Wy - y * Wx);
+			};
+
+			for (int step = 0; step < steps; ++step) {
+				// the cross product of the local up vector with the diagonal
+				const auto ux = two * (Qx * Qy + Qw * Qz);
+				const auto uy = one - two * (Qx * Qx + Qz * Qz);
+				const auto uz = two * (Qy * Qz - Qw * Qx);
+				const lane4_t N[3] = { k * (uy - uz), k * (uz - ux), k * (ux - uy) };
+
+				{
+					lane4_t k1[3], k2[3], k3[3], k4[3];
+					f(N, Wx, Wy, Wz, k1);
+					f(N, Wx + half_h * k1[0], Wy + half_h * k1[1], Wz + half_h * k1[2], k2);
+					f(N, Wx + half_h * k2[0], Wy + half_h * k2[1], Wz + half_h * k2[2], k3);
+					f(N, Wx + full_h * k3[0], Wy + full_h * k3[1], Wz + full_h * k3[2], k4);
+
+					Wx = Wx + sixth_h * (k1[0] + two * (k2[0] + k3[0]) + k4[0]);
+					Wy = Wy + sixth_h * (k1[1] + two * (k2[1] + k3[1]) + k4[1]);
+					Wz = Wz + sixth_h * (k1[2] + two * (k2[2] + k3[2]) + k4[2]);
+				}
+
+				{
+					lane4_t k1[4], k2[4], k3[4], k4[4];
+					g(Qw, Qx, Qy, Qz, k1);
+					g(Qw + half_h * k1[0], Qx + half_h * k1[1], Qy + half_h * k1[2], Qz + half_h * k1[3], k2);
+					g(Qw + half_h * k2[0], Qx + half_h * k2[1], Qy + half_h * k2[2], Qz + half_h * k2[3], k3);
+					g(Qw + full_h * k3[0], Qx + full_h * k3[1], Qy + full_h * k3[2], Qz + full_h * k3[3], k4);
+
+					Qw = Qw + sixth_h * (k1[0] + two * (k2[0] + k3[0]) + k4[0]);
+					Qx = Qx + sixth_h * (k1[1] + two * (k2[1] + k3[1]) + k4[1]);
+					Qy = Qy + sixth_h * (k1[2] + two * (k2[2] + k3[2]) + k4[2]);
+					Qz = Qz + sixth_h * (k1[3] + two * (k2[3] + k3[3]) + k4[3]);
+
+					const auto inv_len = one / lane4_t::sqrt(Qw * Qw + Qx * Qx + Qy * Qy + Qz * Qz);
+					Qw = Qw * inv_len;
+					Qx = Qx * inv_len;
+					Qy = Qy * inv_len;
+					Qz = Qz * inv_len;
+				}
+			}
+
+			Wx.store(&wx[i]);
+			Wy.store(&wy[i]);
+			Wz.store(&wz[i]);
+			Qw.store(&qw[i]);
+			Qx.store(&qx[i]);
+			Qy.store(&qy[i]);
+			Qz.store(&qz[i]);
+		}
+	}
+
+	glm::vec3 top_scene::ensemble_t::tip(std::size_t index) const {
+		const glm::quat Q = { qw[index], qx[index], qy[index], qz[index] };
+		return glm::rotate(Q, -SQRT3INV * diagonal[index] * glm::vec3{ 1.0f, 1.0f, 1.0f });
+	}
+
+	resource_manifest_t top_scene::get_manifest() {
+		return { { "line", "cube", "grid_xz", "point_cloud" } };
 	}
 
 	top_scene::top_scene(application_base& app) : scene_base(app),
@@ -141,10 +408,18 @@ namespace mini {
 		m_display_grid(true),
 		m_display_plane(true),
 		m_display_path(true),
+		m_ensemble_mode(false),
 		m_world_params(),
 		m_start_params(),
 		m_state(m_start_params, &m_world_params),
 		m_max_data_points(MAX_DATA_POINTS),
+		m_ensemble_size(4096),
+		m_deviation_spread(0.05f),
+		m_velocity_spread(2.0f),
+		m_diagonal_spread(0.0f),
+		m_ensemble_time(0.0f),
+		m_ensemble_radius(0.0f),
+		m_ensemble(),
 		m_viewport(app, "Spinning Top") {
 
 		m_clear_data_points();
@@ -152,6 +427,7 @@ namespace mini {
 		auto line_shader = get_app().get_store().get_shader("line");
 		auto cube_shader = get_app().get_store().get_shader("cube");
 		auto grid_shader = get_app().get_store().get_shader("grid_xz");
+		auto cloud_shader = get_app().get_store().get_shader("point_cloud");
 
 		get_app().get_context().set_clear_color({0.75f, 0.75f, 0.9f});
 
@@ -173,6 +449,11 @@ namespace mini {
 			m_curve->set_color({ 0.890f, 0.657f, 0.0178f, 1.0f });
 		}
 
+		if (cloud_shader) {
+			m_tip_cloud = std::make_shared<point_cloud>(cloud_shader);
+			m_tip_cloud->set_point_size(3.0f);
+		}
+
 		auto camera = std::make_unique<default_camera>();
 		camera->video_mode_change(get_app().get_context().get_video_mode());
 		get_app().get_context().set_camera(std::move(camera));
@@ -199,6 +480,16 @@ namespace mini {
 		auto diag_position = glm::rotate(m_state.Q, 2.0f * m_state.parameters.diagonal_length * diag_vector);
 
 		m_push_data_point(m_state.time, diag_position);
+
+		if (m_ensemble_mode) {
+			const float gravity = m_world_params.gravity_enabled ? m_world_params.gravity : 0.0f;
+
+			const auto start = std::chrono::steady_clock::now();
+			m_ensemble.integrate(m_workers, delta_time, m_state.parameters.int_step, gravity);
+			m_ensemble_time = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			m_update_tip_cloud();
+		}
 	}
 
 	void top_scene::render(app_context& context) {
@@ -236,7 +527,11 @@ namespace mini {
 			context.draw(m_cube, cube_model);
 		}
 
-		if (m_curve && m_display_path) {
+		if (m_ensemble_mode) {
+			if (m_tip_cloud && m_display_path) {
+				context.draw(m_tip_cloud, glm::mat4x4(1.0f));
+			}
+		} else if (m_curve && m_display_path) {
 			context.draw(m_curve, glm::mat4x4(1.0f));
 		}
 	}
@@ -326,19 +621,63 @@ namespace mini {
 			gui::prefix_label("Ang. Velocity: ", 250.0f);
 			ImGui::InputFloat("##top_angvel", &m_start_params.angular_velocity);
 
+			constexpr const char* integrators[] = { "RK4", "Lie Splitting" };
+			gui::prefix_label("Integrator: ", 250.0f);
+			ImGui::Combo("##top_integrator", &m_start_params.integrator_id, integrators, 2);
+
 			if (ImGui::Button("Apply Settings")) {
 				m_reset_simulation();
 			}
 
+			ImGui::Text("Energy Drift: %.2e (max %.2e)", m_state.energy_drift, m_state.max_energy_drift);
+			ImGui::Text("Momentum Drift: %.2e (max %.2e)", m_state.momentum_drift, m_state.max_momentum_drift);
+
+			ImGui::NewLine();
+		}
+
+		if (ImGui::CollapsingHeader("Ensemble Settings")) {
+			gui::prefix_label("Ensemble: ", 250.0f);
+			if (ImGui::Checkbox("##top_ensemble", &m_ensemble_mode) && m_ensemble_mode) {
+				m_reset_ensemble();
+			}
+
+			gui::prefix_label("Num. Tops: ", 250.0f);
+			if (ImGui::InputInt("##top_ensemble_size", &m_ensemble_size, 256, 1024)) {
+				gui::clamp(m_ensemble_size, 1, MAX_ENSEMBLE_SIZE);
+			}
+
+			gui::prefix_label("Deviation Spread: ", 250.0f);
+			ImGui::InputFloat("##top_deviation_spread", &m_deviation_spread);
+
+			gui::prefix_label("Velocity Spread: ", 250.0f);
+			ImGui::InputFloat("##top_velocity_spread", &m_velocity_spread);
+
+			gui::prefix_label("Diagonal Spread: ", 250.0f);
+			ImGui::InputFloat("##top_diagonal_spread", &m_diagonal_spread);
+
+			if (ImGui::Button("Apply Ensemble")) {
+				m_reset_ensemble();
+			}
+
+			if (m_ensemble_mode) {
+				ImGui::Text("Integration: %.3f ms", m_ensemble_time);
+				ImGui::Text("Tip Spread: %.4f", m_ensemble_radius);
+			}
+
 			ImGui::NewLine();
 		}
 
 		if (ImGui::CollapsingHeader("World Settings", ImGuiTreeNodeFlags_DefaultOpen)) {
+			// the conserved values change with the world, so drift is measured from here on
 			gui::prefix_label("Gravity Enabled: ", 250.0f);
-			ImGui::Checkbox("##top_gravity_on", &m_world_params.gravity_enabled);
+			if (ImGui::Checkbox("##top_gravity_on", &m_world_params.gravity_enabled)) {
+				m_state.reset_invariants();
+			}
 
 			gui::prefix_label("Gravity Force: ", 250.0f);
-			ImGui::InputFloat("##top_gravity_f", &m_world_params.gravity);
+			if (ImGui::InputFloat("##top_gravity_f", &m_world_params.gravity)) {
+				m_state.reset_invariants();
+			}
 		}
 
 		if (ImGui::CollapsingHeader("Display Settings", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -366,6 +705,74 @@ namespace mini {
 	void top_scene::m_reset_simulation() {
 		m_state = simulation_state_t(m_start_params, &m_world_params);
 		m_clear_data_points();
+
+		if (m_ensemble_mode) {
+			m_reset_ensemble();
+		}
+	}
+
+	void top_scene::m_reset_ensemble() {
+		const std::size_t count = static_cast<std::size_t>(m_ensemble_size);
+
+		m_ensemble.resize(count);
+		m_ensemble_colors.resize(count);
+
+		// fixed seed so the same settings always give the same ensemble
+		std::mt19937 generator(1234u);
+		std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const float deviation = offset(generator);
+			const float velocity = offset(generator);
+			const float diagonal = offset(generator);
+
+			auto parameters = m_start_params;
+			parameters.cube_deviation += deviation * m_deviation_spread;
+			parameters.angular_velocity += velocity * m_velocity_spread;
+			parameters.diagonal_length = glm::max(parameters.diagonal_length + diagonal * m_diagonal_spread, 0.01f);
+
+			m_ensemble.set(i, simulation_state_t(parameters, &m_world_params));
+
+			// red follows the deviation, green the diagonal and blue the angular velocity
+			m_ensemble_colors[i] = {
+				0.5f + 0.5f * deviation,
+				0.5f + 0.5f * diagonal,
+				0.5f + 0.5f * velocity,
+				1.0f
+			};
+		}
+
+		m_update_tip_cloud();
+	}
+
+	void top_scene::m_update_tip_cloud() {
+		glm::vec3 mean = { 0.0f, 0.0f, 0.0f };
+		float squares = 0.0f;
+
+		if (m_tip_cloud) {
+			m_tip_cloud->clear();
+		}
+
+		for (std::size_t i = 0; i < m_ensemble.count; ++i) {
+			const auto tip = m_ensemble.tip(i);
+
+			mean += tip;
+			squares += glm::dot(tip, tip);
+
+			if (m_tip_cloud) {
+				m_tip_cloud->add_point(tip, m_ensemble_colors[i]);
+			}
+		}
+
+		if (m_ensemble.count > 0) {
+			const float n = static_cast<float>(m_ensemble.count);
+			mean /= n;
+			m_ensemble_radius = glm::sqrt(glm::max(squares / n - glm::dot(mean, mean), 0.0f));
+		}
+
+		if (m_tip_cloud) {
+			m_tip_cloud->rebuild_buffers();
+		}
 	}
 
 	void top_scene::m_clear_data_points() {
@@ -47,62 +47,42 @@ namespace mini {
 	}
 
 	bool shader_program::compile () {
-		// compile and link
-		GLuint vs = 0;
-		GLuint ps = 0;
-		GLuint gs = 0;
-		GLuint tcs = 0;
-		GLuint tes = 0;
-
-		// theese will throw exceptions if any fails
-		try {
-			m_try_compile (GL_VERTEX_SHADER, m_vs_source, &vs);
-			m_try_compile (GL_FRAGMENT_SHADER, m_ps_source, &ps);
+		begin_compile ();
+		finish_compile ();
 
-			if (m_gs_source.size () > 0) {
-				m_has_geometry = true;
-				m_try_compile (GL_GEOMETRY_SHADER, m_gs_source, &gs);
-			}
+		return true;
+	}
 
-			if (m_tcs_source.size () > 0 && m_tes_source.size () > 0) {
-				m_has_tesselation = true;
-				m_try_compile (GL_TESS_CONTROL_SHADER, m_tcs_source, &tcs);
-				m_try_compile (GL_TESS_EVALUATION_SHADER, m_tes_source, &tes);
-			}
-		} catch (const std::exception & e) {
-			if (vs) {
-				glDeleteShader (vs);
-			}
+	void shader_program::begin_compile () {
+		if (m_is_ready || m_program != 0) {
+			throw std::runtime_error ("this shader was already linked and compiled");
+		}
 
-			if (ps) {
-				glDeleteShader (ps);
-			}
+		m_has_geometry = m_gs_source.size () > 0;
+		m_has_tesselation = m_tcs_source.size () > 0 && m_tes_source.size () > 0;
 
-			if (gs) {
-				glDeleteShader (gs);
-			}
+		// no status is read here, that would wait for the driver
+		try {
+			m_vs = m_start_compile (GL_VERTEX_SHADER, m_vs_source);
+			m_ps = m_start_compile (GL_FRAGMENT_SHADER, m_ps_source);
 
-			if (tcs) {
-				glDeleteShader (tcs);
+			if (m_has_geometry) {
+				m_gs = m_start_compile (GL_GEOMETRY_SHADER, m_gs_source);
 			}
 
-			if (tes) {
-				glDeleteShader (tes);
+			if (m_has_tesselation) {
+				m_tcs = m_start_compile (GL_TESS_CONTROL_SHADER, m_tcs_source);
+				m_tes = m_start_compile (GL_TESS_EVALUATION_SHADER, m_tes_source);
 			}
-
-			// propagate the error
-			throw e;
+		} catch (...) {
+			m_delete_objects ();
+			throw;
 		}
 
-		m_ps = ps;
-		m_vs = vs;
-		m_gs = gs;
-		m_tcs = tcs;
-		m_tes = tes;
-
 		const GLuint program_object = glCreateProgram ();
 
 		if (program_object == 0) {
+			m_delete_objects ();
 			throw std::runtime_error ("failed to create shader program");
 		}
 
@@ -119,7 +99,48 @@ namespace mini {
 			glAttachShader (m_program, m_tcs);
 		}
 
-		m_try_link ();
+		// keeps the linked binary around for get_binary
+		glProgramParameteri (m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram (m_program);
+	}
+
+	bool shader_program::is_compile_complete () const {
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLAD_GL_KHR_parallel_shader_compile && m_program != 0 && !m_is_ready) {
+			GLint complete = GL_FALSE;
+			glGetProgramiv (m_program, GL_COMPLETION_STATUS_KHR, &complete);
+
+			return complete == GL_TRUE;
+		}
+#endif
+
+		return true;
+	}
+
+	void shader_program::finish_compile () {
+		if (m_program == 0 || m_is_ready) {
+			throw std::runtime_error ("no compile was started for this shader");
+		}
+
+		// stage logs first, they say more than the link log
+		try {
+			m_try_compile (m_vs);
+			m_try_compile (m_ps);
+
+			if (m_has_geometry) {
+				m_try_compile (m_gs);
+			}
+
+			if (m_has_tesselation) {
+				m_try_compile (m_tcs);
+				m_try_compile (m_tes);
+			}
+
+			m_try_link ();
+		} catch (...) {
+			m_delete_objects ();
+			throw;
+		}
 
 		// linker success, delete shaders as they are no longer needed
 		glDeleteShader (m_vs);
@@ -135,9 +156,69 @@ namespace mini {
 		}
 
 		m_vs = m_ps = m_gs = m_tes = m_tcs = 0;
+	}
+
+	bool shader_program::load_binary (GLenum format, const std::vector<unsigned char> & binary) {
+		if (m_is_ready || m_program != 0) {
+			throw std::runtime_error ("this shader was already linked and compiled");
+		}
+
+		const GLuint program_object = glCreateProgram ();
+
+		if (program_object == 0) {
+			throw std::runtime_error ("failed to create shader program");
+		}
+
+		glProgramBinary (program_object, format, binary.data (), static_cast<GLsizei> (binary.size ()));
+
+		// a driver update or a different gpu makes old binaries fail like a bad link
+		GLint link_status = 0;
+		glGetProgramiv (program_object, GL_LINK_STATUS, &link_status);
+
+		if (link_status != GL_TRUE) {
+			glDeleteProgram (program_object);
+			return false;
+		}
+
+		m_program = program_object;
+		m_has_geometry = m_gs_source.size () > 0;
+		m_has_tesselation = m_tcs_source.size () > 0 && m_tes_source.size () > 0;
+		m_is_ready = true;
+
 		return true;
 	}
 
+	bool shader_program::get_binary (GLenum & format, std::vector<unsigned char> & binary) const {
+		if (!m_is_ready) {
+			return false;
+		}
+
+		GLint length = 0;
+		glGetProgramiv (m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+		if (length <= 0) {
+			return false;
+		}
+
+		binary.resize (length);
+		glGetProgramBinary (m_program, length, &length, &format, binary.data ());
+		binary.resize (length);
+
+		return length > 0;
+	}
+
+	bool shader_program::enable_parallel_compile () {
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLAD_GL_KHR_parallel_shader_compile) {
+			// as many threads as the driver likes
+			glMaxShaderCompilerThreadsKHR (0xFFFFFFFF);
+			return true;
+		}
+#endif
+
+		return false;
+	}
+
 	bool shader_program::is_ready () const {
 		return m_is_ready;
 	}
@@ -317,7 +398,7 @@ namespace mini {
 		}
 	}
 
-	bool shader_program::m_try_compile (GLenum shader_type, const std::string & source, GLuint * out_shader) {
+	GLuint shader_program::m_start_compile (GLenum shader_type, const std::string & source) {
 		const GLuint shader_object = glCreateShader (shader_type);
 
 		// error has occured, invalid enum provided
@@ -330,7 +411,10 @@ namespace mini {
 
 		// compile shader
 		glCompileShader (shader_object);
+		return shader_object;
+	}
 
+	bool shader_program::m_try_compile (GLuint shader_object) {
 		// error checking
 		GLint compile_status = 0;
 		glGetShaderiv (shader_object, GL_COMPILE_STATUS, &compile_status);
@@ -344,15 +428,11 @@ namespace mini {
 
 			// make a log and throw an error
 			glGetShaderInfoLog (shader_object, 4096, &compile_log_len, compile_log_buffer);
-
-			// clean up and throw
-			glDeleteShader (shader_object);
 			throw shader_error (shader_error_type_t::compile_shader, "failed to compile shader", std::string (compile_log_buffer));
 
 			return false;
 		}
 
-		(*out_shader) = shader_object;
 		return true;
 	}
 
@@ -376,13 +456,25 @@ namespace mini {
 			// make a log and throw an error
 			glGetProgramInfoLog (m_program, 4096, &link_log_len, link_log_buffer);
 
-			// clean up and throw
-			glDeleteProgram (m_program);
-
+			// finish_compile cleans up
 			throw shader_error (shader_error_type_t::link_program, "failed to link shader", std::string (link_log_buffer));
 		}
 
 		m_is_ready = true;
 		return true;
 	}
+
+	void shader_program::m_delete_objects () {
+		if (m_program) {
+			glDeleteProgram (m_program);
+		}
+
+		for (const GLuint shader_object : { m_vs, m_ps, m_gs, m_tcs, m_tes }) {
+			if (shader_object) {
+				glDeleteShader (shader_object);
+			}
+		}
+
+		m_program = m_ps = m_vs = m_gs = m_tcs = m_tes = 0;
+	}
 }
\ No newline at end of file
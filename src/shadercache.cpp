@@ -0,0 +1,149 @@
+#include "shadercache.hpp"
+
+#include <ios>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+
+namespace mini {
+	namespace {
+		struct file_header_t {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint32_t format;
+			uint32_t reserved;
+			uint64_t size;
+		};
+
+		constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+		std::string get_driver_string(GLenum name) {
+			const auto* value = reinterpret_cast<const char*>(glGetString(name));
+			return value ? value : "";
+		}
+	}
+
+	shader_cache::shader_cache(const std::string& directory) : m_directory(directory) {
+		m_driver = get_driver_string(GL_VENDOR) + "\n" + get_driver_string(GL_RENDERER) + "\n" + get_driver_string(GL_VERSION);
+
+		// some drivers support the calls but no format at all
+		GLint num_formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+		m_enabled = num_formats > 0;
+	}
+
+	bool shader_cache::is_enabled() const {
+		return m_enabled;
+	}
+
+	uint64_t shader_cache::get_key(const sources_t& sources) const {
+		uint64_t key = m_hash(m_driver.data(), m_driver.size(), FNV_OFFSET);
+
+		// lengths go in too, so text moving between two stages changes the key
+		for (const auto& source : sources) {
+			const uint64_t size = source.size();
+			key = m_hash(&size, sizeof(size), key);
+			key = m_hash(source.data(), source.size(), key);
+		}
+
+		return key;
+	}
+
+	std::string shader_cache::get_cache_path(uint64_t key) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.sfsh", static_cast<unsigned long long>(key));
+
+		return (std::filesystem::path(m_directory) / name).string();
+	}
+
+	bool shader_cache::load(uint64_t key, binary_t& binary) const {
+		if (!m_enabled) {
+			return false;
+		}
+
+		std::ifstream stream(get_cache_path(key), std::ios::binary);
+		if (!stream) {
+			return false;
+		}
+
+		file_header_t header;
+		if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+			return false;
+		}
+
+		if (header.magic != MAGIC || header.version != VERSION || header.key != key || header.size == 0) {
+			return false;
+		}
+
+		const auto end = stream.seekg(0, std::ios::end).tellg();
+		if (end < 0 || static_cast<uint64_t>(end) - sizeof(header) < header.size) {
+			return false;
+		}
+
+		binary.format = header.format;
+		binary.data.resize(header.size);
+
+		stream.seekg(sizeof(header));
+		return static_cast<bool>(stream.read(reinterpret_cast<char*>(binary.data.data()), header.size));
+	}
+
+	void shader_cache::store(uint64_t key, const binary_t& binary) const {
+		if (!m_enabled || binary.data.empty()) {
+			return;
+		}
+
+		const std::string path = get_cache_path(key);
+
+		try {
+			std::filesystem::create_directories(m_directory);
+
+			file_header_t header = {};
+			header.magic = MAGIC;
+			header.version = VERSION;
+			header.key = key;
+			header.format = binary.format;
+			header.size = binary.data.size();
+
+			// written aside and renamed, so a reader never sees half a file
+			const auto thread_key = std::hash<std::thread::id>()(std::this_thread::get_id());
+			const std::string temp_path = path + "." + std::to_string(thread_key) + ".tmp";
+
+			{
+				std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+				if (!stream) {
+					throw std::runtime_error("cannot open file: " + temp_path);
+				}
+
+				stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				stream.write(reinterpret_cast<const char*>(binary.data.data()), binary.data.size());
+
+				if (!stream) {
+					throw std::runtime_error("failed to write " + temp_path);
+				}
+			}
+
+			std::filesystem::rename(temp_path, path);
+		} catch (const std::exception& e) {
+			std::cerr << "cannot write shader cache " << path << ": " << e.what() << std::endl;
+		}
+	}
+
+	uint64_t shader_cache::m_hash(const void* data, std::size_t size, uint64_t hash) {
+		// 64 bit fnv-1a, continued from the given hash
+		const auto* bytes = static_cast<const unsigned char*>(data);
+
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+}
\ No newline at end of file
@@ -4,72 +4,96 @@
 #include <sstream>
 #include <ios>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <utility>
+#include <algorithm>
 
 namespace mini {
-	std::shared_ptr<shader_program> resource_store::m_load_shader(const std::string& vs_file, const std::string& ps_file) const {
-		const std::string vs_source = m_read_file_content(vs_file);
-		const std::string ps_source = m_read_file_content(ps_file);
-
-		auto shader = std::make_shared<shader_program>(vs_source, ps_source);
+	namespace {
+		// the six faces of a cube map are decoded by separate jobs, the last one to finish
+		// hands over the upload
+		struct cubemap_job_t {
+			std::array<std::shared_ptr<const baked_image>, 6> faces;
+			std::atomic<int> remaining { 6 };
+
+			std::mutex mutex;
+			std::exception_ptr error;
+		};
+
+		template<typename T> bool is_ready(const std::shared_future<T>& future) {
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+	}
 
-		try {
-			shader->compile();
-		} catch (const shader_error& error) {
-			std::cerr << error.what() << " log: " << std::endl << error.get_log() << std::endl;
+	template<typename T> T resource_store::m_get(std::unordered_map<std::string, slot_t<T>>& slots, const std::string& name) {
+		auto it = slots.find(name);
+		if (it == slots.end()) {
 			return nullptr;
 		}
 
-		return shader;
+		// asked for before its load came through, so the rest of it runs now
+		if (!is_ready(it->second.future)) {
+			m_wait_for(name);
+
+			it = slots.find(name);
+			if (it == slots.end()) {
+				return nullptr;
+			}
+		}
+
+		it->second.last_used = ++m_use_clock;
+		return it->second.future.get();
 	}
 
-	std::shared_ptr<shader_program> resource_store::m_load_shader(const std::string& vs_file, const std::string& ps_file, const std::string& gs_file) const {
-		const std::string vs_source = m_read_file_content(vs_file);
-		const std::string ps_source = m_read_file_content(ps_file);
-		const std::string gs_source = m_read_file_content(gs_file);
+	template<typename T> void resource_store::m_set_ready(std::unordered_map<std::string, slot_t<T>>& slots,
+		const std::string& name, T handle, std::size_t bytes) {
 
-		auto shader = std::make_shared<shader_program>(vs_source, ps_source);
-		shader->set_geometry_source(gs_source);
+		std::promise<T> promise;
+		promise.set_value(handle);
 
-		try {
-			shader->compile();
-		} catch (const shader_error& error) {
-			std::cerr << error.what() << " log: " << std::endl << error.get_log() << std::endl;
-			return nullptr;
-		}
+		auto& slot = slots[name];
+		m_resident_bytes -= slot.bytes;
 
-		return shader;
-	}
+		slot.future = promise.get_future().share();
+		slot.bytes = bytes;
+		slot.last_used = ++m_use_clock;
 
-	std::shared_ptr<shader_program> resource_store::m_load_shader(const std::string& vs_file, const std::string& ps_file, const std::string& tcs_file, const std::string& tes_file) const {
-		const std::string vs_source = m_read_file_content(vs_file);
-		const std::string ps_source = m_read_file_content(ps_file);
-		const std::string tes_source = m_read_file_content(tes_file);
-		const std::string tcs_source = m_read_file_content(tcs_file);
+		m_resident_bytes += bytes;
+	}
 
-		auto shader = std::make_shared<shader_program>(vs_source, ps_source);
-		shader->set_tesselation_source(tcs_source, tes_source);
+	template<typename T> void resource_store::m_set_resident(std::unordered_map<std::string, slot_t<T>>& slots,
+		const std::string& name, std::size_t bytes) {
 
-		try {
-			shader->compile();
-		} catch (const shader_error& error) {
-			std::cerr << error.what() << " log: " << std::endl << error.get_log() << std::endl;
-			return nullptr;
+		auto it = slots.find(name);
+		if (it != slots.end()) {
+			it->second.bytes = bytes;
+			m_resident_bytes += bytes;
 		}
+	}
 
-		return shader;
+	shader_cache::sources_t resource_store::m_read_shader_sources(const shader_files_t& files) const {
+		shader_cache::sources_t sources;
+		sources[0] = m_read_file_content(files.vs);
+		sources[1] = m_read_file_content(files.ps);
+		sources[2] = files.tcs.empty() ? "" : m_read_file_content(files.tcs);
+		sources[3] = files.tes.empty() ? "" : m_read_file_content(files.tes);
+		sources[4] = files.gs.empty() ? "" : m_read_file_content(files.gs);
+
+		return sources;
 	}
 
-	std::shared_ptr<shader_program> resource_store::m_load_shader(const std::string& vs_file, const std::string& ps_file, const std::string& tcs_file, const std::string& tes_file, const std::string& gs_file) const {
-		const std::string vs_source = m_read_file_content(vs_file);
-		const std::string ps_source = m_read_file_content(ps_file);
-		const std::string tes_source = m_read_file_content(tes_file);
-		const std::string tcs_source = m_read_file_content(tcs_file);
-		const std::string gs_source = m_read_file_content(gs_file);
+	std::shared_ptr<shader_program> resource_store::m_load_shader(const shader_files_t& files) {
+		const auto sources = m_read_shader_sources(files);
+		const auto key = m_shader_cache.get_key(sources);
 
-		auto shader = std::make_shared<shader_program>(vs_source, ps_source);
+		auto shader = m_create_shader(sources);
+		shader_cache::binary_t binary;
 
-		shader->set_tesselation_source(tcs_source, tes_source);
-		shader->set_geometry_source(gs_source);
+		if (m_shader_cache.load(key, binary) && shader->load_binary(binary.format, binary.data)) {
+			return shader;
+		}
 
 		try {
 			shader->compile();
@@ -78,75 +102,411 @@ namespace mini {
 			return nullptr;
 		}
 
+		m_store_binary(key, *shader);
 		return shader;
 	}
 
-	std::shared_ptr<texture> resource_store::m_load_texture(const std::string& file) const {
-		texture_handle_t new_texture = texture::load_from_file(file);
-		return new_texture;
-	}
-
 	void resource_store::load_shader(
-		const std::string& name, 
-		const std::string& vs_file, 
+		const std::string& name,
+		const std::string& vs_file,
 		const std::string& ps_file) {
 
-		m_add_shader(name, m_load_shader(vs_file, ps_file));
+		load_shader(name, vs_file, ps_file, "", "", "");
 	}
 
 	void resource_store::load_shader(
-		const std::string& name, 
-		const std::string& vs_file, 
-		const std::string& ps_file, 
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
 		const std::string& gs_file) {
 
-		m_add_shader(name, m_load_shader(vs_file, ps_file, gs_file));
+		load_shader(name, vs_file, ps_file, "", "", gs_file);
 	}
 
 	void resource_store::load_shader(
-		const std::string& name, 
-		const std::string& vs_file, 
-		const std::string& ps_file, 
-		const std::string& tcs_file, 
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
+		const std::string& tcs_file,
 		const std::string& tes_file) {
-		
-		m_add_shader(name, m_load_shader(vs_file, ps_file, tcs_file, tes_file));
+
+		load_shader(name, vs_file, ps_file, tcs_file, tes_file, "");
 	}
 
 	void resource_store::load_shader(
-		const std::string& name, 
-		const std::string& vs_file, 
-		const std::string& ps_file, 
-		const std::string& tcs_file, 
-		const std::string& tes_file, 
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
+		const std::string& tcs_file,
+		const std::string& tes_file,
 		const std::string& gs_file) {
 
-		m_add_shader(name, m_load_shader(vs_file, ps_file, tcs_file, tes_file, gs_file));
+		const shader_files_t files = { vs_file, ps_file, tcs_file, tes_file, gs_file };
+		m_shader_files[name] = files;
+
+		// a load of the same name still in flight would land on top of this one
+		m_wait_for(name);
+
+		auto shader = m_load_shader(files);
+		m_set_ready(m_shaders, name, shader, m_program_bytes(shader.get()));
 	}
 
 	void resource_store::load_texture(const std::string& name, const std::string& file) {
-		m_add_texture(name, m_load_texture(file));
+		m_texture_files[name] = file;
+		m_wait_for(name);
+
+		texture_handle_t handle = texture::load_from_file(file);
+		const std::size_t bytes = static_cast<std::size_t>(handle->get_width()) * handle->get_height() * 4;
+
+		m_set_ready(m_textures, name, handle, bytes);
 	}
 
-	shader_handle_t resource_store::get_shader(const std::string& name) const {
-		auto it = m_shaders.find(name);
-		if (it != m_shaders.end()) {
-			return it->second;
+	shader_future_t resource_store::load_shader_async(
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file) {
+
+		return load_shader_async(name, vs_file, ps_file, "", "", "");
+	}
+
+	shader_future_t resource_store::load_shader_async(
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
+		const std::string& gs_file) {
+
+		return load_shader_async(name, vs_file, ps_file, "", "", gs_file);
+	}
+
+	shader_future_t resource_store::load_shader_async(
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
+		const std::string& tcs_file,
+		const std::string& tes_file) {
+
+		return load_shader_async(name, vs_file, ps_file, tcs_file, tes_file, "");
+	}
+
+	shader_future_t resource_store::load_shader_async(
+		const std::string& name,
+		const std::string& vs_file,
+		const std::string& ps_file,
+		const std::string& tcs_file,
+		const std::string& tes_file,
+		const std::string& gs_file) {
+
+		const shader_files_t files = { vs_file, ps_file, tcs_file, tes_file, gs_file };
+		m_shader_files[name] = files;
+
+		return m_load_shader_async(name, files);
+	}
+
+	texture_future_t resource_store::load_texture_async(const std::string& name, const std::string& file) {
+		m_texture_files[name] = file;
+		return m_load_texture_async(name, file);
+	}
+
+	cubemap_future_t resource_store::load_cubemap_async(const std::string& name, const std::array<std::string, 6>& sides) {
+		m_cubemap_files[name] = sides;
+		return m_load_cubemap_async(name, sides);
+	}
+
+	mesh_future_t resource_store::load_mesh_async(const std::string& name, const mesh_file_t& file) {
+		m_mesh_files[name] = file;
+		return m_load_mesh_async(name, file);
+	}
+
+	void resource_store::declare_shader(const std::string& name, const shader_files_t& files) {
+		m_shader_files[name] = files;
+	}
+
+	void resource_store::declare_texture(const std::string& name, const std::string& file) {
+		m_texture_files[name] = file;
+	}
+
+	void resource_store::declare_cubemap(const std::string& name, const std::array<std::string, 6>& sides) {
+		m_cubemap_files[name] = sides;
+	}
+
+	void resource_store::declare_mesh(const std::string& name, const mesh_file_t& file) {
+		m_mesh_files[name] = file;
+	}
+
+	void resource_store::prefetch(const resource_manifest_t& manifest) {
+		m_manifest = manifest;
+
+		for (const auto& name : manifest.shaders) {
+			auto it = m_shader_files.find(name);
+			if (it == m_shader_files.end()) {
+				std::cerr << "nothing declared for shader " << name << std::endl;
+			} else if (m_shaders.find(name) == m_shaders.end()) {
+				m_load_shader_async(name, it->second);
+			}
+		}
+
+		for (const auto& name : manifest.textures) {
+			auto it = m_texture_files.find(name);
+			if (it == m_texture_files.end()) {
+				std::cerr << "nothing declared for texture " << name << std::endl;
+			} else if (m_textures.find(name) == m_textures.end()) {
+				m_load_texture_async(name, it->second);
+			}
 		}
 
-		return nullptr;
+		for (const auto& name : manifest.cubemaps) {
+			auto it = m_cubemap_files.find(name);
+			if (it == m_cubemap_files.end()) {
+				std::cerr << "nothing declared for cube map " << name << std::endl;
+			} else if (m_cubemaps.find(name) == m_cubemaps.end()) {
+				m_load_cubemap_async(name, it->second);
+			}
+		}
+
+		for (const auto& name : manifest.meshes) {
+			auto it = m_mesh_files.find(name);
+			if (it == m_mesh_files.end()) {
+				std::cerr << "nothing declared for mesh " << name << std::endl;
+			} else if (m_meshes.find(name) == m_meshes.end()) {
+				m_load_mesh_async(name, it->second);
+			}
+		}
 	}
 
-	texture_handle_t resource_store::get_texture(const std::string& name) const {
-		auto it = m_textures.find(name);
-		if (it != m_textures.end()) {
-			return it->second;
+	std::size_t resource_store::process_uploads(double budget_seconds) {
+		using clock = std::chrono::steady_clock;
+
+		const auto start = clock::now();
+		std::size_t num_uploaded = 0;
+
+		for (auto it = m_pending.begin(); it != m_pending.end(); ) {
+			const std::chrono::duration<double> elapsed = clock::now() - start;
+			if (num_uploaded > 0 && elapsed.count() >= budget_seconds) {
+				break;
+			}
+
+			if (it->staged.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++it;
+				continue;
+			}
+
+			m_finish_upload(*it);
+			it = m_pending.erase(it);
+			num_uploaded++;
+		}
+
+		// without parallel compile every program reports done and finishing it compiles
+		for (auto it = m_linking.begin(); it != m_linking.end(); ) {
+			const std::chrono::duration<double> elapsed = clock::now() - start;
+			if (num_uploaded > 0 && elapsed.count() >= budget_seconds) {
+				break;
+			}
+
+			if (!it->shader->is_compile_complete()) {
+				++it;
+				continue;
+			}
+
+			m_finish_link(*it);
+			it = m_linking.erase(it);
+			num_uploaded++;
+		}
+
+		// only an upload adds to the resident size, so there is nothing new to evict otherwise
+		if (num_uploaded > 0 && m_resident_bytes > m_memory_budget) {
+			evict_unused();
+		}
+
+		return get_pending_uploads();
+	}
+
+	void resource_store::finish_uploads() {
+		for (auto& upload : m_pending) {
+			upload.staged.wait();
+			m_finish_upload(upload);
+		}
+
+		m_pending.clear();
+
+		for (auto& link : m_linking) {
+			m_finish_link(link);
+		}
+
+		m_linking.clear();
+	}
+
+	std::size_t resource_store::get_pending_uploads() const {
+		return m_pending.size() + m_linking.size();
+	}
+
+	std::size_t resource_store::get_pending_loads(const resource_manifest_t& manifest) const {
+		// a slot missing here was never declared or its load failed, neither is worth waiting for
+		auto count = [](const auto& slots, const std::vector<std::string>& names) {
+			std::size_t pending = 0;
+
+			for (const auto& name : names) {
+				auto it = slots.find(name);
+				if (it != slots.end() && !is_ready(it->second.future)) {
+					pending++;
+				}
+			}
+
+			return pending;
+		};
+
+		return count(m_shaders, manifest.shaders) + count(m_textures, manifest.textures) + count(m_meshes, manifest.meshes);
+	}
+
+	std::size_t resource_store::evict_unused() {
+		// last use, then the function dropping the slot and returning the bytes it held
+		std::vector<std::pair<uint64_t, std::function<std::size_t()>>> candidates;
+
+		auto collect = [&candidates](auto& slots, const std::vector<std::string>& pinned) {
+			for (auto& [name, slot] : slots) {
+				if (!is_ready(slot.future) || std::find(pinned.begin(), pinned.end(), name) != pinned.end()) {
+					continue;
+				}
+
+				// the handle inside the future has to be the last one
+				if (slot.future.get().use_count() > 1) {
+					continue;
+				}
+
+				candidates.push_back({ slot.last_used, [&slots, key = name]() {
+					auto it = slots.find(key);
+					const std::size_t bytes = it->second.bytes;
+
+					slots.erase(it);
+					return bytes;
+				} });
+			}
+		};
+
+		collect(m_shaders, m_manifest.shaders);
+		collect(m_textures, m_manifest.textures);
+		collect(m_cubemaps, m_manifest.cubemaps);
+		collect(m_meshes, m_manifest.meshes);
+
+		std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+			return a.first < b.first;
+		});
+
+		std::size_t freed = 0;
+
+		for (auto& candidate : candidates) {
+			if (m_resident_bytes <= m_memory_budget) {
+				break;
+			}
+
+			const std::size_t bytes = candidate.second();
+			m_resident_bytes -= bytes;
+			freed += bytes;
+		}
+
+		return freed;
+	}
+
+	void resource_store::set_memory_budget(std::size_t bytes) {
+		m_memory_budget = bytes;
+	}
+
+	std::size_t resource_store::get_memory_budget() const {
+		return m_memory_budget;
+	}
+
+	std::size_t resource_store::get_resident_bytes() const {
+		return m_resident_bytes;
+	}
+
+	std::size_t resource_store::get_resident_bytes(const resource_manifest_t& manifest) const {
+		// loads still in flight have not been counted yet
+		auto sum = [](const auto& slots, const std::vector<std::string>& names) {
+			std::size_t bytes = 0;
+
+			for (const auto& name : names) {
+				auto it = slots.find(name);
+				if (it != slots.end()) {
+					bytes += it->second.bytes;
+				}
+			}
+
+			return bytes;
+		};
+
+		return sum(m_shaders, manifest.shaders) + sum(m_textures, manifest.textures) + 
+			sum(m_cubemaps, manifest.cubemaps) + sum(m_meshes, manifest.meshes);
+	}
+
+	shader_handle_t resource_store::get_shader(const std::string& name) {
+		if (m_shaders.find(name) == m_shaders.end()) {
+			auto it = m_shader_files.find(name);
+			if (it == m_shader_files.end()) {
+				return nullptr;
+			}
+
+			m_load_shader_async(name, it->second);
+		}
+
+		return m_get(m_shaders, name);
+	}
+
+	texture_handle_t resource_store::get_texture(const std::string& name) {
+		if (m_textures.find(name) == m_textures.end()) {
+			auto it = m_texture_files.find(name);
+			if (it == m_texture_files.end()) {
+				return nullptr;
+			}
+
+			m_load_texture_async(name, it->second);
+		}
+
+		return m_get(m_textures, name);
+	}
+
+	cubemap_future_t resource_store::get_cubemap(const std::string& name) {
+		auto it = m_cubemaps.find(name);
+
+		if (it == m_cubemaps.end()) {
+			auto sides = m_cubemap_files.find(name);
+			if (sides == m_cubemap_files.end()) {
+				return cubemap_future_t();
+			}
+
+			return m_load_cubemap_async(name, sides->second);
+		}
+
+		it->second.last_used = ++m_use_clock;
+		return it->second.future;
+	}
+
+	std::array<std::string, 6> resource_store::get_cubemap_files(const std::string& name) const {
+		auto it = m_cubemap_files.find(name);
+		return it != m_cubemap_files.end() ? it->second : std::array<std::string, 6>();
+	}
+
+	mesh_handle_t resource_store::get_mesh(const std::string& name) {
+		if (m_meshes.find(name) == m_meshes.end()) {
+			auto it = m_mesh_files.find(name);
+			if (it == m_mesh_files.end()) {
+				return nullptr;
+			}
+
+			m_load_mesh_async(name, it->second);
 		}
 
-		return nullptr;
+		return m_get(m_meshes, name);
 	}
 
-	resource_store::resource_store() {}
+	resource_store::resource_store() :
+		m_memory_budget(DEFAULT_MEMORY_BUDGET),
+		m_resident_bytes(0),
+		m_use_clock(0),
+		m_texture_cache(),
+		m_shader_cache(),
+		m_workers() {
+
+		shader_program::enable_parallel_compile();
+	}
 
 	std::string resource_store::m_read_file_content(const std::string& path) const {
 		std::ifstream stream(path);
@@ -161,11 +521,276 @@ namespace mini {
 		throw std::runtime_error("failed to read file " + path);
 	}
 
-	void resource_store::m_add_shader(const std::string& name, shader_handle_t shader) {
-		m_shaders[name] = shader;
+	shader_future_t resource_store::m_load_shader_async(const std::string& name, const shader_files_t& files) {
+		// a load in flight or done is shared
+		auto it = m_shaders.find(name);
+		if (it != m_shaders.end()) {
+			return it->second.future;
+		}
+
+		auto promise = std::make_shared<std::promise<shader_handle_t>>();
+		shader_future_t result = promise->get_future().share();
+
+		auto& slot = m_shaders[name];
+		slot.future = result;
+		slot.last_used = ++m_use_clock;
+
+		m_enqueue(name, [this, name, files, promise]() -> upload_t {
+			const auto sources = m_read_shader_sources(files);
+			const auto key = m_shader_cache.get_key(sources);
+
+			auto binary = std::make_shared<shader_cache::binary_t>();
+			if (!m_shader_cache.load(key, *binary)) {
+				binary = nullptr;
+			}
+
+			return [this, name, sources, key, binary, promise]() {
+				auto shader = m_create_shader(sources);
+
+				if (binary && shader->load_binary(binary->format, binary->data)) {
+					m_set_resident(m_shaders, name, m_program_bytes(shader.get()));
+					promise->set_value(shader);
+					return;
+				}
+
+				// the result is picked up by process_uploads once the driver is done
+				shader->begin_compile();
+				m_linking.push_back({ name, key, shader, promise });
+			};
+		}, [this, name, promise](std::exception_ptr error) {
+			// forget the failed request so asking again retries
+			m_shaders.erase(name);
+			promise->set_exception(error);
+		});
+
+		return result;
 	}
 
-	void resource_store::m_add_texture(const std::string& name, texture_handle_t texture) {
-		m_textures[name] = texture;
+	texture_future_t resource_store::m_load_texture_async(const std::string& name, const std::string& file) {
+		auto it = m_textures.find(name);
+		if (it != m_textures.end()) {
+			return it->second.future;
+		}
+
+		auto promise = std::make_shared<std::promise<texture_handle_t>>();
+		texture_future_t result = promise->get_future().share();
+
+		auto& slot = m_textures[name];
+		slot.future = result;
+		slot.last_used = ++m_use_clock;
+
+		m_enqueue(name, [this, name, file, promise]() -> upload_t {
+			auto image = m_texture_cache.load(file);
+
+			return [this, name, promise, image]() {
+				auto handle = std::make_shared<texture>(*image);
+
+				m_set_resident(m_textures, name, m_image_bytes(*image));
+				promise->set_value(handle);
+			};
+		}, [this, name, promise](std::exception_ptr error) {
+			m_textures.erase(name);
+			promise->set_exception(error);
+		});
+
+		return result;
+	}
+
+	cubemap_future_t resource_store::m_load_cubemap_async(const std::string& name, const std::array<std::string, 6>& sides) {
+		auto it = m_cubemaps.find(name);
+		if (it != m_cubemaps.end()) {
+			return it->second.future;
+		}
+
+		auto promise = std::make_shared<std::promise<cubemap_handle_t>>();
+		cubemap_future_t result = promise->get_future().share();
+
+		auto& slot = m_cubemaps[name];
+		slot.future = result;
+		slot.last_used = ++m_use_clock;
+
+		auto job = std::make_shared<cubemap_job_t>();
+
+		for (auto side = 0UL; side < sides.size(); ++side) {
+			m_enqueue(name, [this, job, side, path = sides[side], name, promise]() -> upload_t {
+				try {
+					job->faces[side] = m_texture_cache.load(path);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(job->mutex);
+					if (!job->error) {
+						job->error = std::current_exception();
+					}
+				}
+
+				if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+					return nullptr;
+				}
+
+				return [this, job, name, promise]() {
+					if (job->error) {
+						std::rethrow_exception(job->error);
+					}
+
+					// only the top level of each face is uploaded
+					std::size_t bytes = 0;
+					for (const auto& face : job->faces) {
+						bytes += static_cast<std::size_t>(face->get_width()) * face->get_height() * 4;
+					}
+
+					m_set_resident(m_cubemaps, name, bytes);
+					promise->set_value(std::make_shared<cubemap>(job->faces));
+				};
+			}, [this, name, promise](std::exception_ptr error) {
+				m_cubemaps.erase(name);
+				promise->set_exception(error);
+			});
+		}
+
+		return result;
+	}
+
+	mesh_future_t resource_store::m_load_mesh_async(const std::string& name, const mesh_file_t& file) {
+		auto it = m_meshes.find(name);
+		if (it != m_meshes.end()) {
+			return it->second.future;
+		}
+
+		auto promise = std::make_shared<std::promise<mesh_handle_t>>();
+		mesh_future_t result = promise->get_future().share();
+
+		auto& slot = m_meshes[name];
+		slot.future = result;
+		slot.last_used = ++m_use_clock;
+
+		m_enqueue(name, [this, name, file, promise]() -> upload_t {
+			auto data = std::make_shared<triangle_mesh::mesh_data_t>(
+				triangle_mesh::read_data_from_file(file.file, file.offset, file.scale));
+
+			return [this, name, promise, data]() {
+				auto handle = std::make_shared<triangle_mesh>(std::move(*data));
+
+				m_set_resident(m_meshes, name, m_mesh_bytes(*handle));
+				promise->set_value(handle);
+			};
+		}, [this, name, promise](std::exception_ptr error) {
+			m_meshes.erase(name);
+			promise->set_exception(error);
+		});
+
+		return result;
+	}
+
+	std::shared_ptr<shader_program> resource_store::m_create_shader(const shader_cache::sources_t& sources) {
+		auto shader = std::make_shared<shader_program>(sources[0], sources[1]);
+
+		if (!sources[2].empty()) {
+			shader->set_tesselation_source(sources[2], sources[3]);
+		}
+
+		if (!sources[4].empty()) {
+			shader->set_geometry_source(sources[4]);
+		}
+
+		return shader;
+	}
+
+	void resource_store::m_store_binary(uint64_t key, const shader_program& shader) {
+		auto binary = std::make_shared<shader_cache::binary_t>();
+
+		if (!m_shader_cache.is_enabled() || !shader.get_binary(binary->format, binary->data)) {
+			return;
+		}
+
+		// the write is left to a worker, nothing waits for it
+		m_workers.submit([this, key, binary]() {
+			m_shader_cache.store(key, *binary);
+		});
+	}
+
+	void resource_store::m_finish_link(pending_link_t& link) {
+		shader_handle_t shader = link.shader;
+
+		try {
+			shader->finish_compile();
+			m_store_binary(link.key, *shader);
+		} catch (const shader_error& error) {
+			std::cerr << error.what() << " log: " << std::endl << error.get_log() << std::endl;
+			shader = nullptr;
+		}
+
+		m_set_resident(m_shaders, link.name, m_program_bytes(shader.get()));
+		link.promise->set_value(shader);
+	}
+
+	void resource_store::m_wait_for(const std::string& name) {
+		for (auto it = m_pending.begin(); it != m_pending.end(); ) {
+			if (it->name != name) {
+				++it;
+				continue;
+			}
+
+			it->staged.wait();
+			m_finish_upload(*it);
+			it = m_pending.erase(it);
+		}
+
+		// including programs the uploads above just started
+		for (auto it = m_linking.begin(); it != m_linking.end(); ) {
+			if (it->name != name) {
+				++it;
+				continue;
+			}
+
+			m_finish_link(*it);
+			it = m_linking.erase(it);
+		}
+	}
+
+	std::size_t resource_store::m_program_bytes(const shader_program* shader) {
+		if (!shader || !shader->is_ready()) {
+			return 0;
+		}
+
+		// the size of the driver's own copy is the closest estimate there is
+		GLint length = 0;
+		glGetProgramiv(shader->get_program_handle(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+		return static_cast<std::size_t>(std::max(length, 0));
+	}
+
+	std::size_t resource_store::m_image_bytes(const baked_image& image) {
+		std::size_t bytes = 0;
+
+		for (auto level = 0UL; level < image.get_num_levels(); ++level) {
+			const auto& info = image.get_level(level);
+			bytes += static_cast<std::size_t>(info.width) * info.height * 4;
+		}
+
+		return bytes;
+	}
+
+	std::size_t resource_store::m_mesh_bytes(const triangle_mesh& mesh) {
+		return mesh.get_vertices().size() * sizeof(triangle_mesh::vertex_t) + mesh.get_indices().size() * sizeof(uint32_t);
+	}
+
+	void resource_store::m_enqueue(
+		const std::string& name,
+		std::function<upload_t()> stage,
+		std::function<void(std::exception_ptr)> fail) {
+
+		m_pending.push_back({ name, m_workers.submit(std::move(stage)), std::move(fail) });
+	}
+
+	void resource_store::m_finish_upload(pending_upload_t& upload) {
+		try {
+			upload_t gl_stage = upload.staged.get();
+
+			if (gl_stage) {
+				gl_stage();
+			}
+		} catch (const std::exception& error) {
+			std::cerr << "failed to load " << upload.name << ": " << error.what() << std::endl;
+			upload.fail(std::current_exception());
+		}
 	}
 }
\ No newline at end of file
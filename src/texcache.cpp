@@ -0,0 +1,380 @@
+#include "texcache.hpp"
+#include "threadpool.hpp"
+
+#include <lodepng.h>
+
+#include <ios>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+
+namespace mini {
+	namespace {
+		struct file_header_t {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t source_size;
+			int64_t source_time;
+			uint64_t source_hash;
+			uint32_t num_levels;
+			uint32_t reserved;
+		};
+
+		struct level_header_t {
+			uint32_t width, height;
+			uint64_t offset;
+		};
+
+		constexpr uint32_t MAX_LEVELS = 32;
+	}
+
+	baked_image::baked_image(uint32_t width, uint32_t height, const std::vector<unsigned char>& pixels) {
+		// size the storage up front, the level pointers go into it
+		std::vector<std::pair<uint32_t, uint32_t>> sizes = { { width, height } };
+		std::size_t total = static_cast<std::size_t>(width) * height * 4;
+
+		while (sizes.back().first > 1 || sizes.back().second > 1) {
+			const uint32_t w = std::max(sizes.back().first / 2, 1U);
+			const uint32_t h = std::max(sizes.back().second / 2, 1U);
+
+			sizes.push_back({ w, h });
+			total += static_cast<std::size_t>(w) * h * 4;
+		}
+
+		m_storage.resize(total);
+		std::copy(pixels.begin(), pixels.begin() + static_cast<std::size_t>(width) * height * 4, m_storage.begin());
+
+		unsigned char* level_data = m_storage.data();
+		m_levels.push_back({ width, height, level_data });
+
+		// 2x2 box filter, odd edges repeat the last row or column
+		for (auto level = 1UL; level < sizes.size(); ++level) {
+			const auto& src = m_levels.back();
+			unsigned char* src_data = level_data;
+			level_data += static_cast<std::size_t>(src.width) * src.height * 4;
+
+			const auto [w, h] = sizes[level];
+
+			for (uint32_t y = 0; y < h; ++y) {
+				const uint32_t y0 = std::min(2 * y, src.height - 1);
+				const uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+
+				for (uint32_t x = 0; x < w; ++x) {
+					const uint32_t x0 = std::min(2 * x, src.width - 1);
+					const uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+
+					for (uint32_t c = 0; c < 4; ++c) {
+						const uint32_t sum =
+							src_data[(y0 * src.width + x0) * 4 + c] + src_data[(y0 * src.width + x1) * 4 + c] +
+							src_data[(y1 * src.width + x0) * 4 + c] + src_data[(y1 * src.width + x1) * 4 + c];
+
+						level_data[(y * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+					}
+				}
+			}
+
+			m_levels.push_back({ w, h, level_data });
+		}
+	}
+
+	baked_image::baked_image(std::shared_ptr<mapped_file> file, std::vector<level_t> levels) :
+		m_file(file),
+		m_levels(std::move(levels)) {}
+
+	uint32_t baked_image::get_width() const {
+		return m_levels.front().width;
+	}
+
+	uint32_t baked_image::get_height() const {
+		return m_levels.front().height;
+	}
+
+	std::size_t baked_image::get_num_levels() const {
+		return m_levels.size();
+	}
+
+	const baked_image::level_t& baked_image::get_level(std::size_t level) const {
+		return m_levels[level];
+	}
+
+	texture_cache::texture_cache(const std::string& directory) : m_directory(directory) {}
+
+	std::string texture_cache::get_cache_path(const std::string& source) const {
+		// the stem keeps the directory readable, the path hash keeps equal names apart
+		const auto stem = std::filesystem::path(source).stem().string();
+		const auto key = m_hash(reinterpret_cast<const unsigned char*>(source.data()), source.size());
+
+		char suffix[17];
+		std::snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(key));
+
+		return (std::filesystem::path(m_directory) / (stem + "-" + suffix + ".sftx")).string();
+	}
+
+	std::shared_ptr<const baked_image> texture_cache::load(const std::string& source) const {
+		const std::string path = get_cache_path(source);
+		source_stamp_t stamp = m_stamp(source);
+
+		if (auto cached = m_load_cached(path, source, stamp)) {
+			return cached;
+		}
+
+		const std::vector<unsigned char> bytes = m_read_bytes(source);
+		stamp.hash = m_hash(bytes.data(), bytes.size());
+
+		std::vector<unsigned char> pixels;
+		unsigned int width, height;
+		unsigned int error = lodepng::decode(pixels, width, height, bytes);
+
+		if (error != 0) {
+			throw std::runtime_error("failed to load texture: " + std::string(lodepng_error_text(error)));
+		}
+
+		auto image = std::make_shared<baked_image>(width, height, pixels);
+
+		// a read only cache directory only costs the next start its decode
+		try {
+			m_write(path, stamp, *image);
+		} catch (const std::exception& e) {
+			std::cerr << "cannot write texture cache " << path << ": " << e.what() << std::endl;
+		}
+
+		return image;
+	}
+
+	int texture_cache::run_headless(int argc, char** argv) {
+		const std::string directory = argc > 2 ? argv[2] : "textures";
+
+		std::vector<std::string> sources;
+		std::error_code error;
+
+		for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+			it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+
+			if (it->is_regular_file() && it->path().extension() == ".png") {
+				sources.push_back(it->path().generic_string());
+			}
+		}
+
+		if (error) {
+			std::cerr << "cannot list " << directory << ": " << error.message() << std::endl;
+			return 1;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		texture_cache cache;
+		thread_pool pool;
+		std::vector<std::string> failures(sources.size());
+
+		pool.parallel_for(0, sources.size(), 1, [&](std::size_t first, std::size_t last) {
+			for (auto i = first; i < last; ++i) {
+				try {
+					cache.load(sources[i]);
+				} catch (const std::exception& e) {
+					failures[i] = e.what();
+				}
+			}
+		});
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		int result = 0;
+		for (auto i = 0UL; i < sources.size(); ++i) {
+			if (!failures[i].empty()) {
+				std::cerr << sources[i] << ": " << failures[i] << std::endl;
+				result = 1;
+			}
+		}
+
+		std::cout << "baked " << sources.size() << " textures in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+		return result;
+	}
+
+	std::shared_ptr<const baked_image> texture_cache::m_load_cached(
+		const std::string& path,
+		const std::string& source,
+		const source_stamp_t& stamp) const {
+
+		std::error_code error;
+		if (!std::filesystem::exists(path, error)) {
+			return nullptr;
+		}
+
+		auto is_current = [&stamp](const file_header_t& header) {
+			return header.magic == MAGIC && header.version == VERSION && header.source_size == stamp.size;
+		};
+
+		// the header is checked before the file is mapped, a mapped file cannot be restamped
+		file_header_t header;
+
+		{
+			std::ifstream stream(path, std::ios::binary);
+			if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || !is_current(header)) {
+				return nullptr;
+			}
+		}
+
+		// a touched but unchanged source, e.g. after a checkout, is still a hit, and the new
+		// time goes into the header so the next start does not hash it again
+		if (header.source_time != stamp.time) {
+			const auto bytes = m_read_bytes(source);
+			if (header.source_hash != m_hash(bytes.data(), bytes.size())) {
+				return nullptr;
+			}
+
+			m_restamp(path, stamp.time);
+		}
+
+		std::shared_ptr<mapped_file> file;
+
+		try {
+			file = std::make_shared<mapped_file>(path);
+		} catch (const std::exception&) {
+			return nullptr;
+		}
+
+		const unsigned char* data = file->get_data();
+		const std::size_t size = file->get_size();
+
+		// another thread may have baked the file anew in the meantime
+		if (size < sizeof(header)) {
+			return nullptr;
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+
+		if (!is_current(header)) {
+			return nullptr;
+		}
+
+		if (header.num_levels == 0 || header.num_levels > MAX_LEVELS ||
+			size < sizeof(header) + header.num_levels * sizeof(level_header_t)) {
+			return nullptr;
+		}
+
+		std::vector<baked_image::level_t> levels;
+
+		for (auto level = 0UL; level < header.num_levels; ++level) {
+			level_header_t info;
+			std::memcpy(&info, data + sizeof(header) + level * sizeof(info), sizeof(info));
+
+			const uint64_t bytes = static_cast<uint64_t>(info.width) * info.height * 4;
+			if (info.offset > size || bytes > size - info.offset) {
+				return nullptr;
+			}
+
+			levels.push_back({ info.width, info.height, data + info.offset });
+		}
+
+		return std::make_shared<baked_image>(file, std::move(levels));
+	}
+
+	void texture_cache::m_write(const std::string& path, const source_stamp_t& stamp, const baked_image& image) const {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+
+		file_header_t header = {};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.source_size = stamp.size;
+		header.source_time = stamp.time;
+		header.source_hash = stamp.hash;
+		header.num_levels = static_cast<uint32_t>(image.get_num_levels());
+
+		std::vector<level_header_t> levels(image.get_num_levels());
+		uint64_t offset = sizeof(header) + levels.size() * sizeof(level_header_t);
+
+		for (auto level = 0UL; level < levels.size(); ++level) {
+			const auto& info = image.get_level(level);
+
+			levels[level] = { info.width, info.height, offset };
+			offset += static_cast<uint64_t>(info.width) * info.height * 4;
+		}
+
+		// written aside and renamed, so a reader never maps half a file
+		const auto thread_key = std::hash<std::thread::id>()(std::this_thread::get_id());
+		const std::string temp_path = path + "." + std::to_string(thread_key) + ".tmp";
+
+		{
+			std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+			if (!stream) {
+				throw std::runtime_error("cannot open file: " + temp_path);
+			}
+
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			stream.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(level_header_t));
+
+			for (auto level = 0UL; level < levels.size(); ++level) {
+				const auto& info = image.get_level(level);
+				stream.write(reinterpret_cast<const char*>(info.data), static_cast<std::streamsize>(info.width) * info.height * 4);
+			}
+
+			if (!stream) {
+				throw std::runtime_error("failed to write " + temp_path);
+			}
+		}
+
+		std::filesystem::rename(temp_path, path);
+	}
+
+	void texture_cache::m_restamp(const std::string& path, int64_t time) {
+		std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+
+		if (stream) {
+			stream.seekp(offsetof(file_header_t, source_time));
+			stream.write(reinterpret_cast<const char*>(&time), sizeof(time));
+		}
+
+		// a read only cache directory only costs the next start another hash
+		if (!stream) {
+			std::cerr << "cannot restamp texture cache " << path << std::endl;
+		}
+	}
+
+	texture_cache::source_stamp_t texture_cache::m_stamp(const std::string& source) {
+		std::error_code error;
+		const auto size = std::filesystem::file_size(source, error);
+
+		if (error) {
+			throw std::runtime_error("cannot open file: " + source);
+		}
+
+		const auto time = std::filesystem::last_write_time(source, error);
+
+		source_stamp_t stamp;
+		stamp.size = static_cast<uint64_t>(size);
+		stamp.time = error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+		stamp.hash = 0;
+
+		return stamp;
+	}
+
+	std::vector<unsigned char> texture_cache::m_read_bytes(const std::string& path) {
+		std::ifstream stream(path, std::ios::binary);
+
+		if (!stream) {
+			throw std::runtime_error("cannot open file: " + path);
+		}
+
+		return std::vector<unsigned char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	uint64_t texture_cache::m_hash(const unsigned char* data, std::size_t size) {
+		// 64 bit fnv-1a
+		uint64_t hash = 14695981039346656037ULL;
+
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+}
\ No newline at end of file
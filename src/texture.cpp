@@ -81,6 +81,30 @@ namespace mini {
 		m_initialize ();
 	}
 
+	texture::texture (const baked_image & image, GLenum min_filter, GLenum mag_filter) {
+		m_width = image.get_width ();
+		m_height = image.get_height ();
+		m_mipmap_levels = static_cast<uint32_t> (image.get_num_levels ());
+		m_min_filter = min_filter;
+		m_mag_filter = mag_filter;
+		m_format = GL_RGBA;
+
+		glGenTextures (1, &m_texture);
+		glBindTexture (GL_TEXTURE_2D, m_texture);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_min_filter);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_mag_filter);
+		glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipmap_levels - 1);
+
+		for (uint32_t level = 0; level < m_mipmap_levels; ++level) {
+			const auto & info = image.get_level (level);
+			glTexImage2D (GL_TEXTURE_2D, level, GL_RGBA, info.width, info.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, info.data);
+		}
+
+		glBindTexture (GL_TEXTURE_2D, static_cast<GLuint>(NULL));
+	}
+
 	texture::~texture () {
 		glDeleteTextures (1, &m_texture);
 	}
@@ -102,6 +126,22 @@ namespace mini {
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 
+	void texture::update(unsigned char* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+		// data holds only the rectangle, its rows tightly packed
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		glTexSubImage2D(
+			GL_TEXTURE_2D,
+			0, x, y, width, height,
+			m_format,
+			GL_UNSIGNED_BYTE,
+			data);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
 	void texture::m_initialize () {
 		glGenTextures (1, &m_texture);
 
@@ -117,6 +157,13 @@ namespace mini {
 	}
 
 	std::shared_ptr<texture> texture::load_from_file (const std::string & file) {
+		uint32_t width, height;
+		std::vector<unsigned char> data = decode_file (file, width, height);
+
+		return std::make_shared<texture> (width, height, data.data (), GL_RGBA);
+	}
+
+	std::vector<unsigned char> texture::decode_file (const std::string & file, uint32_t & width, uint32_t & height) {
 		std::fstream stream (file, std::ios::binary | std::ios::in);
 
 		if (!stream) {
@@ -134,14 +181,12 @@ namespace mini {
 		stream.close ();
 
 		std::vector<unsigned char> data;
-		unsigned int width, height;
-
 		unsigned int error = lodepng::decode (data, width, height, buffer);
 
 		if (error != 0) { // failed to load image
 			throw std::runtime_error ("failed to load texture: " + std::string (lodepng_error_text (error)));
 		}
 
-		return std::make_shared<texture> (width, height, data.data (), GL_RGBA);
+		return data;
 	}
 }
@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include "threadpool.hpp"
+
+namespace mini {
+	thread_pool::thread_pool(std::size_t num_threads) : m_stopping(false) {
+		if (num_threads == 0) {
+			num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+		}
+
+		m_workers.reserve(num_threads);
+		for (std::size_t i = 0; i < num_threads; ++i) {
+			m_workers.emplace_back(&thread_pool::m_worker_loop, this);
+		}
+	}
+
+	thread_pool::~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+
+		m_condition.notify_all();
+
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	std::size_t thread_pool::get_num_threads() const {
+		return m_workers.size();
+	}
+
+	void thread_pool::parallel_for(std::size_t begin, std::size_t end, std::size_t grain, 
+		const std::function<void(std::size_t, std::size_t)>& body) {
+
+		if (end <= begin) {
+			return;
+		}
+
+		// a few chunks per worker even out uneven items
+		const std::size_t count = end - begin;
+		const std::size_t chunks = std::max<std::size_t>(1, std::min(count / std::max<std::size_t>(grain, 1), 
+			4 * m_workers.size()));
+		const std::size_t chunk_size = (count + chunks - 1) / chunks;
+
+		std::vector<std::future<void>> pending;
+		pending.reserve(chunks);
+
+		for (std::size_t first = begin; first < end; first += chunk_size) {
+			const std::size_t last = std::min(first + chunk_size, end);
+			pending.push_back(submit([&body, first, last]() { body(first, last); }));
+		}
+
+		for (auto& task : pending) {
+			task.get();
+		}
+	}
+
+	void thread_pool::m_worker_loop() {
+		while (true) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+				// queued work is still finished when the pool shuts down
+				if (m_tasks.empty()) {
+					return;
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+}
\ No newline at end of file